@@ -0,0 +1,101 @@
+#include "OpenStreetMap.h"
+#include "XMLBusSystem.h"
+#include "StringDataSource.h"
+#include <malloc.h>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+// Prints where the memory of a loaded map and bus system goes, next to what malloc reports
+// Usage: memorybench [map.osm] [busroutes.xml] [busstoppaths.xml]
+
+static std::string ReadFile(const std::string &path){
+    std::ifstream Input(path, std::ios::binary);
+    std::stringstream Buffer;
+    Buffer << Input.rdbuf();
+    return Buffer.str();
+}
+
+static std::shared_ptr<CXMLReader> MakeReader(const std::string &contents){
+    return std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(contents));
+}
+
+static std::size_t HeapInUse(){
+    return mallinfo2().uordblks;
+}
+
+static void PrintLine(const std::string &name, std::size_t bytes, std::size_t total){
+    std::cout << "  " << std::left << std::setw(22) << name << std::right << std::setw(12) << bytes
+              << std::setw(8) << std::fixed << std::setprecision(1) << (total ? 100.0 * bytes / total : 0.0) << "%" << std::endl;
+}
+
+static void BenchMap(const std::string &name, const std::string &contents, const COpenStreetMap::SOptions &options){
+    auto Before = HeapInUse();
+    COpenStreetMap Map(MakeReader(contents), options);
+    auto Heap = HeapInUse() - Before;
+    auto Report = Map.MemoryUsage();
+    auto Total = Report.Total();
+    std::cout << name << ": " << Map.NodeCount() << " nodes, " << Map.WayCount() << " ways" << std::endl;
+    PrintLine("nodes", Report.DNodes, Total);
+    PrintLine("node tags", Report.DNodeTags, Total);
+    PrintLine("node ID index", Report.DNodeIndex, Total);
+    PrintLine("ways", Report.DWays, Total);
+    PrintLine("way references", Report.DWayReferences, Total);
+    PrintLine("way tags", Report.DWayTags, Total);
+    PrintLine("way ID index", Report.DWayIndex, Total);
+    PrintLine("strings", Report.DStrings, Total);
+    PrintLine("search indexes", Report.DSearchIndexes, Total);
+    PrintLine("allocator overhead", Report.DAllocatorOverhead, Total);
+    PrintLine("total", Total, Total);
+    std::cout << "  malloc in use " << Heap << std::endl;
+    auto NodeBytes = Report.DNodes + Report.DNodeTags + Report.DNodeIndex;
+    auto WayBytes = Report.DWays + Report.DWayReferences + Report.DWayTags + Report.DWayIndex;
+    std::cout << std::setprecision(2);
+    std::cout << "  bytes/node " << (Map.NodeCount() ? double(NodeBytes) / Map.NodeCount() : 0.0) << std::endl;
+    std::cout << "  bytes/way " << (Map.WayCount() ? double(WayBytes) / Map.WayCount() : 0.0) << std::endl;
+}
+
+int main(int argc, char *argv[]){
+    std::string MapPath = argc > 1 ? argv[1] : "data/city.osm";
+    std::string RoutesPath = argc > 2 ? argv[2] : "data/busroutes.xml";
+    std::string PathsPath = argc > 3 ? argv[3] : "data/busstoppaths.xml";
+
+    auto MapContents = ReadFile(MapPath);
+    if(MapContents.empty()){
+        std::cerr << "Cannot read " << MapPath << std::endl;
+        return 1;
+    }
+    COpenStreetMap::SOptions Options;
+    BenchMap("default", MapContents, Options);
+    Options.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    Options.DWayNodeStorage = COpenStreetMap::EWayNodeStorage::Compressed;
+    Options.DTagDecoding = COpenStreetMap::ETagDecoding::Lazy;
+    BenchMap("fixed point, compressed, lazy tags", MapContents, Options);
+    Options.DIndexType = CIDIndex::EType::OpenAddressing;
+    Options.DBuildWayRTree = true;
+    Options.DBuildNodeKDTree = true;
+    Options.DBuildTagIndex = true;
+    BenchMap("compact with search indexes", MapContents, Options);
+
+    auto Routes = ReadFile(RoutesPath);
+    auto Paths = ReadFile(PathsPath);
+    auto Before = HeapInUse();
+    // The bus system loader logs every stop, keep that out of the report
+    auto Previous = std::cout.rdbuf(nullptr);
+    CXMLBusSystem BusSystem(MakeReader(Routes), MakeReader(Paths));
+    std::cout.rdbuf(Previous);
+    std::cout.clear();
+    auto Heap = HeapInUse() - Before;
+    auto Report = BusSystem.MemoryUsage();
+    auto Total = Report.Total();
+    std::cout << "bus system: " << BusSystem.StopCount() << " stops, " << BusSystem.RouteCount() << " routes" << std::endl;
+    PrintLine("stops", Report.DStops, Total);
+    PrintLine("stop indexes", Report.DStopIndexes, Total);
+    PrintLine("routes", Report.DRoutes, Total);
+    PrintLine("paths", Report.DPaths, Total);
+    PrintLine("allocator overhead", Report.DAllocatorOverhead, Total);
+    PrintLine("total", Total, Total);
+    std::cout << "  malloc in use " << Heap << std::endl;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BINARYCOLUMNIO_H
+#define BINARYCOLUMNIO_H
+
+#include "DataSource.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+//Helpers for the Save/Load formats that write a header then raw columns in native byte order
+
+//Appends size raw bytes from data to buffer
+inline void AppendBytes(std::vector<char> &buffer, const void *data, std::size_t size){
+    auto Bytes = static_cast<const char *>(data);
+    buffer.insert(buffer.end(), Bytes, Bytes + size);
+}
+
+template <typename T>
+void AppendValue(std::vector<char> &buffer, const T &value){
+    AppendBytes(buffer, &value, sizeof(T));
+}
+
+template <typename T>
+void AppendColumn(std::vector<char> &buffer, std::span<const T> values){
+    AppendBytes(buffer, values.data(), values.size() * sizeof(T));
+}
+
+template <typename T>
+void AppendColumn(std::vector<char> &buffer, const std::vector<T> &values){
+    AppendColumn(buffer, std::span<const T>(values));
+}
+
+//Reads exactly size bytes from source into data
+inline bool ReadExact(std::shared_ptr<CDataSource> source, void *data, std::size_t size){
+    std::vector<char> Buffer;
+    auto Bytes = static_cast<char *>(data);
+    while(size){
+        if(!source->Read(Buffer, size)){
+            return false;
+        }
+        std::memcpy(Bytes, Buffer.data(), Buffer.size());
+        Bytes += Buffer.size();
+        size -= Buffer.size();
+    }
+    return true;
+}
+
+//Replaces values with count values read from source
+//Reads a bounded chunk at a time, so a count from a truncated or corrupt header fails on the missing data instead of allocating it all up front
+template <typename T>
+bool ReadColumn(std::shared_ptr<CDataSource> source, std::vector<T> &values, std::size_t count){
+    const std::size_t ChunkValues = std::size_t(1) << 16;
+    values.clear();
+    while(values.size() < count){
+        auto Start = values.size();
+        auto Chunk = std::min(ChunkValues, count - Start);
+        values.resize(Start + Chunk);
+        if(!ReadExact(source, values.data() + Start, Chunk * sizeof(T))){
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+//Fixed capacity lock-free queue for any number of producer and consumer threads
+//Each slot carries a sequence number telling whether it is ready to be written or read,
+//so producers and consumers only contend on their own position counter
+template <typename T>
+class CBoundedQueue{
+    private:
+        struct SSlot{
+            std::atomic<std::size_t> DSequence;
+            T DValue;
+        };
+
+        //Positions on separate cache lines so producers and consumers do not false share
+        alignas(64) std::atomic<std::size_t> DPushPosition{0};
+        alignas(64) std::atomic<std::size_t> DPopPosition{0};
+        alignas(64) std::size_t DMask;
+        std::unique_ptr<SSlot[]> DSlots;
+
+    public:
+        //capacity is rounded up to a power of two
+        explicit CBoundedQueue(std::size_t capacity){
+            std::size_t Capacity = 2;
+            while(Capacity < capacity){
+                Capacity *= 2;
+            }
+            DMask = Capacity - 1;
+            DSlots = std::make_unique<SSlot[]>(Capacity);
+            for(std::size_t Index = 0; Index < Capacity; Index++){
+                DSlots[Index].DSequence.store(Index, std::memory_order_relaxed);
+            }
+        }
+
+        CBoundedQueue(const CBoundedQueue &) = delete;
+        CBoundedQueue &operator=(const CBoundedQueue &) = delete;
+
+        std::size_t Capacity() const noexcept{
+            return DMask + 1;
+        }
+
+        //Moves value in and returns true, or returns false leaving value untouched if the queue is full
+        bool TryPush(T &value){
+            auto Position = DPushPosition.load(std::memory_order_relaxed);
+            while(true){
+                auto &Slot = DSlots[Position & DMask];
+                auto Sequence = Slot.DSequence.load(std::memory_order_acquire);
+                auto Difference = static_cast<std::ptrdiff_t>(Sequence) - static_cast<std::ptrdiff_t>(Position);
+                if(Difference == 0){
+                    if(DPushPosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)){
+                        Slot.DValue = std::move(value);
+                        Slot.DSequence.store(Position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(Difference < 0){
+                    return false;
+                }
+                else{
+                    Position = DPushPosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //Moves the oldest value out and returns true, or returns false if the queue is empty
+        bool TryPop(T &value){
+            auto Position = DPopPosition.load(std::memory_order_relaxed);
+            while(true){
+                auto &Slot = DSlots[Position & DMask];
+                auto Sequence = Slot.DSequence.load(std::memory_order_acquire);
+                auto Difference = static_cast<std::ptrdiff_t>(Sequence) - static_cast<std::ptrdiff_t>(Position + 1);
+                if(Difference == 0){
+                    if(DPopPosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)){
+                        value = std::move(Slot.DValue);
+                        Slot.DSequence.store(Position + DMask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(Difference < 0){
+                    return false;
+                }
+                else{
+                    Position = DPopPosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //Pushes value, yielding while the queue is full
+        void Push(T value){
+            while(!TryPush(value)){
+                std::this_thread::yield();
+            }
+        }
+
+        //Pops into value, yielding while the queue is empty
+        void Pop(T &value){
+            while(!TryPop(value)){
+                std::this_thread::yield();
+            }
+        }
+
+        //Like Push, but gives up and returns false once cancel is set, so a stuck producer can be shut down
+        bool Push(T value, const std::atomic<bool> &cancel){
+            while(!TryPush(value)){
+                if(cancel.load(std::memory_order_acquire)){
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        //Like Pop, but gives up and returns false once cancel is set, so a stuck consumer can be shut down
+        bool Pop(T &value, const std::atomic<bool> &cancel){
+            while(!TryPop(value)){
+                if(cancel.load(std::memory_order_acquire)){
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+};
+
+#endif
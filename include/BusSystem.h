@@ -41,6 +41,19 @@ class CBusSystem{
         virtual std::shared_ptr<SRoute> RouteByIndex(std::size_t index) const noexcept = 0;
         virtual std::shared_ptr<SRoute> RouteByName(const std::string &name) const noexcept = 0;
         virtual std::shared_ptr<SPath> PathByStopIDs(TStopID start, TStopID end) const noexcept = 0;
+
+        //Sets nodeids[i] to the node of stop ids[i], or CStreetMap::InvalidNodeID if there is no such stop
+        //Returns how many were found, implementations overlap the lookups' cache misses
+        virtual std::size_t StopNodeIDsByID(std::span<const TStopID> ids, std::vector<CStreetMap::TNodeID> &nodeids) const{
+            std::size_t Found = 0;
+            nodeids.resize(ids.size());
+            for(std::size_t Index = 0; Index < ids.size(); Index++){
+                auto Stop = StopByID(ids[Index]);
+                nodeids[Index] = Stop ? Stop->NodeID() : CStreetMap::InvalidNodeID;
+                Found += Stop != nullptr;
+            }
+            return Found;
+        }
 };
 
 #endif
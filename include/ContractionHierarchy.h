@@ -0,0 +1,81 @@
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include "RoadGraph.h"
+#include <limits>
+#include <memory>
+#include <vector>
+
+//Contraction hierarchy over a CRoadGraph for exact shortest paths in microseconds
+//Vertices are contracted from least to most important, adding shortcut arcs that keep every distance,
+//so a query only has to search upward from both ends until the two searches meet
+class CContractionHierarchy{
+    public:
+        using TVertex = CRoadGraph::TVertex;
+
+        inline static constexpr TVertex InvalidVertex = CRoadGraph::InvalidVertex;
+        inline static constexpr double NoPathExists = std::numeric_limits<double>::max();
+        inline static constexpr char SerializedMagic[8] = {'O', 'S', 'M', 'C', 'H', 'I', 'E', 'R'};
+        inline static constexpr uint32_t SerializedVersion = 1;
+
+        enum class EDirection{Forward, Backward};
+
+        struct SSearchEntry{
+            TVertex DVertex;
+            double DDistance;
+        };
+
+        struct SOptions{
+            std::size_t DWitnessSettleLimit = 500;  // Witness searches stop after settling this many vertices and keep the shortcut
+            std::size_t DThreadCount = 0;           // Threads for contraction, 0 uses every hardware thread
+        };
+
+        //Search state for one thread, reset between queries by bumping a generation counter
+        struct SWorkspace{
+            private:
+                struct SImplementation;
+                std::unique_ptr<SImplementation> DImplementation;
+                friend class CContractionHierarchy;
+
+            public:
+                SWorkspace();
+                SWorkspace(SWorkspace &&workspace) noexcept;
+                SWorkspace &operator=(SWorkspace &&workspace) noexcept;
+                ~SWorkspace();
+
+                std::size_t SettledCount() const noexcept;
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CContractionHierarchy();
+        CContractionHierarchy(CContractionHierarchy &&hierarchy) noexcept;
+        CContractionHierarchy &operator=(CContractionHierarchy &&hierarchy) noexcept;
+        ~CContractionHierarchy();
+
+        void Build(const CRoadGraph &graph);
+        void Build(const CRoadGraph &graph, const SOptions &options);
+
+        std::size_t VertexCount() const noexcept;
+        std::size_t ArcCount() const noexcept;
+        std::size_t ShortcutCount() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+
+        TVertex VertexByNodeID(CStreetMap::TNodeID id) const noexcept;
+        CStreetMap::TNodeID NodeID(TVertex vertex) const noexcept;
+        uint32_t Rank(TVertex vertex) const noexcept;
+
+        double Distance(CStreetMap::TNodeID src, CStreetMap::TNodeID dest) const;
+        double Distance(SWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest) const;
+        double FindShortestPath(CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path) const;
+        double FindShortestPath(SWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path) const;
+        std::size_t SearchSpace(SWorkspace &workspace, CStreetMap::TNodeID id, EDirection direction, std::vector<SSearchEntry> &entries) const;
+
+        bool Save(std::shared_ptr<CDataSink> sink) const;
+        bool Load(std::shared_ptr<CDataSource> source);
+};
+
+#endif
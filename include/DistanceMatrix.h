@@ -0,0 +1,51 @@
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include "ContractionHierarchy.h"
+#include "BusSystem.h"
+#include <memory>
+#include <span>
+#include <vector>
+
+//Shortest path distances in meters from every source node to every target node, one row per source
+//Computed with the bucket many to many algorithm over a CContractionHierarchy
+class CDistanceMatrix{
+    public:
+        inline static constexpr double NoPathExists = CContractionHierarchy::NoPathExists;
+        inline static constexpr char SerializedMagic[8] = {'O', 'S', 'M', 'M', 'A', 'T', 'R', 'X'};
+        inline static constexpr uint32_t SerializedVersion = 1;
+
+        struct SOptions{
+            std::size_t DThreadCount = 0;       // Threads for the searches, 0 uses every hardware thread
+            std::size_t DBlockRows = 1024;      // Rows Write computes and writes at a time
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CDistanceMatrix();
+        CDistanceMatrix(CDistanceMatrix &&matrix) noexcept;
+        CDistanceMatrix &operator=(CDistanceMatrix &&matrix) noexcept;
+        ~CDistanceMatrix();
+
+        void Build(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets);
+        void Build(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets, const SOptions &options);
+        static bool Write(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets, std::shared_ptr<CDataSink> sink);
+        static bool Write(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets, std::shared_ptr<CDataSink> sink, const SOptions &options);
+        static std::vector<CStreetMap::TNodeID> StopNodeIDs(const CBusSystem &bussystem);
+
+        std::size_t RowCount() const noexcept;
+        std::size_t ColumnCount() const noexcept;
+        double Distance(std::size_t row, std::size_t column) const noexcept;
+        std::span<const double> Row(std::size_t row) const noexcept;
+        std::span<const double> Values() const noexcept;
+        std::span<const CStreetMap::TNodeID> SourceNodeIDs() const noexcept;
+        std::span<const CStreetMap::TNodeID> TargetNodeIDs() const noexcept;
+
+        bool Save(std::shared_ptr<CDataSink> sink) const;
+        bool Load(std::shared_ptr<CDataSource> source);
+};
+
+#endif
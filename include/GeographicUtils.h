@@ -0,0 +1,19 @@
+#ifndef GEOGRAPHICUTILS_H
+#define GEOGRAPHICUTILS_H
+
+#include "StreetMap.h"
+
+//Distance helpers shared by the spatial indexes and routing
+struct SGeographicUtils{
+    //Mean Earth radius (IUGG)
+    inline static constexpr double EarthRadiusMeters = 6371008.8;
+
+    static double DegreesToRadians(double degrees) noexcept;
+    static double HaversineDistanceInMeters(const CStreetMap::SLocation &location1, const CStreetMap::SLocation &location2) noexcept;
+
+    //Straight line distance through the Earth between points on a unit sphere, and back
+    static double MetersToChord(double meters) noexcept;
+    static double ChordToMeters(double chord) noexcept;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Maps OSM style 64-bit IDs to their position in a column, using one of several backends
+class CIDIndex{
+    public:
+        using TID = uint64_t;
+
+        enum class EType{
+            Hash,           // std::unordered_map, one heap node per entry
+            Sorted,         // Sorted ID array searched by interpolation, 8-12 bytes per entry
+            OpenAddressing  // Flat linear probing table, 16 to 32 bytes per entry
+        };
+
+        // IDs whose first probes are prefetched together by FindBatch
+        inline static constexpr std::size_t BatchGroupSize = 16;
+
+        inline static constexpr std::size_t InvalidIndex = std::numeric_limits<std::size_t>::max();
+        inline static constexpr TID EmptyID = std::numeric_limits<TID>::max();
+
+    private:
+        EType DType;
+        std::size_t DCount;
+
+        // Hash backend
+        std::unordered_map<TID, uint32_t> DHashIndices;
+
+        // Sorted backend, DSortedIndices is left empty when the IDs were already in order
+        std::vector<TID> DSortedIDs;
+        std::vector<uint32_t> DSortedIndices;
+
+        // Open addressing backend, EmptyID marks an unused slot
+        std::vector<TID> DSlotIDs;
+        std::vector<uint32_t> DSlotIndices;
+        std::size_t DSlotMask;
+
+        std::size_t SlotFind(TID id) const noexcept;
+        void SlotGrow();
+        void SortedStorePositions();
+        static std::size_t SortedProbe(std::span<const TID> ids, TID id) noexcept;
+
+    public:
+        CIDIndex(EType type = EType::Hash);
+
+        EType Type() const noexcept;
+        std::size_t Count() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+
+        void Build(const std::vector<TID> &ids, std::size_t threadcount = 1);
+        std::size_t Find(TID id) const noexcept;
+        std::size_t FindBatch(std::span<const TID> ids, std::vector<std::size_t> &indices) const;
+        void Set(TID id, std::size_t index);
+        bool Erase(TID id);
+
+        static std::size_t SortedFind(std::span<const TID> ids, std::span<const uint32_t> positions, TID id) noexcept;
+        static std::size_t SortedFindBatch(std::span<const TID> ids, std::span<const uint32_t> positions, std::span<const TID> queries, std::vector<std::size_t> &indices);
+};
+
+#endif
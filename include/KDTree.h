@@ -0,0 +1,52 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include "StreetMap.h"
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+//k-d tree for nearest point queries in great circle distance
+//Update and Remove change single points and the tree is rebuilt once enough changes have piled up
+class CKDTree{
+    public:
+        inline static constexpr uint32_t InvalidItem = std::numeric_limits<uint32_t>::max();
+        //Changes allowed since the last build before the tree is rebuilt, at least this many or a sixteenth of the points
+        inline static constexpr std::size_t MinimumRebuildUpdates = 64;
+
+        struct SNeighbor{
+            uint32_t DItem;
+            double DDistance;   // Meters
+
+            bool operator==(const SNeighbor &neighbor) const{
+                return DItem == neighbor.DItem && DDistance == neighbor.DDistance;
+            }
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CKDTree();
+        CKDTree(CKDTree &&tree) noexcept;
+        CKDTree &operator=(CKDTree &&tree) noexcept;
+        ~CKDTree();
+
+        void Build(const std::vector<CStreetMap::SLocation> &points, std::size_t threadcount = 0);
+        void Update(uint32_t item, const CStreetMap::SLocation &location);
+        void Remove(uint32_t item);
+
+        std::size_t Count() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+        SNeighbor Nearest(const CStreetMap::SLocation &location) const noexcept;
+        std::size_t KNearest(const CStreetMap::SLocation &location, std::size_t k, std::vector<SNeighbor> &neighbors) const;
+        std::size_t Radius(const CStreetMap::SLocation &location, double meters, std::vector<SNeighbor> &neighbors) const;
+
+        void NearestBatch(const std::vector<CStreetMap::SLocation> &locations, std::vector<SNeighbor> &neighbors, std::size_t threadcount = 0) const;
+        void KNearestBatch(const std::vector<CStreetMap::SLocation> &locations, std::size_t k, std::vector<std::vector<SNeighbor>> &neighbors, std::size_t threadcount = 0) const;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MAPPEDSTREETMAP_H
+#define MAPPEDSTREETMAP_H
+
+#include "StreetMap.h"
+
+// Street map served straight from a memory mapped snapshot written by COpenStreetMap::WriteSnapshot
+class CMappedStreetMap : public CStreetMap{
+    public:
+        inline static constexpr char SnapshotMagic[8] = {'O','S','M','S','N','A','P','\0'};
+        inline static constexpr uint32_t SnapshotVersion = 1;
+
+        // Sections of a snapshot file, in the order they are written
+        enum class ESection{
+            NodeIDs,            // uint64_t[NodeCount]
+            NodeLatitudes,      // double[NodeCount], or int32_t[NodeCount] for fixed point
+            NodeLongitudes,     // double[NodeCount], or int32_t[NodeCount] for fixed point
+            NodeTagOffsets,     // uint32_t[NodeCount + 1]
+            NodeTags,           // uint32_t key, uint32_t value pairs [NodeTagCount]
+            WayIDs,             // uint64_t[WayCount]
+            WayNodeOffsets,     // uint64_t[WayCount + 1]
+            WayNodeReferences,  // uint64_t[WayNodeCount]
+            WayTagOffsets,      // uint32_t[WayCount + 1]
+            WayTags,            // uint32_t key, uint32_t value pairs [WayTagCount]
+            StringOffsets,      // uint64_t[StringCount + 1]
+            StringData,         // char[StringBytes]
+            NodeIndexIDs,       // uint64_t[NodeIndexCount] sorted
+            NodeIndexPositions, // uint32_t[NodeIndexCount]
+            WayIndexIDs,        // uint64_t[WayIndexCount] sorted
+            WayIndexPositions,  // uint32_t[WayIndexCount]
+            Count
+        };
+
+        // Fixed size header at the start of a snapshot, every section starts on an 8 byte boundary
+        struct SSnapshotHeader{
+            char DMagic[8];
+            uint32_t DVersion;
+            uint32_t DFixedPoint;
+            uint64_t DNodeCount;
+            uint64_t DWayCount;
+            uint64_t DNodeTagCount;
+            uint64_t DWayTagCount;
+            uint64_t DWayNodeCount;
+            uint64_t DStringCount;
+            uint64_t DStringBytes;
+            uint64_t DNodeIndexCount;
+            uint64_t DWayIndexCount;
+            uint64_t DSectionOffsets[static_cast<std::size_t>(ESection::Count)];
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CMappedStreetMap(const std::string &filename);
+        ~CMappedStreetMap();
+
+        bool Valid() const noexcept;
+
+        std::size_t NodeCount() const noexcept override;
+        std::size_t WayCount() const noexcept override;
+        std::shared_ptr<CStreetMap::SNode> NodeByIndex(std::size_t index) const noexcept override;
+        std::shared_ptr<CStreetMap::SNode> NodeByID(TNodeID id) const noexcept override;
+        std::shared_ptr<CStreetMap::SWay> WayByIndex(std::size_t index) const noexcept override;
+        std::shared_ptr<CStreetMap::SWay> WayByID(TWayID id) const noexcept override;
+        void ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const override;
+        void ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const override;
+        std::size_t NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const override;
+};
+
+#endif
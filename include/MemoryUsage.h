@@ -0,0 +1,90 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Heap bytes and allocations held by containers, added up for the MemoryUsage reports
+//Containers are charged for their capacity, hash tables for their buckets and one node per entry
+struct SMemoryUsage{
+    //Bookkeeping a typical malloc (glibc) keeps per allocation, charged as allocator overhead
+    inline static constexpr std::size_t AllocationOverhead = 16;
+    //Reference counts that std::make_shared places next to the object
+    inline static constexpr std::size_t SharedControlBytes = 2 * sizeof(long);
+
+    std::size_t DBytes = 0;
+    std::size_t DAllocations = 0;
+
+    void AddBlock(std::size_t bytes) noexcept{
+        DBytes += bytes;
+        DAllocations++;
+    }
+
+    template <typename T>
+    void Add(const std::vector<T> &vector) noexcept{
+        if(vector.capacity()){
+            AddBlock(vector.capacity() * sizeof(T));
+        }
+    }
+
+    //Short strings live inside the std::string itself and cost nothing extra
+    void Add(const std::string &str) noexcept{
+        auto Data = str.data();
+        auto Object = reinterpret_cast<const char *>(&str);
+        if((Data < Object)||(Data >= Object + sizeof(str))){
+            AddBlock(str.capacity() + 1);
+        }
+    }
+
+    //Each node holds the next pointer, the entry and the cached hash
+    //libstdc++ keeps a lone bucket inside the map, so an unused map allocates nothing
+    template <typename TKey, typename TValue, typename THash, typename TEqual>
+    void Add(const std::unordered_map<TKey, TValue, THash, TEqual> &map) noexcept{
+        if(map.bucket_count() > 1){
+            AddBlock(map.bucket_count() * sizeof(void *));
+        }
+        DBytes += map.size() * (sizeof(void *) + sizeof(std::pair<const TKey, TValue>) + sizeof(std::size_t));
+        DAllocations += map.size();
+    }
+
+    template <typename TKey, typename TValue, typename THash, typename TEqual>
+    void Add(const std::unordered_multimap<TKey, TValue, THash, TEqual> &map) noexcept{
+        if(map.bucket_count() > 1){
+            AddBlock(map.bucket_count() * sizeof(void *));
+        }
+        DBytes += map.size() * (sizeof(void *) + sizeof(std::pair<const TKey, TValue>) + sizeof(std::size_t));
+        DAllocations += map.size();
+    }
+
+    //libstdc++ deques hold 512 byte blocks plus a map of block pointers
+    template <typename T>
+    void Add(const std::deque<T> &deque) noexcept{
+        const std::size_t BlockBytes = 512;
+        auto PerBlock = sizeof(T) < BlockBytes ? BlockBytes / sizeof(T) : 1;
+        auto Blocks = deque.size() / PerBlock + 1;
+        AddBlock((Blocks + 2) * sizeof(void *));
+        DBytes += Blocks * PerBlock * sizeof(T);
+        DAllocations += Blocks;
+    }
+
+    //Object made by std::make_shared, bytes is the size of its dynamic type
+    void AddShared(std::size_t bytes) noexcept{
+        AddBlock(bytes + SharedControlBytes);
+    }
+
+    std::size_t Overhead() const noexcept{
+        return DAllocations * AllocationOverhead;
+    }
+
+    SMemoryUsage &operator+=(const SMemoryUsage &usage) noexcept{
+        DBytes += usage.DBytes;
+        DAllocations += usage.DAllocations;
+        return *this;
+    }
+};
+
+#endif
@@ -2,15 +2,144 @@
 #define OPENSTREETMAP_H
 
 #include "XMLReader.h"
+#include "DataSink.h"
 #include "StreetMap.h"
+#include "StringPool.h"
+#include "IDIndex.h"
+#include "RTree.h"
+#include "KDTree.h"
+#include "TagIndex.h"
+#include <span>
+#include <iterator>
+#include <functional>
+#include <unordered_map>
 
 class COpenStreetMap : public CStreetMap{
+    public:
+        using TStringID = CStringPool::TStringID;
+
+        inline static constexpr TStringID InvalidStringID = CStringPool::InvalidStringID;
+
+        //How node coordinates are kept in memory
+        enum class ECoordinateStorage{
+            Double,     // Two doubles per node
+            FixedPoint  // Two int32 per node in units of 1e-7 degrees (OSM's native precision)
+        };
+
+        inline static constexpr double FixedPointScale = 1e7;
+
+        //When node and way tags are turned into strings
+        enum class ETagDecoding{
+            Eager,          // Interned into the string pool while loading
+            Lazy,           // Kept as raw bytes, decoded on every attribute call
+            LazyMemoized    // Kept as raw bytes, decoded on the first attribute call and cached
+        };
+
+        //How way node references are kept in memory
+        enum class EWayNodeStorage{
+            Plain,      // One 64-bit ID per reference
+            Compressed  // Delta + varint packed in blocks of WayNodeBlockSize references while loading, then only the IDs of refs to missing nodes
+        };
+
+        inline static constexpr std::size_t WayNodeBlockSize = 16;
+
+        inline static constexpr uint32_t InvalidNodeIndex = std::numeric_limits<uint32_t>::max();
+
+        //Index given by the batch ID lookups for IDs that are not in the map
+        inline static constexpr std::size_t InvalidIndex = CIDIndex::InvalidIndex;
+
+        //Forward iterator over one way's node IDs, compressed lists read each ID from the node row the ref resolved to
+        //Only valid while the COpenStreetMap is alive
+        class CWayNodeIDIterator{
+            private:
+                const TNodeID *DPlain = nullptr;
+                const uint32_t *DNodeIndices = nullptr;
+                const TNodeID *DNodeIDs = nullptr;
+                const std::unordered_map<std::size_t, TNodeID> *DUnresolvedIDs = nullptr;
+                std::size_t DPosition = 0;
+                std::size_t DRemaining = 0;
+                TNodeID DCurrent = CStreetMap::InvalidNodeID;
+
+                void Decode() noexcept;
+
+            public:
+                using iterator_category = std::input_iterator_tag;
+                using value_type = TNodeID;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const TNodeID *;
+                using reference = TNodeID;
+
+                CWayNodeIDIterator() = default;
+                CWayNodeIDIterator(const TNodeID *plain, std::size_t count) noexcept;
+                CWayNodeIDIterator(const uint32_t *nodeindices, const TNodeID *nodeids, const std::unordered_map<std::size_t, TNodeID> *unresolvedids, std::size_t position, std::size_t count) noexcept;
+
+                TNodeID operator*() const noexcept{
+                    return DCurrent;
+                }
+                CWayNodeIDIterator &operator++() noexcept;
+                CWayNodeIDIterator operator++(int) noexcept{
+                    auto Previous = *this;
+                    ++*this;
+                    return Previous;
+                }
+                bool operator==(std::default_sentinel_t) const noexcept{
+                    return DRemaining == 0;
+                }
+        };
+
+        //Range of CWayNodeIDIterator usable in range based for
+        struct SWayNodeIDRange{
+            CWayNodeIDIterator DBegin;
+
+            CWayNodeIDIterator begin() const noexcept{
+                return DBegin;
+            }
+            std::default_sentinel_t end() const noexcept{
+                return std::default_sentinel;
+            }
+        };
+
+        //Decides from a way's tags whether the way is loaded
+        using TWayFilter = std::function<bool(const TAttributes &tags)>;
+
+        //Load time choices, the defaults suit most maps
+        struct SOptions{
+            CIDIndex::EType DIndexType = CIDIndex::EType::Hash;
+            ECoordinateStorage DCoordinateStorage = ECoordinateStorage::Double;
+            ETagDecoding DTagDecoding = ETagDecoding::Eager;
+            EWayNodeStorage DWayNodeStorage = EWayNodeStorage::Plain;
+            TWayFilter DWayFilter;          // Empty keeps every way
+            bool DBuildWayRTree = false;
+            bool DBuildNodeKDTree = false;
+            bool DBuildTagIndex = false;
+            bool DPipelinedLoad = false;    // Reads, converts and appends on separate threads
+            std::size_t DThreadCount = 0;   // Threads for parallel build steps, 0 uses every hardware thread
+        };
+
+        //Heap bytes held by each part of the map, see MemoryUsage
+        struct SMemoryReport{
+            std::size_t DNodes = 0;             // Node ID and coordinate columns
+            std::size_t DNodeTags = 0;          // Node tag columns, and decoded tags when LazyMemoized
+            std::size_t DNodeIndex = 0;         // Node ID index
+            std::size_t DWays = 0;              // Way ID column
+            std::size_t DWayReferences = 0;     // Way node refs, their offsets and resolved node indices, plus the node to way map ApplyChanges keeps
+            std::size_t DWayTags = 0;           // Way tag columns, and decoded tags when LazyMemoized
+            std::size_t DWayIndex = 0;          // Way ID index
+            std::size_t DStrings = 0;           // Interned tag keys and values
+            std::size_t DSearchIndexes = 0;     // Way R-tree, node k-d tree and tag indexes
+            std::size_t DAllocatorOverhead = 0; // Estimated malloc bookkeeping for every allocation above
+
+            std::size_t Total() const noexcept;
+        };
+
     private:
         struct SImplementation;
         std::unique_ptr<SImplementation> DImplementation;
 
     public:
         COpenStreetMap(std::shared_ptr<CXMLReader> src);
+        COpenStreetMap(std::shared_ptr<CXMLReader> src, const SOptions &options);
+        COpenStreetMap(std::shared_ptr<CXMLReader> filtersrc, std::shared_ptr<CXMLReader> src, const SOptions &options);
         ~COpenStreetMap();
 
         std::size_t NodeCount() const noexcept override;
@@ -19,6 +148,42 @@ class COpenStreetMap : public CStreetMap{
         std::shared_ptr<CStreetMap::SNode> NodeByID(TNodeID id) const noexcept override;
         std::shared_ptr<CStreetMap::SWay> WayByIndex(std::size_t index) const noexcept override;
         std::shared_ptr<CStreetMap::SWay> WayByID(TWayID id) const noexcept override;
+        void ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const override;
+        void ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const override;
+        std::size_t NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const override;
+
+        TStringID StringID(const std::string &str) const noexcept;
+        std::string StringByID(TStringID id) const noexcept;
+        TStringID NodeAttributeID(std::size_t index, TStringID key) const noexcept;
+        TStringID WayAttributeID(std::size_t index, TStringID key) const noexcept;
+        std::size_t NodeIndicesByID(std::span<const TNodeID> ids, std::vector<std::size_t> &indices) const;
+        std::size_t WayIndicesByID(std::span<const TWayID> ids, std::vector<std::size_t> &indices) const;
+
+        ECoordinateStorage CoordinateStorage() const noexcept;
+        ETagDecoding TagDecoding() const noexcept;
+        EWayNodeStorage WayNodeStorage() const noexcept;
+        SWayNodeIDRange WayNodeIDs(std::size_t index) const noexcept;
+        std::size_t WayNodeIDs(std::size_t index, std::vector<TNodeID> &ids) const;
+        std::span<const uint32_t> WayNodeIndices(std::size_t index) const noexcept;
+        std::size_t WayLocations(std::size_t index, std::vector<SLocation> &locations) const;
+        CRTree::SBox WayBounds(std::size_t index) const noexcept;
+        const CRTree &WayRTree() const noexcept;
+        std::size_t WaysInBox(const CRTree::SBox &box, std::vector<uint32_t> &ways) const;
+        const CKDTree &NodeKDTree() const noexcept;
+        const CTagIndex &NodeTagIndex() const noexcept;
+        const CTagIndex &WayTagIndex() const noexcept;
+        std::span<const double> NodeLatitudes() const noexcept;
+        std::span<const double> NodeLongitudes() const noexcept;
+        std::span<const int32_t> NodeFixedPointLatitudes() const noexcept;
+        std::span<const int32_t> NodeFixedPointLongitudes() const noexcept;
+
+        bool WriteSnapshot(std::shared_ptr<CDataSink> sink) const;
+        bool ApplyChanges(std::shared_ptr<CXMLReader> changes);
+        bool ApplyChanges(std::shared_ptr<CXMLReader> changes, std::size_t &skipped);
+        SMemoryReport MemoryUsage() const noexcept;
+
+        static int32_t ToFixedPoint(double degrees) noexcept;
+        static double FromFixedPoint(int32_t fixedpoint) noexcept;
 };
 
 #endif
@@ -0,0 +1,39 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+//Returns threadcount, or the number of hardware threads when threadcount is 0
+inline std::size_t ResolveThreadCount(std::size_t threadcount) noexcept{
+    if(threadcount){
+        return threadcount;
+    }
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+//Splits [0, count) into one contiguous chunk per thread and calls func(begin, end) for each chunk
+//The calling thread runs the first chunk, threadcount 0 uses every hardware thread
+template <typename TFunc>
+void ParallelFor(std::size_t count, std::size_t threadcount, TFunc func){
+    auto Threads = std::min(ResolveThreadCount(threadcount), count);
+    if(Threads <= 1){
+        if(count){
+            func(std::size_t(0), count);
+        }
+        return;
+    }
+    auto ChunkSize = (count + Threads - 1) / Threads;
+    std::vector<std::thread> Workers;
+    for(std::size_t Begin = ChunkSize; Begin < count; Begin += ChunkSize){
+        Workers.emplace_back(func, Begin, std::min(Begin + ChunkSize, count));
+    }
+    func(std::size_t(0), std::min(ChunkSize, count));
+    for(auto &Worker : Workers){
+        Worker.join();
+    }
+}
+
+#endif
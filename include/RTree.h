@@ -0,0 +1,64 @@
+#ifndef RTREE_H
+#define RTREE_H
+
+#include "DataSource.h"
+#include "DataSink.h"
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//Packed R-tree over latitude/longitude boxes, bulk loaded with Sort-Tile-Recursive
+//Update changes single items in place and is rebuilt once enough updates have piled up
+class CRTree{
+    public:
+        struct SBox{
+            double DMinLatitude;
+            double DMinLongitude;
+            double DMaxLatitude;
+            double DMaxLongitude;
+
+            bool Empty() const noexcept{
+                return (DMinLatitude > DMaxLatitude)||(DMinLongitude > DMaxLongitude);
+            }
+
+            bool Intersects(const SBox &box) const noexcept{
+                return (DMinLatitude <= box.DMaxLatitude)&&(box.DMinLatitude <= DMaxLatitude)&&(DMinLongitude <= box.DMaxLongitude)&&(box.DMinLongitude <= DMaxLongitude);
+            }
+
+            //Grows the box to also cover box
+            void Expand(const SBox &box) noexcept;
+
+            //A box that contains nothing and grows to exactly the first box it is expanded by
+            static SBox EmptyBox() noexcept;
+        };
+
+        inline static constexpr std::size_t NodeCapacity = 16;
+        //Updates allowed since the last build before the tree is rebuilt, at least this many or a sixteenth of the items
+        inline static constexpr std::size_t MinimumRebuildUpdates = 64;
+        inline static constexpr char SerializedMagic[8] = {'O', 'S', 'M', 'R', 'T', 'R', 'E', 'E'};
+        inline static constexpr uint32_t SerializedVersion = 1;
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CRTree();
+        CRTree(CRTree &&tree) noexcept;
+        CRTree &operator=(CRTree &&tree) noexcept;
+        ~CRTree();
+
+        void Build(const std::vector<SBox> &boxes, std::size_t threadcount = 0);
+        void Update(uint32_t item, const SBox &box);
+
+        std::size_t Count() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+        SBox Bounds() const noexcept;
+        std::size_t Query(const SBox &box, std::vector<uint32_t> &items) const;
+
+        bool Save(std::shared_ptr<CDataSink> sink) const;
+        bool Load(std::shared_ptr<CDataSource> source);
+};
+
+#endif
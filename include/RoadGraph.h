@@ -0,0 +1,77 @@
+#ifndef ROADGRAPH_H
+#define ROADGRAPH_H
+
+#include "OpenStreetMap.h"
+#include "DataSource.h"
+#include "DataSink.h"
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+//Directed street network in compressed sparse row form
+//Vertices are the nodes the chosen ways reference, edges join consecutive nodes of a way
+//The edges leaving vertex v are Targets()[Offsets()[v]] to Targets()[Offsets()[v+1]], with their lengths in meters in Lengths()
+class CRoadGraph{
+    public:
+        using TVertex = uint32_t;
+
+        inline static constexpr TVertex InvalidVertex = std::numeric_limits<uint32_t>::max();
+        inline static constexpr char SerializedMagic[8] = {'O', 'S', 'M', 'G', 'R', 'A', 'P', 'H'};
+        inline static constexpr uint32_t SerializedVersion = 2;
+
+        struct SOptions{
+            std::string DRequiredKey = "highway";   // Only ways with this tag become edges, empty uses every way
+            bool DRespectOneway = true;             // Oneway ways only get edges in their direction of travel
+            std::size_t DThreadCount = 0;           // Threads for building, 0 uses every hardware thread
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CRoadGraph();
+        CRoadGraph(CRoadGraph &&graph) noexcept;
+        CRoadGraph &operator=(CRoadGraph &&graph) noexcept;
+        ~CRoadGraph();
+
+        void Build(const COpenStreetMap &map);
+        void Build(const COpenStreetMap &map, const SOptions &options);
+        void BuildContracted(const CRoadGraph &graph, std::size_t threadcount = 0);
+        void BuildContracted(const CRoadGraph &graph, std::span<const CStreetMap::TNodeID> keep, std::size_t threadcount = 0);
+
+        std::size_t VertexCount() const noexcept;
+        std::size_t EdgeCount() const noexcept;
+        std::size_t ShapeNodeCount() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+
+        TVertex VertexByNodeID(CStreetMap::TNodeID id) const noexcept;
+        CStreetMap::TNodeID NodeID(TVertex vertex) const noexcept;
+        CStreetMap::SLocation Location(TVertex vertex) const noexcept;
+
+        std::size_t EdgeBegin(TVertex vertex) const noexcept;
+        std::size_t EdgeEnd(TVertex vertex) const noexcept;
+        TVertex EdgeTarget(std::size_t edge) const noexcept;
+        double EdgeLength(std::size_t edge) const noexcept;
+        std::size_t EdgeWayIndex(std::size_t edge) const noexcept;
+        TVertex EdgeSource(std::size_t edge) const noexcept;
+        std::size_t EdgeNodeIDs(std::size_t edge, std::vector<CStreetMap::TNodeID> &ids) const;
+        std::size_t EdgeLocations(std::size_t edge, std::vector<CStreetMap::SLocation> &locations) const;
+
+        std::span<const uint32_t> Offsets() const noexcept;
+        std::span<const TVertex> Targets() const noexcept;
+        std::span<const double> Lengths() const noexcept;
+        std::span<const uint32_t> WayIndices() const noexcept;
+        std::span<const CStreetMap::TNodeID> NodeIDs() const noexcept;
+        std::span<const double> Latitudes() const noexcept;
+        std::span<const double> Longitudes() const noexcept;
+
+        bool Save(std::shared_ptr<CDataSink> sink) const;
+        bool Load(std::shared_ptr<CDataSource> source);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef ROADROUTER_H
+#define ROADROUTER_H
+
+#include "RoadGraph.h"
+#include "BusSystem.h"
+#include <limits>
+#include <memory>
+#include <vector>
+
+//Node to node shortest paths over a CRoadGraph
+//Searches keep their per vertex state in a workspace that is reused across queries, so a warm query allocates nothing
+class CRoadRouter{
+    public:
+        inline static constexpr double NoPathExists = std::numeric_limits<double>::max();
+
+        enum class EAlgorithm{Dijkstra, AStar};
+
+        //Search state for one thread, reset between queries by bumping a generation counter
+        struct SWorkspace{
+            private:
+                struct SImplementation;
+                std::unique_ptr<SImplementation> DImplementation;
+                friend class CRoadRouter;
+
+            public:
+                SWorkspace();
+                SWorkspace(SWorkspace &&workspace) noexcept;
+                SWorkspace &operator=(SWorkspace &&workspace) noexcept;
+                ~SWorkspace();
+
+                std::size_t SettledCount() const noexcept;
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CRoadRouter(std::shared_ptr<const CRoadGraph> graph);
+        ~CRoadRouter();
+
+        std::shared_ptr<const CRoadGraph> Graph() const noexcept;
+
+        double FindShortestPath(CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path, EAlgorithm algorithm = EAlgorithm::AStar) const;
+        double FindShortestPath(SWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path, EAlgorithm algorithm = EAlgorithm::AStar) const;
+        std::shared_ptr<CBusSystem::SPath> ShortestPath(CStreetMap::TNodeID src, CStreetMap::TNodeID dest, EAlgorithm algorithm = EAlgorithm::AStar) const;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SEGMENTINDEX_H
+#define SEGMENTINDEX_H
+
+#include "OpenStreetMap.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+//Grid of way segments for nearest point on the nearest way (reverse geocoding)
+class CSegmentIndex{
+    public:
+        struct SOptions{
+            double DCellMeters = 200.0;             // Grid cell edge length
+            double DMaxDistanceMeters = 2000.0;     // Queries farther than this from every segment find nothing
+            std::string DRequiredKey = "highway";   // Only ways with this tag are indexed, empty indexes every way
+            std::size_t DThreadCount = 0;           // Threads for building, 0 uses every hardware thread
+        };
+
+        struct SMatch{
+            CStreetMap::SLocation DLocation;    // Closest point on the segment
+            double DDistance;                   // Meters from the query to DLocation
+            CStreetMap::TWayID DWayID;          // InvalidWayID if nothing was found
+            std::size_t DWayIndex;
+            std::size_t DSegment;               // Position in the way's node list of the segment's first node
+            double DOffset;                     // Meters from the segment's first node to DLocation
+            std::string DName;                  // The way's "name" tag
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CSegmentIndex(std::shared_ptr<const COpenStreetMap> map);
+        CSegmentIndex(std::shared_ptr<const COpenStreetMap> map, const SOptions &options);
+        ~CSegmentIndex();
+
+        std::size_t SegmentCount() const noexcept;
+        SMatch Nearest(const CStreetMap::SLocation &location) const;
+        void NearestBatch(const std::vector<CStreetMap::SLocation> &locations, std::vector<SMatch> &matches, std::size_t threadcount = 0) const;
+};
+
+#endif
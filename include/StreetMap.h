@@ -1,10 +1,14 @@
 #ifndef STREETMAP_H
 #define STREETMAP_H
 
+#include <cmath>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
+#include <vector>
 #include <limits>
 
 class CStreetMap{
@@ -46,14 +50,67 @@ class CStreetMap{
             virtual std::string GetAttribute(const std::string &key) const noexcept = 0;
         };
 
+        //Visitors get the object's index and a reference that is only valid during the call
+        using TNodeVisitor = std::function<void(std::size_t index, const SNode &node)>;
+        using TWayVisitor = std::function<void(std::size_t index, const SWay &way)>;
+
         virtual ~CStreetMap(){};
 
+        //Location given by batch lookups for IDs that are not in the map, test with std::isnan
+        static SLocation InvalidLocation() noexcept{
+            return SLocation(std::nan(""), std::nan(""));
+        }
+
         virtual std::size_t NodeCount() const noexcept = 0;
         virtual std::size_t WayCount() const noexcept = 0;
         virtual std::shared_ptr<SNode> NodeByIndex(std::size_t index) const noexcept = 0;
         virtual std::shared_ptr<SNode> NodeByID(TNodeID id) const noexcept = 0;
         virtual std::shared_ptr<SWay> WayByIndex(std::size_t index) const noexcept = 0;
         virtual std::shared_ptr<SWay> WayByID(TWayID id) const noexcept = 0;
+
+        //Calls visit for the nodes with index in [begin, end) in index order
+        //The default goes through NodeByIndex, implementations override it to reuse one handle
+        virtual void ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const{
+            for(auto Index = begin; Index < end; Index++){
+                if(auto Node = NodeByIndex(Index)){
+                    visit(Index, *Node);
+                }
+            }
+        }
+
+        //Calls visit for the ways with index in [begin, end) in index order
+        virtual void ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const{
+            for(auto Index = begin; Index < end; Index++){
+                if(auto Way = WayByIndex(Index)){
+                    visit(Index, *Way);
+                }
+            }
+        }
+
+        //Sets locations[i] to the location of node ids[i], or InvalidLocation() if it is not in the map
+        //Returns how many were found, implementations overlap the lookups' cache misses
+        virtual std::size_t NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const{
+            std::size_t Found = 0;
+            locations.resize(ids.size());
+            for(std::size_t Index = 0; Index < ids.size(); Index++){
+                auto Node = NodeByID(ids[Index]);
+                locations[Index] = Node ? Node->Location() : InvalidLocation();
+                Found += Node != nullptr;
+            }
+            return Found;
+        }
+
+        void ForEachNode(const TNodeVisitor &visit) const{
+            ForEachNodeInRange(0, NodeCount(), visit);
+        }
+
+        void ForEachWay(const TWayVisitor &visit) const{
+            ForEachWayInRange(0, WayCount(), visit);
+        }
+
+        //Splits the nodes into one contiguous chunk per thread, visit must be safe to call from several threads
+        void ParallelForEachNode(const TNodeVisitor &visit, std::size_t threadcount = 0) const;
+        void ParallelForEachWay(const TWayVisitor &visit, std::size_t threadcount = 0) const;
 };
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Stores each distinct string once and hands out small integer IDs for them
+class CStringPool{
+    public:
+        using TStringID = uint32_t;
+
+        inline static constexpr TStringID InvalidStringID = std::numeric_limits<TStringID>::max();
+
+    private:
+        // deque never moves its elements, so the views in DIDsByString stay valid
+        std::deque<std::string> DStrings;
+        std::unordered_map<std::string_view, TStringID> DIDsByString;
+
+    public:
+        TStringID Intern(std::string_view str);
+        TStringID Find(std::string_view str) const noexcept;
+        const std::string &String(TStringID id) const noexcept;
+        std::size_t Count() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TAGINDEX_H
+#define TAGINDEX_H
+
+#include "StreetMap.h"
+#include "XMLEntity.h"
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+//Inverted index from tag key, and tag key and value, to the sorted indices of the nodes or ways that have them
+class CTagIndex{
+    public:
+        enum class EObjectType{
+            Nodes,
+            Ways
+        };
+
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CTagIndex();
+        CTagIndex(CTagIndex &&index) noexcept;
+        CTagIndex &operator=(CTagIndex &&index) noexcept;
+        ~CTagIndex();
+
+        void Build(const CStreetMap &map, EObjectType type);
+        void Add(uint32_t index, const TAttributes &tags);
+        void Remove(uint32_t index, const TAttributes &tags);
+
+        std::size_t KeyCount() const noexcept;
+        SMemoryUsage MemoryUsage() const noexcept;
+        std::span<const uint32_t> Find(const std::string &key) const noexcept;
+        std::span<const uint32_t> Find(const std::string &key, const std::string &value) const noexcept;
+
+        static std::size_t Intersect(std::span<const uint32_t> left, std::span<const uint32_t> right, std::vector<uint32_t> &result);
+        static std::size_t Union(std::span<const uint32_t> left, std::span<const uint32_t> right, std::vector<uint32_t> &result);
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef VERSIONHOLDER_H
+#define VERSIONHOLDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//Holds the current version of a read only object, such as a CStreetMap or CBusSystem, while new versions are published
+//Readers pin the global epoch in a slot before loading the current version, so a reader costs one compare and swap
+//and one store and never takes a lock. A replaced version is freed once no slot holds an epoch from before it was replaced
+template <typename T>
+class CVersionHolder{
+    public:
+        inline static constexpr std::size_t DefaultSlotCount = 128;
+
+    private:
+        struct SVersion{
+            std::shared_ptr<const T> DValue;
+            uint64_t DNumber;
+        };
+
+        //0 while unused, otherwise the epoch its reader pinned
+        struct alignas(64) SSlot{
+            std::atomic<uint64_t> DEpoch{0};
+        };
+
+        struct SRetired{
+            SVersion *DVersion;
+            uint64_t DEpoch;
+        };
+
+        alignas(64) std::atomic<SVersion *> DCurrent{nullptr};
+        alignas(64) std::atomic<uint64_t> DGlobalEpoch{1};
+        std::size_t DSlotCount;
+        std::unique_ptr<SSlot[]> DSlots;
+        //Only publishers take the lock, readers never touch it
+        std::mutex DPublishMutex;
+        std::vector<SRetired> DRetired;
+        uint64_t DNextNumber = 1;
+
+        //Frees every retired version no reader can still see, DPublishMutex must be held
+        std::size_t ReclaimLocked(){
+            auto Oldest = std::numeric_limits<uint64_t>::max();
+            for(std::size_t Index = 0; Index < DSlotCount; Index++){
+                auto Epoch = DSlots[Index].DEpoch.load();
+                if(Epoch && (Epoch < Oldest)){
+                    Oldest = Epoch;
+                }
+            }
+            std::size_t Kept = 0;
+            for(auto &Retired : DRetired){
+                //A reader that pinned a later epoch started after the version was replaced, so it cannot hold it
+                if(Retired.DEpoch < Oldest){
+                    delete Retired.DVersion;
+                }
+                else{
+                    DRetired[Kept++] = Retired;
+                }
+            }
+            DRetired.resize(Kept);
+            return Kept;
+        }
+
+    public:
+        //Reference to the version that was current when it was taken, valid until the guard is destroyed
+        class CReadGuard{
+            private:
+                SSlot *DSlot = nullptr;
+                const SVersion *DVersion = nullptr;
+
+                friend class CVersionHolder;
+
+            public:
+                CReadGuard() = default;
+                CReadGuard(const CReadGuard &) = delete;
+                CReadGuard &operator=(const CReadGuard &) = delete;
+                CReadGuard(CReadGuard &&guard) noexcept : DSlot(std::exchange(guard.DSlot, nullptr)), DVersion(std::exchange(guard.DVersion, nullptr)){
+
+                }
+                CReadGuard &operator=(CReadGuard &&guard) noexcept{
+                    std::swap(DSlot, guard.DSlot);
+                    std::swap(DVersion, guard.DVersion);
+                    return *this;
+                }
+                ~CReadGuard(){
+                    if(DSlot){
+                        DSlot->DEpoch.store(0, std::memory_order_release);
+                    }
+                }
+
+                //False when nothing had been published yet
+                explicit operator bool() const noexcept{
+                    return DVersion != nullptr;
+                }
+                const T *Get() const noexcept{
+                    return DVersion ? DVersion->DValue.get() : nullptr;
+                }
+                const T &operator*() const noexcept{
+                    return *DVersion->DValue;
+                }
+                const T *operator->() const noexcept{
+                    return DVersion->DValue.get();
+                }
+                //Number Publish returned for this version, 0 when nothing had been published yet
+                uint64_t Version() const noexcept{
+                    return DVersion ? DVersion->DNumber : 0;
+                }
+        };
+
+        //slotcount bounds how many guards can be held at once, more readers wait for a slot to free up
+        explicit CVersionHolder(std::size_t slotcount = DefaultSlotCount) : DSlotCount(slotcount ? slotcount : 1), DSlots(std::make_unique<SSlot[]>(DSlotCount)){
+
+        }
+
+        CVersionHolder(const CVersionHolder &) = delete;
+        CVersionHolder &operator=(const CVersionHolder &) = delete;
+
+        //Every guard must be gone before the holder is destroyed
+        ~CVersionHolder(){
+            for(auto &Retired : DRetired){
+                delete Retired.DVersion;
+            }
+            delete DCurrent.load();
+        }
+
+        //Pins the current version, lock-free for readers
+        CReadGuard Acquire() const noexcept{
+            //Each thread starts at its own slot so threads rarely compete for one
+            thread_local const std::size_t Hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+            for(std::size_t Attempt = 0;; Attempt++){
+                auto &Slot = DSlots[(Hint + Attempt) % DSlotCount];
+                uint64_t Free = 0;
+                if(!Slot.DEpoch.load(std::memory_order_relaxed) && Slot.DEpoch.compare_exchange_strong(Free, DGlobalEpoch.load())){
+                    CReadGuard Guard;
+                    Guard.DSlot = &Slot;
+                    Guard.DVersion = DCurrent.load();
+                    return Guard;
+                }
+                if(Attempt && (Attempt % DSlotCount == 0)){
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        //Makes value the current version and returns its number, readers already holding a guard keep the version they have
+        //The replaced version is freed here or by a later Publish or Reclaim once its readers are done, never by a reader
+        uint64_t Publish(std::shared_ptr<const T> value){
+            std::lock_guard<std::mutex> Lock(DPublishMutex);
+            auto Number = DNextNumber++;
+            auto Previous = DCurrent.exchange(new SVersion{std::move(value), Number});
+            if(Previous){
+                DRetired.push_back({Previous, DGlobalEpoch.fetch_add(1)});
+            }
+            ReclaimLocked();
+            return Number;
+        }
+
+        //Frees the replaced versions whose readers are done, returns how many are still waiting for readers
+        std::size_t Reclaim(){
+            std::lock_guard<std::mutex> Lock(DPublishMutex);
+            return ReclaimLocked();
+        }
+
+        //Number of the current version, 0 when nothing has been published
+        uint64_t Version() const noexcept{
+            return Acquire().Version();
+        }
+
+        std::size_t SlotCount() const noexcept{
+            return DSlotCount;
+        }
+};
+
+#endif
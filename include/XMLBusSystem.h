@@ -3,12 +3,24 @@
 
 #include "BusSystem.h"
 #include "XMLReader.h"
+#include "MemoryUsage.h"
 
 class CXMLBusSystem : public CBusSystem{
     private:
         struct SImplementation;
         std::unique_ptr< SImplementation > DImplementation;
     public:
+        // Heap bytes held by each part of the bus system, see MemoryUsage
+        struct SMemoryReport{
+            std::size_t DStops = 0;             // Stop objects and their descriptions
+            std::size_t DStopIndexes = 0;       // Stop ID map, batch lookup index and stop node IDs
+            std::size_t DRoutes = 0;            // Route objects, names, stop lists and the name map
+            std::size_t DPaths = 0;             // Path objects, node lists and the nested stop ID maps
+            std::size_t DAllocatorOverhead = 0; // Estimated malloc bookkeeping for every allocation above
+
+            std::size_t Total() const noexcept;
+        };
+
         CXMLBusSystem(std::shared_ptr< CXMLReader > systemsource, std::shared_ptr< CXMLReader > pathsource);
         ~CXMLBusSystem();
 
@@ -19,6 +31,8 @@ class CXMLBusSystem : public CBusSystem{
         std::shared_ptr<SRoute> RouteByIndex(std::size_t index) const noexcept override;
         std::shared_ptr<SRoute> RouteByName(const std::string &name) const noexcept override;
         std::shared_ptr<SPath> PathByStopIDs(TStopID start, TStopID end) const noexcept override;
+        std::size_t StopNodeIDsByID(std::span<const TStopID> ids, std::vector<CStreetMap::TNodeID> &nodeids) const override;
+        SMemoryReport MemoryUsage() const noexcept;
 };
 
 #endif
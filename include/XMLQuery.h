@@ -0,0 +1,24 @@
+#ifndef XMLQUERY_H
+#define XMLQUERY_H
+
+#include <memory>
+#include <string>
+#include "XMLReader.h"
+
+// Streams a CXMLReader once and returns only the elements matching a small
+// path expression, e.g. "//way[tag[@k='highway'][@v='residential']]"
+class CXMLQuery{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        CXMLQuery(std::shared_ptr< CXMLReader > src, const std::string &expression);
+        ~CXMLQuery();
+
+        bool Valid() const noexcept;
+        bool End() const;
+        bool ReadMatch(SXMLEntity &entity);
+};
+
+#endif
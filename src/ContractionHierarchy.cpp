@@ -0,0 +1,776 @@
+#include "ContractionHierarchy.h"
+#include "IDIndex.h"
+#include "BinaryColumnIO.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+struct CContractionHierarchy::SWorkspace::SImplementation{
+    using TVertex = CRoadGraph::TVertex;
+    using THeapEntry = std::pair<double, TVertex>;
+
+    //Valid only when DGeneration matches the workspace's, so nothing is cleared between queries
+    struct SVertexState{
+        double DDistance;
+        uint32_t DGeneration;
+        uint32_t DParentArc;
+        TVertex DParent;
+    };
+
+    //Index 0 searches forward from the source, index 1 backward from the target
+    std::vector<SVertexState> DStates[2];
+    std::vector<THeapEntry> DHeaps[2];
+    uint32_t DGeneration = 0;
+    std::size_t DSettledCount = 0;
+    //Scratch for unpacking paths
+    std::vector<uint32_t> DPathArcs;
+    std::vector<uint32_t> DArcStack;
+
+    //Starts a query over vertexcount vertices
+    void Reset(std::size_t vertexcount){
+        for(int Side = 0; Side < 2; Side++){
+            if(DStates[Side].size() < vertexcount){
+                DStates[Side].resize(vertexcount, SVertexState{0, 0, 0, 0});
+            }
+            DHeaps[Side].clear();
+        }
+        DGeneration++;
+        if(DGeneration == 0){
+            //Wrapped around, stale states could now look current
+            for(int Side = 0; Side < 2; Side++){
+                for(auto &State : DStates[Side]){
+                    State.DGeneration = 0;
+                }
+            }
+            DGeneration = 1;
+        }
+        DSettledCount = 0;
+    }
+
+    bool Reached(int side, TVertex vertex) const noexcept{
+        return DStates[side][vertex].DGeneration == DGeneration;
+    }
+
+    //Lowers the distance of vertex if distance beats it, heap entries left behind are skipped when popped
+    void Relax(int side, TVertex vertex, double distance, uint32_t arc, TVertex parent){
+        auto &State = DStates[side][vertex];
+        if((State.DGeneration != DGeneration)||(distance < State.DDistance)){
+            State = {distance, DGeneration, arc, parent};
+            DHeaps[side].push_back({distance, vertex});
+            std::push_heap(DHeaps[side].begin(), DHeaps[side].end(), std::greater<THeapEntry>());
+        }
+    }
+
+    double TopKey(int side) const noexcept{
+        return DHeaps[side].empty() ? NoPathExists : DHeaps[side].front().first;
+    }
+
+    THeapEntry Pop(int side) noexcept{
+        std::pop_heap(DHeaps[side].begin(), DHeaps[side].end(), std::greater<THeapEntry>());
+        auto Entry = DHeaps[side].back();
+        DHeaps[side].pop_back();
+        return Entry;
+    }
+};
+
+CContractionHierarchy::SWorkspace::SWorkspace() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CContractionHierarchy::SWorkspace::SWorkspace(SWorkspace &&workspace) noexcept = default;
+
+CContractionHierarchy::SWorkspace &CContractionHierarchy::SWorkspace::operator=(SWorkspace &&workspace) noexcept = default;
+
+CContractionHierarchy::SWorkspace::~SWorkspace(){
+
+}
+
+std::size_t CContractionHierarchy::SWorkspace::SettledCount() const noexcept{
+    return DImplementation ? DImplementation->DSettledCount : 0;
+}
+
+struct CContractionHierarchy::SImplementation{
+    using TWorkspace = SWorkspace::SImplementation;
+
+    std::vector<CStreetMap::TNodeID> DNodeIDs;
+    std::vector<uint32_t> DRanks;
+    //Arcs to higher ranked vertices, those leaving v are DUpOffsets[v] to DUpOffsets[v+1]
+    std::vector<uint32_t> DUpOffsets{0};
+    std::vector<TVertex> DUpTargets;
+    std::vector<double> DUpWeights;
+    std::vector<uint32_t> DUpArcs;
+    //Arcs from higher ranked vertices, those entering v are DDownOffsets[v] to DDownOffsets[v+1]
+    std::vector<uint32_t> DDownOffsets{0};
+    std::vector<TVertex> DDownSources;
+    std::vector<double> DDownWeights;
+    std::vector<uint32_t> DDownArcs;
+    //Head of every arc. Arcs below DOriginalArcCount are graph edges, shortcut s stands for arcs DShortcutFirst[s] then DShortcutSecond[s]
+    std::vector<TVertex> DArcTargets;
+    std::size_t DOriginalArcCount = 0;
+    std::vector<uint32_t> DShortcutFirst;
+    std::vector<uint32_t> DShortcutSecond;
+    //Built from a contracted graph only: the nodes inside original arc a are DShapeOffsets[a] to DShapeOffsets[a+1]
+    std::vector<uint32_t> DShapeOffsets;
+    std::vector<CStreetMap::TNodeID> DShapeNodeIDs;
+    CIDIndex DVertexIndex{CIDIndex::EType::Sorted};
+
+    //Arc between vertices still in the graph being contracted
+    struct SNeighbor{
+        TVertex DVertex;
+        double DWeight;
+        uint32_t DArc;
+    };
+
+    struct SShortcut{
+        TVertex DSource;
+        TVertex DTarget;
+        double DWeight;
+        uint32_t DFirst;
+        uint32_t DSecond;
+    };
+
+    //Bounded Dijkstra over the remaining graph that avoids the vertex being contracted, one per thread
+    struct SWitnessSearch{
+        std::vector<double> DDistances;
+        std::vector<uint32_t> DGenerations;
+        std::vector<std::pair<double, TVertex>> DHeap;
+        std::vector<SShortcut> DShortcuts;
+        uint32_t DGeneration = 0;
+
+        SWitnessSearch(std::size_t vertexcount) : DDistances(vertexcount, 0), DGenerations(vertexcount, 0){
+
+        }
+
+        double Distance(TVertex vertex) const noexcept{
+            return DGenerations[vertex] == DGeneration ? DDistances[vertex] : NoPathExists;
+        }
+
+        void Run(const std::vector<std::vector<SNeighbor>> &out, TVertex source, TVertex skip, double limit, std::size_t settlelimit){
+            DGeneration++;
+            if(DGeneration == 0){
+                std::fill(DGenerations.begin(), DGenerations.end(), 0);
+                DGeneration = 1;
+            }
+            DHeap.clear();
+            DDistances[source] = 0;
+            DGenerations[source] = DGeneration;
+            DHeap.push_back({0, source});
+            std::size_t Settled = 0;
+            while(!DHeap.empty()&&(Settled < settlelimit)){
+                std::pop_heap(DHeap.begin(), DHeap.end(), std::greater<std::pair<double, TVertex>>());
+                auto [Distance, Vertex] = DHeap.back();
+                DHeap.pop_back();
+                if(Distance > DDistances[Vertex]){
+                    continue;
+                }
+                if(Distance > limit){
+                    break;
+                }
+                Settled++;
+                for(auto &Neighbor : out[Vertex]){
+                    auto Candidate = Distance + Neighbor.DWeight;
+                    if((Neighbor.DVertex != skip)&&(Candidate <= limit)&&(Candidate < this->Distance(Neighbor.DVertex))){
+                        DDistances[Neighbor.DVertex] = Candidate;
+                        DGenerations[Neighbor.DVertex] = DGeneration;
+                        DHeap.push_back({Candidate, Neighbor.DVertex});
+                        std::push_heap(DHeap.begin(), DHeap.end(), std::greater<std::pair<double, TVertex>>());
+                    }
+                }
+            }
+        }
+    };
+
+    //Shortcuts contracting vertex needs: a pair of arcs through it gets one unless a witness path is strictly shorter
+    //A witness only as long may run through another vertex contracted in the same round, which would drop its own shortcut for the same reason
+    static void FindShortcuts(TVertex vertex, const std::vector<std::vector<SNeighbor>> &out, const std::vector<std::vector<SNeighbor>> &in, SWitnessSearch &witness, std::size_t settlelimit, std::vector<SShortcut> &shortcuts){
+        shortcuts.clear();
+        for(auto &Incoming : in[vertex]){
+            double Limit = -1;
+            for(auto &Outgoing : out[vertex]){
+                if(Outgoing.DVertex != Incoming.DVertex){
+                    Limit = std::max(Limit, Incoming.DWeight + Outgoing.DWeight);
+                }
+            }
+            if(Limit < 0){
+                continue;
+            }
+            witness.Run(out, Incoming.DVertex, vertex, Limit, settlelimit);
+            for(auto &Outgoing : out[vertex]){
+                auto Weight = Incoming.DWeight + Outgoing.DWeight;
+                if((Outgoing.DVertex != Incoming.DVertex)&&(witness.Distance(Outgoing.DVertex) >= Weight)){
+                    shortcuts.push_back({Incoming.DVertex, Outgoing.DVertex, Weight, Incoming.DArc, Outgoing.DArc});
+                }
+            }
+        }
+    }
+
+    static SNeighbor *FindNeighbor(std::vector<SNeighbor> &neighbors, TVertex vertex) noexcept{
+        auto Found = std::find_if(neighbors.begin(), neighbors.end(), [vertex](const SNeighbor &neighbor){ return neighbor.DVertex == vertex; });
+        return Found == neighbors.end() ? nullptr : &*Found;
+    }
+
+    static void RemoveNeighbor(std::vector<SNeighbor> &neighbors, TVertex vertex){
+        std::erase_if(neighbors, [vertex](const SNeighbor &neighbor){ return neighbor.DVertex == vertex; });
+    }
+
+    void Build(const CRoadGraph &graph, const SOptions &options){
+        auto VertexCount = graph.VertexCount();
+        auto Offsets = graph.Offsets();
+        auto Targets = graph.Targets();
+        auto Lengths = graph.Lengths();
+
+        //Graph edges become the first arcs, dropping self loops and all but the shortest of parallel edges
+        std::vector<std::vector<SNeighbor>> Out(VertexCount), In(VertexCount);
+        std::vector<TVertex> ArcTargets;
+        std::vector<uint32_t> ArcEdges;
+        for(TVertex Source = 0; Source < VertexCount; Source++){
+            for(auto Edge = Offsets[Source]; Edge < Offsets[Source + 1]; Edge++){
+                auto Target = Targets[Edge];
+                if(Target == Source){
+                    continue;
+                }
+                if(auto Existing = FindNeighbor(Out[Source], Target)){
+                    if(Lengths[Edge] < Existing->DWeight){
+                        Existing->DWeight = Lengths[Edge];
+                        FindNeighbor(In[Target], Source)->DWeight = Lengths[Edge];
+                        ArcEdges[Existing->DArc] = Edge;
+                    }
+                    continue;
+                }
+                auto Arc = static_cast<uint32_t>(ArcTargets.size());
+                Out[Source].push_back({Target, Lengths[Edge], Arc});
+                In[Target].push_back({Source, Lengths[Edge], Arc});
+                ArcTargets.push_back(Target);
+                ArcEdges.push_back(Edge);
+            }
+        }
+        auto OriginalArcCount = ArcTargets.size();
+        std::vector<uint32_t> ShapeOffsets;
+        std::vector<CStreetMap::TNodeID> ShapeNodeIDs;
+        if(graph.ShapeNodeCount()){
+            std::vector<CStreetMap::TNodeID> EdgeNodeIDs;
+            ShapeOffsets.push_back(0);
+            for(auto Edge : ArcEdges){
+                graph.EdgeNodeIDs(Edge, EdgeNodeIDs);
+                ShapeNodeIDs.insert(ShapeNodeIDs.end(), EdgeNodeIDs.begin() + 1, EdgeNodeIDs.end() - 1);
+                ShapeOffsets.push_back(static_cast<uint32_t>(ShapeNodeIDs.size()));
+            }
+        }
+
+        //Contract in rounds: every vertex whose priority beats all of its neighbours' is contracted at once
+        //No two of them are adjacent, so their shortcuts can be found in parallel against the same graph
+        auto Threads = ResolveThreadCount(options.DThreadCount);
+        std::vector<SWitnessSearch> Witnesses(Threads, SWitnessSearch(VertexCount));
+        auto ForEachChunk = [&](std::size_t count, auto func){
+            auto ChunkSize = (count + Threads - 1) / Threads;
+            ParallelFor(Threads, Threads, [&](std::size_t begin, std::size_t end){
+                for(auto Chunk = begin; Chunk < end; Chunk++){
+                    for(auto Index = Chunk * ChunkSize; Index < std::min(count, (Chunk + 1) * ChunkSize); Index++){
+                        func(Witnesses[Chunk], Index);
+                    }
+                }
+            });
+        };
+
+        //Edge difference plus contracted neighbours, which spreads contraction evenly over the map
+        std::vector<int64_t> Priorities(VertexCount, 0);
+        std::vector<int64_t> ContractedNeighbors(VertexCount, 0);
+        auto Before = [&](TVertex vertex1, TVertex vertex2){
+            return (Priorities[vertex1] < Priorities[vertex2])||((Priorities[vertex1] == Priorities[vertex2])&&(vertex1 < vertex2));
+        };
+        std::vector<uint32_t> Ranks(VertexCount, 0);
+        std::vector<std::vector<SNeighbor>> UpArcs(VertexCount), DownArcs(VertexCount);
+        std::vector<uint32_t> ShortcutFirst, ShortcutSecond;
+        std::vector<TVertex> Remaining(VertexCount), Updated;
+        for(TVertex Vertex = 0; Vertex < VertexCount; Vertex++){
+            Remaining[Vertex] = Vertex;
+        }
+        Updated = Remaining;
+        std::vector<uint8_t> Selected, Dirty(VertexCount, 0), Done(VertexCount, 0);
+        std::vector<TVertex> Contracting;
+        std::vector<std::vector<SShortcut>> Shortcuts;
+        uint32_t NextRank = 0;
+        while(!Remaining.empty()){
+            ForEachChunk(Updated.size(), [&](SWitnessSearch &witness, std::size_t index){
+                auto Vertex = Updated[index];
+                FindShortcuts(Vertex, Out, In, witness, options.DWitnessSettleLimit, witness.DShortcuts);
+                Priorities[Vertex] = int64_t(witness.DShortcuts.size()) - int64_t(In[Vertex].size() + Out[Vertex].size()) + ContractedNeighbors[Vertex];
+            });
+            Selected.assign(Remaining.size(), 0);
+            ForEachChunk(Remaining.size(), [&](SWitnessSearch &, std::size_t index){
+                auto Vertex = Remaining[index];
+                auto Beats = [&](const SNeighbor &neighbor){ return Before(Vertex, neighbor.DVertex); };
+                Selected[index] = std::all_of(Out[Vertex].begin(), Out[Vertex].end(), Beats)&&std::all_of(In[Vertex].begin(), In[Vertex].end(), Beats);
+            });
+            Contracting.clear();
+            for(std::size_t Index = 0; Index < Remaining.size(); Index++){
+                if(Selected[Index]){
+                    Contracting.push_back(Remaining[Index]);
+                }
+            }
+            Shortcuts.resize(Contracting.size());
+            ForEachChunk(Contracting.size(), [&](SWitnessSearch &witness, std::size_t index){
+                FindShortcuts(Contracting[index], Out, In, witness, options.DWitnessSettleLimit, Shortcuts[index]);
+            });
+
+            //Applied in vertex order so the hierarchy is the same for every thread count
+            Updated.clear();
+            for(std::size_t Index = 0; Index < Contracting.size(); Index++){
+                auto Vertex = Contracting[Index];
+                Ranks[Vertex] = NextRank++;
+                Done[Vertex] = 1;
+                UpArcs[Vertex] = std::move(Out[Vertex]);
+                DownArcs[Vertex] = std::move(In[Vertex]);
+                Out[Vertex] = {};
+                In[Vertex] = {};
+                for(auto &Neighbor : UpArcs[Vertex]){
+                    RemoveNeighbor(In[Neighbor.DVertex], Vertex);
+                    ContractedNeighbors[Neighbor.DVertex]++;
+                    Dirty[Neighbor.DVertex] = 1;
+                }
+                for(auto &Neighbor : DownArcs[Vertex]){
+                    RemoveNeighbor(Out[Neighbor.DVertex], Vertex);
+                    ContractedNeighbors[Neighbor.DVertex]++;
+                    Dirty[Neighbor.DVertex] = 1;
+                }
+                for(auto &Shortcut : Shortcuts[Index]){
+                    auto Existing = FindNeighbor(Out[Shortcut.DSource], Shortcut.DTarget);
+                    if(Existing && (Existing->DWeight <= Shortcut.DWeight)){
+                        continue;
+                    }
+                    auto Arc = static_cast<uint32_t>(ArcTargets.size());
+                    ArcTargets.push_back(Shortcut.DTarget);
+                    ShortcutFirst.push_back(Shortcut.DFirst);
+                    ShortcutSecond.push_back(Shortcut.DSecond);
+                    if(Existing){
+                        *Existing = {Shortcut.DTarget, Shortcut.DWeight, Arc};
+                        *FindNeighbor(In[Shortcut.DTarget], Shortcut.DSource) = {Shortcut.DSource, Shortcut.DWeight, Arc};
+                    }
+                    else{
+                        Out[Shortcut.DSource].push_back({Shortcut.DTarget, Shortcut.DWeight, Arc});
+                        In[Shortcut.DTarget].push_back({Shortcut.DSource, Shortcut.DWeight, Arc});
+                    }
+                }
+            }
+            std::erase_if(Remaining, [&](TVertex vertex){ return Done[vertex]; });
+            for(auto Vertex : Remaining){
+                if(Dirty[Vertex]){
+                    Updated.push_back(Vertex);
+                    Dirty[Vertex] = 0;
+                }
+            }
+        }
+
+        //Flatten the arcs kept at each vertex into the two CSR arrays
+        DUpOffsets.assign(1, 0);
+        DDownOffsets.assign(1, 0);
+        DUpTargets.clear();
+        DUpWeights.clear();
+        DUpArcs.clear();
+        DDownSources.clear();
+        DDownWeights.clear();
+        DDownArcs.clear();
+        for(TVertex Vertex = 0; Vertex < VertexCount; Vertex++){
+            for(auto &Arc : UpArcs[Vertex]){
+                DUpTargets.push_back(Arc.DVertex);
+                DUpWeights.push_back(Arc.DWeight);
+                DUpArcs.push_back(Arc.DArc);
+            }
+            for(auto &Arc : DownArcs[Vertex]){
+                DDownSources.push_back(Arc.DVertex);
+                DDownWeights.push_back(Arc.DWeight);
+                DDownArcs.push_back(Arc.DArc);
+            }
+            DUpOffsets.push_back(static_cast<uint32_t>(DUpTargets.size()));
+            DDownOffsets.push_back(static_cast<uint32_t>(DDownSources.size()));
+        }
+        DNodeIDs.assign(graph.NodeIDs().begin(), graph.NodeIDs().end());
+        DRanks = std::move(Ranks);
+        DArcTargets = std::move(ArcTargets);
+        DOriginalArcCount = OriginalArcCount;
+        DShortcutFirst = std::move(ShortcutFirst);
+        DShortcutSecond = std::move(ShortcutSecond);
+        DShapeOffsets = std::move(ShapeOffsets);
+        DShapeNodeIDs = std::move(ShapeNodeIDs);
+        DVertexIndex.Build(DNodeIDs);
+    }
+
+    //Forward searches relax up arcs and are stalled through down arcs, backward searches the other way round
+    const std::vector<uint32_t> &SideOffsets(int side) const noexcept{
+        return side ? DDownOffsets : DUpOffsets;
+    }
+
+    const std::vector<TVertex> &SideHeads(int side) const noexcept{
+        return side ? DDownSources : DUpTargets;
+    }
+
+    const std::vector<double> &SideWeights(int side) const noexcept{
+        return side ? DDownWeights : DUpWeights;
+    }
+
+    //Stall on demand: a higher vertex the search reached more cheaply means distance is not the shortest to vertex, so it need not be spread
+    bool Stalled(const TWorkspace &workspace, int side, TVertex vertex, double distance) const noexcept{
+        auto &Offsets = SideOffsets(1 - side);
+        auto &Heads = SideHeads(1 - side);
+        auto &Weights = SideWeights(1 - side);
+        for(auto Arc = Offsets[vertex]; Arc < Offsets[vertex + 1]; Arc++){
+            if(workspace.Reached(side, Heads[Arc])&&(workspace.DStates[side][Heads[Arc]].DDistance + Weights[Arc] < distance)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Spread(TWorkspace &workspace, int side, TVertex vertex, double distance) const{
+        auto &Offsets = SideOffsets(side);
+        auto &Heads = SideHeads(side);
+        auto &Weights = SideWeights(side);
+        auto &Arcs = side ? DDownArcs : DUpArcs;
+        for(auto Arc = Offsets[vertex]; Arc < Offsets[vertex + 1]; Arc++){
+            workspace.Relax(side, Heads[Arc], distance + Weights[Arc], Arcs[Arc], vertex);
+        }
+    }
+
+    //Every vertex one upward search settles without being stalled, with its distance
+    void SearchSpace(TWorkspace &workspace, TVertex vertex, int side, std::vector<SSearchEntry> &entries) const{
+        workspace.Reset(DNodeIDs.size());
+        workspace.Relax(side, vertex, 0, 0, InvalidVertex);
+        while(!workspace.DHeaps[side].empty()){
+            auto [Distance, Vertex] = workspace.Pop(side);
+            if((Distance > workspace.DStates[side][Vertex].DDistance)||Stalled(workspace, side, Vertex, Distance)){
+                continue;
+            }
+            workspace.DSettledCount++;
+            entries.push_back({Vertex, Distance});
+            Spread(workspace, side, Vertex, Distance);
+        }
+    }
+
+    //Runs the upward searches from both ends, returns the distance and the vertex where the shortest path peaks
+    double Search(TWorkspace &workspace, TVertex source, TVertex target, TVertex &meeting) const{
+        workspace.Reset(DNodeIDs.size());
+        workspace.Relax(0, source, 0, 0, InvalidVertex);
+        workspace.Relax(1, target, 0, 0, InvalidVertex);
+        double Best = NoPathExists;
+        meeting = InvalidVertex;
+        while(true){
+            auto ForwardKey = workspace.TopKey(0);
+            auto BackwardKey = workspace.TopKey(1);
+            if(std::min(ForwardKey, BackwardKey) >= Best){
+                break;
+            }
+            int Side = ForwardKey <= BackwardKey ? 0 : 1;
+            auto [Distance, Vertex] = workspace.Pop(Side);
+            if(Distance > workspace.DStates[Side][Vertex].DDistance){
+                continue;
+            }
+            workspace.DSettledCount++;
+            if(workspace.Reached(1 - Side, Vertex)&&(Distance + workspace.DStates[1 - Side][Vertex].DDistance < Best)){
+                Best = Distance + workspace.DStates[1 - Side][Vertex].DDistance;
+                meeting = Vertex;
+            }
+            if(!Stalled(workspace, Side, Vertex, Distance)){
+                Spread(workspace, Side, Vertex, Distance);
+            }
+        }
+        return Best;
+    }
+
+    //Appends the nodes after the tail of arc, expanding shortcuts into the arcs they stand for
+    void AppendArc(uint32_t arc, std::vector<uint32_t> &stack, std::vector<CStreetMap::TNodeID> &path) const{
+        stack.clear();
+        stack.push_back(arc);
+        while(!stack.empty()){
+            auto Arc = stack.back();
+            stack.pop_back();
+            if(Arc >= DOriginalArcCount){
+                stack.push_back(DShortcutSecond[Arc - DOriginalArcCount]);
+                stack.push_back(DShortcutFirst[Arc - DOriginalArcCount]);
+                continue;
+            }
+            if(!DShapeOffsets.empty()){
+                path.insert(path.end(), DShapeNodeIDs.begin() + DShapeOffsets[Arc], DShapeNodeIDs.begin() + DShapeOffsets[Arc + 1]);
+            }
+            path.push_back(DNodeIDs[DArcTargets[Arc]]);
+        }
+    }
+
+    double FindShortestPath(TWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> *path) const{
+        if(path){
+            path->clear();
+        }
+        workspace.DSettledCount = 0;
+        auto SourceIndex = DVertexIndex.Find(src);
+        auto TargetIndex = DVertexIndex.Find(dest);
+        if((SourceIndex == CIDIndex::InvalidIndex)||(TargetIndex == CIDIndex::InvalidIndex)){
+            return NoPathExists;
+        }
+        auto Source = static_cast<TVertex>(SourceIndex);
+        auto Target = static_cast<TVertex>(TargetIndex);
+        TVertex Meeting;
+        auto Distance = Search(workspace, Source, Target, Meeting);
+        if((Distance == NoPathExists)||!path){
+            return Distance;
+        }
+        //Arcs up from the source to the peak, then down to the target
+        auto &Forward = workspace.DStates[0];
+        auto &Backward = workspace.DStates[1];
+        workspace.DPathArcs.clear();
+        for(auto Vertex = Meeting; Vertex != Source; Vertex = Forward[Vertex].DParent){
+            workspace.DPathArcs.push_back(Forward[Vertex].DParentArc);
+        }
+        std::reverse(workspace.DPathArcs.begin(), workspace.DPathArcs.end());
+        for(auto Vertex = Meeting; Vertex != Target; Vertex = Backward[Vertex].DParent){
+            workspace.DPathArcs.push_back(Backward[Vertex].DParentArc);
+        }
+        path->push_back(src);
+        for(auto Arc : workspace.DPathArcs){
+            AppendArc(Arc, workspace.DArcStack, *path);
+        }
+        return Distance;
+    }
+
+    bool Save(std::shared_ptr<CDataSink> sink) const{
+        std::vector<char> Buffer(SerializedMagic, SerializedMagic + sizeof(SerializedMagic));
+        uint32_t Version = SerializedVersion;
+        uint64_t Counts[7] = {DNodeIDs.size(), DUpTargets.size(), DDownSources.size(), DArcTargets.size(), DOriginalArcCount, DShapeOffsets.size(), DShapeNodeIDs.size()};
+        AppendValue(Buffer, Version);
+        AppendBytes(Buffer, Counts, sizeof(Counts));
+        AppendColumn(Buffer, DNodeIDs);
+        AppendColumn(Buffer, DRanks);
+        AppendColumn(Buffer, DUpOffsets);
+        AppendColumn(Buffer, DUpTargets);
+        AppendColumn(Buffer, DUpWeights);
+        AppendColumn(Buffer, DUpArcs);
+        AppendColumn(Buffer, DDownOffsets);
+        AppendColumn(Buffer, DDownSources);
+        AppendColumn(Buffer, DDownWeights);
+        AppendColumn(Buffer, DDownArcs);
+        AppendColumn(Buffer, DArcTargets);
+        AppendColumn(Buffer, DShortcutFirst);
+        AppendColumn(Buffer, DShortcutSecond);
+        AppendColumn(Buffer, DShapeOffsets);
+        AppendColumn(Buffer, DShapeNodeIDs);
+        return sink->Write(Buffer);
+    }
+
+    //Offsets must climb from 0 to count
+    static bool ValidOffsets(const std::vector<uint32_t> &offsets, std::size_t count){
+        return (offsets.front() == 0)&&(offsets.back() == count)&&std::is_sorted(offsets.begin(), offsets.end());
+    }
+
+    static bool ValidWeights(const std::vector<double> &weights){
+        return std::all_of(weights.begin(), weights.end(), [](double weight){ return std::isfinite(weight) && (weight >= 0); });
+    }
+
+    template <typename T>
+    static bool AllBelow(const std::vector<T> &values, std::size_t bound){
+        return std::all_of(values.begin(), values.end(), [bound](T value){ return value < bound; });
+    }
+
+    bool Load(std::shared_ptr<CDataSource> source){
+        char Magic[sizeof(SerializedMagic)];
+        uint32_t Version;
+        uint64_t Counts[7];
+        if(!ReadExact(source, Magic, sizeof(Magic))||std::memcmp(Magic, SerializedMagic, sizeof(Magic))){
+            return false;
+        }
+        if(!ReadExact(source, &Version, sizeof(Version))||(Version != SerializedVersion)){
+            return false;
+        }
+        if(!ReadExact(source, Counts, sizeof(Counts))||(Counts[0] >= InvalidVertex)){
+            return false;
+        }
+        auto VertexCount = Counts[0], ArcCount = Counts[3], OriginalArcCount = Counts[4];
+        if((Counts[1] > ArcCount)||(Counts[2] > ArcCount)||(ArcCount >= std::numeric_limits<uint32_t>::max())||(OriginalArcCount > ArcCount)){
+            return false;
+        }
+        //Shape offsets are either absent or one per original arc plus one
+        if((Counts[5] && (Counts[5] != OriginalArcCount + 1))||(!Counts[5] && Counts[6])||(Counts[6] >= std::numeric_limits<uint32_t>::max())){
+            return false;
+        }
+        std::vector<CStreetMap::TNodeID> NodeIDs, ShapeNodeIDs;
+        std::vector<uint32_t> Ranks, UpOffsets, UpArcs, DownOffsets, DownArcs, ShortcutFirst, ShortcutSecond, ShapeOffsets;
+        std::vector<TVertex> UpTargets, DownSources, ArcTargets;
+        std::vector<double> UpWeights, DownWeights;
+        if(!ReadColumn(source, NodeIDs, VertexCount)||!ReadColumn(source, Ranks, VertexCount)){
+            return false;
+        }
+        if(!ReadColumn(source, UpOffsets, VertexCount + 1)||!ReadColumn(source, UpTargets, Counts[1])||!ReadColumn(source, UpWeights, Counts[1])||!ReadColumn(source, UpArcs, Counts[1])){
+            return false;
+        }
+        if(!ReadColumn(source, DownOffsets, VertexCount + 1)||!ReadColumn(source, DownSources, Counts[2])||!ReadColumn(source, DownWeights, Counts[2])||!ReadColumn(source, DownArcs, Counts[2])){
+            return false;
+        }
+        if(!ReadColumn(source, ArcTargets, ArcCount)||!ReadColumn(source, ShortcutFirst, ArcCount - OriginalArcCount)||!ReadColumn(source, ShortcutSecond, ArcCount - OriginalArcCount)){
+            return false;
+        }
+        if(!ReadColumn(source, ShapeOffsets, Counts[5])||!ReadColumn(source, ShapeNodeIDs, Counts[6])){
+            return false;
+        }
+        if(!ValidOffsets(UpOffsets, Counts[1])||!ValidOffsets(DownOffsets, Counts[2])||(Counts[5] && !ValidOffsets(ShapeOffsets, Counts[6]))){
+            return false;
+        }
+        if(!AllBelow(UpTargets, VertexCount)||!AllBelow(DownSources, VertexCount)||!AllBelow(ArcTargets, VertexCount)||!AllBelow(UpArcs, ArcCount)||!AllBelow(DownArcs, ArcCount)){
+            return false;
+        }
+        if(!ValidWeights(UpWeights)||!ValidWeights(DownWeights)){
+            return false;
+        }
+        //Ranks are a permutation, and shortcuts only stand for older arcs so unpacking always ends
+        std::vector<uint8_t> Ranked(VertexCount, 0);
+        for(auto Rank : Ranks){
+            if((Rank >= VertexCount)||Ranked[Rank]){
+                return false;
+            }
+            Ranked[Rank] = 1;
+        }
+        for(std::size_t Shortcut = 0; Shortcut < ShortcutFirst.size(); Shortcut++){
+            if((ShortcutFirst[Shortcut] >= OriginalArcCount + Shortcut)||(ShortcutSecond[Shortcut] >= OriginalArcCount + Shortcut)){
+                return false;
+            }
+        }
+        DNodeIDs = std::move(NodeIDs);
+        DRanks = std::move(Ranks);
+        DUpOffsets = std::move(UpOffsets);
+        DUpTargets = std::move(UpTargets);
+        DUpWeights = std::move(UpWeights);
+        DUpArcs = std::move(UpArcs);
+        DDownOffsets = std::move(DownOffsets);
+        DDownSources = std::move(DownSources);
+        DDownWeights = std::move(DownWeights);
+        DDownArcs = std::move(DownArcs);
+        DArcTargets = std::move(ArcTargets);
+        DOriginalArcCount = OriginalArcCount;
+        DShortcutFirst = std::move(ShortcutFirst);
+        DShortcutSecond = std::move(ShortcutSecond);
+        DShapeOffsets = std::move(ShapeOffsets);
+        DShapeNodeIDs = std::move(ShapeNodeIDs);
+        DVertexIndex.Build(DNodeIDs);
+        return true;
+    }
+};
+
+CContractionHierarchy::CContractionHierarchy() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CContractionHierarchy::CContractionHierarchy(CContractionHierarchy &&hierarchy) noexcept : DImplementation(std::move(hierarchy.DImplementation)){
+    hierarchy.DImplementation = std::make_unique<SImplementation>();
+}
+
+CContractionHierarchy &CContractionHierarchy::operator=(CContractionHierarchy &&hierarchy) noexcept{
+    std::swap(DImplementation, hierarchy.DImplementation);
+    return *this;
+}
+
+CContractionHierarchy::~CContractionHierarchy(){
+
+}
+
+void CContractionHierarchy::Build(const CRoadGraph &graph){
+    Build(graph, SOptions());
+}
+
+//Replaces the hierarchy with one over graph, which may be freed afterwards
+void CContractionHierarchy::Build(const CRoadGraph &graph, const SOptions &options){
+    DImplementation->Build(graph, options);
+}
+
+std::size_t CContractionHierarchy::VertexCount() const noexcept{
+    return DImplementation->DNodeIDs.size();
+}
+
+std::size_t CContractionHierarchy::ArcCount() const noexcept{
+    return DImplementation->DUpTargets.size() + DImplementation->DDownSources.size();
+}
+
+std::size_t CContractionHierarchy::ShortcutCount() const noexcept{
+    return DImplementation->DShortcutFirst.size();
+}
+
+SMemoryUsage CContractionHierarchy::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    Usage.Add(DImplementation->DNodeIDs);
+    Usage.Add(DImplementation->DRanks);
+    Usage.Add(DImplementation->DUpOffsets);
+    Usage.Add(DImplementation->DUpTargets);
+    Usage.Add(DImplementation->DUpWeights);
+    Usage.Add(DImplementation->DUpArcs);
+    Usage.Add(DImplementation->DDownOffsets);
+    Usage.Add(DImplementation->DDownSources);
+    Usage.Add(DImplementation->DDownWeights);
+    Usage.Add(DImplementation->DDownArcs);
+    Usage.Add(DImplementation->DArcTargets);
+    Usage.Add(DImplementation->DShortcutFirst);
+    Usage.Add(DImplementation->DShortcutSecond);
+    Usage.Add(DImplementation->DShapeOffsets);
+    Usage.Add(DImplementation->DShapeNodeIDs);
+    Usage += DImplementation->DVertexIndex.MemoryUsage();
+    return Usage;
+}
+
+//Vertex of the node with id, InvalidVertex if it is not in the hierarchy
+CContractionHierarchy::TVertex CContractionHierarchy::VertexByNodeID(CStreetMap::TNodeID id) const noexcept{
+    auto Index = DImplementation->DVertexIndex.Find(id);
+    return Index == CIDIndex::InvalidIndex ? InvalidVertex : static_cast<TVertex>(Index);
+}
+
+CStreetMap::TNodeID CContractionHierarchy::NodeID(TVertex vertex) const noexcept{
+    return vertex < DImplementation->DNodeIDs.size() ? DImplementation->DNodeIDs[vertex] : CStreetMap::InvalidNodeID;
+}
+
+//Position of vertex in the contraction order, higher ranks were contracted later
+uint32_t CContractionHierarchy::Rank(TVertex vertex) const noexcept{
+    return vertex < DImplementation->DRanks.size() ? DImplementation->DRanks[vertex] : InvalidVertex;
+}
+
+double CContractionHierarchy::Distance(CStreetMap::TNodeID src, CStreetMap::TNodeID dest) const{
+    //One workspace per thread, shared by every hierarchy that thread uses
+    thread_local SWorkspace Workspace;
+    return Distance(Workspace, src, dest);
+}
+
+double CContractionHierarchy::Distance(SWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest) const{
+    if(!workspace.DImplementation){
+        workspace.DImplementation = std::make_unique<SWorkspace::SImplementation>();
+    }
+    return DImplementation->FindShortestPath(*workspace.DImplementation, src, dest, nullptr);
+}
+
+double CContractionHierarchy::FindShortestPath(CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path) const{
+    thread_local SWorkspace Workspace;
+    return FindShortestPath(Workspace, src, dest, path);
+}
+
+double CContractionHierarchy::FindShortestPath(SWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path) const{
+    if(!workspace.DImplementation){
+        workspace.DImplementation = std::make_unique<SWorkspace::SImplementation>();
+    }
+    return DImplementation->FindShortestPath(*workspace.DImplementation, src, dest, &path);
+}
+
+//Replaces entries with the vertices an upward search from the node settles and their distances, for many to many tables
+//Forward spaces follow arcs out of the node, backward spaces arcs into it. Returns the number of entries
+std::size_t CContractionHierarchy::SearchSpace(SWorkspace &workspace, CStreetMap::TNodeID id, EDirection direction, std::vector<SSearchEntry> &entries) const{
+    if(!workspace.DImplementation){
+        workspace.DImplementation = std::make_unique<SWorkspace::SImplementation>();
+    }
+    entries.clear();
+    workspace.DImplementation->DSettledCount = 0;
+    auto Vertex = VertexByNodeID(id);
+    if(Vertex != InvalidVertex){
+        DImplementation->SearchSpace(*workspace.DImplementation, Vertex, direction == EDirection::Forward ? 0 : 1, entries);
+    }
+    return entries.size();
+}
+
+bool CContractionHierarchy::Save(std::shared_ptr<CDataSink> sink) const{
+    return DImplementation->Save(sink);
+}
+
+//Replaces the hierarchy with one written by Save, the hierarchy is unchanged if the data is not valid
+bool CContractionHierarchy::Load(std::shared_ptr<CDataSource> source){
+    return DImplementation->Load(source);
+}
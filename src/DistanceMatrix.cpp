@@ -0,0 +1,238 @@
+#include "DistanceMatrix.h"
+#include "BinaryColumnIO.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+struct CDistanceMatrix::SImplementation{
+    using TVertex = CContractionHierarchy::TVertex;
+
+    std::vector<CStreetMap::TNodeID> DSourceNodeIDs;
+    std::vector<CStreetMap::TNodeID> DTargetNodeIDs;
+    std::vector<double> DValues;
+
+    //Backward search spaces of every target grouped by vertex, the targets reaching vertex v are entries DOffsets[v] to DOffsets[v+1]
+    struct SBuckets{
+        std::vector<uint32_t> DOffsets;
+        std::vector<uint32_t> DColumns;
+        std::vector<double> DDistances;
+
+        void Build(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> targets, std::size_t threads){
+            struct SEntry{
+                TVertex DVertex;
+                uint32_t DColumn;
+                double DDistance;
+            };
+            std::vector<std::vector<SEntry>> ChunkEntries(threads);
+            auto ChunkSize = (targets.size() + threads - 1) / threads;
+            ParallelFor(threads, threads, [&](std::size_t begin, std::size_t end){
+                CContractionHierarchy::SWorkspace Workspace;
+                std::vector<CContractionHierarchy::SSearchEntry> Space;
+                for(auto Chunk = begin; Chunk < end; Chunk++){
+                    for(auto Column = Chunk * ChunkSize; Column < std::min(targets.size(), (Chunk + 1) * ChunkSize); Column++){
+                        hierarchy.SearchSpace(Workspace, targets[Column], CContractionHierarchy::EDirection::Backward, Space);
+                        for(auto &Entry : Space){
+                            ChunkEntries[Chunk].push_back({Entry.DVertex, static_cast<uint32_t>(Column), Entry.DDistance});
+                        }
+                    }
+                }
+            });
+            //Counting sort by vertex, taking the chunks in column order so every bucket lists its columns in order
+            DOffsets.assign(hierarchy.VertexCount() + 1, 0);
+            for(auto &Entries : ChunkEntries){
+                for(auto &Entry : Entries){
+                    DOffsets[Entry.DVertex + 1]++;
+                }
+            }
+            std::partial_sum(DOffsets.begin(), DOffsets.end(), DOffsets.begin());
+            std::vector<uint32_t> Next(DOffsets.begin(), DOffsets.end() - 1);
+            DColumns.resize(DOffsets.back());
+            DDistances.resize(DOffsets.back());
+            for(auto &Entries : ChunkEntries){
+                for(auto &Entry : Entries){
+                    auto Position = Next[Entry.DVertex]++;
+                    DColumns[Position] = Entry.DColumn;
+                    DDistances[Position] = Entry.DDistance;
+                }
+            }
+        }
+    };
+
+    //Fills rows begin to end into values, which starts at row begin
+    //Each thread takes a contiguous run of rows, so its writes stay in its own part of the matrix
+    static void ComputeRows(const CContractionHierarchy &hierarchy, const SBuckets &buckets, std::span<const CStreetMap::TNodeID> sources, std::size_t columns, std::size_t begin, std::size_t end, double *values, std::size_t threads){
+        ParallelFor(end - begin, threads, [&](std::size_t first, std::size_t last){
+            CContractionHierarchy::SWorkspace Workspace;
+            std::vector<CContractionHierarchy::SSearchEntry> Space;
+            for(auto Row = first; Row < last; Row++){
+                auto RowValues = values + Row * columns;
+                std::fill(RowValues, RowValues + columns, NoPathExists);
+                hierarchy.SearchSpace(Workspace, sources[begin + Row], CContractionHierarchy::EDirection::Forward, Space);
+                for(auto &Entry : Space){
+                    for(auto Index = buckets.DOffsets[Entry.DVertex]; Index < buckets.DOffsets[Entry.DVertex + 1]; Index++){
+                        auto Total = Entry.DDistance + buckets.DDistances[Index];
+                        auto &Value = RowValues[buckets.DColumns[Index]];
+                        if(Total < Value){
+                            Value = Total;
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    //Magic, version, row and column counts, then the source and target node IDs
+    static std::vector<char> Header(std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets){
+        std::vector<char> Buffer(SerializedMagic, SerializedMagic + sizeof(SerializedMagic));
+        uint32_t Version = SerializedVersion;
+        uint64_t Counts[2] = {sources.size(), targets.size()};
+        AppendValue(Buffer, Version);
+        AppendBytes(Buffer, Counts, sizeof(Counts));
+        AppendColumn(Buffer, sources);
+        AppendColumn(Buffer, targets);
+        return Buffer;
+    }
+
+    bool Load(std::shared_ptr<CDataSource> source){
+        char Magic[sizeof(SerializedMagic)];
+        uint32_t Version;
+        uint64_t Counts[2];
+        if(!ReadExact(source, Magic, sizeof(Magic))||std::memcmp(Magic, SerializedMagic, sizeof(Magic))){
+            return false;
+        }
+        if(!ReadExact(source, &Version, sizeof(Version))||(Version != SerializedVersion)){
+            return false;
+        }
+        //The value count in bytes must not overflow
+        if(!ReadExact(source, Counts, sizeof(Counts))||(Counts[1] && (Counts[0] > std::numeric_limits<std::size_t>::max() / sizeof(double) / Counts[1]))){
+            return false;
+        }
+        std::vector<CStreetMap::TNodeID> SourceNodeIDs, TargetNodeIDs;
+        std::vector<double> Values;
+        if(!ReadColumn(source, SourceNodeIDs, Counts[0])||!ReadColumn(source, TargetNodeIDs, Counts[1])||!ReadColumn(source, Values, Counts[0] * Counts[1])){
+            return false;
+        }
+        DSourceNodeIDs = std::move(SourceNodeIDs);
+        DTargetNodeIDs = std::move(TargetNodeIDs);
+        DValues = std::move(Values);
+        return true;
+    }
+};
+
+CDistanceMatrix::CDistanceMatrix() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CDistanceMatrix::CDistanceMatrix(CDistanceMatrix &&matrix) noexcept : DImplementation(std::move(matrix.DImplementation)){
+    matrix.DImplementation = std::make_unique<SImplementation>();
+}
+
+CDistanceMatrix &CDistanceMatrix::operator=(CDistanceMatrix &&matrix) noexcept{
+    std::swap(DImplementation, matrix.DImplementation);
+    return *this;
+}
+
+CDistanceMatrix::~CDistanceMatrix(){
+
+}
+
+void CDistanceMatrix::Build(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets){
+    Build(hierarchy, sources, targets, SOptions());
+}
+
+//Replaces the matrix with the distances from every source to every target, NoPathExists where there is no path
+void CDistanceMatrix::Build(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets, const SOptions &options){
+    auto Threads = ResolveThreadCount(options.DThreadCount);
+    SImplementation::SBuckets Buckets;
+    Buckets.Build(hierarchy, targets, Threads);
+    std::vector<double> Values(sources.size() * targets.size());
+    SImplementation::ComputeRows(hierarchy, Buckets, sources, targets.size(), 0, sources.size(), Values.data(), Threads);
+    DImplementation->DSourceNodeIDs.assign(sources.begin(), sources.end());
+    DImplementation->DTargetNodeIDs.assign(targets.begin(), targets.end());
+    DImplementation->DValues = std::move(Values);
+}
+
+bool CDistanceMatrix::Write(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets, std::shared_ptr<CDataSink> sink){
+    return Write(hierarchy, sources, targets, sink, SOptions());
+}
+
+//Computes the matrix a block of rows at a time and writes it to sink in the Save format, never holding more than one block
+bool CDistanceMatrix::Write(const CContractionHierarchy &hierarchy, std::span<const CStreetMap::TNodeID> sources, std::span<const CStreetMap::TNodeID> targets, std::shared_ptr<CDataSink> sink, const SOptions &options){
+    auto Threads = ResolveThreadCount(options.DThreadCount);
+    auto BlockRows = std::max<std::size_t>(1, options.DBlockRows);
+    if(!sink->Write(SImplementation::Header(sources, targets))){
+        return false;
+    }
+    SImplementation::SBuckets Buckets;
+    Buckets.Build(hierarchy, targets, Threads);
+    std::vector<double> Block(std::min(BlockRows, sources.size()) * targets.size());
+    std::vector<char> Bytes;
+    for(std::size_t Begin = 0; Begin < sources.size(); Begin += BlockRows){
+        auto End = std::min(Begin + BlockRows, sources.size());
+        SImplementation::ComputeRows(hierarchy, Buckets, sources, targets.size(), Begin, End, Block.data(), Threads);
+        Bytes.clear();
+        AppendColumn(Bytes, std::span<const double>(Block.data(), (End - Begin) * targets.size()));
+        if(!sink->Write(Bytes)){
+            return false;
+        }
+    }
+    return true;
+}
+
+//Node of every stop in bussystem, in stop index order
+std::vector<CStreetMap::TNodeID> CDistanceMatrix::StopNodeIDs(const CBusSystem &bussystem){
+    std::vector<CStreetMap::TNodeID> NodeIDs;
+    NodeIDs.reserve(bussystem.StopCount());
+    for(std::size_t Index = 0; Index < bussystem.StopCount(); Index++){
+        auto Stop = bussystem.StopByIndex(Index);
+        NodeIDs.push_back(Stop ? Stop->NodeID() : CStreetMap::InvalidNodeID);
+    }
+    return NodeIDs;
+}
+
+std::size_t CDistanceMatrix::RowCount() const noexcept{
+    return DImplementation->DSourceNodeIDs.size();
+}
+
+std::size_t CDistanceMatrix::ColumnCount() const noexcept{
+    return DImplementation->DTargetNodeIDs.size();
+}
+
+double CDistanceMatrix::Distance(std::size_t row, std::size_t column) const noexcept{
+    if((row >= RowCount())||(column >= ColumnCount())){
+        return NoPathExists;
+    }
+    return DImplementation->DValues[row * ColumnCount() + column];
+}
+
+std::span<const double> CDistanceMatrix::Row(std::size_t row) const noexcept{
+    if(row >= RowCount()){
+        return {};
+    }
+    return std::span<const double>(DImplementation->DValues).subspan(row * ColumnCount(), ColumnCount());
+}
+
+std::span<const double> CDistanceMatrix::Values() const noexcept{
+    return DImplementation->DValues;
+}
+
+std::span<const CStreetMap::TNodeID> CDistanceMatrix::SourceNodeIDs() const noexcept{
+    return DImplementation->DSourceNodeIDs;
+}
+
+std::span<const CStreetMap::TNodeID> CDistanceMatrix::TargetNodeIDs() const noexcept{
+    return DImplementation->DTargetNodeIDs;
+}
+
+bool CDistanceMatrix::Save(std::shared_ptr<CDataSink> sink) const{
+    auto Buffer = SImplementation::Header(DImplementation->DSourceNodeIDs, DImplementation->DTargetNodeIDs);
+    AppendColumn(Buffer, Values());
+    return sink->Write(Buffer);
+}
+
+//Replaces the matrix with one written by Save or Write, the matrix is unchanged if the data is not valid
+bool CDistanceMatrix::Load(std::shared_ptr<CDataSource> source){
+    return DImplementation->Load(source);
+}
@@ -0,0 +1,25 @@
+#include "FileDataSink.h"
+
+// Opens (and truncates) filename for binary writing
+CFileDataSink::CFileDataSink(const std::string &filename){
+    DFile = std::fopen(filename.c_str(), "wb");
+}
+
+CFileDataSink::~CFileDataSink(){
+    if(DFile){
+        std::fclose(DFile);
+    }
+}
+
+// Returns false if the file could not be opened
+bool CFileDataSink::Valid() const noexcept{
+    return DFile != nullptr;
+}
+
+bool CFileDataSink::Put(const char &ch) noexcept{
+    return DFile && (std::fputc(ch, DFile) != EOF);
+}
+
+bool CFileDataSink::Write(const std::vector<char> &buf) noexcept{
+    return DFile && (std::fwrite(buf.data(), 1, buf.size(), DFile) == buf.size());
+}
@@ -0,0 +1,28 @@
+#include "GeographicUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+double SGeographicUtils::DegreesToRadians(double degrees) noexcept{
+    return degrees * std::numbers::pi / 180.0;
+}
+
+//Great circle distance on a spherical Earth
+double SGeographicUtils::HaversineDistanceInMeters(const CStreetMap::SLocation &location1, const CStreetMap::SLocation &location2) noexcept{
+    auto Latitude1 = DegreesToRadians(location1.DLatitude);
+    auto Latitude2 = DegreesToRadians(location2.DLatitude);
+    auto SinLatitude = std::sin((Latitude2 - Latitude1) / 2);
+    auto SinLongitude = std::sin(DegreesToRadians(location2.DLongitude - location1.DLongitude) / 2);
+    auto A = SinLatitude * SinLatitude + std::cos(Latitude1) * std::cos(Latitude2) * SinLongitude * SinLongitude;
+    return 2 * EarthRadiusMeters * std::asin(std::min(1.0, std::sqrt(A)));
+}
+
+//Chord length on the unit sphere for a great circle distance, distances past half the globe clamp to the diameter
+double SGeographicUtils::MetersToChord(double meters) noexcept{
+    auto Angle = std::min(meters / EarthRadiusMeters, std::numbers::pi);
+    return 2 * std::sin(Angle / 2);
+}
+
+double SGeographicUtils::ChordToMeters(double chord) noexcept{
+    return 2 * EarthRadiusMeters * std::asin(std::clamp(chord / 2, 0.0, 1.0));
+}
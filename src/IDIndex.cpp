@@ -0,0 +1,467 @@
+#include "IDIndex.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+
+// Interpolation steps tried before falling back to binary search
+static constexpr int InterpolationSteps = 8;
+
+// The open addressing table grows once it would pass MaxLoadNumerator / MaxLoadDenominator full
+// Linear probing stays at a few probes per lookup up to three quarters full
+static constexpr std::size_t MaxLoadNumerator = 3;
+static constexpr std::size_t MaxLoadDenominator = 4;
+
+// Positions are stored as uint32_t, so larger ones cannot be represented
+static void CheckPosition(std::size_t index){
+    if(index > std::numeric_limits<uint32_t>::max()){
+        throw std::length_error("CIDIndex positions must fit in 32 bits");
+    }
+}
+
+// Spreads sequential IDs across the open addressing table
+static inline std::size_t HashID(CIDIndex::TID id) noexcept{
+    return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ULL) ^ (id >> 29));
+}
+
+// True if every ID is larger than the one before it, chunks of ids are checked on separate threads
+static bool StrictlyIncreasing(const std::vector<CIDIndex::TID> &ids, std::size_t threadcount){
+    std::atomic<bool> Increasing = true;
+    ParallelFor(ids.size(), threadcount, [&](std::size_t begin, std::size_t end){
+        for(auto Index = std::max<std::size_t>(begin, 1); (Index < end) && Increasing.load(std::memory_order_relaxed); Index++){
+            if(ids[Index - 1] >= ids[Index]){
+                Increasing = false;
+            }
+        }
+    });
+    return Increasing;
+}
+
+// Sorts one run per thread, then merges neighbouring runs pairwise until one is left
+template <typename T>
+static void ParallelSort(std::vector<T> &values, std::size_t threadcount){
+    auto Runs = std::min(ResolveThreadCount(threadcount), values.size());
+    if(Runs <= 1){
+        std::sort(values.begin(), values.end());
+        return;
+    }
+    std::vector<std::size_t> Bounds;
+    for(std::size_t Run = 0; Run <= Runs; Run++){
+        Bounds.push_back(values.size() * Run / Runs);
+    }
+    ParallelFor(Runs, threadcount, [&](std::size_t begin, std::size_t end){
+        for(auto Run = begin; Run < end; Run++){
+            std::sort(values.begin() + Bounds[Run], values.begin() + Bounds[Run + 1]);
+        }
+    });
+    while(Bounds.size() > 2){
+        auto Pairs = (Bounds.size() - 1) / 2;
+        ParallelFor(Pairs, threadcount, [&](std::size_t begin, std::size_t end){
+            for(auto Pair = begin; Pair < end; Pair++){
+                std::inplace_merge(values.begin() + Bounds[Pair * 2], values.begin() + Bounds[Pair * 2 + 1], values.begin() + Bounds[Pair * 2 + 2]);
+            }
+        });
+        std::vector<std::size_t> Merged;
+        for(std::size_t Bound = 0; Bound < Bounds.size(); Bound += 2){
+            Merged.push_back(Bounds[Bound]);
+        }
+        if(Merged.back() != Bounds.back()){
+            Merged.push_back(Bounds.back());
+        }
+        Bounds = std::move(Merged);
+    }
+}
+
+CIDIndex::CIDIndex(EType type) : DType(type), DCount(0), DSlotMask(0){
+
+}
+
+CIDIndex::EType CIDIndex::Type() const noexcept{
+    return DType;
+}
+
+std::size_t CIDIndex::Count() const noexcept{
+    return DCount;
+}
+
+// Heap held by whichever backend is in use
+SMemoryUsage CIDIndex::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    Usage.Add(DHashIndices);
+    Usage.Add(DSortedIDs);
+    Usage.Add(DSortedIndices);
+    Usage.Add(DSlotIDs);
+    Usage.Add(DSlotIndices);
+    return Usage;
+}
+
+// Builds the index so that ids[i] maps to i, if an ID repeats the last one wins
+// Sorted and OpenAddressing spread the work over threadcount threads, 0 uses every hardware thread
+void CIDIndex::Build(const std::vector<TID> &ids, std::size_t threadcount){
+    DHashIndices.clear();
+    DSortedIDs.clear();
+    DSortedIndices.clear();
+    DSlotIDs.clear();
+    DSlotIndices.clear();
+    DSlotMask = 0;
+    DCount = 0;
+    if(!ids.empty()){
+        CheckPosition(ids.size() - 1);
+    }
+
+    switch(DType){
+        case EType::Hash:
+            DHashIndices.reserve(ids.size());
+            for(std::size_t Index = 0; Index < ids.size(); Index++){
+                DHashIndices[ids[Index]] = Index;
+            }
+            DCount = DHashIndices.size();
+            break;
+
+        case EType::Sorted:{
+            // OSM files are normally sorted by ID, so the indices can be skipped entirely
+            if(StrictlyIncreasing(ids, threadcount)){
+                DSortedIDs = ids;
+            }
+            else{
+                std::vector<std::pair<TID, uint32_t>> Pairs(ids.size());
+                ParallelFor(ids.size(), threadcount, [&](std::size_t begin, std::size_t end){
+                    for(auto Index = begin; Index < end; Index++){
+                        Pairs[Index] = {ids[Index], static_cast<uint32_t>(Index)};
+                    }
+                });
+                ParallelSort(Pairs, threadcount);
+                for(std::size_t Index = 0; Index < Pairs.size(); Index++){
+                    // Keep only the last index of each repeated ID
+                    if((Index + 1 < Pairs.size())&&(Pairs[Index + 1].first == Pairs[Index].first)){
+                        continue;
+                    }
+                    DSortedIDs.push_back(Pairs[Index].first);
+                    DSortedIndices.push_back(Pairs[Index].second);
+                }
+            }
+            DSortedIDs.shrink_to_fit();
+            DSortedIndices.shrink_to_fit();
+            DCount = DSortedIDs.size();
+            break;
+        }
+
+        case EType::OpenAddressing:{
+            std::size_t Capacity = 16;
+            while(Capacity * MaxLoadNumerator < ids.size() * MaxLoadDenominator){
+                Capacity *= 2;
+            }
+            DSlotIDs.assign(Capacity, EmptyID);
+            DSlotIndices.assign(Capacity, 0);
+            DSlotMask = Capacity - 1;
+            // Threads claim empty slots with a compare and swap, and a repeated ID keeps the largest position,
+            // so the table finds the same positions as inserting in order would
+            std::atomic<std::size_t> Count = 0;
+            ParallelFor(ids.size(), threadcount, [&](std::size_t begin, std::size_t end){
+                std::size_t Claimed = 0;
+                for(auto Index = begin; Index < end; Index++){
+                    if(ids[Index] == EmptyID){
+                        continue;
+                    }
+                    auto Slot = HashID(ids[Index]) & DSlotMask;
+                    while(true){
+                        std::atomic_ref<TID> SlotID(DSlotIDs[Slot]);
+                        auto Current = EmptyID;
+                        if(SlotID.compare_exchange_strong(Current, ids[Index], std::memory_order_relaxed)){
+                            Claimed++;
+                            break;
+                        }
+                        if(Current == ids[Index]){
+                            break;
+                        }
+                        Slot = (Slot + 1) & DSlotMask;
+                    }
+                    std::atomic_ref<uint32_t> Position(DSlotIndices[Slot]);
+                    auto Current = Position.load(std::memory_order_relaxed);
+                    while((Current < Index)&&!Position.compare_exchange_weak(Current, static_cast<uint32_t>(Index), std::memory_order_relaxed)){
+                    }
+                }
+                Count += Claimed;
+            });
+            DCount = Count;
+            break;
+        }
+    }
+}
+
+// Returns the position of id, or InvalidIndex if it is not in the index
+std::size_t CIDIndex::Find(TID id) const noexcept{
+    switch(DType){
+        case EType::Hash:{
+            auto Search = DHashIndices.find(id);
+            if(Search != DHashIndices.end()){
+                return Search->second;
+            }
+            return InvalidIndex;
+        }
+        case EType::Sorted:
+            return SortedFind(DSortedIDs, DSortedIndices, id);
+        case EType::OpenAddressing:
+            return SlotFind(id);
+    }
+    return InvalidIndex;
+}
+
+// Interpolation search over sorted ids, IDs are close to evenly spread so this usually takes one or two probes
+// positions[i] is the column position of ids[i], an empty positions means ids[i] is at position i
+std::size_t CIDIndex::SortedFind(std::span<const TID> ids, std::span<const uint32_t> positions, TID id) noexcept{
+    if(ids.empty()){
+        return InvalidIndex;
+    }
+    std::size_t Low = 0;
+    std::size_t High = ids.size() - 1;
+    for(int Step = 0; Step < InterpolationSteps; Step++){
+        if((Low > High)||(id < ids[Low])||(id > ids[High])){
+            return InvalidIndex;
+        }
+        auto LowID = ids[Low];
+        auto HighID = ids[High];
+        std::size_t Probe = Low;
+        if(HighID != LowID){
+            // 128-bit product so huge IDs cannot overflow
+            Probe = Low + static_cast<std::size_t>((static_cast<unsigned __int128>(id - LowID) * (High - Low)) / (HighID - LowID));
+        }
+        if(ids[Probe] == id){
+            return positions.empty() ? Probe : positions[Probe];
+        }
+        if(ids[Probe] < id){
+            Low = Probe + 1;
+        }
+        else{
+            if(Probe == 0){
+                return InvalidIndex;
+            }
+            High = Probe - 1;
+        }
+    }
+    // Badly skewed ID ranges fall back to binary search
+    if(Low > High){
+        return InvalidIndex;
+    }
+    auto Begin = ids.begin() + Low;
+    auto End = ids.begin() + High + 1;
+    auto Search = std::lower_bound(Begin, End, id);
+    if((Search != End)&&(*Search == id)){
+        std::size_t Position = Search - ids.begin();
+        return positions.empty() ? Position : positions[Position];
+    }
+    return InvalidIndex;
+}
+
+// First interpolation probe of a sorted search over all of ids
+std::size_t CIDIndex::SortedProbe(std::span<const TID> ids, TID id) noexcept{
+    auto LowID = ids.front();
+    auto HighID = ids.back();
+    if((id <= LowID)||(HighID == LowID)){
+        return 0;
+    }
+    if(id >= HighID){
+        return ids.size() - 1;
+    }
+    return static_cast<std::size_t>((static_cast<unsigned __int128>(id - LowID) * (ids.size() - 1)) / (HighID - LowID));
+}
+
+// Sets indices[i] to Find(ids[i]) and returns how many were found
+// Lookups run in groups: the first probe of every ID in a group is prefetched before any is searched,
+// so the group's cache misses overlap instead of being paid one after another
+std::size_t CIDIndex::FindBatch(std::span<const TID> ids, std::vector<std::size_t> &indices) const{
+    if(DType == EType::Sorted){
+        return SortedFindBatch(DSortedIDs, DSortedIndices, ids, indices);
+    }
+    indices.resize(ids.size());
+    std::size_t Found = 0;
+    for(std::size_t GroupBegin = 0; GroupBegin < ids.size(); GroupBegin += BatchGroupSize){
+        auto GroupEnd = std::min(ids.size(), GroupBegin + BatchGroupSize);
+        if((DType == EType::OpenAddressing)&&!DSlotIDs.empty()){
+            for(auto Index = GroupBegin; Index < GroupEnd; Index++){
+                auto Slot = HashID(ids[Index]) & DSlotMask;
+                __builtin_prefetch(&DSlotIDs[Slot]);
+                __builtin_prefetch(&DSlotIndices[Slot]);
+            }
+        }
+        for(auto Index = GroupBegin; Index < GroupEnd; Index++){
+            indices[Index] = Find(ids[Index]);
+            Found += indices[Index] != InvalidIndex;
+        }
+    }
+    return Found;
+}
+
+// SortedFind of every query with the same group prefetching as FindBatch, returns how many were found
+std::size_t CIDIndex::SortedFindBatch(std::span<const TID> ids, std::span<const uint32_t> positions, std::span<const TID> queries, std::vector<std::size_t> &indices){
+    indices.resize(queries.size());
+    std::size_t Found = 0;
+    for(std::size_t GroupBegin = 0; GroupBegin < queries.size(); GroupBegin += BatchGroupSize){
+        auto GroupEnd = std::min(queries.size(), GroupBegin + BatchGroupSize);
+        if(!ids.empty()){
+            for(auto Index = GroupBegin; Index < GroupEnd; Index++){
+                auto Probe = SortedProbe(ids, queries[Index]);
+                __builtin_prefetch(&ids[Probe]);
+                if(!positions.empty()){
+                    __builtin_prefetch(&positions[Probe]);
+                }
+            }
+        }
+        for(auto Index = GroupBegin; Index < GroupEnd; Index++){
+            indices[Index] = SortedFind(ids, positions, queries[Index]);
+            Found += indices[Index] != InvalidIndex;
+        }
+    }
+    return Found;
+}
+
+// Maps id to index, adding id if it is not in the index yet
+// Hash and OpenAddressing take amortized constant time, Sorted shifts every later entry
+void CIDIndex::Set(TID id, std::size_t index){
+    CheckPosition(index);
+    switch(DType){
+        case EType::Hash:
+            if(DHashIndices.insert_or_assign(id, index).second){
+                DCount++;
+            }
+            break;
+
+        case EType::Sorted:{
+            auto Search = std::lower_bound(DSortedIDs.begin(), DSortedIDs.end(), id);
+            std::size_t Position = Search - DSortedIDs.begin();
+            if((Search == DSortedIDs.end())||(*Search != id)||(Position != index)){
+                SortedStorePositions();
+            }
+            if((Search != DSortedIDs.end())&&(*Search == id)){
+                if(!DSortedIndices.empty()){
+                    DSortedIndices[Position] = index;
+                }
+                break;
+            }
+            DSortedIDs.insert(Search, id);
+            DSortedIndices.insert(DSortedIndices.begin() + Position, index);
+            DCount++;
+            break;
+        }
+
+        case EType::OpenAddressing:{
+            if(id == EmptyID){
+                break;
+            }
+            if((DCount + 1) * MaxLoadDenominator > DSlotIDs.size() * MaxLoadNumerator){
+                SlotGrow();
+            }
+            auto Slot = HashID(id) & DSlotMask;
+            while((DSlotIDs[Slot] != EmptyID)&&(DSlotIDs[Slot] != id)){
+                Slot = (Slot + 1) & DSlotMask;
+            }
+            if(DSlotIDs[Slot] == EmptyID){
+                DCount++;
+            }
+            DSlotIDs[Slot] = id;
+            DSlotIndices[Slot] = index;
+            break;
+        }
+    }
+}
+
+// Removes id, returns false if it was not in the index
+bool CIDIndex::Erase(TID id){
+    switch(DType){
+        case EType::Hash:
+            if(DHashIndices.erase(id)){
+                DCount--;
+                return true;
+            }
+            return false;
+
+        case EType::Sorted:{
+            auto Search = std::lower_bound(DSortedIDs.begin(), DSortedIDs.end(), id);
+            if((Search == DSortedIDs.end())||(*Search != id)){
+                return false;
+            }
+            // Every later ID would sit one entry before its position
+            SortedStorePositions();
+            DSortedIndices.erase(DSortedIndices.begin() + (Search - DSortedIDs.begin()));
+            DSortedIDs.erase(Search);
+            DCount--;
+            return true;
+        }
+
+        case EType::OpenAddressing:{
+            if(DSlotIDs.empty()||(id == EmptyID)){
+                return false;
+            }
+            auto Slot = HashID(id) & DSlotMask;
+            while(DSlotIDs[Slot] != id){
+                if(DSlotIDs[Slot] == EmptyID){
+                    return false;
+                }
+                Slot = (Slot + 1) & DSlotMask;
+            }
+            // Backward shift deletion: pull later entries of the probe run into the hole so no tombstones are needed
+            auto Hole = Slot;
+            auto Next = (Slot + 1) & DSlotMask;
+            while(DSlotIDs[Next] != EmptyID){
+                auto Home = HashID(DSlotIDs[Next]) & DSlotMask;
+                // Move Next unless its home lies cyclically in (Hole, Next]
+                if(((Next - Home) & DSlotMask) >= ((Next - Hole) & DSlotMask)){
+                    DSlotIDs[Hole] = DSlotIDs[Next];
+                    DSlotIndices[Hole] = DSlotIndices[Next];
+                    Hole = Next;
+                }
+                Next = (Next + 1) & DSlotMask;
+            }
+            DSlotIDs[Hole] = EmptyID;
+            DCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Positions stop matching the order of the IDs once entries are added or removed, so they are stored from then on
+void CIDIndex::SortedStorePositions(){
+    if(DSortedIndices.size() == DSortedIDs.size()){
+        return;
+    }
+    DSortedIndices.resize(DSortedIDs.size());
+    for(std::size_t Entry = 0; Entry < DSortedIndices.size(); Entry++){
+        DSortedIndices[Entry] = Entry;
+    }
+}
+
+// Doubles the open addressing table and reinserts every entry
+void CIDIndex::SlotGrow(){
+    std::vector<TID> IDs(std::max<std::size_t>(16, DSlotIDs.size() * 2), EmptyID);
+    std::vector<uint32_t> Indices(IDs.size(), 0);
+    std::swap(IDs, DSlotIDs);
+    std::swap(Indices, DSlotIndices);
+    DSlotMask = DSlotIDs.size() - 1;
+    for(std::size_t Slot = 0; Slot < IDs.size(); Slot++){
+        if(IDs[Slot] == EmptyID){
+            continue;
+        }
+        auto NewSlot = HashID(IDs[Slot]) & DSlotMask;
+        while(DSlotIDs[NewSlot] != EmptyID){
+            NewSlot = (NewSlot + 1) & DSlotMask;
+        }
+        DSlotIDs[NewSlot] = IDs[Slot];
+        DSlotIndices[NewSlot] = Indices[Slot];
+    }
+}
+
+std::size_t CIDIndex::SlotFind(TID id) const noexcept{
+    if(DSlotIDs.empty()||(id == EmptyID)){
+        return InvalidIndex;
+    }
+    auto Slot = HashID(id) & DSlotMask;
+    while(DSlotIDs[Slot] != EmptyID){
+        if(DSlotIDs[Slot] == id){
+            return DSlotIndices[Slot];
+        }
+        Slot = (Slot + 1) & DSlotMask;
+    }
+    return InvalidIndex;
+}
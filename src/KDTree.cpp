@@ -0,0 +1,410 @@
+#include "KDTree.h"
+#include "GeographicUtils.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <thread>
+
+struct CKDTree::SImplementation{
+    //Ranges this small are scanned instead of split further
+    inline static constexpr std::size_t LeafSize = 8;
+
+    //Points as unit vectors so straight line (chord) order matches great circle order
+    //The tree is implicit: range [begin, end) splits at its middle element on DSplitDimensions[middle]
+    std::vector<double> DCoordinates[3];
+    std::vector<uint32_t> DItems;
+    std::vector<uint8_t> DSplitDimensions;
+
+    struct SPoint{
+        double DCoordinates[3];
+    };
+
+    std::size_t DThreadCount = 0;
+
+    //Changes since the last build
+    //Points added or moved since are kept in DExtraPoints/DExtraItems and scanned by every query
+    //Removed and moved points keep their place in the tree for its splits, with InvalidItem as their item
+    //DPositions[item] is the tree position of item, or DItems.size() + its extra entry, built by the first change
+    inline static constexpr uint32_t NoPosition = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> DPositions;
+    std::vector<SPoint> DExtraPoints;
+    std::vector<uint32_t> DExtraItems;
+    std::size_t DRemovedCount = 0;
+    std::size_t DUpdateCount = 0;
+
+    static SPoint ToUnitVector(const CStreetMap::SLocation &location) noexcept{
+        auto Latitude = SGeographicUtils::DegreesToRadians(location.DLatitude);
+        auto Longitude = SGeographicUtils::DegreesToRadians(location.DLongitude);
+        return SPoint{{std::cos(Latitude) * std::cos(Longitude), std::cos(Latitude) * std::sin(Longitude), std::sin(Latitude)}};
+    }
+
+    double SquaredChord(const SPoint &point, std::size_t position) const noexcept{
+        double Sum = 0;
+        for(int Dimension = 0; Dimension < 3; Dimension++){
+            auto Delta = point.DCoordinates[Dimension] - DCoordinates[Dimension][position];
+            Sum += Delta * Delta;
+        }
+        return Sum;
+    }
+
+    static double SquaredChord(const SPoint &point, const SPoint &other) noexcept{
+        double Sum = 0;
+        for(int Dimension = 0; Dimension < 3; Dimension++){
+            auto Delta = point.DCoordinates[Dimension] - other.DCoordinates[Dimension];
+            Sum += Delta * Delta;
+        }
+        return Sum;
+    }
+
+    std::size_t Count() const noexcept{
+        return DItems.size() - DRemovedCount + DExtraItems.size();
+    }
+
+    //Splits order[begin, end) around its middle on the widest dimension, the top levels run on their own threads
+    void Split(const std::vector<SPoint> &points, std::vector<uint32_t> &order, std::size_t begin, std::size_t end, std::size_t threads){
+        if(end - begin <= LeafSize){
+            return;
+        }
+        double Low[3], High[3];
+        for(int Dimension = 0; Dimension < 3; Dimension++){
+            Low[Dimension] = High[Dimension] = points[order[begin]].DCoordinates[Dimension];
+        }
+        for(auto Index = begin + 1; Index < end; Index++){
+            for(int Dimension = 0; Dimension < 3; Dimension++){
+                Low[Dimension] = std::min(Low[Dimension], points[order[Index]].DCoordinates[Dimension]);
+                High[Dimension] = std::max(High[Dimension], points[order[Index]].DCoordinates[Dimension]);
+            }
+        }
+        int Widest = 0;
+        for(int Dimension = 1; Dimension < 3; Dimension++){
+            if(High[Dimension] - Low[Dimension] > High[Widest] - Low[Widest]){
+                Widest = Dimension;
+            }
+        }
+        auto Middle = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + Middle, order.begin() + end, [&](uint32_t left, uint32_t right){
+            return points[left].DCoordinates[Widest] < points[right].DCoordinates[Widest];
+        });
+        DSplitDimensions[Middle] = Widest;
+        if(threads > 1){
+            std::thread Left([&, begin, Middle, threads]{ Split(points, order, begin, Middle, threads / 2); });
+            Split(points, order, Middle + 1, end, threads - threads / 2);
+            Left.join();
+        }
+        else{
+            Split(points, order, begin, Middle, 1);
+            Split(points, order, Middle + 1, end, 1);
+        }
+    }
+
+    void Build(const std::vector<CStreetMap::SLocation> &locations, std::size_t threadcount){
+        std::vector<SPoint> Points(locations.size());
+        ParallelFor(locations.size(), threadcount, [&](std::size_t begin, std::size_t end){
+            for(auto Index = begin; Index < end; Index++){
+                Points[Index] = ToUnitVector(locations[Index]);
+            }
+        });
+        std::vector<uint32_t> Items(locations.size());
+        for(std::size_t Index = 0; Index < Items.size(); Index++){
+            Items[Index] = Index;
+        }
+        Build(Points, Items, threadcount);
+    }
+
+    //points[i] is reported as items[i]
+    void Build(const std::vector<SPoint> &points, const std::vector<uint32_t> &items, std::size_t threadcount){
+        std::vector<uint32_t> Order(points.size());
+        for(std::size_t Index = 0; Index < Order.size(); Index++){
+            Order[Index] = Index;
+        }
+        DSplitDimensions.assign(Order.size(), 0);
+        Split(points, Order, 0, Order.size(), ResolveThreadCount(threadcount));
+        for(int Dimension = 0; Dimension < 3; Dimension++){
+            DCoordinates[Dimension].resize(Order.size());
+            for(std::size_t Index = 0; Index < Order.size(); Index++){
+                DCoordinates[Dimension][Index] = points[Order[Index]].DCoordinates[Dimension];
+            }
+        }
+        DItems.resize(Order.size());
+        for(std::size_t Index = 0; Index < Order.size(); Index++){
+            DItems[Index] = items[Order[Index]];
+        }
+        DThreadCount = threadcount;
+        DPositions = std::vector<uint32_t>();
+        DExtraPoints.clear();
+        DExtraItems.clear();
+        DRemovedCount = 0;
+        DUpdateCount = 0;
+    }
+
+    //Position of item in the tree or past its end in the extras, NoPosition if it is in neither
+    uint32_t &PositionOf(uint32_t item){
+        if(DPositions.empty()){
+            for(std::size_t Position = 0; Position < DItems.size(); Position++){
+                if(DPositions.size() <= DItems[Position]){
+                    DPositions.resize(DItems[Position] + 1, NoPosition);
+                }
+                DPositions[DItems[Position]] = Position;
+            }
+        }
+        if(DPositions.size() <= item){
+            DPositions.resize(item + 1, NoPosition);
+        }
+        return DPositions[item];
+    }
+
+    //Takes item out of the tree or the extras
+    void Detach(uint32_t item){
+        auto &Current = PositionOf(item);
+        if(Current < DItems.size()){
+            DItems[Current] = InvalidItem;
+            DRemovedCount++;
+        }
+        else if(Current != NoPosition){
+            auto Extra = Current - DItems.size();
+            DPositions[DExtraItems.back()] = Current;
+            DExtraPoints[Extra] = DExtraPoints.back();
+            DExtraItems[Extra] = DExtraItems.back();
+            DExtraPoints.pop_back();
+            DExtraItems.pop_back();
+        }
+        Current = NoPosition;
+    }
+
+    void Changed(){
+        if(++DUpdateCount <= std::max(MinimumRebuildUpdates, Count() / 16)){
+            return;
+        }
+        std::vector<SPoint> Points;
+        std::vector<uint32_t> Items;
+        for(std::size_t Position = 0; Position < DItems.size(); Position++){
+            if(DItems[Position] != InvalidItem){
+                Points.push_back(SPoint{{DCoordinates[0][Position], DCoordinates[1][Position], DCoordinates[2][Position]}});
+                Items.push_back(DItems[Position]);
+            }
+        }
+        Points.insert(Points.end(), DExtraPoints.begin(), DExtraPoints.end());
+        Items.insert(Items.end(), DExtraItems.begin(), DExtraItems.end());
+        Build(Points, Items, DThreadCount);
+    }
+
+    void Update(uint32_t item, const CStreetMap::SLocation &location){
+        Detach(item);
+        PositionOf(item) = DItems.size() + DExtraItems.size();
+        DExtraPoints.push_back(ToUnitVector(location));
+        DExtraItems.push_back(item);
+        Changed();
+    }
+
+    void Remove(uint32_t item){
+        Detach(item);
+        Changed();
+    }
+
+    //Calls visit(item, squaredchord) for every point that may be within limit(), which may shrink as points are found
+    template <typename TVisit, typename TLimit>
+    void Search(const SPoint &point, std::size_t begin, std::size_t end, TVisit &visit, TLimit &limit) const{
+        if(end - begin <= LeafSize){
+            for(auto Position = begin; Position < end; Position++){
+                auto Distance = SquaredChord(point, Position);
+                if((Distance <= limit())&&(DItems[Position] != InvalidItem)){
+                    visit(DItems[Position], Distance);
+                }
+            }
+            return;
+        }
+        auto Middle = begin + (end - begin) / 2;
+        auto Dimension = DSplitDimensions[Middle];
+        auto Delta = point.DCoordinates[Dimension] - DCoordinates[Dimension][Middle];
+        auto Distance = SquaredChord(point, Middle);
+        if((Distance <= limit())&&(DItems[Middle] != InvalidItem)){
+            visit(DItems[Middle], Distance);
+        }
+        //Nearer half first so the far half is usually pruned
+        if(Delta < 0){
+            Search(point, begin, Middle, visit, limit);
+            if(Delta * Delta <= limit()){
+                Search(point, Middle + 1, end, visit, limit);
+            }
+        }
+        else{
+            Search(point, Middle + 1, end, visit, limit);
+            if(Delta * Delta <= limit()){
+                Search(point, begin, Middle, visit, limit);
+            }
+        }
+    }
+
+    //Searches the tree and then the points changed since it was built
+    template <typename TVisit, typename TLimit>
+    void Search(const SPoint &point, TVisit &visit, TLimit &limit) const{
+        if(!DItems.empty()){
+            Search(point, 0, DItems.size(), visit, limit);
+        }
+        for(std::size_t Extra = 0; Extra < DExtraItems.size(); Extra++){
+            auto Distance = SquaredChord(point, DExtraPoints[Extra]);
+            if(Distance <= limit()){
+                visit(DExtraItems[Extra], Distance);
+            }
+        }
+    }
+
+    //Converts (squared chord, item) pairs to neighbors sorted by distance then item
+    static void Finish(std::vector<std::pair<double, uint32_t>> &found, std::vector<SNeighbor> &neighbors){
+        neighbors.clear();
+        for(const auto &[Distance, Item] : found){
+            neighbors.push_back({Item, SGeographicUtils::ChordToMeters(std::sqrt(Distance))});
+        }
+        std::sort(neighbors.begin(), neighbors.end(), [](const SNeighbor &left, const SNeighbor &right){
+            return left.DDistance != right.DDistance ? left.DDistance < right.DDistance : left.DItem < right.DItem;
+        });
+    }
+
+    //Single neighbor search without any allocation, ties go to the lower item
+    SNeighbor Nearest(const CStreetMap::SLocation &location) const noexcept{
+        auto BestDistance = std::numeric_limits<double>::infinity();
+        auto BestItem = InvalidItem;
+        auto Limit = [&]{
+            return BestDistance;
+        };
+        auto Visit = [&](uint32_t item, double distance){
+            if((distance < BestDistance)||((distance == BestDistance)&&(item < BestItem))){
+                BestDistance = distance;
+                BestItem = item;
+            }
+        };
+        if(!Count()){
+            return SNeighbor{InvalidItem, BestDistance};
+        }
+        Search(ToUnitVector(location), Visit, Limit);
+        return SNeighbor{BestItem, SGeographicUtils::ChordToMeters(std::sqrt(BestDistance))};
+    }
+
+    std::size_t KNearest(const CStreetMap::SLocation &location, std::size_t k, std::vector<SNeighbor> &neighbors) const{
+        //Max heap of the k best so far
+        std::priority_queue<std::pair<double, uint32_t>> Best;
+        auto Point = ToUnitVector(location);
+        auto Limit = [&]{
+            return Best.size() < k ? std::numeric_limits<double>::infinity() : Best.top().first;
+        };
+        auto Visit = [&](uint32_t item, double distance){
+            Best.push({distance, item});
+            if(Best.size() > k){
+                Best.pop();
+            }
+        };
+        if(k){
+            Search(Point, Visit, Limit);
+        }
+        std::vector<std::pair<double, uint32_t>> Found;
+        while(!Best.empty()){
+            Found.push_back(Best.top());
+            Best.pop();
+        }
+        Finish(Found, neighbors);
+        return neighbors.size();
+    }
+
+    std::size_t Radius(const CStreetMap::SLocation &location, double meters, std::vector<SNeighbor> &neighbors) const{
+        std::vector<std::pair<double, uint32_t>> Found;
+        auto Chord = SGeographicUtils::MetersToChord(meters);
+        auto SquaredLimit = Chord * Chord;
+        auto Limit = [&]{
+            return SquaredLimit;
+        };
+        auto Visit = [&](uint32_t item, double distance){
+            Found.push_back({distance, item});
+        };
+        if(meters >= 0){
+            Search(ToUnitVector(location), Visit, Limit);
+        }
+        Finish(Found, neighbors);
+        return neighbors.size();
+    }
+};
+
+CKDTree::CKDTree() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CKDTree::CKDTree(CKDTree &&tree) noexcept : DImplementation(std::move(tree.DImplementation)){
+    tree.DImplementation = std::make_unique<SImplementation>();
+}
+
+CKDTree &CKDTree::operator=(CKDTree &&tree) noexcept{
+    std::swap(DImplementation, tree.DImplementation);
+    return *this;
+}
+
+CKDTree::~CKDTree(){
+
+}
+
+//Replaces the contents with points, points[i] is reported as item i
+void CKDTree::Build(const std::vector<CStreetMap::SLocation> &points, std::size_t threadcount){
+    DImplementation->Build(points, threadcount);
+}
+
+//Moves item to location, adding it if it is not in the tree
+//The tree is rebuilt once the changes since the last build pass MinimumRebuildUpdates or a sixteenth of the points
+void CKDTree::Update(uint32_t item, const CStreetMap::SLocation &location){
+    DImplementation->Update(item, location);
+}
+
+//Takes item out of the tree, items that are not in it are ignored
+void CKDTree::Remove(uint32_t item){
+    DImplementation->Remove(item);
+}
+
+std::size_t CKDTree::Count() const noexcept{
+    return DImplementation->Count();
+}
+
+SMemoryUsage CKDTree::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    for(const auto &Coordinates : DImplementation->DCoordinates){
+        Usage.Add(Coordinates);
+    }
+    Usage.Add(DImplementation->DItems);
+    Usage.Add(DImplementation->DSplitDimensions);
+    Usage.Add(DImplementation->DPositions);
+    Usage.Add(DImplementation->DExtraPoints);
+    Usage.Add(DImplementation->DExtraItems);
+    return Usage;
+}
+
+//Closest point to location, DItem is InvalidItem if the tree is empty
+CKDTree::SNeighbor CKDTree::Nearest(const CStreetMap::SLocation &location) const noexcept{
+    return DImplementation->Nearest(location);
+}
+
+//Fills neighbors with the k closest points nearest first, returns how many were found
+std::size_t CKDTree::KNearest(const CStreetMap::SLocation &location, std::size_t k, std::vector<SNeighbor> &neighbors) const{
+    return DImplementation->KNearest(location, k, neighbors);
+}
+
+//Fills neighbors with every point within meters of location nearest first, returns how many were found
+std::size_t CKDTree::Radius(const CStreetMap::SLocation &location, double meters, std::vector<SNeighbor> &neighbors) const{
+    return DImplementation->Radius(location, meters, neighbors);
+}
+
+//neighbors[i] is Nearest(locations[i]), queries are split across threadcount threads
+void CKDTree::NearestBatch(const std::vector<CStreetMap::SLocation> &locations, std::vector<SNeighbor> &neighbors, std::size_t threadcount) const{
+    neighbors.resize(locations.size());
+    ParallelFor(locations.size(), threadcount, [&](std::size_t begin, std::size_t end){
+        for(auto Index = begin; Index < end; Index++){
+            neighbors[Index] = Nearest(locations[Index]);
+        }
+    });
+}
+
+//neighbors[i] is the KNearest result for locations[i], queries are split across threadcount threads
+void CKDTree::KNearestBatch(const std::vector<CStreetMap::SLocation> &locations, std::size_t k, std::vector<std::vector<SNeighbor>> &neighbors, std::size_t threadcount) const{
+    neighbors.resize(locations.size());
+    ParallelFor(locations.size(), threadcount, [&](std::size_t begin, std::size_t end){
+        for(auto Index = begin; Index < end; Index++){
+            DImplementation->KNearest(locations[Index], k, neighbors[Index]);
+        }
+    });
+}
@@ -0,0 +1,389 @@
+#include "MappedStreetMap.h"
+#include "IDIndex.h"
+#include "OpenStreetMap.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Internal implementation
+//Cannot be access outside
+struct CMappedStreetMap::SImplementation{
+    //Owns the mapped file, shared with handles so they can outlive the map
+    struct SMapping{
+        const char *DBase = nullptr;
+        std::size_t DSize = 0;
+        SSnapshotHeader DHeader;
+
+        ~SMapping(){
+            if(DBase){
+                munmap(const_cast<char *>(DBase), DSize);
+            }
+        }
+
+        template <typename T> const T *Section(ESection section) const noexcept{
+            return reinterpret_cast<const T *>(DBase + DHeader.DSectionOffsets[static_cast<std::size_t>(section)]);
+        }
+
+        template <typename T> std::span<const T> Section(ESection section, std::size_t count) const noexcept{
+            return std::span<const T>(Section<T>(section), count);
+        }
+
+        std::string_view String(uint32_t id) const noexcept{
+            if(id >= DHeader.DStringCount){
+                return std::string_view();
+            }
+            auto Offsets = Section<uint64_t>(ESection::StringOffsets);
+            return std::string_view(Section<char>(ESection::StringData) + Offsets[id], Offsets[id + 1] - Offsets[id]);
+        }
+
+        SLocation NodeLocation(std::size_t index) const noexcept{
+            if(DHeader.DFixedPoint){
+                return SLocation{COpenStreetMap::FromFixedPoint(Section<int32_t>(ESection::NodeLatitudes)[index]), COpenStreetMap::FromFixedPoint(Section<int32_t>(ESection::NodeLongitudes)[index])};
+            }
+            return SLocation{Section<double>(ESection::NodeLatitudes)[index], Section<double>(ESection::NodeLongitudes)[index]};
+        }
+
+        //Shared attribute lookups for node and way handles, tags are key/value uint32_t pairs
+        std::size_t AttributeCount(ESection offsets, std::size_t object) const noexcept{
+            auto Offsets = Section<uint32_t>(offsets);
+            return Offsets[object + 1] - Offsets[object];
+        }
+
+        std::string AttributeKey(ESection offsets, ESection tags, std::size_t object, std::size_t index) const noexcept{
+            if(index >= AttributeCount(offsets, object)){
+                return std::string();
+            }
+            auto Tag = Section<uint32_t>(offsets)[object] + index;
+            return std::string(String(Section<uint32_t>(tags)[Tag * 2]));
+        }
+
+        //Returns the tag position of key on object, or InvalidIndex
+        std::size_t FindAttribute(ESection offsets, ESection tags, std::size_t object, const std::string &key) const noexcept{
+            auto Offsets = Section<uint32_t>(offsets);
+            auto Tags = Section<uint32_t>(tags);
+            for(auto Tag = Offsets[object]; Tag < Offsets[object + 1]; Tag++){
+                if(String(Tags[Tag * 2]) == key){
+                    return Tag;
+                }
+            }
+            return CIDIndex::InvalidIndex;
+        }
+
+        std::string Attribute(ESection offsets, ESection tags, std::size_t object, const std::string &key) const noexcept{
+            auto Tag = FindAttribute(offsets, tags, object, key);
+            if(Tag == CIDIndex::InvalidIndex){
+                return std::string(); // If nothing is found, return an empty string " "
+            }
+            return std::string(String(Section<uint32_t>(tags)[Tag * 2 + 1]));
+        }
+    };
+
+    struct SNode: public CStreetMap::SNode{
+        std::shared_ptr<const SMapping> DMapping;
+        std::size_t DIndex;
+
+        SNode(std::shared_ptr<const SMapping> mapping, std::size_t index) : DMapping(mapping), DIndex(index){
+
+        }
+
+        TNodeID ID() const noexcept override{
+            return DMapping->Section<uint64_t>(ESection::NodeIDs)[DIndex];
+        }
+
+        SLocation Location() const noexcept override{
+            return DMapping->NodeLocation(DIndex);
+        }
+
+        std::size_t AttributeCount() const noexcept override{
+            return DMapping->AttributeCount(ESection::NodeTagOffsets, DIndex);
+        }
+
+        std::string GetAttributeKey(std::size_t index) const noexcept override{
+            return DMapping->AttributeKey(ESection::NodeTagOffsets, ESection::NodeTags, DIndex, index);
+        }
+
+        bool HasAttribute(const std::string &key) const noexcept override{
+            return DMapping->FindAttribute(ESection::NodeTagOffsets, ESection::NodeTags, DIndex, key) != CIDIndex::InvalidIndex;
+        }
+
+        std::string GetAttribute(const std::string &key) const noexcept override{
+            return DMapping->Attribute(ESection::NodeTagOffsets, ESection::NodeTags, DIndex, key);
+        }
+    };
+
+    struct SWay: public CStreetMap::SWay{
+        std::shared_ptr<const SMapping> DMapping;
+        std::size_t DIndex;
+
+        SWay(std::shared_ptr<const SMapping> mapping, std::size_t index) : DMapping(mapping), DIndex(index){
+
+        }
+
+        TWayID ID() const noexcept override{
+            return DMapping->Section<uint64_t>(ESection::WayIDs)[DIndex];
+        }
+
+        std::size_t NodeCount() const noexcept override{
+            auto Offsets = DMapping->Section<uint64_t>(ESection::WayNodeOffsets);
+            return Offsets[DIndex + 1] - Offsets[DIndex];
+        }
+
+        TNodeID GetNodeID(std::size_t index) const noexcept override{
+            if(index >= NodeCount()){
+                return InvalidNodeID;
+            }
+            auto Offsets = DMapping->Section<uint64_t>(ESection::WayNodeOffsets);
+            return DMapping->Section<uint64_t>(ESection::WayNodeReferences)[Offsets[DIndex] + index];
+        }
+
+        std::size_t AttributeCount() const noexcept override{
+            return DMapping->AttributeCount(ESection::WayTagOffsets, DIndex);
+        }
+
+        std::string GetAttributeKey(std::size_t index) const noexcept override{
+            return DMapping->AttributeKey(ESection::WayTagOffsets, ESection::WayTags, DIndex, index);
+        }
+
+        bool HasAttribute(const std::string &key) const noexcept override{
+            return DMapping->FindAttribute(ESection::WayTagOffsets, ESection::WayTags, DIndex, key) != CIDIndex::InvalidIndex;
+        }
+
+        std::string GetAttribute(const std::string &key) const noexcept override{
+            return DMapping->Attribute(ESection::WayTagOffsets, ESection::WayTags, DIndex, key);
+        }
+    };
+
+    std::shared_ptr<SMapping> DMapping;
+
+    //Number of bytes each section should hold according to the header, false if that overflows
+    static bool SectionSize(const SSnapshotHeader &header, ESection section, uint64_t &size){
+        uint64_t CoordinateSize = header.DFixedPoint ? sizeof(int32_t) : sizeof(double);
+        uint64_t Count = 0, ElementSize = 0;
+        //Offset columns hold one more entry than their count
+        bool Offsets = false;
+        switch(section){
+            case ESection::NodeIDs:             Count = header.DNodeCount;          ElementSize = sizeof(uint64_t);     break;
+            case ESection::NodeLatitudes:       Count = header.DNodeCount;          ElementSize = CoordinateSize;       break;
+            case ESection::NodeLongitudes:      Count = header.DNodeCount;          ElementSize = CoordinateSize;       break;
+            case ESection::NodeTagOffsets:      Count = header.DNodeCount;          ElementSize = sizeof(uint32_t);     Offsets = true; break;
+            case ESection::NodeTags:            Count = header.DNodeTagCount;       ElementSize = 2 * sizeof(uint32_t); break;
+            case ESection::WayIDs:              Count = header.DWayCount;           ElementSize = sizeof(uint64_t);     break;
+            case ESection::WayNodeOffsets:      Count = header.DWayCount;           ElementSize = sizeof(uint64_t);     Offsets = true; break;
+            case ESection::WayNodeReferences:   Count = header.DWayNodeCount;       ElementSize = sizeof(uint64_t);     break;
+            case ESection::WayTagOffsets:       Count = header.DWayCount;           ElementSize = sizeof(uint32_t);     Offsets = true; break;
+            case ESection::WayTags:             Count = header.DWayTagCount;        ElementSize = 2 * sizeof(uint32_t); break;
+            case ESection::StringOffsets:       Count = header.DStringCount;        ElementSize = sizeof(uint64_t);     Offsets = true; break;
+            case ESection::StringData:          Count = header.DStringBytes;        ElementSize = 1;                    break;
+            case ESection::NodeIndexIDs:        Count = header.DNodeIndexCount;     ElementSize = sizeof(uint64_t);     break;
+            case ESection::NodeIndexPositions:  Count = header.DNodeIndexCount;     ElementSize = sizeof(uint32_t);     break;
+            case ESection::WayIndexIDs:         Count = header.DWayIndexCount;      ElementSize = sizeof(uint64_t);     break;
+            case ESection::WayIndexPositions:   Count = header.DWayIndexCount;      ElementSize = sizeof(uint32_t);     break;
+            default:                            size = 0;                           return true;
+        }
+        if(Offsets){
+            if(Count == std::numeric_limits<uint64_t>::max()){
+                return false;
+            }
+            Count++;
+        }
+        if(Count > std::numeric_limits<uint64_t>::max() / ElementSize){
+            return false;
+        }
+        size = Count * ElementSize;
+        return true;
+    }
+
+    //True if the offsets column of section climbs from its first entry to total without going down
+    template <typename T> static bool ValidOffsets(const SMapping &mapping, ESection section, uint64_t count, uint64_t total){
+        auto Offsets = mapping.Section<T>(section, count + 1);
+        return std::is_sorted(Offsets.begin(), Offsets.end()) && (Offsets.back() == total);
+    }
+
+    //Checks the header, that every section fits inside the file, and that every offset stays inside the section it indexes
+    static bool ValidateMapping(const SMapping &mapping){
+        const auto &Header = mapping.DHeader;
+        if(std::memcmp(Header.DMagic, SnapshotMagic, sizeof(SnapshotMagic))||(Header.DVersion != SnapshotVersion)){
+            return false;
+        }
+        if((Header.DNodeIndexCount > Header.DNodeCount)||(Header.DWayIndexCount > Header.DWayCount)){
+            return false;
+        }
+        for(std::size_t Index = 0; Index < static_cast<std::size_t>(ESection::Count); Index++){
+            auto Offset = Header.DSectionOffsets[Index];
+            uint64_t Size;
+            if(!SectionSize(Header, static_cast<ESection>(Index), Size)){
+                return false;
+            }
+            if((Offset % 8)||(Offset < sizeof(SSnapshotHeader))||(Offset > mapping.DSize)||(Size > mapping.DSize - Offset)){
+                return false;
+            }
+        }
+        //Every offset must be in order and the last must agree with the count, so no lookup can run off the end
+        return ValidOffsets<uint32_t>(mapping, ESection::NodeTagOffsets, Header.DNodeCount, Header.DNodeTagCount)
+            && ValidOffsets<uint32_t>(mapping, ESection::WayTagOffsets, Header.DWayCount, Header.DWayTagCount)
+            && ValidOffsets<uint64_t>(mapping, ESection::WayNodeOffsets, Header.DWayCount, Header.DWayNodeCount)
+            && ValidOffsets<uint64_t>(mapping, ESection::StringOffsets, Header.DStringCount, Header.DStringBytes);
+    }
+
+    SImplementation(const std::string &filename){
+        int FileDescriptor = open(filename.c_str(), O_RDONLY);
+        if(FileDescriptor < 0){
+            return;
+        }
+        struct stat FileStatus;
+        if((fstat(FileDescriptor, &FileStatus) == 0)&&(static_cast<std::size_t>(FileStatus.st_size) >= sizeof(SSnapshotHeader))){
+            void *Base = mmap(nullptr, FileStatus.st_size, PROT_READ, MAP_SHARED, FileDescriptor, 0);
+            if(Base != MAP_FAILED){
+                auto Mapping = std::make_shared<SMapping>();
+                Mapping->DBase = static_cast<const char *>(Base);
+                Mapping->DSize = FileStatus.st_size;
+                std::memcpy(&Mapping->DHeader, Base, sizeof(SSnapshotHeader));
+                if(ValidateMapping(*Mapping)){
+                    DMapping = Mapping;
+                }
+            }
+        }
+        //The mapping stays valid after the descriptor is closed
+        close(FileDescriptor);
+    }
+
+    std::size_t NodeCount() const noexcept{
+        return DMapping ? DMapping->DHeader.DNodeCount : 0;
+    }
+
+    std::size_t WayCount() const noexcept{
+        return DMapping ? DMapping->DHeader.DWayCount : 0;
+    }
+
+    std::shared_ptr<CStreetMap::SNode> NodeByIndex(std::size_t index) const noexcept{
+        if(index < NodeCount()){
+            return std::make_shared<SNode>(DMapping, index);
+        }
+        return nullptr;
+    }
+
+    //Search the sorted node ID section stored in the file
+    std::shared_ptr<CStreetMap::SNode> NodeByID(TNodeID id) const noexcept{
+        if(!DMapping){
+            return nullptr;
+        }
+        auto Count = DMapping->DHeader.DNodeIndexCount;
+        auto Index = CIDIndex::SortedFind(DMapping->Section<uint64_t>(ESection::NodeIndexIDs, Count), DMapping->Section<uint32_t>(ESection::NodeIndexPositions, Count), id);
+        if(Index < NodeCount()){
+            return std::make_shared<SNode>(DMapping, Index);
+        }
+        return nullptr;
+    }
+
+    std::size_t NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const{
+        locations.resize(ids.size());
+        if(!DMapping){
+            std::fill(locations.begin(), locations.end(), InvalidLocation());
+            return 0;
+        }
+        std::vector<std::size_t> Indices;
+        auto Count = DMapping->DHeader.DNodeIndexCount;
+        CIDIndex::SortedFindBatch(DMapping->Section<uint64_t>(ESection::NodeIndexIDs, Count), DMapping->Section<uint32_t>(ESection::NodeIndexPositions, Count), ids, Indices);
+        std::size_t Found = 0;
+        for(std::size_t Index = 0; Index < ids.size(); Index++){
+            if(Indices[Index] < NodeCount()){
+                locations[Index] = DMapping->NodeLocation(Indices[Index]);
+                Found++;
+            }
+            else{
+                locations[Index] = InvalidLocation();
+            }
+        }
+        return Found;
+    }
+
+    //One handle is moved along the range, so visiting needs no allocation or reference counting per object
+    void ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const{
+        SNode Node(DMapping, begin);
+        for(end = std::min(end, NodeCount()); Node.DIndex < end; Node.DIndex++){
+            visit(Node.DIndex, Node);
+        }
+    }
+
+    void ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const{
+        SWay Way(DMapping, begin);
+        for(end = std::min(end, WayCount()); Way.DIndex < end; Way.DIndex++){
+            visit(Way.DIndex, Way);
+        }
+    }
+
+    std::shared_ptr<CStreetMap::SWay> WayByIndex(std::size_t index) const noexcept{
+        if(index < WayCount()){
+            return std::make_shared<SWay>(DMapping, index);
+        }
+        return nullptr;
+    }
+
+    //Search the sorted way ID section stored in the file
+    std::shared_ptr<CStreetMap::SWay> WayByID(TWayID id) const noexcept{
+        if(!DMapping){
+            return nullptr;
+        }
+        auto Count = DMapping->DHeader.DWayIndexCount;
+        auto Index = CIDIndex::SortedFind(DMapping->Section<uint64_t>(ESection::WayIndexIDs, Count), DMapping->Section<uint32_t>(ESection::WayIndexPositions, Count), id);
+        if(Index < WayCount()){
+            return std::make_shared<SWay>(DMapping, Index);
+        }
+        return nullptr;
+    }
+};
+
+CMappedStreetMap::CMappedStreetMap(const std::string &filename){
+    DImplementation = std::make_unique<SImplementation>(filename);
+}
+
+CMappedStreetMap::~CMappedStreetMap(){
+
+}
+
+//Returns false if the file could not be opened or is not a valid snapshot
+bool CMappedStreetMap::Valid() const noexcept{
+    return DImplementation->DMapping != nullptr;
+}
+
+std::size_t CMappedStreetMap::NodeCount() const noexcept{
+    return DImplementation->NodeCount();
+}
+
+std::size_t CMappedStreetMap::WayCount() const noexcept{
+    return DImplementation->WayCount();
+}
+
+std::shared_ptr<CStreetMap::SNode> CMappedStreetMap::NodeByIndex(std::size_t index) const noexcept{
+    return DImplementation->NodeByIndex(index);
+}
+
+std::shared_ptr<CStreetMap::SNode> CMappedStreetMap::NodeByID(TNodeID id) const noexcept{
+    return DImplementation->NodeByID(id);
+}
+
+std::shared_ptr<CStreetMap::SWay> CMappedStreetMap::WayByIndex(std::size_t index) const noexcept{
+    return DImplementation->WayByIndex(index);
+}
+
+std::shared_ptr<CStreetMap::SWay> CMappedStreetMap::WayByID(TWayID id) const noexcept{
+    return DImplementation->WayByID(id);
+}
+
+//Batch lookup through the snapshot's sorted ID section with grouped prefetching
+std::size_t CMappedStreetMap::NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const{
+    return DImplementation->NodeLocationsByID(ids, locations);
+}
+
+void CMappedStreetMap::ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const{
+    DImplementation->ForEachNodeInRange(begin, end, visit);
+}
+
+void CMappedStreetMap::ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const{
+    DImplementation->ForEachWayInRange(begin, end, visit);
+}
@@ -1,5 +1,50 @@
 #include "OpenStreetMap.h"
+#include "MappedStreetMap.h"
+#include "ParallelFor.h"
+#include "BoundedQueue.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string_view>
 #include <unordered_map>
+//Little endian base 128 varints, 7 bits per byte with the high bit set on every byte but the last
+static inline void WriteVarint(std::vector<uint8_t> &bytes, uint64_t value){
+    while(value >= 0x80){
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+static inline uint64_t ReadVarint(const uint8_t *&bytes) noexcept{
+    //Deltas inside a way are almost always a single byte
+    if(*bytes < 0x80){
+        return *bytes++;
+    }
+    uint64_t Value = 0;
+    int Shift = 0;
+    while(*bytes >= 0x80){
+        Value |= uint64_t(*bytes++ & 0x7F) << Shift;
+        Shift += 7;
+    }
+    return Value | (uint64_t(*bytes++) << Shift);
+}
+
+//Maps signed deltas to unsigned so small negative steps stay small
+static inline uint64_t ZigZag(uint64_t delta) noexcept{
+    return (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+}
+
+static inline uint64_t UnZigZag(uint64_t value) noexcept{
+    return (value >> 1) ^ (~(value & 1) + 1);
+}
+
 //Internal implementation
 //Cannot be access outside
 struct COpenStreetMap::SImplementation{
@@ -9,129 +54,841 @@ struct COpenStreetMap::SImplementation{
     const std::string DNodeReferenceTag = "nd";
     const std::string DAttributeTag = "tag";
 
-    //Stores information of <node> tag with attributes in <tag>
+    const std::string DNodeIDAttr = "id";
+    const std::string DNodeLatAttr = "lat";
+    const std::string DNodeLonAttr = "lon";
+    const std::string DWayIDAttr = "id";
+
+    const std::string DChangeTag = "osmChange";
+    const std::string DCreateTag = "create";
+    const std::string DModifyTag = "modify";
+    const std::string DDeleteTag = "delete";
+
+    //One <tag> with its key and value interned in the string pool
+    struct STag{
+        TStringID DKey;
+        TStringID DValue;
+    };
+
+    //Tags of every object
+    //Eager: tags of object i are DTags[DOffsets[i]] to DTags[DOffsets[i+1]]
+    //Lazy: tags of object i are "key\0value\0" pairs in DRawBytes[DRawOffsets[i]] to DRawBytes[DRawOffsets[i+1]]
+    //Once mutable (see MakeMutable) object i ends at DEnds[i] (DRawEnds[i]) instead, and the last offset is where the next tags go
+    struct STagColumns{
+        ETagDecoding DDecoding = ETagDecoding::Eager;
+        std::vector<uint32_t> DOffsets{0};
+        std::vector<STag> DTags;
+        std::vector<uint64_t> DRawOffsets{0};
+        std::vector<char> DRawBytes;
+        bool DMutable = false;
+        std::vector<uint32_t> DEnds;
+        std::vector<uint64_t> DRawEnds;
+        //Tags or raw bytes no object points at any more, left behind by rewritten and removed objects
+        std::size_t DUnused = 0;
+        //LazyMemoized: decoded tags of each object, published once and kept until the columns go away
+        std::unique_ptr<std::atomic<const TAttributes *>[]> DDecoded;
+        std::size_t DDecodedCount = 0;
+
+        STagColumns() = default;
+        STagColumns(const STagColumns &) = delete;
+        STagColumns &operator=(const STagColumns &) = delete;
+        ~STagColumns(){
+            for(std::size_t Index = 0; Index < DDecodedCount; Index++){
+                delete DDecoded[Index].load(std::memory_order_relaxed);
+            }
+        }
+
+        std::size_t Begin(std::size_t index) const noexcept{
+            return DOffsets[index];
+        }
+
+        std::size_t End(std::size_t index) const noexcept{
+            return DMutable ? DEnds[index] : DOffsets[index + 1];
+        }
+
+        std::size_t Count(std::size_t index) const noexcept{
+            return End(index) - Begin(index);
+        }
+
+        //Returns the value ID for key on object index, or InvalidStringID
+        TStringID Find(std::size_t index, TStringID key) const noexcept{
+            for(auto Index = Begin(index); Index < End(index); Index++){
+                if(DTags[Index].DKey == key){
+                    return DTags[Index].DValue;
+                }
+            }
+            return CStringPool::InvalidStringID;
+        }
+
+        std::string_view Raw(std::size_t index) const noexcept{
+            auto End = DMutable ? DRawEnds[index] : DRawOffsets[index + 1];
+            return std::string_view(DRawBytes.data() + DRawOffsets[index], End - DRawOffsets[index]);
+        }
+
+        std::size_t ObjectCount() const noexcept{
+            return DDecoding == ETagDecoding::Eager ? DOffsets.size() - 1 : DRawOffsets.size() - 1;
+        }
+
+        //Calls func(key, value) for each raw tag of object index until it returns false
+        template <typename TFunc>
+        void ForEachRaw(std::size_t index, TFunc func) const{
+            auto Bytes = Raw(index);
+            while(!Bytes.empty()){
+                auto KeyEnd = Bytes.find('\0');
+                auto ValueEnd = Bytes.find('\0', KeyEnd + 1);
+                if(!func(Bytes.substr(0, KeyEnd), Bytes.substr(KeyEnd + 1, ValueEnd - KeyEnd - 1))){
+                    return;
+                }
+                Bytes.remove_prefix(ValueEnd + 1);
+            }
+        }
+
+        //Decoded tags of object index, built on first use and shared by every later call
+        const TAttributes &Decoded(std::size_t index) const{
+            auto Attributes = DDecoded[index].load(std::memory_order_acquire);
+            if(Attributes){
+                return *Attributes;
+            }
+            auto Fresh = new TAttributes;
+            ForEachRaw(index, [&](std::string_view key, std::string_view value){
+                Fresh->push_back({std::string(key), std::string(value)});
+                return true;
+            });
+            //Another thread may have decoded the same object first, keep its copy
+            if(DDecoded[index].compare_exchange_strong(Attributes, Fresh, std::memory_order_acq_rel, std::memory_order_acquire)){
+                return *Fresh;
+            }
+            delete Fresh;
+            return *Attributes;
+        }
+
+        //Drops the tags added since the last FinishObject
+        void DiscardObject(){
+            if(DDecoding == ETagDecoding::Eager){
+                DTags.resize(DOffsets.back());
+            }
+            else{
+                DRawBytes.resize(DRawOffsets.back());
+            }
+        }
+
+        //Called once per object after its tags are added
+        void FinishObject(){
+            if(DDecoding == ETagDecoding::Eager){
+                DOffsets.push_back(DTags.size());
+                if(DMutable){
+                    DEnds.push_back(DTags.size());
+                }
+            }
+            else{
+                DRawOffsets.push_back(DRawBytes.size());
+                if(DMutable){
+                    DRawEnds.push_back(DRawBytes.size());
+                    GrowDecoded();
+                }
+            }
+        }
+
+        //Gives every object an explicit end so objects can be rewritten and removed in place
+        void MakeMutable(){
+            if(DMutable){
+                return;
+            }
+            DMutable = true;
+            DEnds.assign(DOffsets.begin() + 1, DOffsets.end());
+            DRawEnds.assign(DRawOffsets.begin() + 1, DRawOffsets.end());
+        }
+
+        //Makes room in the memo array for objects added after loading, doubling so growth stays amortized constant
+        void GrowDecoded(){
+            if((DDecoding != ETagDecoding::LazyMemoized)||(ObjectCount() <= DDecodedCount)){
+                return;
+            }
+            auto Count = std::max(ObjectCount(), DDecodedCount * 2);
+            auto Grown = std::make_unique<std::atomic<const TAttributes *>[]>(Count);
+            for(std::size_t Index = 0; Index < Count; Index++){
+                Grown[Index].store(Index < DDecodedCount ? DDecoded[Index].load(std::memory_order_relaxed) : nullptr, std::memory_order_relaxed);
+            }
+            DDecoded = std::move(Grown);
+            DDecodedCount = Count;
+        }
+
+        void ForgetDecoded(std::size_t index){
+            if(index < DDecodedCount){
+                delete DDecoded[index].exchange(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        //Points object index at the tags added since the last FinishObject, its old tags become unused
+        void RewriteObject(std::size_t index){
+            if(DDecoding == ETagDecoding::Eager){
+                DUnused += DEnds[index] - DOffsets[index];
+                DOffsets[index] = DOffsets.back();
+                DEnds[index] = DOffsets.back() = DTags.size();
+            }
+            else{
+                DUnused += DRawEnds[index] - DRawOffsets[index];
+                DRawOffsets[index] = DRawOffsets.back();
+                DRawEnds[index] = DRawOffsets.back() = DRawBytes.size();
+            }
+            ForgetDecoded(index);
+        }
+
+        //Moves the last object into index, so removal costs the same wherever the object is
+        void RemoveObject(std::size_t index){
+            auto Last = ObjectCount() - 1;
+            auto Remove = [&](auto &offsets, auto &ends){
+                DUnused += ends[index] - offsets[index];
+                offsets[index] = offsets[Last];
+                ends[index] = ends[Last];
+                offsets[Last] = offsets.back();
+                offsets.pop_back();
+                ends.pop_back();
+            };
+            ForgetDecoded(index);
+            if(DDecoding == ETagDecoding::Eager){
+                Remove(DOffsets, DEnds);
+            }
+            else{
+                Remove(DRawOffsets, DRawEnds);
+            }
+            if((index != Last)&&(Last < DDecodedCount)){
+                DDecoded[index].store(DDecoded[Last].exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+
+        //Copies every object's tags back to back once more than half the storage is unused,
+        //so the copying is paid for by the changes that made the garbage
+        void CompactIfSparse(){
+            auto Size = DDecoding == ETagDecoding::Eager ? DTags.size() : DRawBytes.size();
+            if(DUnused * 2 <= Size){
+                return;
+            }
+            auto Compact = [&](auto &offsets, auto &ends, auto &data){
+                std::remove_reference_t<decltype(data)> Data;
+                Data.reserve(Size - DUnused);
+                for(std::size_t Index = 0; Index + 1 < offsets.size(); Index++){
+                    auto Begin = offsets[Index];
+                    offsets[Index] = Data.size();
+                    Data.insert(Data.end(), data.begin() + Begin, data.begin() + ends[Index]);
+                    ends[Index] = Data.size();
+                }
+                offsets.back() = Data.size();
+                data = std::move(Data);
+            };
+            if(DDecoding == ETagDecoding::Eager){
+                Compact(DOffsets, DEnds, DTags);
+            }
+            else{
+                Compact(DRawOffsets, DRawEnds, DRawBytes);
+            }
+            DUnused = 0;
+        }
+
+        void ShrinkToFit(){
+            DOffsets.shrink_to_fit();
+            DTags.shrink_to_fit();
+            DRawOffsets.shrink_to_fit();
+            DRawBytes.shrink_to_fit();
+            if(DDecoding == ETagDecoding::LazyMemoized){
+                DDecodedCount = DRawOffsets.size() - 1;
+                DDecoded = std::make_unique<std::atomic<const TAttributes *>[]>(DDecodedCount);
+                for(std::size_t Index = 0; Index < DDecodedCount; Index++){
+                    DDecoded[Index].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //Heap held by the tag columns, including the tags LazyMemoized has decoded so far
+        SMemoryUsage MemoryUsage() const noexcept{
+            SMemoryUsage Usage;
+            Usage.Add(DOffsets);
+            Usage.Add(DTags);
+            Usage.Add(DRawOffsets);
+            Usage.Add(DRawBytes);
+            Usage.Add(DEnds);
+            Usage.Add(DRawEnds);
+            if(DDecodedCount){
+                Usage.AddBlock(DDecodedCount * sizeof(DDecoded[0]));
+            }
+            for(std::size_t Index = 0; Index < DDecodedCount; Index++){
+                auto Decoded = DDecoded[Index].load(std::memory_order_acquire);
+                if(Decoded){
+                    Usage.AddBlock(sizeof(TAttributes));
+                    Usage.Add(*Decoded);
+                    for(const auto &Tag : *Decoded){
+                        Usage.Add(Tag.first);
+                        Usage.Add(Tag.second);
+                    }
+                }
+            }
+            return Usage;
+        }
+    };
+
+    //Column storage of every <node>, one entry per node in load order
+    //Only one pair of coordinate columns is filled, depending on DStorage
+    struct SNodeColumns{
+        ECoordinateStorage DStorage = ECoordinateStorage::Double;
+        std::vector<TNodeID> DIDs;
+        std::vector<double> DLatitudes;
+        std::vector<double> DLongitudes;
+        std::vector<int32_t> DFixedLatitudes;
+        std::vector<int32_t> DFixedLongitudes;
+        STagColumns DTags;
+        //Bumped whenever a removal moves rows, so handles taken before it know they are stale
+        std::size_t DGeneration = 0;
+
+        std::size_t Count() const noexcept{
+            return DIDs.size();
+        }
+
+        void AddLocation(double latitude, double longitude){
+            if(DStorage == ECoordinateStorage::FixedPoint){
+                DFixedLatitudes.push_back(ToFixedPoint(latitude));
+                DFixedLongitudes.push_back(ToFixedPoint(longitude));
+            }
+            else{
+                DLatitudes.push_back(latitude);
+                DLongitudes.push_back(longitude);
+            }
+        }
+
+        void SetLocation(std::size_t index, double latitude, double longitude){
+            if(DStorage == ECoordinateStorage::FixedPoint){
+                DFixedLatitudes[index] = ToFixedPoint(latitude);
+                DFixedLongitudes[index] = ToFixedPoint(longitude);
+            }
+            else{
+                DLatitudes[index] = latitude;
+                DLongitudes[index] = longitude;
+            }
+        }
+
+        //Moves the last node into index and drops the last row
+        void RemoveNode(std::size_t index){
+            DGeneration++;
+            auto Remove = [index](auto &column){
+                column[index] = column.back();
+                column.pop_back();
+            };
+            Remove(DIDs);
+            if(DStorage == ECoordinateStorage::FixedPoint){
+                Remove(DFixedLatitudes);
+                Remove(DFixedLongitudes);
+            }
+            else{
+                Remove(DLatitudes);
+                Remove(DLongitudes);
+            }
+            DTags.RemoveObject(index);
+        }
+
+        SLocation Location(std::size_t index) const noexcept{
+            if(DStorage == ECoordinateStorage::FixedPoint){
+                return SLocation{FromFixedPoint(DFixedLatitudes[index]), FromFixedPoint(DFixedLongitudes[index])};
+            }
+            return SLocation{DLatitudes[index], DLongitudes[index]};
+        }
+
+        void PrefetchLocation(std::size_t index) const noexcept{
+            if(DStorage == ECoordinateStorage::FixedPoint){
+                __builtin_prefetch(&DFixedLatitudes[index]);
+                __builtin_prefetch(&DFixedLongitudes[index]);
+            }
+            else{
+                __builtin_prefetch(&DLatitudes[index]);
+                __builtin_prefetch(&DLongitudes[index]);
+            }
+        }
+
+        //Drops the spare capacity left over from push_back growth
+        void ShrinkToFit(){
+            DIDs.shrink_to_fit();
+            DLatitudes.shrink_to_fit();
+            DLongitudes.shrink_to_fit();
+            DFixedLatitudes.shrink_to_fit();
+            DFixedLongitudes.shrink_to_fit();
+            DTags.ShrinkToFit();
+        }
+
+        //Heap held by the ID and coordinate columns, tags are counted separately
+        SMemoryUsage MemoryUsage() const noexcept{
+            SMemoryUsage Usage;
+            Usage.Add(DIDs);
+            Usage.Add(DLatitudes);
+            Usage.Add(DLongitudes);
+            Usage.Add(DFixedLatitudes);
+            Usage.Add(DFixedLongitudes);
+            return Usage;
+        }
+    };
+
+    //Column storage of every <way>, way i has DNodeOffsets[i+1] - DNodeOffsets[i] node refs
+    //Plain: node refs of way i are DNodeReferences[DNodeOffsets[i]] to DNodeReferences[DNodeOffsets[i+1]]
+    //Compressed: while loading, node refs of way i are packed in DPackedReferences from DPackedOffsets[i], see AddNodeReferences
+    //Once ResolveWayNodes has run (DIDsFromNodes) the packed refs are dropped: a resolved ref takes its ID from its node row,
+    //and only refs to nodes not in the map keep their ID, in DUnresolvedIDs keyed by ref position
+    //Once mutable (see MakeMutable) way i ends at DNodeEnds[i] instead, and the last offsets are where the next refs go
+    struct SWayColumns{
+        EWayNodeStorage DStorage = EWayNodeStorage::Plain;
+        std::vector<TWayID> DIDs;
+        std::vector<std::size_t> DNodeOffsets{0};
+        std::vector<TNodeID> DNodeReferences;
+        std::vector<uint64_t> DPackedOffsets{0};
+        std::vector<uint8_t> DPackedReferences;
+        //Node index of every ref in DNodeOffsets order, InvalidNodeIndex for refs to nodes not in the map
+        std::vector<uint32_t> DNodeIndices;
+        std::unordered_map<std::size_t, TNodeID> DUnresolvedIDs;
+        bool DIDsFromNodes = false;
+        STagColumns DTags;
+        bool DMutable = false;
+        std::vector<std::size_t> DNodeEnds;
+        //Refs no way points at any more, left behind by rewritten and removed ways
+        std::size_t DUnusedReferences = 0;
+        //Bumped whenever a removal moves rows, so handles taken before it know they are stale
+        std::size_t DGeneration = 0;
+
+        std::size_t Count() const noexcept{
+            return DIDs.size();
+        }
+
+        std::size_t NodeCount(std::size_t way) const noexcept{
+            return (DMutable ? DNodeEnds[way] : DNodeOffsets[way + 1]) - DNodeOffsets[way];
+        }
+
+        void AddNodeReferences(const std::vector<TNodeID> &refs){
+            auto Start = DNodeOffsets.back();
+            DNodeOffsets.push_back(Start + refs.size());
+            if(DMutable){
+                DNodeEnds.push_back(DNodeOffsets.back());
+                DNodeIndices.resize(DNodeOffsets.back(), InvalidNodeIndex);
+            }
+            PackNodeReferences(Start, refs);
+        }
+
+        //Stores refs at positions from start, which are unresolved until ResolveWay runs
+        //A compressed list starts with a uint32 byte offset for every block after the first,
+        //then each block holds its first ref as a varint followed by zigzag varint deltas
+        void PackNodeReferences(std::size_t start, const std::vector<TNodeID> &refs){
+            if(DStorage == EWayNodeStorage::Plain){
+                DNodeReferences.insert(DNodeReferences.end(), refs.begin(), refs.end());
+                return;
+            }
+            if(DIDsFromNodes){
+                for(std::size_t Index = 0; Index < refs.size(); Index++){
+                    DUnresolvedIDs[start + Index] = refs[Index];
+                }
+                return;
+            }
+            auto Start = DPackedReferences.size();
+            auto Blocks = (refs.size() + WayNodeBlockSize - 1) / WayNodeBlockSize;
+            auto TableSize = Blocks ? (Blocks - 1) * sizeof(uint32_t) : 0;
+            DPackedReferences.resize(Start + TableSize);
+            for(std::size_t Index = 0; Index < refs.size(); Index++){
+                if(Index % WayNodeBlockSize == 0){
+                    if(Index){
+                        uint32_t BlockOffset = DPackedReferences.size() - Start;
+                        std::memcpy(DPackedReferences.data() + Start + (Index / WayNodeBlockSize - 1) * sizeof(uint32_t), &BlockOffset, sizeof(BlockOffset));
+                    }
+                    WriteVarint(DPackedReferences, refs[Index]);
+                }
+                else{
+                    WriteVarint(DPackedReferences, ZigZag(refs[Index] - refs[Index - 1]));
+                }
+            }
+            DPackedOffsets.push_back(DPackedReferences.size());
+        }
+
+        void MakeMutable(){
+            if(DMutable){
+                return;
+            }
+            DMutable = true;
+            DNodeEnds.assign(DNodeOffsets.begin() + 1, DNodeOffsets.end());
+            DTags.MakeMutable();
+        }
+
+        //Points way at refs added after every other way, its resolved indices are left InvalidNodeIndex
+        void RewriteNodeReferences(std::size_t way, const std::vector<TNodeID> &refs){
+            DUnusedReferences += NodeCount(way);
+            DNodeOffsets[way] = DNodeOffsets.back();
+            DNodeEnds[way] = DNodeOffsets.back() += refs.size();
+            DNodeIndices.resize(DNodeOffsets.back(), InvalidNodeIndex);
+            PackNodeReferences(DNodeOffsets[way], refs);
+        }
+
+        //Moves the last way into index and drops the last row
+        void RemoveWay(std::size_t index){
+            DGeneration++;
+            auto Last = Count() - 1;
+            DUnusedReferences += NodeCount(index);
+            DIDs[index] = DIDs[Last];
+            DIDs.pop_back();
+            DNodeOffsets[index] = DNodeOffsets[Last];
+            DNodeEnds[index] = DNodeEnds[Last];
+            DNodeOffsets[Last] = DNodeOffsets.back();
+            DNodeOffsets.pop_back();
+            DNodeEnds.pop_back();
+            DTags.RemoveObject(index);
+        }
+
+        //Repacks every way's refs back to back once more than half of them are unused
+        void CompactIfSparse(){
+            DTags.CompactIfSparse();
+            if(DUnusedReferences * 2 <= DNodeOffsets.back()){
+                return;
+            }
+            SWayColumns Compact;
+            for(std::size_t Way = 0; Way < Count(); Way++){
+                auto Start = DNodeOffsets[Way];
+                auto References = NodeCount(Way);
+                auto CompactStart = Compact.DNodeOffsets.back();
+                Compact.DNodeOffsets.push_back(CompactStart + References);
+                Compact.DNodeIndices.insert(Compact.DNodeIndices.end(), DNodeIndices.begin() + Start, DNodeIndices.begin() + Start + References);
+                if(DStorage == EWayNodeStorage::Plain){
+                    Compact.DNodeReferences.insert(Compact.DNodeReferences.end(), DNodeReferences.begin() + Start, DNodeReferences.begin() + Start + References);
+                    continue;
+                }
+                for(std::size_t Ref = 0; Ref < References; Ref++){
+                    if(DNodeIndices[Start + Ref] == InvalidNodeIndex){
+                        Compact.DUnresolvedIDs[CompactStart + Ref] = DUnresolvedIDs.at(Start + Ref);
+                    }
+                }
+            }
+            DNodeOffsets = std::move(Compact.DNodeOffsets);
+            DNodeEnds.assign(DNodeOffsets.begin() + 1, DNodeOffsets.end());
+            DNodeReferences = std::move(Compact.DNodeReferences);
+            DNodeIndices = std::move(Compact.DNodeIndices);
+            DUnresolvedIDs = std::move(Compact.DUnresolvedIDs);
+            DUnusedReferences = 0;
+        }
+
+        //Resolves the ref at position to nodeindex, keeping id when compressed refs take their IDs from node rows
+        void SetNodeIndex(std::size_t position, uint32_t nodeindex, TNodeID id){
+            DNodeIndices[position] = nodeindex;
+            if(DStorage == EWayNodeStorage::Plain){
+                return;
+            }
+            if(nodeindex == InvalidNodeIndex){
+                DUnresolvedIDs[position] = id;
+            }
+            else{
+                DUnresolvedIDs.erase(position);
+            }
+        }
+
+        //ID of the ref at position once IDs come from node rows, nodeids is the node ID column
+        TNodeID ReferenceID(std::size_t position, const std::vector<TNodeID> &nodeids) const noexcept{
+            auto NodeIndex = DNodeIndices[position];
+            if(NodeIndex != InvalidNodeIndex){
+                return nodeids[NodeIndex];
+            }
+            auto Search = DUnresolvedIDs.find(position);
+            return Search == DUnresolvedIDs.end() ? InvalidNodeID : Search->second;
+        }
+
+        //Packed refs decode only the block holding index
+        TNodeID NodeID(std::size_t way, std::size_t index, const std::vector<TNodeID> &nodeids) const noexcept{
+            if(DStorage == EWayNodeStorage::Plain){
+                return DNodeReferences[DNodeOffsets[way] + index];
+            }
+            if(DIDsFromNodes){
+                return ReferenceID(DNodeOffsets[way] + index, nodeids);
+            }
+            auto Start = DPackedReferences.data() + DPackedOffsets[way];
+            auto Block = index / WayNodeBlockSize;
+            uint32_t BlockOffset;
+            if(Block){
+                std::memcpy(&BlockOffset, Start + (Block - 1) * sizeof(uint32_t), sizeof(BlockOffset));
+            }
+            else{
+                BlockOffset = ((NodeCount(way) + WayNodeBlockSize - 1) / WayNodeBlockSize - 1) * sizeof(uint32_t);
+            }
+            const uint8_t *Bytes = Start + BlockOffset;
+            TNodeID Value = ReadVarint(Bytes);
+            for(auto Step = index % WayNodeBlockSize; Step; Step--){
+                Value += UnZigZag(ReadVarint(Bytes));
+            }
+            return Value;
+        }
+
+        //First byte after the block offset table of a compressed way
+        const uint8_t *PackedBegin(std::size_t way) const noexcept{
+            auto Blocks = (NodeCount(way) + WayNodeBlockSize - 1) / WayNodeBlockSize;
+            return DPackedReferences.data() + DPackedOffsets[way] + (Blocks ? (Blocks - 1) * sizeof(uint32_t) : 0);
+        }
+
+        //Decodes every node ref of way into out
+        void DecodeNodeIDs(std::size_t way, TNodeID *out, const std::vector<TNodeID> &nodeids) const noexcept{
+            auto Count = NodeCount(way);
+            if(DStorage == EWayNodeStorage::Plain){
+                std::copy_n(DNodeReferences.data() + DNodeOffsets[way], Count, out);
+                return;
+            }
+            if(DIDsFromNodes){
+                for(std::size_t Index = 0; Index < Count; Index++){
+                    out[Index] = ReferenceID(DNodeOffsets[way] + Index, nodeids);
+                }
+                return;
+            }
+            const uint8_t *Bytes = PackedBegin(way);
+            TNodeID Value = 0;
+            for(std::size_t Index = 0; Index < Count; Index++){
+                if(Index % WayNodeBlockSize == 0){
+                    Value = ReadVarint(Bytes);
+                }
+                else{
+                    Value += UnZigZag(ReadVarint(Bytes));
+                }
+                out[Index] = Value;
+            }
+        }
+
+        void ShrinkToFit(){
+            DIDs.shrink_to_fit();
+            DNodeOffsets.shrink_to_fit();
+            DNodeReferences.shrink_to_fit();
+            DPackedOffsets.shrink_to_fit();
+            DPackedReferences.shrink_to_fit();
+            DNodeIndices.shrink_to_fit();
+            DTags.ShrinkToFit();
+        }
+
+        //Heap held by the node refs of every way, in whichever form they are stored, and their resolved indices
+        SMemoryUsage ReferenceUsage() const noexcept{
+            SMemoryUsage Usage;
+            Usage.Add(DNodeOffsets);
+            Usage.Add(DNodeReferences);
+            Usage.Add(DPackedOffsets);
+            Usage.Add(DPackedReferences);
+            Usage.Add(DNodeIndices);
+            Usage.Add(DUnresolvedIDs);
+            Usage.Add(DNodeEnds);
+            return Usage;
+        }
+    };
+
+    //Everything handed out handles need, shared so handles outlive the map
+    struct SData{
+        CStringPool DStrings;
+        SNodeColumns DNodes;
+        SWayColumns DWays;
+
+        //Shared attribute lookups for node and way handles
+        std::size_t AttributeCount(const STagColumns &tags, std::size_t object) const noexcept{
+            switch(tags.DDecoding){
+                case ETagDecoding::Eager:
+                    return tags.Count(object);
+                case ETagDecoding::Lazy:{
+                    auto Raw = tags.Raw(object);
+                    return std::count(Raw.begin(), Raw.end(), '\0') / 2;
+                }
+                case ETagDecoding::LazyMemoized:
+                    return tags.Decoded(object).size();
+            }
+            return 0;
+        }
+
+        std::string AttributeKey(const STagColumns &tags, std::size_t object, std::size_t index) const noexcept{
+            switch(tags.DDecoding){
+                case ETagDecoding::Eager:
+                    if(index >= tags.Count(object)){
+                        return std::string();
+                    }
+                    return DStrings.String(tags.DTags[tags.Begin(object) + index].DKey);
+                case ETagDecoding::Lazy:{
+                    std::string Key;
+                    tags.ForEachRaw(object, [&](std::string_view key, std::string_view){
+                        if(index--){
+                            return true;
+                        }
+                        Key = key;
+                        return false;
+                    });
+                    return Key;
+                }
+                case ETagDecoding::LazyMemoized:{
+                    const auto &Attributes = tags.Decoded(object);
+                    return index < Attributes.size() ? Attributes[index].first : std::string();
+                }
+            }
+            return std::string();
+        }
+
+        bool HasAttribute(const STagColumns &tags, std::size_t object, const std::string &key) const noexcept{
+            switch(tags.DDecoding){
+                case ETagDecoding::Eager:{
+                    auto KeyID = DStrings.Find(key);
+                    if(KeyID == CStringPool::InvalidStringID){ // Key appears nowhere in the map
+                        return false;
+                    }
+                    return tags.Find(object, KeyID) != CStringPool::InvalidStringID;
+                }
+                case ETagDecoding::Lazy:{
+                    bool Found = false;
+                    tags.ForEachRaw(object, [&](std::string_view rawkey, std::string_view){
+                        Found = rawkey == key;
+                        return !Found;
+                    });
+                    return Found;
+                }
+                case ETagDecoding::LazyMemoized:
+                    for(const auto &Attribute : tags.Decoded(object)){
+                        if(Attribute.first == key){
+                            return true;
+                        }
+                    }
+                    return false;
+            }
+            return false;
+        }
+
+        std::string Attribute(const STagColumns &tags, std::size_t object, const std::string &key) const noexcept{
+            switch(tags.DDecoding){
+                case ETagDecoding::Eager:{
+                    auto KeyID = DStrings.Find(key);
+                    if(KeyID == CStringPool::InvalidStringID){
+                        return std::string(); // If nothing is found, return an empty string " "
+                    }
+                    return DStrings.String(tags.Find(object, KeyID));
+                }
+                case ETagDecoding::Lazy:{
+                    std::string Value;
+                    tags.ForEachRaw(object, [&](std::string_view rawkey, std::string_view rawvalue){
+                        if(rawkey != key){
+                            return true;
+                        }
+                        Value = rawvalue;
+                        return false;
+                    });
+                    return Value;
+                }
+                case ETagDecoding::LazyMemoized:
+                    for(const auto &Attribute : tags.Decoded(object)){
+                        if(Attribute.first == key){
+                            return Attribute.second;
+                        }
+                    }
+                    return std::string();
+            }
+            return std::string();
+        }
+    };
+
+    //Lightweight handle to one row of the node columns
+    //Once ApplyChanges removes a node the row may hold another node or be gone, so the handle reads as an empty node
     struct SNode: public CStreetMap::SNode{
-        const std::string DNodeIDAttr = "id";
-        const std::string DNodeLatAttr = "lat";
-        const std::string DNodeLonAttr = "lon";
-        TNodeID DID;
-        SLocation DLocation;
-        //Vector of attributes in <tag>
-        TAttributes DAttributes;
+        std::shared_ptr<const SData> DData;
+        std::size_t DIndex;
+        std::size_t DGeneration;
+
+        SNode(std::shared_ptr<const SData> data, std::size_t index) : DData(data), DIndex(index), DGeneration(data->DNodes.DGeneration){
 
-        SNode(const SXMLEntity &entity){
-            auto NodeID = std::stoull(entity.AttributeValue(DNodeIDAttr));
-            auto NodeLat = std::stod(entity.AttributeValue(DNodeLatAttr));
-            auto NodeLon = std::stod(entity.AttributeValue(DNodeLonAttr));
-            DID = NodeID;
-            DLocation = SLocation{NodeLat,NodeLon};
         }
         ~SNode(){
 
         }
 
+        bool Current() const noexcept{
+            return DGeneration == DData->DNodes.DGeneration;
+        }
+
         TNodeID ID() const noexcept override{
-            return DID;
+            return Current() ? DData->DNodes.DIDs[DIndex] : InvalidNodeID;
         }
-        
+
         SLocation Location() const noexcept override{
-            return DLocation;
+            return Current() ? DData->DNodes.Location(DIndex) : InvalidLocation();
         }
-        
+
         std::size_t AttributeCount() const noexcept override{
-            return DAttributes.size();
+            return Current() ? DData->AttributeCount(DData->DNodes.DTags, DIndex) : 0;
         }
-        
+
         std::string GetAttributeKey(std::size_t index) const noexcept override{
-            return DAttributes[index].first;
+            return Current() ? DData->AttributeKey(DData->DNodes.DTags, DIndex, index) : std::string();
         }
-        
+
         bool HasAttribute(const std::string &key) const noexcept override{
-            for(auto &Attribute : DAttributes){ // Looks through all attributes in DAttributes
-                if(std::get<0>(Attribute) == key){ // Finds the first element of pair
-                    return true;   // Returns true if found
-                }
-            }
-            return false; // If nothing is found, return false
+            return Current() && DData->HasAttribute(DData->DNodes.DTags, DIndex, key);
         }
-        
+
         std::string GetAttribute(const std::string &key) const noexcept override{
-            for(auto &Attribute : DAttributes){ // Looks through all attributes in DAttributes
-                if(std::get<0>(Attribute) == key){ // Finds the key of pair
-                    return std::get<1>(Attribute);   // Returns the value of attribute
-                }
-            }
-            return std::string(); // If nothing is found, return an empty string " "
+            return Current() ? DData->Attribute(DData->DNodes.DTags, DIndex, key) : std::string();
         }
-        
+
     };
-    //Stores information of <way> tag with attributes in <tag> and id refs of <nd>
+    //Lightweight handle to one row of the way columns, stale after a way removal as SNode is after a node removal
     struct SWay: public CStreetMap::SWay{
-        const std::string DWayIDAttr = "id";
-        TWayID DID;
-        //Vector of attributes in <tag>
-        TAttributes DAttributes;
-        //Vector of reference id in <nd> tag
-        std::vector<TNodeID> DNodeReferences;
+        std::shared_ptr<const SData> DData;
+        std::size_t DIndex;
+        std::size_t DGeneration;
+
+        SWay(std::shared_ptr<const SData> data, std::size_t index) : DData(data), DIndex(index), DGeneration(data->DWays.DGeneration){
 
-        SWay(const SXMLEntity &entity){
-            auto WayID = std::stoull(entity.AttributeValue(DWayIDAttr));
-            DID = WayID;  
         }
 
         ~SWay(){
 
         }
 
+        bool Current() const noexcept{
+            return DGeneration == DData->DWays.DGeneration;
+        }
+
         TWayID ID() const noexcept override{
-            return DID;
+            return Current() ? DData->DWays.DIDs[DIndex] : InvalidWayID;
         }
-        
+
         std::size_t NodeCount() const noexcept override{
-            return DNodeReferences.size();
+            return Current() ? DData->DWays.NodeCount(DIndex) : 0;
         }
-        
+
         TNodeID GetNodeID(std::size_t index) const noexcept override{
             if(index >= NodeCount()){
                 return InvalidNodeID;
             }
 
-            return DNodeReferences[index];
+            return DData->DWays.NodeID(DIndex, index, DData->DNodes.DIDs);
         }
-        
+
         std::size_t AttributeCount() const noexcept override{
-            return DAttributes.size();
+            return Current() ? DData->AttributeCount(DData->DWays.DTags, DIndex) : 0;
         }
-        
+
         std::string GetAttributeKey(std::size_t index) const noexcept override{
-            return DAttributes[index].first;
+            return Current() ? DData->AttributeKey(DData->DWays.DTags, DIndex, index) : std::string();
         }
-        
+
         bool HasAttribute(const std::string &key) const noexcept override{
-            for(auto &Attribute : DAttributes){ // Looks through all attributes in DAttributes
-                if(std::get<0>(Attribute) == key){ // Finds the first element of pair
-                    return true;   // Returns true if found
-                }
-            }
-            return false; // If nothing is found, return false
+            return Current() && DData->HasAttribute(DData->DWays.DTags, DIndex, key);
         }
-        
+
         std::string GetAttribute(const std::string &key) const noexcept override{
-            for(auto &Attribute : DAttributes){ // Looks through all attributes in DAttributes
-                if(std::get<0>(Attribute) == key){ // Finds the key of pair
-                    return std::get<1>(Attribute);   // Returns the value of attribute
-                }
-            }
-            return std::string(); // If nothing is found, return an empty string " "
+            return Current() ? DData->Attribute(DData->DWays.DTags, DIndex, key) : std::string();
         }
-        
+
     };
     //Data storage
-    std::vector<std::shared_ptr<SNode>> DNodesByIndex;
-    std::unordered_map<TNodeID,std::shared_ptr<SNode>> DNodesByID;
-
-    std::vector<std::shared_ptr<SWay>> DWaysByIndex;
-    std::unordered_map<TNodeID,std::shared_ptr<SWay>> DWaysByID;
+    std::shared_ptr<SData> DData = std::make_shared<SData>();
+    SOptions DOptions;
+    CIDIndex DNodesByID;
+    CIDIndex DWaysByID;
+    std::vector<TNodeID> DWayNodeScratch;
+    //Filtered loading: two pass keeps only DKeptWayIDs and DKeptNodeIDs, one pass tests each way's tags
+    bool DFilterNodes = false;
+    bool DFilterWays = false;
+    std::vector<TNodeID> DKeptNodeIDs;
+    std::vector<TWayID> DKeptWayIDs;
+    CRTree DWayRTree;
+    CKDTree DNodeKDTree;
+    CTagIndex DNodeTagIndex;
+    CTagIndex DWayTagIndex;
+    //Way IDs naming each node ID, one entry per distinct node of a way, including nodes missing from the map
+    //Built by the first ApplyChanges so a node change only revisits the ways that name it
+    std::unordered_multimap<TNodeID, TWayID> DWaysByNode;
+    bool DWaysByNodeBuilt = false;
 
     bool FindStartTag(std::shared_ptr< CXMLReader > xmlsource, const std::string &starttag){
         SXMLEntity TempEntity;
@@ -143,8 +900,78 @@ struct COpenStreetMap::SImplementation{
         return false;
     }
 
+    //Interns key and value and appends them to tags, lazy modes only copy the raw bytes
+    void AddTag(const std::string &key, const std::string &value, STagColumns &tags){
+        if(tags.DDecoding != ETagDecoding::Eager){
+            for(const auto *Text : {&key, &value}){
+                tags.DRawBytes.insert(tags.DRawBytes.end(), Text->begin(), Text->end());
+                tags.DRawBytes.push_back('\0');
+            }
+            return;
+        }
+        tags.DTags.push_back({DData->DStrings.Intern(key), DData->DStrings.Intern(value)});
+    }
+
+    void ParseTag(const SXMLEntity &tag, STagColumns &tags){
+        AddTag(tag.AttributeValue("k"), tag.AttributeValue("v"), tags);
+    }
+
+    //Reads up to and including the end tag of an element that is not kept
+    void SkipElement(std::shared_ptr< CXMLReader > xmlsource, const std::string &name){
+        SXMLEntity TempEntity;
+        while(xmlsource->ReadEntity(TempEntity,true)){
+            if((TempEntity.DType == SXMLEntity::EType::EndElement)&&(TempEntity.DNameData == name)){
+                break;
+            }
+        }
+    }
+
+    //First pass of filtered loading, remembers the ways the filter keeps and every node they reference
+    void FilterOSM(std::shared_ptr<CXMLReader> src){
+        SXMLEntity TempEntity;
+        TAttributes Tags;
+        std::vector<TNodeID> References;
+        if(!FindStartTag(src,DOSMTag)){
+            return;
+        }
+        while(src->ReadEntity(TempEntity, true)){
+            if((TempEntity.DType != SXMLEntity::EType::StartElement)||(TempEntity.DNameData != DWayTag)){
+                continue;
+            }
+            auto WayID = std::stoull(TempEntity.AttributeValue(DWayIDAttr));
+            Tags.clear();
+            References.clear();
+            while(src->ReadEntity(TempEntity,true)){
+                if((TempEntity.DType == SXMLEntity::EType::EndElement)&&(TempEntity.DNameData == DWayTag)){
+                    break;
+                }
+                if((TempEntity.DType == SXMLEntity::EType::StartElement)&&(TempEntity.DNameData == DNodeReferenceTag)){
+                    References.push_back(std::stoull(TempEntity.AttributeValue("ref")));
+                }
+                if((TempEntity.DType == SXMLEntity::EType::StartElement)&&(TempEntity.DNameData == DAttributeTag)){
+                    Tags.push_back({TempEntity.AttributeValue("k"), TempEntity.AttributeValue("v")});
+                }
+            }
+            if(DOptions.DWayFilter(Tags)){
+                DKeptWayIDs.push_back(WayID);
+                DKeptNodeIDs.insert(DKeptNodeIDs.end(), References.begin(), References.end());
+            }
+        }
+        for(auto IDs : {&DKeptWayIDs, &DKeptNodeIDs}){
+            std::sort(IDs->begin(), IDs->end());
+            IDs->erase(std::unique(IDs->begin(), IDs->end()), IDs->end());
+        }
+    }
+
     void ParseNode(std::shared_ptr< CXMLReader > xmlsource, const SXMLEntity &node){
-        auto NewNode = std::make_shared<SNode>(node);
+        auto &Nodes = DData->DNodes;
+        auto NodeID = std::stoull(node.AttributeValue(DNodeIDAttr));
+        if(DFilterNodes && !std::binary_search(DKeptNodeIDs.begin(), DKeptNodeIDs.end(), NodeID)){
+            SkipElement(xmlsource, DNodeTag);
+            return;
+        }
+        Nodes.DIDs.push_back(NodeID);
+        Nodes.AddLocation(std::stod(node.AttributeValue(DNodeLatAttr)), std::stod(node.AttributeValue(DNodeLonAttr)));
         SXMLEntity TempEntity;
 
         while(xmlsource->ReadEntity(TempEntity,true)){
@@ -154,17 +981,22 @@ struct COpenStreetMap::SImplementation{
             }
             //Get attributes in <tag>
             if((TempEntity.DType == SXMLEntity::EType::StartElement)&&(TempEntity.DNameData == DAttributeTag)){
-                auto Key =TempEntity.AttributeValue("k");
-                auto Value =TempEntity.AttributeValue("v");
-                NewNode->DAttributes.push_back({Key, Value});
+                ParseTag(TempEntity, Nodes.DTags);
             }
         }
-        DNodesByIndex.push_back(NewNode);
-        DNodesByID[NewNode->ID()] = NewNode;
+        Nodes.DTags.FinishObject();
     }
 
     void ParseWay(std::shared_ptr< CXMLReader > xmlsource, const SXMLEntity &way){
-        auto NewWay = std::make_shared<SWay>(way);
+        auto &Ways = DData->DWays;
+        auto WayID = std::stoull(way.AttributeValue(DWayIDAttr));
+        if(DFilterNodes && !std::binary_search(DKeptWayIDs.begin(), DKeptWayIDs.end(), WayID)){
+            SkipElement(xmlsource, DWayTag);
+            return;
+        }
+        Ways.DIDs.push_back(WayID);
+        DWayNodeScratch.clear();
+        TAttributes FilterTags;
         SXMLEntity TempEntity;
 
         //Find and read the <nd> between way
@@ -176,17 +1008,24 @@ struct COpenStreetMap::SImplementation{
             //Get the ref id
             if((TempEntity.DType == SXMLEntity::EType::StartElement)&&(TempEntity.DNameData == DNodeReferenceTag)){
                 auto NodeRef = std::stoull(TempEntity.AttributeValue("ref"));
-                NewWay->DNodeReferences.push_back(NodeRef);
+                DWayNodeScratch.push_back(NodeRef);
             }
             //Get attributes in <tag>
             if((TempEntity.DType == SXMLEntity::EType::StartElement)&&(TempEntity.DNameData == DAttributeTag)){
-                auto Key =TempEntity.AttributeValue("k");
-                auto Value =TempEntity.AttributeValue("v");
-                NewWay->DAttributes.push_back({Key, Value});
+                ParseTag(TempEntity, Ways.DTags);
+                if(DFilterWays){
+                    FilterTags.push_back({TempEntity.AttributeValue("k"), TempEntity.AttributeValue("v")});
+                }
             }
         }
-        DWaysByIndex.push_back(NewWay);
-        DWaysByID[NewWay->ID()] = NewWay;
+        //Single pass filtering can only drop the way once its tags are known
+        if(DFilterWays && !DOptions.DWayFilter(FilterTags)){
+            Ways.DIDs.pop_back();
+            Ways.DTags.DiscardObject();
+            return;
+        }
+        Ways.AddNodeReferences(DWayNodeScratch);
+        Ways.DTags.FinishObject();
     }
 
     bool ParseOSM(std::shared_ptr<CXMLReader> src){
@@ -207,60 +1046,1041 @@ struct COpenStreetMap::SImplementation{
         return true;
     }
 
-    SImplementation(std::shared_ptr<CXMLReader> src){
-        ParseOSM(src);
+    //Pipelined loading: the reader thread batches raw elements, workers convert them and the constructing thread appends them in order
+    inline static constexpr std::size_t PipelineBatchSize = 512;
+    inline static constexpr std::size_t PipelineQueueCapacity = 64;
+
+    //A <node> or <way> as the XML reader produced it, numbers still text
+    struct SRawElement{
+        bool DWay;
+        TAttributes DAttributes;
+        std::vector<std::string> DReferences;
+        TAttributes DTags;
+    };
+
+    struct SRawBatch{
+        std::size_t DSequence;
+        std::vector<SRawElement> DElements;
+    };
+
+    //An element ready to append, elements two pass filtering drops never get here
+    struct SParsedElement{
+        bool DWay;
+        uint64_t DID;
+        double DLatitude;
+        double DLongitude;
+        std::vector<TNodeID> DReferences;
+        TAttributes DTags;
+    };
+
+    struct SParsedBatch{
+        std::size_t DSequence;
+        std::vector<SParsedElement> DElements;
+    };
+
+    //A null batch tells the receiving thread that no more batches follow
+    using TRawQueue = CBoundedQueue<std::unique_ptr<SRawBatch>>;
+    using TParsedQueue = CBoundedQueue<std::unique_ptr<SParsedBatch>>;
+
+    //Returns false unless all of text is a number
+    static bool ParseUnsigned(const std::string &text, uint64_t &value) noexcept{
+        auto End = text.data() + text.size();
+        auto [Pointer, Error] = std::from_chars(text.data(), End, value);
+        return (Error == std::errc())&&(Pointer == End);
+    }
+
+    //Returns false unless all of text is a finite number
+    static bool ParseCoordinate(const std::string &text, double &value) noexcept{
+        auto End = text.data() + text.size();
+        auto [Pointer, Error] = std::from_chars(text.data(), End, value);
+        return (Error == std::errc())&&(Pointer == End)&&std::isfinite(value);
+    }
+
+    //Set by the first pipeline thread that throws, the other threads stop waiting on the queues and return
+    struct SPipelineFailure{
+        std::atomic<bool> DFailed{false};
+        std::mutex DMutex;
+        std::exception_ptr DError;
+
+        void Fail(std::exception_ptr error){
+            std::lock_guard<std::mutex> Lock(DMutex);
+            if(!DError){
+                DError = error;
+            }
+            DFailed.store(true, std::memory_order_release);
+        }
+    };
+
+    //Only moves strings out of the reader's entities, so the single reader thread stays as short as possible
+    //Returns early if another pipeline thread failed
+    void ReadElements(std::shared_ptr<CXMLReader> src, TRawQueue &raw, std::size_t workers, const std::atomic<bool> &failed){
+        SXMLEntity TempEntity;
+        std::size_t Sequence = 0;
+        auto Batch = std::make_unique<SRawBatch>();
+        auto Send = [&]{
+            Batch->DSequence = Sequence++;
+            if(!raw.Push(std::move(Batch), failed)){
+                return false;
+            }
+            Batch = std::make_unique<SRawBatch>();
+            Batch->DElements.reserve(PipelineBatchSize);
+            return true;
+        };
+        if(FindStartTag(src, DOSMTag)){
+            while(src->ReadEntity(TempEntity, true)){
+                if(TempEntity.DType != SXMLEntity::EType::StartElement){
+                    continue;
+                }
+                bool IsWay = TempEntity.DNameData == DWayTag;
+                if(!IsWay && (TempEntity.DNameData != DNodeTag)){
+                    continue;
+                }
+                auto &Element = Batch->DElements.emplace_back();
+                Element.DWay = IsWay;
+                Element.DAttributes = std::move(TempEntity.DAttributes);
+                const auto &EndTag = IsWay ? DWayTag : DNodeTag;
+                while(src->ReadEntity(TempEntity, true)){
+                    if((TempEntity.DType == SXMLEntity::EType::EndElement)&&(TempEntity.DNameData == EndTag)){
+                        break;
+                    }
+                    if(TempEntity.DType != SXMLEntity::EType::StartElement){
+                        continue;
+                    }
+                    if(IsWay && (TempEntity.DNameData == DNodeReferenceTag)){
+                        Element.DReferences.push_back(TempEntity.AttributeValue("ref"));
+                    }
+                    else if(TempEntity.DNameData == DAttributeTag){
+                        Element.DTags.push_back({TempEntity.AttributeValue("k"), TempEntity.AttributeValue("v")});
+                    }
+                }
+                if((Batch->DElements.size() == PipelineBatchSize)&&!Send()){
+                    return;
+                }
+            }
+        }
+        if(!Batch->DElements.empty()&&!Send()){
+            return;
+        }
+        for(std::size_t Worker = 0; Worker < workers; Worker++){
+            if(!raw.Push(nullptr, failed)){
+                return;
+            }
+        }
+    }
+
+    //Converts numbers and applies two pass filtering, which only reads the sorted kept ID sets
+    //Numbers are converted as ParseOSM does, so malformed IDs and coordinates throw the same way
+    void ParseElements(TRawQueue &raw, TParsedQueue &parsed, const std::atomic<bool> &failed){
+        std::unique_ptr<SRawBatch> Batch;
+        while(raw.Pop(Batch, failed)){
+            if(!Batch){
+                parsed.Push(nullptr, failed);
+                return;
+            }
+            auto Parsed = std::make_unique<SParsedBatch>();
+            Parsed->DSequence = Batch->DSequence;
+            Parsed->DElements.reserve(Batch->DElements.size());
+            for(auto &Element : Batch->DElements){
+                SXMLEntity Attributes;
+                Attributes.DAttributes = std::move(Element.DAttributes);
+                auto ID = std::stoull(Attributes.AttributeValue(Element.DWay ? DWayIDAttr : DNodeIDAttr));
+                const auto &Kept = Element.DWay ? DKeptWayIDs : DKeptNodeIDs;
+                if(DFilterNodes && !std::binary_search(Kept.begin(), Kept.end(), ID)){
+                    continue;
+                }
+                auto &Result = Parsed->DElements.emplace_back();
+                Result.DWay = Element.DWay;
+                Result.DID = ID;
+                if(Element.DWay){
+                    Result.DReferences.reserve(Element.DReferences.size());
+                    for(const auto &Reference : Element.DReferences){
+                        Result.DReferences.push_back(std::stoull(Reference));
+                    }
+                }
+                else{
+                    Result.DLatitude = std::stod(Attributes.AttributeValue(DNodeLatAttr));
+                    Result.DLongitude = std::stod(Attributes.AttributeValue(DNodeLonAttr));
+                }
+                Result.DTags = std::move(Element.DTags);
+            }
+            if(!parsed.Push(std::move(Parsed), failed)){
+                return;
+            }
+        }
+    }
+
+    //Appends one converted element, single pass filtering runs here since the filter need not be thread safe
+    void AppendElement(const SParsedElement &element){
+        if(element.DWay){
+            auto &Ways = DData->DWays;
+            if(DFilterWays && !DOptions.DWayFilter(element.DTags)){
+                return;
+            }
+            Ways.DIDs.push_back(element.DID);
+            Ways.AddNodeReferences(element.DReferences);
+            for(const auto &[Key, Value] : element.DTags){
+                AddTag(Key, Value, Ways.DTags);
+            }
+            Ways.DTags.FinishObject();
+            return;
+        }
+        auto &Nodes = DData->DNodes;
+        Nodes.DIDs.push_back(element.DID);
+        Nodes.AddLocation(element.DLatitude, element.DLongitude);
+        for(const auto &[Key, Value] : element.DTags){
+            AddTag(Key, Value, Nodes.DTags);
+        }
+        Nodes.DTags.FinishObject();
+    }
+
+    //Same result as ParseOSM, with reading, converting and appending on separate threads
+    //An exception on any thread stops the others, and once all are joined it is rethrown here
+    void ParseOSMPipelined(std::shared_ptr<CXMLReader> src){
+        //One thread reads and this thread appends, the rest convert
+        auto Threads = ResolveThreadCount(DOptions.DThreadCount);
+        auto Workers = Threads > 2 ? Threads - 2 : 1;
+        TRawQueue Raw(PipelineQueueCapacity);
+        TParsedQueue Parsed(PipelineQueueCapacity);
+        SPipelineFailure Failure;
+        auto Guarded = [&Failure](auto work){
+            return [&Failure, work]{
+                try{
+                    work();
+                }
+                catch(...){
+                    Failure.Fail(std::current_exception());
+                }
+            };
+        };
+        std::thread Reader(Guarded([&]{ ReadElements(src, Raw, Workers, Failure.DFailed); }));
+        std::vector<std::thread> Converters;
+        for(std::size_t Worker = 0; Worker < Workers; Worker++){
+            Converters.emplace_back(Guarded([&]{ ParseElements(Raw, Parsed, Failure.DFailed); }));
+        }
+        Guarded([&]{
+            //Batches finish out of order, hold the early ones until their turn
+            std::map<std::size_t, std::unique_ptr<SParsedBatch>> Waiting;
+            std::size_t NextSequence = 0;
+            std::size_t Finished = 0;
+            std::unique_ptr<SParsedBatch> Batch;
+            while((Finished < Workers)&&Parsed.Pop(Batch, Failure.DFailed)){
+                if(!Batch){
+                    Finished++;
+                    continue;
+                }
+                Waiting[Batch->DSequence] = std::move(Batch);
+                for(auto Search = Waiting.find(NextSequence); Search != Waiting.end(); Search = Waiting.find(NextSequence)){
+                    for(const auto &Element : Search->second->DElements){
+                        AppendElement(Element);
+                    }
+                    Waiting.erase(Search);
+                    NextSequence++;
+                }
+            }
+        })();
+        Reader.join();
+        for(auto &Converter : Converters){
+            Converter.join();
+        }
+        if(Failure.DError){
+            std::rethrow_exception(Failure.DError);
+        }
+    }
+
+    //filtersrc is only read when options has a way filter, it must hold the same data as src
+    SImplementation(std::shared_ptr<CXMLReader> filtersrc, std::shared_ptr<CXMLReader> src, const SOptions &options) : DOptions(options), DNodesByID(options.DIndexType), DWaysByID(options.DIndexType){
+        DData->DNodes.DStorage = options.DCoordinateStorage;
+        DData->DNodes.DTags.DDecoding = options.DTagDecoding;
+        DData->DWays.DTags.DDecoding = options.DTagDecoding;
+        DData->DWays.DStorage = options.DWayNodeStorage;
+        if(options.DWayFilter){
+            if(filtersrc){
+                FilterOSM(filtersrc);
+                DFilterNodes = true;
+            }
+            else{
+                DFilterWays = true;
+            }
+        }
+        if(options.DPipelinedLoad){
+            ParseOSMPipelined(src);
+        }
+        else{
+            ParseOSM(src);
+        }
+        DKeptNodeIDs = std::vector<TNodeID>();
+        DKeptWayIDs = std::vector<TWayID>();
+        DData->DNodes.ShrinkToFit();
+        DData->DWays.ShrinkToFit();
+        //Indexes are built in bulk once every ID is known
+        DNodesByID.Build(DData->DNodes.DIDs, DOptions.DThreadCount);
+        DWaysByID.Build(DData->DWays.DIDs, DOptions.DThreadCount);
+        ResolveWayNodes();
+        DWayNodeScratch = std::vector<TNodeID>();
+        BuildSpatialIndexes();
+    }
+
+    void BuildSpatialIndexes(){
+        if(DOptions.DBuildWayRTree){
+            std::vector<CRTree::SBox> Boxes(DData->DWays.Count());
+            ParallelFor(Boxes.size(), DOptions.DThreadCount, [&](std::size_t begin, std::size_t end){
+                for(auto Index = begin; Index < end; Index++){
+                    Boxes[Index] = WayBounds(Index);
+                }
+            });
+            DWayRTree.Build(Boxes, DOptions.DThreadCount);
+        }
+        if(DOptions.DBuildNodeKDTree){
+            std::vector<SLocation> Locations(DData->DNodes.Count());
+            ParallelFor(Locations.size(), DOptions.DThreadCount, [&](std::size_t begin, std::size_t end){
+                for(auto Index = begin; Index < end; Index++){
+                    Locations[Index] = DData->DNodes.Location(Index);
+                }
+            });
+            DNodeKDTree.Build(Locations, DOptions.DThreadCount);
+        }
+    }
+
+    //Looks every way node ref up once so geometry reads need no ID lookups
+    //Ways are split between DThreadCount threads, each only writes the indices of its own ways
+    //Compressed refs then drop their packed IDs, as every resolved ref can read its ID from its node row
+    void ResolveWayNodes(){
+        auto &Ways = DData->DWays;
+        Ways.DNodeIndices.resize(Ways.DNodeOffsets.back());
+        bool Compressed = Ways.DStorage == EWayNodeStorage::Compressed;
+        std::mutex UnresolvedMutex;
+        ParallelFor(Ways.Count(), DOptions.DThreadCount, [&](std::size_t begin, std::size_t end){
+            std::vector<TNodeID> References;
+            std::vector<std::pair<std::size_t, TNodeID>> Unresolved;
+            for(auto Way = begin; Way < end; Way++){
+                References.resize(Ways.NodeCount(Way));
+                Ways.DecodeNodeIDs(Way, References.data(), DData->DNodes.DIDs);
+                auto Start = Ways.DNodeOffsets[Way];
+                for(std::size_t Ref = 0; Ref < References.size(); Ref++){
+                    auto NodeIndex = DNodesByID.Find(References[Ref]);
+                    if(NodeIndex == CIDIndex::InvalidIndex){
+                        Ways.DNodeIndices[Start + Ref] = InvalidNodeIndex;
+                        if(Compressed){
+                            Unresolved.push_back({Start + Ref, References[Ref]});
+                        }
+                    }
+                    else{
+                        Ways.DNodeIndices[Start + Ref] = static_cast<uint32_t>(NodeIndex);
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> Lock(UnresolvedMutex);
+            Ways.DUnresolvedIDs.insert(Unresolved.begin(), Unresolved.end());
+        });
+        if(Compressed){
+            Ways.DIDsFromNodes = true;
+            Ways.DPackedOffsets = std::vector<uint64_t>();
+            Ways.DPackedReferences = std::vector<uint8_t>();
+        }
+    }
+
+    void ResolveWay(std::size_t index){
+        auto &Ways = DData->DWays;
+        DWayNodeScratch.resize(Ways.NodeCount(index));
+        Ways.DecodeNodeIDs(index, DWayNodeScratch.data(), DData->DNodes.DIDs);
+        auto Start = Ways.DNodeOffsets[index];
+        for(std::size_t Ref = 0; Ref < DWayNodeScratch.size(); Ref++){
+            auto NodeIndex = DNodesByID.Find(DWayNodeScratch[Ref]);
+            Ways.SetNodeIndex(Start + Ref, NodeIndex == CIDIndex::InvalidIndex ? InvalidNodeIndex : static_cast<uint32_t>(NodeIndex), DWayNodeScratch[Ref]);
+        }
+    }
+
+    //What one ApplyChanges call has touched, so only that is revisited at the end
+    struct SChangeState{
+        //Ways that changed or name a node that was added, moved, removed or whose row moved
+        //Their refs are looked up again and their R-tree boxes replaced
+        std::vector<TWayID> DTouchedWays;
+    };
+
+    //Reads one <node> or <way> of a change block, unlike loading a <delete> entry may carry nothing but its ID
+    //Returns false if the ID or a ref is not a number, or a node being created or modified lacks a numeric lat and lon
+    //The whole element is still consumed
+    bool ReadChangeElement(std::shared_ptr<CXMLReader> changes, const SXMLEntity &element, bool deleting, SParsedElement &parsed){
+        parsed.DWay = element.DNameData == DWayTag;
+        bool Valid = ParseUnsigned(element.AttributeValue(parsed.DWay ? DWayIDAttr : DNodeIDAttr), parsed.DID);
+        if(!parsed.DWay && !deleting){
+            Valid &= ParseCoordinate(element.AttributeValue(DNodeLatAttr), parsed.DLatitude);
+            Valid &= ParseCoordinate(element.AttributeValue(DNodeLonAttr), parsed.DLongitude);
+        }
+        parsed.DReferences.clear();
+        parsed.DTags.clear();
+        SXMLEntity TempEntity;
+        while(changes->ReadEntity(TempEntity, true)){
+            if((TempEntity.DType == SXMLEntity::EType::EndElement)&&(TempEntity.DNameData == element.DNameData)){
+                break;
+            }
+            if(TempEntity.DType != SXMLEntity::EType::StartElement){
+                continue;
+            }
+            if(parsed.DWay && (TempEntity.DNameData == DNodeReferenceTag)){
+                Valid &= ParseUnsigned(TempEntity.AttributeValue("ref"), parsed.DReferences.emplace_back());
+            }
+            else if(TempEntity.DNameData == DAttributeTag){
+                parsed.DTags.push_back({TempEntity.AttributeValue("k"), TempEntity.AttributeValue("v")});
+            }
+        }
+        return Valid;
+    }
+
+    //Tags of a node or way handle as the public interface reports them, which is what the tag indexes were built from
+    template <typename TObject>
+    static TAttributes ObjectTags(const TObject &object){
+        TAttributes Tags;
+        for(std::size_t Attribute = 0; Attribute < object->AttributeCount(); Attribute++){
+            auto Key = object->GetAttributeKey(Attribute);
+            Tags.push_back({Key, object->GetAttribute(Key)});
+        }
+        return Tags;
+    }
+
+    //Adds or removes the DWaysByNode entries of way index
+    void LinkWay(std::size_t index, bool link){
+        auto &Ways = DData->DWays;
+        auto WayID = Ways.DIDs[index];
+        DWayNodeScratch.resize(Ways.NodeCount(index));
+        Ways.DecodeNodeIDs(index, DWayNodeScratch.data(), DData->DNodes.DIDs);
+        std::sort(DWayNodeScratch.begin(), DWayNodeScratch.end());
+        DWayNodeScratch.erase(std::unique(DWayNodeScratch.begin(), DWayNodeScratch.end()), DWayNodeScratch.end());
+        for(auto NodeID : DWayNodeScratch){
+            if(link){
+                DWaysByNode.emplace(NodeID, WayID);
+                continue;
+            }
+            auto [Begin, End] = DWaysByNode.equal_range(NodeID);
+            for(auto Search = Begin; Search != End; ++Search){
+                if(Search->second == WayID){
+                    DWaysByNode.erase(Search);
+                    break;
+                }
+            }
+        }
+    }
+
+    void TouchWaysNaming(TNodeID id, SChangeState &state){
+        auto [Begin, End] = DWaysByNode.equal_range(id);
+        for(auto Search = Begin; Search != End; ++Search){
+            state.DTouchedWays.push_back(Search->second);
+        }
+    }
+
+    //Points the refs to node id at row from to row to instead, before the row moves or goes
+    //Compressed refs read their IDs from node rows, so they must never point at a row that now holds another node
+    void RetargetWayNodes(TNodeID id, uint32_t from, uint32_t to){
+        auto &Ways = DData->DWays;
+        auto [Begin, End] = DWaysByNode.equal_range(id);
+        for(auto Search = Begin; Search != End; ++Search){
+            auto Way = DWaysByID.Find(Search->second);
+            auto Start = Ways.DNodeOffsets[Way];
+            for(auto Position = Start; Position < Start + Ways.NodeCount(Way); Position++){
+                if(Ways.DNodeIndices[Position] == from){
+                    Ways.SetNodeIndex(Position, to, id);
+                }
+            }
+        }
+    }
+
+    //Create and modify both leave the node as given, so replaying a change is harmless
+    void UpsertNode(const SParsedElement &element, SChangeState &state){
+        auto &Nodes = DData->DNodes;
+        auto Index = DNodesByID.Find(element.DID);
+        bool Created = Index == CIDIndex::InvalidIndex;
+        if(!Created && DOptions.DBuildTagIndex){
+            DNodeTagIndex.Remove(Index, ObjectTags(NodeByIndex(Index)));
+        }
+        for(const auto &[Key, Value] : element.DTags){
+            AddTag(Key, Value, Nodes.DTags);
+        }
+        if(Created){
+            Index = Nodes.Count();
+            DNodesByID.Set(element.DID, Index);
+            Nodes.DIDs.push_back(element.DID);
+            Nodes.AddLocation(element.DLatitude, element.DLongitude);
+            Nodes.DTags.FinishObject();
+        }
+        else{
+            Nodes.SetLocation(Index, element.DLatitude, element.DLongitude);
+            Nodes.DTags.RewriteObject(Index);
+        }
+        if(DOptions.DBuildTagIndex){
+            DNodeTagIndex.Add(Index, ObjectTags(NodeByIndex(Index)));
+        }
+        if(DOptions.DBuildNodeKDTree){
+            DNodeKDTree.Update(Index, Nodes.Location(Index));
+        }
+        TouchWaysNaming(element.DID, state);
+    }
+
+    //The last row moves into the removed one, so the moved node's ways are revisited as well
+    void RemoveNode(TNodeID id, SChangeState &state){
+        auto &Nodes = DData->DNodes;
+        auto Index = DNodesByID.Find(id);
+        if(Index == CIDIndex::InvalidIndex){
+            return;
+        }
+        auto Last = Nodes.Count() - 1;
+        if(DOptions.DBuildTagIndex){
+            DNodeTagIndex.Remove(Index, ObjectTags(NodeByIndex(Index)));
+            if(Index != Last){
+                auto Moved = ObjectTags(NodeByIndex(Last));
+                DNodeTagIndex.Remove(Last, Moved);
+                DNodeTagIndex.Add(Index, Moved);
+            }
+        }
+        if(DOptions.DBuildNodeKDTree){
+            if(Index != Last){
+                DNodeKDTree.Update(Index, Nodes.Location(Last));
+            }
+            DNodeKDTree.Remove(Last);
+        }
+        TouchWaysNaming(id, state);
+        RetargetWayNodes(id, Index, InvalidNodeIndex);
+        DNodesByID.Erase(id);
+        if(Index != Last){
+            TouchWaysNaming(Nodes.DIDs[Last], state);
+            RetargetWayNodes(Nodes.DIDs[Last], Last, Index);
+            DNodesByID.Set(Nodes.DIDs[Last], Index);
+        }
+        Nodes.RemoveNode(Index);
+    }
+
+    //Ways the way filter drops are removed, as loading would not have kept them
+    void UpsertWay(const SParsedElement &element, SChangeState &state){
+        auto &Ways = DData->DWays;
+        if(DOptions.DWayFilter && !DOptions.DWayFilter(element.DTags)){
+            RemoveWay(element.DID, state);
+            return;
+        }
+        auto Index = DWaysByID.Find(element.DID);
+        bool Created = Index == CIDIndex::InvalidIndex;
+        if(!Created){
+            if(DOptions.DBuildTagIndex){
+                DWayTagIndex.Remove(Index, ObjectTags(WayByIndex(Index)));
+            }
+            LinkWay(Index, false);
+        }
+        for(const auto &[Key, Value] : element.DTags){
+            AddTag(Key, Value, Ways.DTags);
+        }
+        if(Created){
+            Index = Ways.Count();
+            DWaysByID.Set(element.DID, Index);
+            Ways.DIDs.push_back(element.DID);
+            Ways.AddNodeReferences(element.DReferences);
+            Ways.DTags.FinishObject();
+        }
+        else{
+            Ways.RewriteNodeReferences(Index, element.DReferences);
+            Ways.DTags.RewriteObject(Index);
+        }
+        LinkWay(Index, true);
+        if(DOptions.DBuildTagIndex){
+            DWayTagIndex.Add(Index, ObjectTags(WayByIndex(Index)));
+        }
+        state.DTouchedWays.push_back(element.DID);
+    }
+
+    //The last row moves into the removed one, its box is replaced once its refs are resolved at the end
+    void RemoveWay(TWayID id, SChangeState &state){
+        auto &Ways = DData->DWays;
+        auto Index = DWaysByID.Find(id);
+        if(Index == CIDIndex::InvalidIndex){
+            return;
+        }
+        auto Last = Ways.Count() - 1;
+        if(DOptions.DBuildTagIndex){
+            DWayTagIndex.Remove(Index, ObjectTags(WayByIndex(Index)));
+            if(Index != Last){
+                auto Moved = ObjectTags(WayByIndex(Last));
+                DWayTagIndex.Remove(Last, Moved);
+                DWayTagIndex.Add(Index, Moved);
+            }
+        }
+        if(DOptions.DBuildWayRTree){
+            DWayRTree.Update(Last, CRTree::SBox::EmptyBox());
+        }
+        LinkWay(Index, false);
+        DWaysByID.Erase(id);
+        if(Index != Last){
+            state.DTouchedWays.push_back(Ways.DIDs[Last]);
+            DWaysByID.Set(Ways.DIDs[Last], Index);
+        }
+        Ways.RemoveWay(Index);
+    }
+
+    //Applies an osmChange document in place, see COpenStreetMap::ApplyChanges for what each part costs
+    //skipped counts the elements that were not applied because they did not parse
+    bool ApplyChanges(std::shared_ptr<CXMLReader> changes, std::size_t &skipped){
+        SXMLEntity TempEntity;
+        if(!FindStartTag(changes, DChangeTag)){
+            return false;
+        }
+        auto &Nodes = DData->DNodes;
+        auto &Ways = DData->DWays;
+        Nodes.DTags.MakeMutable();
+        Ways.MakeMutable();
+        if(!DWaysByNodeBuilt){
+            DWaysByNode.reserve(Ways.DNodeOffsets.back());
+            for(std::size_t Index = 0; Index < Ways.Count(); Index++){
+                LinkWay(Index, true);
+            }
+            DWaysByNodeBuilt = true;
+        }
+        SChangeState State;
+        SParsedElement Element;
+        bool Deleting = false;
+        skipped = 0;
+        while(changes->ReadEntity(TempEntity, true)){
+            if(TempEntity.DType != SXMLEntity::EType::StartElement){
+                continue;
+            }
+            if((TempEntity.DNameData == DCreateTag)||(TempEntity.DNameData == DModifyTag)||(TempEntity.DNameData == DDeleteTag)){
+                Deleting = TempEntity.DNameData == DDeleteTag;
+                continue;
+            }
+            if((TempEntity.DNameData != DNodeTag)&&(TempEntity.DNameData != DWayTag)){
+                continue;
+            }
+            if(!ReadChangeElement(changes, TempEntity, Deleting, Element)){
+                skipped++;
+                continue;
+            }
+            if(Deleting && Element.DWay){
+                RemoveWay(Element.DID, State);
+            }
+            else if(Deleting){
+                RemoveNode(Element.DID, State);
+            }
+            else if(Element.DWay){
+                UpsertWay(Element, State);
+            }
+            else{
+                UpsertNode(Element, State);
+            }
+        }
+        //Touched ways are resolved last, so refs to nodes created after them in the document are found
+        std::sort(State.DTouchedWays.begin(), State.DTouchedWays.end());
+        State.DTouchedWays.erase(std::unique(State.DTouchedWays.begin(), State.DTouchedWays.end()), State.DTouchedWays.end());
+        for(auto WayID : State.DTouchedWays){
+            auto Index = DWaysByID.Find(WayID);
+            if(Index == CIDIndex::InvalidIndex){
+                continue;
+            }
+            ResolveWay(Index);
+            if(DOptions.DBuildWayRTree){
+                DWayRTree.Update(Index, WayBounds(Index));
+            }
+        }
+        Nodes.DTags.CompactIfSparse();
+        Ways.CompactIfSparse();
+        return true;
     }
 
     std::size_t NodeCount() const noexcept{
-        return DNodesByIndex.size();
+        return DData->DNodes.Count();
     }
 
     std::size_t WayCount() const noexcept{
-        return DWaysByIndex.size();
+        return DData->DWays.Count();
+    }
+
+    SMemoryReport MemoryUsage() const noexcept{
+        SMemoryReport Report;
+        SMemoryUsage All;
+        auto Charge = [&All](std::size_t &bytes, const SMemoryUsage &usage){
+            bytes += usage.DBytes;
+            All += usage;
+        };
+        const auto &Nodes = DData->DNodes;
+        const auto &Ways = DData->DWays;
+        SMemoryUsage WayIDs;
+        WayIDs.Add(Ways.DIDs);
+        SMemoryUsage Scratch;
+        Scratch.Add(DWayNodeScratch);
+        Scratch.Add(DKeptNodeIDs);
+        Scratch.Add(DKeptWayIDs);
+        Charge(Report.DNodes, Nodes.MemoryUsage());
+        Charge(Report.DNodeTags, Nodes.DTags.MemoryUsage());
+        Charge(Report.DNodeIndex, DNodesByID.MemoryUsage());
+        Charge(Report.DWays, WayIDs);
+        Charge(Report.DWayReferences, Ways.ReferenceUsage());
+        Charge(Report.DWayReferences, Scratch);
+        SMemoryUsage ReverseReferences;
+        ReverseReferences.Add(DWaysByNode);
+        Charge(Report.DWayReferences, ReverseReferences);
+        Charge(Report.DWayTags, Ways.DTags.MemoryUsage());
+        Charge(Report.DWayIndex, DWaysByID.MemoryUsage());
+        Charge(Report.DStrings, DData->DStrings.MemoryUsage());
+        Charge(Report.DSearchIndexes, DWayRTree.MemoryUsage());
+        Charge(Report.DSearchIndexes, DNodeKDTree.MemoryUsage());
+        Charge(Report.DSearchIndexes, DNodeTagIndex.MemoryUsage());
+        Charge(Report.DSearchIndexes, DWayTagIndex.MemoryUsage());
+        Report.DAllocatorOverhead = All.Overhead();
+        return Report;
     }
     //Access node based on order
     std::shared_ptr<CStreetMap::SNode> NodeByIndex(std::size_t index) const noexcept{
-        if(index < DNodesByIndex.size()){
-            return DNodesByIndex[index];
+        if(index < DData->DNodes.Count()){
+            return std::make_shared<SNode>(DData, index);
         }
         return nullptr;
     }
-    //Search key id in hash map
+    //Search key id in the ID index
     std::shared_ptr<CStreetMap::SNode> NodeByID(TNodeID id) const noexcept{
-        auto Search = DNodesByID.find(id);
-        if(Search != DNodesByID.end()){
-            return Search->second;
+        auto Index = DNodesByID.Find(id);
+        if(Index != CIDIndex::InvalidIndex){
+            return std::make_shared<SNode>(DData, Index);
         }
         return nullptr;
     }
+    std::size_t NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const{
+        std::vector<std::size_t> Indices;
+        auto Found = DNodesByID.FindBatch(ids, Indices);
+        locations.resize(ids.size());
+        //Found rows are scattered too, prefetch a group of coordinate rows before reading them
+        const auto GroupSize = CIDIndex::BatchGroupSize;
+        for(std::size_t GroupBegin = 0; GroupBegin < ids.size(); GroupBegin += GroupSize){
+            auto GroupEnd = std::min(ids.size(), GroupBegin + GroupSize);
+            for(auto Index = GroupBegin; Index < GroupEnd; Index++){
+                if(Indices[Index] != CIDIndex::InvalidIndex){
+                    DData->DNodes.PrefetchLocation(Indices[Index]);
+                }
+            }
+            for(auto Index = GroupBegin; Index < GroupEnd; Index++){
+                locations[Index] = Indices[Index] != CIDIndex::InvalidIndex ? DData->DNodes.Location(Indices[Index]) : InvalidLocation();
+            }
+        }
+        return Found;
+    }
+
+    //One handle is moved along the range, so visiting needs no allocation or reference counting per object
+    void ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const{
+        SNode Node(DData, begin);
+        for(end = std::min(end, DData->DNodes.Count()); Node.DIndex < end; Node.DIndex++){
+            visit(Node.DIndex, Node);
+        }
+    }
+
+    void ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const{
+        SWay Way(DData, begin);
+        for(end = std::min(end, DData->DWays.Count()); Way.DIndex < end; Way.DIndex++){
+            visit(Way.DIndex, Way);
+        }
+    }
+
     //Access way based on order
     std::shared_ptr<CStreetMap::SWay> WayByIndex(std::size_t index) const noexcept{
-        if(index < DWaysByIndex.size()){//check if successful
-            return DWaysByIndex[index];
+        if(index < DData->DWays.Count()){//check if successful
+            return std::make_shared<SWay>(DData, index);
         }
         return nullptr;
     }
-    //Search key id in hash map 
+    //Search key id in the ID index
     std::shared_ptr<CStreetMap::SWay> WayByID(TWayID id) const noexcept{
-        auto Search = DWaysByID.find(id);
-        if(Search != DWaysByID.end()){//check if successful
-            return Search->second;
+        auto Index = DWaysByID.Find(id);
+        if(Index != CIDIndex::InvalidIndex){//check if successful
+            return std::make_shared<SWay>(DData, Index);
         }
         return nullptr;
     }
 
+    //Sorted (ID, position) pairs for the snapshot index sections, the last position wins for repeated IDs
+    static void SortedIDIndex(const std::vector<uint64_t> &ids, std::vector<uint64_t> &sortedids, std::vector<uint32_t> &positions){
+        std::vector<std::pair<uint64_t, uint32_t>> Pairs;
+        Pairs.reserve(ids.size());
+        for(std::size_t Index = 0; Index < ids.size(); Index++){
+            Pairs.push_back({ids[Index], static_cast<uint32_t>(Index)});
+        }
+        std::sort(Pairs.begin(), Pairs.end());
+        for(std::size_t Index = 0; Index < Pairs.size(); Index++){
+            if((Index + 1 < Pairs.size())&&(Pairs[Index + 1].first == Pairs[Index].first)){
+                continue;
+            }
+            sortedids.push_back(Pairs[Index].first);
+            positions.push_back(Pairs[Index].second);
+        }
+    }
+
+    //Interns lazily kept raw tags so they can be written like eager ones
+    static void InternRawTags(const STagColumns &raw, std::size_t count, CStringPool &strings, STagColumns &tags){
+        for(std::size_t Index = 0; Index < count; Index++){
+            raw.ForEachRaw(Index, [&](std::string_view key, std::string_view value){
+                tags.DTags.push_back({strings.Intern(key), strings.Intern(value)});
+                return true;
+            });
+            tags.FinishObject();
+        }
+    }
+
+    //Copies tags that changes have scattered back into object order
+    static void CopyTags(const STagColumns &scattered, std::size_t count, STagColumns &tags){
+        for(std::size_t Index = 0; Index < count; Index++){
+            tags.DTags.insert(tags.DTags.end(), scattered.DTags.begin() + scattered.Begin(Index), scattered.DTags.begin() + scattered.End(Index));
+            tags.FinishObject();
+        }
+    }
+
+    //Writes every column in the CMappedStreetMap snapshot layout
+    bool WriteSnapshot(std::shared_ptr<CDataSink> sink) const{
+        using ESection = CMappedStreetMap::ESection;
+        const auto &Nodes = DData->DNodes;
+        const auto &Ways = DData->DWays;
+        const CStringPool *StringsPointer = &DData->DStrings;
+        const STagColumns *NodeTagsPointer = &Nodes.DTags;
+        const STagColumns *WayTagsPointer = &Ways.DTags;
+        //Snapshots always hold interned tags in object order
+        CStringPool LazyStrings;
+        STagColumns OrderedNodeTags, OrderedWayTags;
+        if(DOptions.DTagDecoding != ETagDecoding::Eager){
+            InternRawTags(Nodes.DTags, Nodes.Count(), LazyStrings, OrderedNodeTags);
+            InternRawTags(Ways.DTags, Ways.Count(), LazyStrings, OrderedWayTags);
+            StringsPointer = &LazyStrings;
+            NodeTagsPointer = &OrderedNodeTags;
+            WayTagsPointer = &OrderedWayTags;
+        }
+        else if(Nodes.DTags.DMutable){
+            CopyTags(Nodes.DTags, Nodes.Count(), OrderedNodeTags);
+            CopyTags(Ways.DTags, Ways.Count(), OrderedWayTags);
+            NodeTagsPointer = &OrderedNodeTags;
+            WayTagsPointer = &OrderedWayTags;
+        }
+        //Snapshots always hold plain node refs in way order
+        const std::vector<TNodeID> *NodeReferencesPointer = &Ways.DNodeReferences;
+        const std::vector<std::size_t> *NodeOffsetsPointer = &Ways.DNodeOffsets;
+        std::vector<TNodeID> PlainReferences;
+        std::vector<std::size_t> PlainOffsets{0};
+        if((Ways.DStorage == EWayNodeStorage::Compressed)||Ways.DMutable){
+            for(std::size_t Index = 0; Index < Ways.Count(); Index++){
+                PlainReferences.resize(PlainOffsets.back() + Ways.NodeCount(Index));
+                Ways.DecodeNodeIDs(Index, PlainReferences.data() + PlainOffsets.back(), Nodes.DIDs);
+                PlainOffsets.push_back(PlainReferences.size());
+            }
+            NodeReferencesPointer = &PlainReferences;
+            NodeOffsetsPointer = &PlainOffsets;
+        }
+        const auto &NodeReferences = *NodeReferencesPointer;
+        const auto &NodeOffsets = *NodeOffsetsPointer;
+        const auto &Strings = *StringsPointer;
+        const auto &NodeTags = *NodeTagsPointer;
+        const auto &WayTags = *WayTagsPointer;
+        bool FixedPoint = Nodes.DStorage == ECoordinateStorage::FixedPoint;
+
+        std::vector<uint64_t> StringOffsets{0};
+        std::vector<char> StringData;
+        for(TStringID Index = 0; Index < Strings.Count(); Index++){
+            const auto &String = Strings.String(Index);
+            StringData.insert(StringData.end(), String.begin(), String.end());
+            StringOffsets.push_back(StringData.size());
+        }
+        std::vector<uint64_t> NodeIndexIDs, WayIndexIDs;
+        std::vector<uint32_t> NodeIndexPositions, WayIndexPositions;
+        SortedIDIndex(Nodes.DIDs, NodeIndexIDs, NodeIndexPositions);
+        SortedIDIndex(Ways.DIDs, WayIndexIDs, WayIndexPositions);
+
+        CMappedStreetMap::SSnapshotHeader Header;
+        std::memset(&Header, 0, sizeof(Header));
+        std::memcpy(Header.DMagic, CMappedStreetMap::SnapshotMagic, sizeof(Header.DMagic));
+        Header.DVersion = CMappedStreetMap::SnapshotVersion;
+        Header.DFixedPoint = FixedPoint ? 1 : 0;
+        Header.DNodeCount = Nodes.Count();
+        Header.DWayCount = Ways.Count();
+        Header.DNodeTagCount = NodeTags.DTags.size();
+        Header.DWayTagCount = WayTags.DTags.size();
+        Header.DWayNodeCount = NodeReferences.size();
+        Header.DStringCount = Strings.Count();
+        Header.DStringBytes = StringData.size();
+        Header.DNodeIndexCount = NodeIndexIDs.size();
+        Header.DWayIndexCount = WayIndexIDs.size();
+
+        //Raw bytes of each section in ESection order
+        static_assert(sizeof(STag) == 2 * sizeof(uint32_t));
+        std::pair<const void *, std::size_t> Sections[] = {
+            {Nodes.DIDs.data(), Nodes.DIDs.size() * sizeof(uint64_t)},
+            FixedPoint ? std::pair<const void *, std::size_t>{Nodes.DFixedLatitudes.data(), Nodes.DFixedLatitudes.size() * sizeof(int32_t)} : std::pair<const void *, std::size_t>{Nodes.DLatitudes.data(), Nodes.DLatitudes.size() * sizeof(double)},
+            FixedPoint ? std::pair<const void *, std::size_t>{Nodes.DFixedLongitudes.data(), Nodes.DFixedLongitudes.size() * sizeof(int32_t)} : std::pair<const void *, std::size_t>{Nodes.DLongitudes.data(), Nodes.DLongitudes.size() * sizeof(double)},
+            {NodeTags.DOffsets.data(), NodeTags.DOffsets.size() * sizeof(uint32_t)},
+            {NodeTags.DTags.data(), NodeTags.DTags.size() * sizeof(STag)},
+            {Ways.DIDs.data(), Ways.DIDs.size() * sizeof(uint64_t)},
+            {NodeOffsets.data(), NodeOffsets.size() * sizeof(uint64_t)},
+            {NodeReferences.data(), NodeReferences.size() * sizeof(uint64_t)},
+            {WayTags.DOffsets.data(), WayTags.DOffsets.size() * sizeof(uint32_t)},
+            {WayTags.DTags.data(), WayTags.DTags.size() * sizeof(STag)},
+            {StringOffsets.data(), StringOffsets.size() * sizeof(uint64_t)},
+            {StringData.data(), StringData.size()},
+            {NodeIndexIDs.data(), NodeIndexIDs.size() * sizeof(uint64_t)},
+            {NodeIndexPositions.data(), NodeIndexPositions.size() * sizeof(uint32_t)},
+            {WayIndexIDs.data(), WayIndexIDs.size() * sizeof(uint64_t)},
+            {WayIndexPositions.data(), WayIndexPositions.size() * sizeof(uint32_t)}
+        };
+        static_assert(std::size(Sections) == static_cast<std::size_t>(ESection::Count));
+
+        //Every section starts on an 8 byte boundary
+        auto Align = [](uint64_t offset){ return (offset + 7) & ~uint64_t(7); };
+        uint64_t Offset = Align(sizeof(Header));
+        for(std::size_t Index = 0; Index < std::size(Sections); Index++){
+            Header.DSectionOffsets[Index] = Offset;
+            Offset = Align(Offset + Sections[Index].second);
+        }
+
+        //Stream through a bounded buffer so big maps are not copied whole
+        const std::size_t ChunkSize = 1 << 20;
+        std::vector<char> Buffer;
+        uint64_t Written = 0;
+        auto Emit = [&](const void *data, std::size_t size) -> bool{
+            auto Bytes = static_cast<const char *>(data);
+            while(size){
+                auto Count = std::min(size, ChunkSize - Buffer.size());
+                Buffer.insert(Buffer.end(), Bytes, Bytes + Count);
+                Bytes += Count;
+                size -= Count;
+                Written += Count;
+                if(Buffer.size() == ChunkSize){
+                    if(!sink->Write(Buffer)){
+                        return false;
+                    }
+                    Buffer.clear();
+                }
+            }
+            return true;
+        };
+        const char Padding[8] = {0};
+        if(!Emit(&Header, sizeof(Header))){
+            return false;
+        }
+        for(std::size_t Index = 0; Index < std::size(Sections); Index++){
+            if(!Emit(Padding, Header.DSectionOffsets[Index] - Written)||!Emit(Sections[Index].first, Sections[Index].second)){
+                return false;
+            }
+        }
+        if(!Emit(Padding, Offset - Written)){
+            return false;
+        }
+        return Buffer.empty() || sink->Write(Buffer);
+    }
+
+    SWayNodeIDRange WayNodeIDs(std::size_t index) const noexcept{
+        const auto &Ways = DData->DWays;
+        if(index >= Ways.Count()){
+            return SWayNodeIDRange();
+        }
+        if(Ways.DStorage == EWayNodeStorage::Plain){
+            return SWayNodeIDRange{CWayNodeIDIterator(Ways.DNodeReferences.data() + Ways.DNodeOffsets[index], Ways.NodeCount(index))};
+        }
+        return SWayNodeIDRange{CWayNodeIDIterator(Ways.DNodeIndices.data(), DData->DNodes.DIDs.data(), &Ways.DUnresolvedIDs, Ways.DNodeOffsets[index], Ways.NodeCount(index))};
+    }
+
+    std::size_t WayNodeIDs(std::size_t index, std::vector<TNodeID> &ids) const{
+        const auto &Ways = DData->DWays;
+        if(index >= Ways.Count()){
+            ids.clear();
+            return 0;
+        }
+        ids.resize(Ways.NodeCount(index));
+        Ways.DecodeNodeIDs(index, ids.data(), DData->DNodes.DIDs);
+        return ids.size();
+    }
+
+    std::span<const uint32_t> WayNodeIndices(std::size_t index) const noexcept{
+        const auto &Ways = DData->DWays;
+        if(index >= Ways.Count()){
+            return std::span<const uint32_t>();
+        }
+        return std::span<const uint32_t>(Ways.DNodeIndices.data() + Ways.DNodeOffsets[index], Ways.NodeCount(index));
+    }
+
+    std::size_t WayLocations(std::size_t index, std::vector<SLocation> &locations) const{
+        locations.clear();
+        const auto &Nodes = DData->DNodes;
+        for(auto NodeIndex : WayNodeIndices(index)){
+            if(NodeIndex != InvalidNodeIndex){
+                locations.push_back(Nodes.Location(NodeIndex));
+            }
+        }
+        return locations.size();
+    }
+
+    CRTree::SBox WayBounds(std::size_t index) const noexcept{
+        auto Box = CRTree::SBox::EmptyBox();
+        for(auto NodeIndex : WayNodeIndices(index)){
+            if(NodeIndex != InvalidNodeIndex){
+                auto Location = DData->DNodes.Location(NodeIndex);
+                Box.Expand(CRTree::SBox{Location.DLatitude, Location.DLongitude, Location.DLatitude, Location.DLongitude});
+            }
+        }
+        return Box;
+    }
+
+    //Uses the R-tree when it was built, otherwise checks every way
+    std::size_t WaysInBox(const CRTree::SBox &box, std::vector<uint32_t> &ways) const{
+        if(DOptions.DBuildWayRTree){
+            return DWayRTree.Query(box, ways);
+        }
+        ways.clear();
+        for(std::size_t Index = 0; Index < DData->DWays.Count(); Index++){
+            auto Bounds = WayBounds(Index);
+            if(!Bounds.Empty() && Bounds.Intersects(box)){
+                ways.push_back(Index);
+            }
+        }
+        return ways.size();
+    }
+
+    //Interned tag lookups, only Eager decoding interns tags
+    TStringID NodeAttributeID(std::size_t index, TStringID key) const noexcept{
+        if((DOptions.DTagDecoding == ETagDecoding::Eager)&&(index < DData->DNodes.Count())){
+            return DData->DNodes.DTags.Find(index, key);
+        }
+        return CStringPool::InvalidStringID;
+    }
+
+    TStringID WayAttributeID(std::size_t index, TStringID key) const noexcept{
+        if((DOptions.DTagDecoding == ETagDecoding::Eager)&&(index < DData->DWays.Count())){
+            return DData->DWays.DTags.Find(index, key);
+        }
+        return CStringPool::InvalidStringID;
+    }
+
 };
 
 //Public functions can be call outside
 //Functions just gets information
-COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> src){
-    DImplementation = std::make_unique<SImplementation>(src);
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> src) : COpenStreetMap(nullptr, src, SOptions()){
+
+}
+
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> src, const SOptions &options) : COpenStreetMap(nullptr, src, options){
+
+}
+
+//Two pass filtered loading, filtersrc and src must read the same data
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> filtersrc, std::shared_ptr<CXMLReader> src, const SOptions &options){
+    DImplementation = std::make_unique<SImplementation>(filtersrc, src, options);
+    //Built through the public interface so every tag decoding mode is indexed the same way
+    if(options.DBuildTagIndex){
+        DImplementation->DNodeTagIndex.Build(*this, CTagIndex::EObjectType::Nodes);
+        DImplementation->DWayTagIndex.Build(*this, CTagIndex::EObjectType::Ways);
+    }
 }
 
 COpenStreetMap::~COpenStreetMap(){
 
 }
 
+//Applies an osmChange document, returns false if changes does not hold one
+bool COpenStreetMap::ApplyChanges(std::shared_ptr<CXMLReader> changes){
+    std::size_t Skipped;
+    return ApplyChanges(changes, Skipped);
+}
+
+//Same as above, skipped is set to the number of elements left out because they did not parse
+bool COpenStreetMap::ApplyChanges(std::shared_ptr<CXMLReader> changes, std::size_t &skipped){
+    return DImplementation->ApplyChanges(changes, skipped);
+}
+
 std::size_t COpenStreetMap::NodeCount() const noexcept{
     return DImplementation->NodeCount();
 }
@@ -269,6 +2089,14 @@ std::size_t COpenStreetMap::WayCount() const noexcept{
     return DImplementation->WayCount();
 }
 
+std::size_t COpenStreetMap::SMemoryReport::Total() const noexcept{
+    return DNodes + DNodeTags + DNodeIndex + DWays + DWayReferences + DWayTags + DWayIndex + DStrings + DSearchIndexes + DAllocatorOverhead;
+}
+
+COpenStreetMap::SMemoryReport COpenStreetMap::MemoryUsage() const noexcept{
+    return DImplementation->MemoryUsage();
+}
+
 std::shared_ptr<CStreetMap::SNode> COpenStreetMap::NodeByIndex(std::size_t index) const noexcept{
     return DImplementation->NodeByIndex(index);
 }
@@ -285,3 +2113,179 @@ std::shared_ptr<CStreetMap::SWay> COpenStreetMap::WayByID(TWayID id) const noexc
     return DImplementation->WayByID(id);
 }
 
+void COpenStreetMap::ForEachNodeInRange(std::size_t begin, std::size_t end, const TNodeVisitor &visit) const{
+    DImplementation->ForEachNodeInRange(begin, end, visit);
+}
+
+void COpenStreetMap::ForEachWayInRange(std::size_t begin, std::size_t end, const TWayVisitor &visit) const{
+    DImplementation->ForEachWayInRange(begin, end, visit);
+}
+
+//Returns the pool ID of a tag key or value, or InvalidStringID if no tag uses it
+COpenStreetMap::TStringID COpenStreetMap::StringID(const std::string &str) const noexcept{
+    return DImplementation->DData->DStrings.Find(str);
+}
+
+//Returns the string for a pool ID, or an empty string if the ID is unknown
+std::string COpenStreetMap::StringByID(TStringID id) const noexcept{
+    return DImplementation->DData->DStrings.String(id);
+}
+
+//Returns the value ID of tag key on the node at index, or InvalidStringID (always when tags are decoded lazily)
+COpenStreetMap::TStringID COpenStreetMap::NodeAttributeID(std::size_t index, TStringID key) const noexcept{
+    return DImplementation->NodeAttributeID(index, key);
+}
+
+//Returns the value ID of tag key on the way at index, or InvalidStringID (always when tags are decoded lazily)
+COpenStreetMap::TStringID COpenStreetMap::WayAttributeID(std::size_t index, TStringID key) const noexcept{
+    return DImplementation->WayAttributeID(index, key);
+}
+
+COpenStreetMap::ECoordinateStorage COpenStreetMap::CoordinateStorage() const noexcept{
+    return DImplementation->DData->DNodes.DStorage;
+}
+
+COpenStreetMap::ETagDecoding COpenStreetMap::TagDecoding() const noexcept{
+    return DImplementation->DOptions.DTagDecoding;
+}
+
+COpenStreetMap::EWayNodeStorage COpenStreetMap::WayNodeStorage() const noexcept{
+    return DImplementation->DOptions.DWayNodeStorage;
+}
+
+//Node IDs of the way at index in order, empty if index is out of range
+COpenStreetMap::SWayNodeIDRange COpenStreetMap::WayNodeIDs(std::size_t index) const noexcept{
+    return DImplementation->WayNodeIDs(index);
+}
+
+//Decodes every node ID of the way at index into ids, returns how many were written
+std::size_t COpenStreetMap::WayNodeIDs(std::size_t index, std::vector<TNodeID> &ids) const{
+    return DImplementation->WayNodeIDs(index, ids);
+}
+
+//Node index of every ref of the way at index, InvalidNodeIndex where the node is not in the map
+std::span<const uint32_t> COpenStreetMap::WayNodeIndices(std::size_t index) const noexcept{
+    return DImplementation->WayNodeIndices(index);
+}
+
+//Fills locations with the coordinates of the way at index, refs to missing nodes are skipped
+std::size_t COpenStreetMap::WayLocations(std::size_t index, std::vector<SLocation> &locations) const{
+    return DImplementation->WayLocations(index, locations);
+}
+
+//Box around the resolved nodes of the way at index, empty if it has none or index is out of range
+CRTree::SBox COpenStreetMap::WayBounds(std::size_t index) const noexcept{
+    return DImplementation->WayBounds(index);
+}
+
+//R-tree over WayBounds of every way, empty unless SOptions::DBuildWayRTree was set
+const CRTree &COpenStreetMap::WayRTree() const noexcept{
+    return DImplementation->DWayRTree;
+}
+
+//Fills ways with the index of every way whose bounds intersect box in ascending order
+std::size_t COpenStreetMap::WaysInBox(const CRTree::SBox &box, std::vector<uint32_t> &ways) const{
+    return DImplementation->WaysInBox(box, ways);
+}
+
+//k-d tree over every node location, items are node indices, empty unless SOptions::DBuildNodeKDTree was set
+const CKDTree &COpenStreetMap::NodeKDTree() const noexcept{
+    return DImplementation->DNodeKDTree;
+}
+
+//Sets indices[i] to the index of node ids[i], or InvalidIndex, returns how many were found
+//Probes are prefetched a group at a time, which is much faster than one NodeByID per ID for long lists
+std::size_t COpenStreetMap::NodeIndicesByID(std::span<const TNodeID> ids, std::vector<std::size_t> &indices) const{
+    return DImplementation->DNodesByID.FindBatch(ids, indices);
+}
+
+//Sets indices[i] to the index of way ids[i], or InvalidIndex, returns how many were found
+std::size_t COpenStreetMap::WayIndicesByID(std::span<const TWayID> ids, std::vector<std::size_t> &indices) const{
+    return DImplementation->DWaysByID.FindBatch(ids, indices);
+}
+
+std::size_t COpenStreetMap::NodeLocationsByID(std::span<const TNodeID> ids, std::vector<SLocation> &locations) const{
+    return DImplementation->NodeLocationsByID(ids, locations);
+}
+
+//Tag index over every node, positions are node indices, empty unless SOptions::DBuildTagIndex was set
+const CTagIndex &COpenStreetMap::NodeTagIndex() const noexcept{
+    return DImplementation->DNodeTagIndex;
+}
+
+//Tag index over every way, positions are way indices, empty unless SOptions::DBuildTagIndex was set
+const CTagIndex &COpenStreetMap::WayTagIndex() const noexcept{
+    return DImplementation->DWayTagIndex;
+}
+
+COpenStreetMap::CWayNodeIDIterator::CWayNodeIDIterator(const TNodeID *plain, std::size_t count) noexcept : DPlain(plain), DRemaining(count){
+    Decode();
+}
+
+COpenStreetMap::CWayNodeIDIterator::CWayNodeIDIterator(const uint32_t *nodeindices, const TNodeID *nodeids, const std::unordered_map<std::size_t, TNodeID> *unresolvedids, std::size_t position, std::size_t count) noexcept : DNodeIndices(nodeindices), DNodeIDs(nodeids), DUnresolvedIDs(unresolvedids), DPosition(position), DRemaining(count){
+    Decode();
+}
+
+//Loads the ID at the current position, refs to missing nodes are the only ones looked up by position
+void COpenStreetMap::CWayNodeIDIterator::Decode() noexcept{
+    if(!DRemaining){
+        return;
+    }
+    if(DPlain){
+        DCurrent = *DPlain;
+        return;
+    }
+    auto NodeIndex = DNodeIndices[DPosition];
+    if(NodeIndex != InvalidNodeIndex){
+        DCurrent = DNodeIDs[NodeIndex];
+        return;
+    }
+    auto Search = DUnresolvedIDs->find(DPosition);
+    DCurrent = Search == DUnresolvedIDs->end() ? CStreetMap::InvalidNodeID : Search->second;
+}
+
+COpenStreetMap::CWayNodeIDIterator &COpenStreetMap::CWayNodeIDIterator::operator++() noexcept{
+    if(!DRemaining){
+        return *this;
+    }
+    DRemaining--;
+    if(DPlain){
+        DPlain++;
+    }
+    DPosition++;
+    Decode();
+    return *this;
+}
+
+//Latitude of every node in index order, empty unless storage is Double
+std::span<const double> COpenStreetMap::NodeLatitudes() const noexcept{
+    return DImplementation->DData->DNodes.DLatitudes;
+}
+
+//Longitude of every node in index order, empty unless storage is Double
+std::span<const double> COpenStreetMap::NodeLongitudes() const noexcept{
+    return DImplementation->DData->DNodes.DLongitudes;
+}
+
+//Raw 1e-7 degree latitude of every node in index order, empty unless storage is FixedPoint
+std::span<const int32_t> COpenStreetMap::NodeFixedPointLatitudes() const noexcept{
+    return DImplementation->DData->DNodes.DFixedLatitudes;
+}
+
+//Raw 1e-7 degree longitude of every node in index order, empty unless storage is FixedPoint
+std::span<const int32_t> COpenStreetMap::NodeFixedPointLongitudes() const noexcept{
+    return DImplementation->DData->DNodes.DFixedLongitudes;
+}
+
+int32_t COpenStreetMap::ToFixedPoint(double degrees) noexcept{
+    return static_cast<int32_t>(std::lround(degrees * FixedPointScale));
+}
+
+double COpenStreetMap::FromFixedPoint(int32_t fixedpoint) noexcept{
+    return fixedpoint / FixedPointScale;
+}
+
+//Serializes the map into a snapshot that CMappedStreetMap can open
+bool COpenStreetMap::WriteSnapshot(std::shared_ptr<CDataSink> sink) const{
+    return DImplementation->WriteSnapshot(sink);
+}
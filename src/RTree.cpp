@@ -0,0 +1,362 @@
+#include "RTree.h"
+#include "BinaryColumnIO.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+void CRTree::SBox::Expand(const SBox &box) noexcept{
+    DMinLatitude = std::min(DMinLatitude, box.DMinLatitude);
+    DMinLongitude = std::min(DMinLongitude, box.DMinLongitude);
+    DMaxLatitude = std::max(DMaxLatitude, box.DMaxLatitude);
+    DMaxLongitude = std::max(DMaxLongitude, box.DMaxLongitude);
+}
+
+CRTree::SBox CRTree::SBox::EmptyBox() noexcept{
+    const double Infinity = std::numeric_limits<double>::infinity();
+    return SBox{Infinity, Infinity, -Infinity, -Infinity};
+}
+
+struct CRTree::SImplementation{
+    //Every level stored one after another, level 0 holds the item boxes
+    //Entry i of level L+1 covers entries i * NodeCapacity to (i + 1) * NodeCapacity of level L
+    std::vector<SBox> DBoxes;
+    std::vector<uint64_t> DLevelOffsets;
+    //Caller index of each level 0 entry
+    std::vector<uint32_t> DItems;
+    std::size_t DThreadCount = 0;
+
+    //Updates since the last build
+    //Items added since are kept in DExtraBoxes/DExtraItems and scanned by every query
+    //Level 0 entries of removed items are left with an empty box, which nothing intersects
+    //DPositions[item] is the level 0 entry of item, or DItems.size() + its extra entry, built by the first update
+    inline static constexpr uint32_t NoPosition = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> DPositions;
+    std::vector<SBox> DExtraBoxes;
+    std::vector<uint32_t> DExtraItems;
+    std::size_t DRemovedCount = 0;
+    std::size_t DUpdateCount = 0;
+
+    std::size_t LevelCount() const noexcept{
+        return DLevelOffsets.empty() ? 0 : DLevelOffsets.size() - 1;
+    }
+
+    std::size_t LevelSize(std::size_t level) const noexcept{
+        return DLevelOffsets[level + 1] - DLevelOffsets[level];
+    }
+
+    std::size_t Count() const noexcept{
+        return DItems.size() - DRemovedCount + DExtraItems.size();
+    }
+
+    void ClearUpdates(){
+        DPositions = std::vector<uint32_t>();
+        DExtraBoxes.clear();
+        DExtraItems.clear();
+        DRemovedCount = 0;
+        DUpdateCount = 0;
+    }
+
+    void Build(const std::vector<SBox> &boxes, std::size_t threadcount){
+        DBoxes.clear();
+        DLevelOffsets.clear();
+        DItems.clear();
+        ClearUpdates();
+        DThreadCount = threadcount;
+
+        std::vector<uint32_t> Order;
+        for(std::size_t Index = 0; Index < boxes.size(); Index++){
+            if(!boxes[Index].Empty()){
+                Order.push_back(Index);
+            }
+        }
+        if(Order.empty()){
+            return;
+        }
+        auto CenterLongitude = [&](uint32_t index){ return boxes[index].DMinLongitude + boxes[index].DMaxLongitude; };
+        auto CenterLatitude = [&](uint32_t index){ return boxes[index].DMinLatitude + boxes[index].DMaxLatitude; };
+
+        //Sort-Tile-Recursive: vertical slices by longitude, each slice sorted by latitude and cut into leaves
+        std::sort(Order.begin(), Order.end(), [&](uint32_t left, uint32_t right){
+            return CenterLongitude(left) < CenterLongitude(right);
+        });
+        auto LeafCount = (Order.size() + NodeCapacity - 1) / NodeCapacity;
+        auto SliceCount = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(LeafCount))));
+        auto SliceSize = ((LeafCount + SliceCount - 1) / SliceCount) * NodeCapacity;
+        auto Slices = (Order.size() + SliceSize - 1) / SliceSize;
+        ParallelFor(Slices, threadcount, [&](std::size_t begin, std::size_t end){
+            for(auto Slice = begin; Slice < end; Slice++){
+                auto First = Order.begin() + Slice * SliceSize;
+                auto Last = Order.begin() + std::min(Order.size(), (Slice + 1) * SliceSize);
+                std::sort(First, Last, [&](uint32_t left, uint32_t right){
+                    return CenterLatitude(left) < CenterLatitude(right);
+                });
+            }
+        });
+
+        //Total entries over every level, so DBoxes never reallocates while threads fill it
+        std::vector<std::size_t> LevelSizes{Order.size()};
+        while(LevelSizes.back() > 1){
+            LevelSizes.push_back((LevelSizes.back() + NodeCapacity - 1) / NodeCapacity);
+        }
+        DLevelOffsets.push_back(0);
+        for(auto Size : LevelSizes){
+            DLevelOffsets.push_back(DLevelOffsets.back() + Size);
+        }
+        DBoxes.resize(DLevelOffsets.back());
+        DItems = std::move(Order);
+        ParallelFor(DItems.size(), threadcount, [&](std::size_t begin, std::size_t end){
+            for(auto Index = begin; Index < end; Index++){
+                DBoxes[Index] = boxes[DItems[Index]];
+            }
+        });
+        for(std::size_t Level = 1; Level < LevelSizes.size(); Level++){
+            auto Children = DBoxes.data() + DLevelOffsets[Level - 1];
+            auto ChildCount = LevelSizes[Level - 1];
+            auto Parents = DBoxes.data() + DLevelOffsets[Level];
+            ParallelFor(LevelSizes[Level], threadcount, [&](std::size_t begin, std::size_t end){
+                for(auto Parent = begin; Parent < end; Parent++){
+                    auto Box = SBox::EmptyBox();
+                    for(auto Child = Parent * NodeCapacity; Child < std::min(ChildCount, (Parent + 1) * NodeCapacity); Child++){
+                        Box.Expand(Children[Child]);
+                    }
+                    Parents[Parent] = Box;
+                }
+            });
+        }
+    }
+
+    //Current box of every item, empty for items not in the tree
+    std::vector<SBox> LiveBoxes() const{
+        std::vector<SBox> Boxes;
+        auto Store = [&](uint32_t item, const SBox &box){
+            if(Boxes.size() <= item){
+                Boxes.resize(item + 1, SBox::EmptyBox());
+            }
+            Boxes[item] = box;
+        };
+        for(std::size_t Entry = 0; Entry < DItems.size(); Entry++){
+            if(!DBoxes[Entry].Empty()){
+                Store(DItems[Entry], DBoxes[Entry]);
+            }
+        }
+        for(std::size_t Extra = 0; Extra < DExtraItems.size(); Extra++){
+            Store(DExtraItems[Extra], DExtraBoxes[Extra]);
+        }
+        return Boxes;
+    }
+
+    void Update(uint32_t item, const SBox &box){
+        auto Packed = DItems.size();
+        if(DPositions.empty()){
+            for(std::size_t Entry = 0; Entry < Packed; Entry++){
+                if(DPositions.size() <= DItems[Entry]){
+                    DPositions.resize(DItems[Entry] + 1, NoPosition);
+                }
+                DPositions[DItems[Entry]] = Entry;
+            }
+        }
+        if(DPositions.size() <= item){
+            DPositions.resize(item + 1, NoPosition);
+        }
+        auto Position = DPositions[item];
+        if(Position < Packed){
+            if(box.Empty()){
+                DPositions[item] = NoPosition;
+                DRemovedCount++;
+            }
+            //Ancestors only grow, so they keep covering the entry wherever it moves
+            DBoxes[Position] = box.Empty() ? SBox::EmptyBox() : box;
+            for(std::size_t Level = 1, Entry = Position; !box.Empty() && (Level < LevelCount()); Level++){
+                Entry /= NodeCapacity;
+                DBoxes[DLevelOffsets[Level] + Entry].Expand(box);
+            }
+        }
+        else if(Position != NoPosition){
+            auto Extra = Position - Packed;
+            if(box.Empty()){
+                DPositions[DExtraItems.back()] = Position;
+                DExtraBoxes[Extra] = DExtraBoxes.back();
+                DExtraItems[Extra] = DExtraItems.back();
+                DExtraBoxes.pop_back();
+                DExtraItems.pop_back();
+                DPositions[item] = NoPosition;
+            }
+            else{
+                DExtraBoxes[Extra] = box;
+            }
+        }
+        else if(!box.Empty()){
+            DPositions[item] = Packed + DExtraItems.size();
+            DExtraBoxes.push_back(box);
+            DExtraItems.push_back(item);
+        }
+        if(++DUpdateCount > std::max(MinimumRebuildUpdates, Count() / 16)){
+            Build(LiveBoxes(), DThreadCount);
+        }
+    }
+
+    std::size_t Query(const SBox &box, std::vector<uint32_t> &items) const{
+        items.clear();
+        for(std::size_t Extra = 0; Extra < DExtraItems.size(); Extra++){
+            if(DExtraBoxes[Extra].Intersects(box)){
+                items.push_back(DExtraItems[Extra]);
+            }
+        }
+        if(DItems.empty()){
+            std::sort(items.begin(), items.end());
+            return items.size();
+        }
+        //(level, entry) pairs still to visit, starting from the root
+        std::vector<std::pair<std::size_t, std::size_t>> Stack{{LevelCount() - 1, 0}};
+        while(!Stack.empty()){
+            auto [Level, Entry] = Stack.back();
+            Stack.pop_back();
+            if(!DBoxes[DLevelOffsets[Level] + Entry].Intersects(box)){
+                continue;
+            }
+            if(Level == 0){
+                items.push_back(DItems[Entry]);
+                continue;
+            }
+            auto End = std::min(LevelSize(Level - 1), (Entry + 1) * NodeCapacity);
+            for(auto Child = Entry * NodeCapacity; Child < End; Child++){
+                Stack.push_back({Level - 1, Child});
+            }
+        }
+        std::sort(items.begin(), items.end());
+        return items.size();
+    }
+
+    //Layout: magic, version, node capacity, level count, level offsets, boxes, items
+    //An updated tree is written as a fresh build of its current items
+    bool Save(std::shared_ptr<CDataSink> sink) const{
+        if(DUpdateCount){
+            SImplementation Packed;
+            Packed.Build(LiveBoxes(), DThreadCount);
+            return Packed.Save(sink);
+        }
+        std::vector<char> Buffer(SerializedMagic, SerializedMagic + sizeof(SerializedMagic));
+        uint32_t Version = SerializedVersion;
+        uint32_t Capacity = NodeCapacity;
+        uint64_t Levels = LevelCount();
+        AppendValue(Buffer, Version);
+        AppendValue(Buffer, Capacity);
+        AppendValue(Buffer, Levels);
+        AppendColumn(Buffer, DLevelOffsets);
+        AppendColumn(Buffer, DBoxes);
+        AppendColumn(Buffer, DItems);
+        return sink->Write(Buffer);
+    }
+
+    bool Load(std::shared_ptr<CDataSource> source){
+        char Magic[sizeof(SerializedMagic)];
+        uint32_t Version, Capacity;
+        uint64_t Levels;
+        if(!ReadExact(source, Magic, sizeof(Magic))||std::memcmp(Magic, SerializedMagic, sizeof(Magic))){
+            return false;
+        }
+        if(!ReadExact(source, &Version, sizeof(Version))||(Version != SerializedVersion)){
+            return false;
+        }
+        if(!ReadExact(source, &Capacity, sizeof(Capacity))||(Capacity != NodeCapacity)){
+            return false;
+        }
+        if(!ReadExact(source, &Levels, sizeof(Levels))||(Levels > 64)){
+            return false;
+        }
+        std::vector<uint64_t> LevelOffsets(Levels ? Levels + 1 : 0);
+        if(!ReadExact(source, LevelOffsets.data(), LevelOffsets.size() * sizeof(uint64_t))){
+            return false;
+        }
+        //Each level must be the packed parent level of the one below and end with a single root
+        for(std::size_t Level = 0; Level < Levels; Level++){
+            auto Size = LevelOffsets[Level + 1] - LevelOffsets[Level];
+            if((LevelOffsets[Level + 1] <= LevelOffsets[Level])||(Level && (Size != (LevelOffsets[Level] - LevelOffsets[Level - 1] + NodeCapacity - 1) / NodeCapacity))){
+                return false;
+            }
+        }
+        if(Levels && ((LevelOffsets[0] != 0)||(LevelOffsets[Levels] - LevelOffsets[Levels - 1] != 1))){
+            return false;
+        }
+        std::vector<SBox> Boxes;
+        std::vector<uint32_t> Items;
+        if(!ReadColumn(source, Boxes, Levels ? LevelOffsets.back() : 0)||!ReadColumn(source, Items, Levels ? LevelOffsets[1] : 0)){
+            return false;
+        }
+        DLevelOffsets = std::move(LevelOffsets);
+        DBoxes = std::move(Boxes);
+        DItems = std::move(Items);
+        ClearUpdates();
+        return true;
+    }
+};
+
+CRTree::CRTree() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CRTree::CRTree(CRTree &&tree) noexcept : DImplementation(std::move(tree.DImplementation)){
+    tree.DImplementation = std::make_unique<SImplementation>();
+}
+
+CRTree &CRTree::operator=(CRTree &&tree) noexcept{
+    std::swap(DImplementation, tree.DImplementation);
+    return *this;
+}
+
+CRTree::~CRTree(){
+
+}
+
+//Bulk loads the tree, boxes[i] is reported as item i and empty boxes are left out
+void CRTree::Build(const std::vector<SBox> &boxes, std::size_t threadcount){
+    DImplementation->Build(boxes, threadcount);
+}
+
+//Replaces the box of item, adding item if it is not in the tree, an empty box removes it
+//The tree is rebuilt once the updates since the last build pass MinimumRebuildUpdates or a sixteenth of the items
+void CRTree::Update(uint32_t item, const SBox &box){
+    DImplementation->Update(item, box);
+}
+
+//Number of items in the tree
+std::size_t CRTree::Count() const noexcept{
+    return DImplementation->Count();
+}
+
+SMemoryUsage CRTree::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    Usage.Add(DImplementation->DBoxes);
+    Usage.Add(DImplementation->DLevelOffsets);
+    Usage.Add(DImplementation->DItems);
+    Usage.Add(DImplementation->DPositions);
+    Usage.Add(DImplementation->DExtraBoxes);
+    Usage.Add(DImplementation->DExtraItems);
+    return Usage;
+}
+
+//Box covering every item, EmptyBox() if the tree is empty
+//After updates it may still cover removed items until the next rebuild
+CRTree::SBox CRTree::Bounds() const noexcept{
+    auto Box = DImplementation->DBoxes.empty() ? SBox::EmptyBox() : DImplementation->DBoxes.back();
+    for(const auto &Extra : DImplementation->DExtraBoxes){
+        Box.Expand(Extra);
+    }
+    return Box;
+}
+
+//Fills items with every item whose box intersects box in ascending order, returns how many were found
+std::size_t CRTree::Query(const SBox &box, std::vector<uint32_t> &items) const{
+    return DImplementation->Query(box, items);
+}
+
+bool CRTree::Save(std::shared_ptr<CDataSink> sink) const{
+    return DImplementation->Save(sink);
+}
+
+//Replaces the tree with one written by Save, the tree is unchanged if the data is not valid
+bool CRTree::Load(std::shared_ptr<CDataSource> source){
+    return DImplementation->Load(source);
+}
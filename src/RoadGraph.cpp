@@ -0,0 +1,610 @@
+#include "RoadGraph.h"
+#include "GeographicUtils.h"
+#include "IDIndex.h"
+#include "BinaryColumnIO.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+
+struct CRoadGraph::SImplementation{
+    const std::string DOnewayKey = "oneway";
+    const std::string DJunctionKey = "junction";
+    const std::string DHighwayKey = "highway";
+
+    //Vertex columns, vertices are numbered in map node order
+    std::vector<CStreetMap::TNodeID> DNodeIDs;
+    std::vector<double> DLatitudes;
+    std::vector<double> DLongitudes;
+    //Edge columns, the edges leaving vertex v are DOffsets[v] to DOffsets[v+1]
+    std::vector<uint32_t> DOffsets{0};
+    std::vector<TVertex> DTargets;
+    std::vector<double> DLengths;
+    std::vector<uint32_t> DWays;
+    //Contracted graphs only: the nodes edge e passes between its ends are DShapeOffsets[e] to DShapeOffsets[e+1]
+    std::vector<uint32_t> DShapeOffsets;
+    std::vector<CStreetMap::TNodeID> DShapeNodeIDs;
+    std::vector<double> DShapeLatitudes;
+    std::vector<double> DShapeLongitudes;
+    CIDIndex DVertexIndex{CIDIndex::EType::Sorted};
+
+    //Edge between two map node indices, before vertices are numbered
+    struct SRawEdge{
+        uint32_t DSource;
+        uint32_t DTarget;
+        double DLength;
+        uint32_t DWay;
+    };
+
+    //1 for travel in node order only, -1 for against it only, 0 for both ways
+    int Direction(const CStreetMap::SWay &way) const{
+        auto Oneway = way.GetAttribute(DOnewayKey);
+        if((Oneway == "yes")||(Oneway == "true")||(Oneway == "1")){
+            return 1;
+        }
+        if((Oneway == "-1")||(Oneway == "reverse")){
+            return -1;
+        }
+        if(!Oneway.empty()){
+            return 0;
+        }
+        //Roundabouts and motorways are oneway unless tagged otherwise
+        if((way.GetAttribute(DJunctionKey) == "roundabout")||(way.GetAttribute(DHighwayKey) == "motorway")){
+            return 1;
+        }
+        return 0;
+    }
+
+    void Build(const COpenStreetMap &map, const SOptions &options){
+        auto Fixed = map.CoordinateStorage() == COpenStreetMap::ECoordinateStorage::FixedPoint;
+        auto NodeLocation = [&](std::size_t index){
+            if(Fixed){
+                return CStreetMap::SLocation{COpenStreetMap::FromFixedPoint(map.NodeFixedPointLatitudes()[index]), COpenStreetMap::FromFixedPoint(map.NodeFixedPointLongitudes()[index])};
+            }
+            return CStreetMap::SLocation{map.NodeLatitudes()[index], map.NodeLongitudes()[index]};
+        };
+
+        //Ways are turned into edges in parallel chunks, which keep way order when joined
+        auto Threads = ResolveThreadCount(options.DThreadCount);
+        auto ChunkSize = (map.WayCount() + Threads - 1) / Threads;
+        std::vector<std::vector<SRawEdge>> ChunkEdges(Threads);
+        ParallelFor(Threads, Threads, [&](std::size_t begin, std::size_t end){
+            for(auto Chunk = begin; Chunk < end; Chunk++){
+                auto &Edges = ChunkEdges[Chunk];
+                auto First = std::min(map.WayCount(), Chunk * ChunkSize);
+                map.ForEachWayInRange(First, std::min(map.WayCount(), First + ChunkSize), [&](std::size_t index, const CStreetMap::SWay &way){
+                    if(!options.DRequiredKey.empty() && !way.HasAttribute(options.DRequiredKey)){
+                        return;
+                    }
+                    auto WayDirection = options.DRespectOneway ? Direction(way) : 0;
+                    auto Previous = COpenStreetMap::InvalidNodeIndex;
+                    //Refs to nodes missing from the map are skipped, joining their neighbours
+                    for(auto Node : map.WayNodeIndices(index)){
+                        if(Node == COpenStreetMap::InvalidNodeIndex){
+                            continue;
+                        }
+                        if((Previous != COpenStreetMap::InvalidNodeIndex)&&(Previous != Node)){
+                            auto Length = SGeographicUtils::HaversineDistanceInMeters(NodeLocation(Previous), NodeLocation(Node));
+                            if(WayDirection >= 0){
+                                Edges.push_back({Previous, Node, Length, static_cast<uint32_t>(index)});
+                            }
+                            if(WayDirection <= 0){
+                                Edges.push_back({Node, Previous, Length, static_cast<uint32_t>(index)});
+                            }
+                        }
+                        Previous = Node;
+                    }
+                });
+            }
+        });
+
+        //Every node an edge touches becomes a vertex
+        std::vector<TVertex> VertexOfNode(map.NodeCount(), InvalidVertex);
+        for(const auto &Edges : ChunkEdges){
+            for(const auto &Edge : Edges){
+                VertexOfNode[Edge.DSource] = VertexOfNode[Edge.DTarget] = 0;
+            }
+        }
+        DNodeIDs.clear();
+        DLatitudes.clear();
+        DLongitudes.clear();
+        map.ForEachNode([&](std::size_t index, const CStreetMap::SNode &node){
+            if(VertexOfNode[index] != InvalidVertex){
+                VertexOfNode[index] = static_cast<TVertex>(DNodeIDs.size());
+                auto Location = NodeLocation(index);
+                DNodeIDs.push_back(node.ID());
+                DLatitudes.push_back(Location.DLatitude);
+                DLongitudes.push_back(Location.DLongitude);
+            }
+        });
+
+        //Counting sort by source keeps each vertex's edges in way order
+        DOffsets.assign(DNodeIDs.size() + 1, 0);
+        std::size_t EdgeCount = 0;
+        for(const auto &Edges : ChunkEdges){
+            for(const auto &Edge : Edges){
+                DOffsets[VertexOfNode[Edge.DSource] + 1]++;
+            }
+            EdgeCount += Edges.size();
+        }
+        for(std::size_t Vertex = 0; Vertex < DNodeIDs.size(); Vertex++){
+            DOffsets[Vertex + 1] += DOffsets[Vertex];
+        }
+        DTargets.resize(EdgeCount);
+        DLengths.resize(EdgeCount);
+        DWays.resize(EdgeCount);
+        std::vector<uint32_t> Next(DOffsets.begin(), DOffsets.end() - 1);
+        ClearShapes();
+        for(auto &Edges : ChunkEdges){
+            for(const auto &Edge : Edges){
+                auto Position = Next[VertexOfNode[Edge.DSource]]++;
+                DTargets[Position] = VertexOfNode[Edge.DTarget];
+                DLengths[Position] = Edge.DLength;
+                DWays[Position] = Edge.DWay;
+            }
+            std::vector<SRawEdge>().swap(Edges);
+        }
+        DVertexIndex.Build(DNodeIDs);
+    }
+
+    void ClearShapes(){
+        DShapeOffsets.clear();
+        DShapeNodeIDs.clear();
+        DShapeLatitudes.clear();
+        DShapeLongitudes.clear();
+    }
+
+    std::size_t ShapeBegin(std::size_t edge) const noexcept{
+        return DShapeOffsets.empty() ? 0 : DShapeOffsets[edge];
+    }
+
+    std::size_t ShapeEnd(std::size_t edge) const noexcept{
+        return DShapeOffsets.empty() ? 0 : DShapeOffsets[edge + 1];
+    }
+
+    //A vertex only passed through by one way, with exactly two neighbours a and b and either edges both ways
+    //to both or a single a->v->b, is the inside of a chain and is put in through
+    bool ChainVertex(TVertex vertex, const std::vector<uint32_t> &inoffsets, const std::vector<TVertex> &insources, const std::vector<uint32_t> &inways, TVertex *through) const noexcept{
+        auto OutBegin = DOffsets[vertex], OutCount = DOffsets[vertex + 1] - OutBegin;
+        auto InBegin = inoffsets[vertex], InCount = inoffsets[vertex + 1] - InBegin;
+        if((OutCount != InCount)||((OutCount != 1)&&(OutCount != 2))){
+            return false;
+        }
+        auto Way = DWays[OutBegin];
+        for(uint32_t Index = 0; Index < OutCount; Index++){
+            if((DWays[OutBegin + Index] != Way)||(inways[InBegin + Index] != Way)||(DTargets[OutBegin + Index] == vertex)){
+                return false;
+            }
+        }
+        if(OutCount == 1){
+            through[0] = insources[InBegin];
+            through[1] = DTargets[OutBegin];
+            return through[0] != through[1];
+        }
+        through[0] = DTargets[OutBegin];
+        through[1] = DTargets[OutBegin + 1];
+        auto Source0 = insources[InBegin], Source1 = insources[InBegin + 1];
+        return (through[0] != through[1])&&(((Source0 == through[0])&&(Source1 == through[1]))||((Source0 == through[1])&&(Source1 == through[0])));
+    }
+
+    //Edges of one chunk of kept vertices in a contracted graph
+    struct SContractedChunk{
+        std::vector<uint32_t> DDegrees;
+        std::vector<TVertex> DTargets;
+        std::vector<double> DLengths;
+        std::vector<uint32_t> DWays;
+        std::vector<uint32_t> DShapeCounts;
+        std::vector<CStreetMap::TNodeID> DShapeNodeIDs;
+        std::vector<double> DShapeLatitudes;
+        std::vector<double> DShapeLongitudes;
+    };
+
+    //Builds graph with every chain between kept vertices collapsed into one edge that remembers the nodes it passes
+    //Vertices of the nodes in keep are never folded into an edge
+    void BuildContracted(const SImplementation &graph, std::span<const CStreetMap::TNodeID> keep, std::size_t threadcount){
+        auto VertexCount = graph.DNodeIDs.size();
+        auto EdgeCount = graph.DTargets.size();
+        //Sources and ways of the edges entering each vertex
+        std::vector<uint32_t> InOffsets(VertexCount + 1, 0);
+        for(auto Target : graph.DTargets){
+            InOffsets[Target + 1]++;
+        }
+        for(std::size_t Vertex = 0; Vertex < VertexCount; Vertex++){
+            InOffsets[Vertex + 1] += InOffsets[Vertex];
+        }
+        std::vector<TVertex> InSources(EdgeCount);
+        std::vector<uint32_t> InWays(EdgeCount);
+        std::vector<uint32_t> Next(InOffsets.begin(), InOffsets.end() - 1);
+        for(TVertex Vertex = 0; Vertex < VertexCount; Vertex++){
+            for(auto Edge = graph.DOffsets[Vertex]; Edge < graph.DOffsets[Vertex + 1]; Edge++){
+                auto Position = Next[graph.DTargets[Edge]]++;
+                InSources[Position] = Vertex;
+                InWays[Position] = graph.DWays[Edge];
+            }
+        }
+
+        std::vector<uint8_t> Required(VertexCount, 0);
+        for(auto ID : keep){
+            auto Vertex = graph.DVertexIndex.Find(ID);
+            if(Vertex < VertexCount){
+                Required[Vertex] = 1;
+            }
+        }
+        std::vector<uint8_t> Kept(VertexCount, 1);
+        std::vector<TVertex> Through(VertexCount * 2, InvalidVertex);
+        ParallelFor(VertexCount, threadcount, [&](std::size_t begin, std::size_t end){
+            for(auto Vertex = begin; Vertex < end; Vertex++){
+                Kept[Vertex] = Required[Vertex] || !graph.ChainVertex(Vertex, InOffsets, InSources, InWays, &Through[Vertex * 2]);
+            }
+        });
+        //A loop made only of chain vertices keeps its first vertex so it can still be reached
+        std::vector<uint8_t> Seen(VertexCount, 0);
+        auto Walk = [&](TVertex start, TVertex next){
+            auto Previous = start;
+            while(!Kept[next] && (next != start)){
+                Seen[next] = 1;
+                auto Following = Through[next * 2] == Previous ? Through[next * 2 + 1] : Through[next * 2];
+                Previous = next;
+                next = Following;
+            }
+            return next == start;
+        };
+        for(TVertex Vertex = 0; Vertex < VertexCount; Vertex++){
+            if(!Kept[Vertex] && !Seen[Vertex]){
+                Seen[Vertex] = 1;
+                if(Walk(Vertex, Through[Vertex * 2])){
+                    Kept[Vertex] = 1;
+                }
+                else{
+                    Walk(Vertex, Through[Vertex * 2 + 1]);
+                }
+            }
+        }
+
+        //Kept vertices are walked out along each of their edges in parallel chunks, joined in vertex order
+        auto Threads = ResolveThreadCount(threadcount);
+        auto ChunkSize = (VertexCount + Threads - 1) / Threads;
+        std::vector<SContractedChunk> Chunks(Threads);
+        ParallelFor(Threads, Threads, [&](std::size_t begin, std::size_t end){
+            for(auto ChunkIndex = begin; ChunkIndex < end; ChunkIndex++){
+                auto &Chunk = Chunks[ChunkIndex];
+                auto AppendShape = [&](std::size_t edge){
+                    for(auto Shape = graph.ShapeBegin(edge); Shape < graph.ShapeEnd(edge); Shape++){
+                        Chunk.DShapeNodeIDs.push_back(graph.DShapeNodeIDs[Shape]);
+                        Chunk.DShapeLatitudes.push_back(graph.DShapeLatitudes[Shape]);
+                        Chunk.DShapeLongitudes.push_back(graph.DShapeLongitudes[Shape]);
+                    }
+                };
+                auto First = std::min(VertexCount, ChunkIndex * ChunkSize);
+                for(auto Vertex = First; Vertex < std::min(VertexCount, First + ChunkSize); Vertex++){
+                    if(!Kept[Vertex]){
+                        continue;
+                    }
+                    Chunk.DDegrees.push_back(graph.DOffsets[Vertex + 1] - graph.DOffsets[Vertex]);
+                    for(auto Edge = graph.DOffsets[Vertex]; Edge < graph.DOffsets[Vertex + 1]; Edge++){
+                        auto ShapeStart = Chunk.DShapeNodeIDs.size();
+                        auto Length = graph.DLengths[Edge];
+                        AppendShape(Edge);
+                        TVertex Previous = Vertex;
+                        auto Current = graph.DTargets[Edge];
+                        while(!Kept[Current]){
+                            Chunk.DShapeNodeIDs.push_back(graph.DNodeIDs[Current]);
+                            Chunk.DShapeLatitudes.push_back(graph.DLatitudes[Current]);
+                            Chunk.DShapeLongitudes.push_back(graph.DLongitudes[Current]);
+                            //Leave by the edge that does not lead back
+                            auto Out = graph.DOffsets[Current];
+                            if(graph.DTargets[Out] == Previous){
+                                Out++;
+                            }
+                            Length += graph.DLengths[Out];
+                            AppendShape(Out);
+                            Previous = Current;
+                            Current = graph.DTargets[Out];
+                        }
+                        Chunk.DTargets.push_back(Current);
+                        Chunk.DLengths.push_back(Length);
+                        Chunk.DWays.push_back(graph.DWays[Edge]);
+                        Chunk.DShapeCounts.push_back(Chunk.DShapeNodeIDs.size() - ShapeStart);
+                    }
+                }
+            }
+        });
+
+        std::vector<TVertex> NewVertex(VertexCount, InvalidVertex);
+        DNodeIDs.clear();
+        DLatitudes.clear();
+        DLongitudes.clear();
+        for(TVertex Vertex = 0; Vertex < VertexCount; Vertex++){
+            if(Kept[Vertex]){
+                NewVertex[Vertex] = static_cast<TVertex>(DNodeIDs.size());
+                DNodeIDs.push_back(graph.DNodeIDs[Vertex]);
+                DLatitudes.push_back(graph.DLatitudes[Vertex]);
+                DLongitudes.push_back(graph.DLongitudes[Vertex]);
+            }
+        }
+        DOffsets.assign(1, 0);
+        DTargets.clear();
+        DLengths.clear();
+        DWays.clear();
+        ClearShapes();
+        DShapeOffsets.push_back(0);
+        for(auto &Chunk : Chunks){
+            for(auto Degree : Chunk.DDegrees){
+                DOffsets.push_back(DOffsets.back() + Degree);
+            }
+            for(auto Target : Chunk.DTargets){
+                DTargets.push_back(NewVertex[Target]);
+            }
+            DLengths.insert(DLengths.end(), Chunk.DLengths.begin(), Chunk.DLengths.end());
+            DWays.insert(DWays.end(), Chunk.DWays.begin(), Chunk.DWays.end());
+            for(auto Count : Chunk.DShapeCounts){
+                DShapeOffsets.push_back(DShapeOffsets.back() + Count);
+            }
+            DShapeNodeIDs.insert(DShapeNodeIDs.end(), Chunk.DShapeNodeIDs.begin(), Chunk.DShapeNodeIDs.end());
+            DShapeLatitudes.insert(DShapeLatitudes.end(), Chunk.DShapeLatitudes.begin(), Chunk.DShapeLatitudes.end());
+            DShapeLongitudes.insert(DShapeLongitudes.end(), Chunk.DShapeLongitudes.begin(), Chunk.DShapeLongitudes.end());
+            Chunk = SContractedChunk();
+        }
+        DVertexIndex.Build(DNodeIDs);
+    }
+
+    bool Save(std::shared_ptr<CDataSink> sink) const{
+        std::vector<char> Buffer(SerializedMagic, SerializedMagic + sizeof(SerializedMagic));
+        uint32_t Version = SerializedVersion;
+        uint64_t Counts[4] = {DNodeIDs.size(), DTargets.size(), DShapeOffsets.size(), DShapeNodeIDs.size()};
+        AppendValue(Buffer, Version);
+        AppendBytes(Buffer, Counts, sizeof(Counts));
+        AppendColumn(Buffer, DNodeIDs);
+        AppendColumn(Buffer, DLatitudes);
+        AppendColumn(Buffer, DLongitudes);
+        AppendColumn(Buffer, DOffsets);
+        AppendColumn(Buffer, DTargets);
+        AppendColumn(Buffer, DLengths);
+        AppendColumn(Buffer, DWays);
+        AppendColumn(Buffer, DShapeOffsets);
+        AppendColumn(Buffer, DShapeNodeIDs);
+        AppendColumn(Buffer, DShapeLatitudes);
+        AppendColumn(Buffer, DShapeLongitudes);
+        return sink->Write(Buffer);
+    }
+
+    bool Load(std::shared_ptr<CDataSource> source){
+        char Magic[sizeof(SerializedMagic)];
+        uint32_t Version;
+        uint64_t Counts[4];
+        if(!ReadExact(source, Magic, sizeof(Magic))||std::memcmp(Magic, SerializedMagic, sizeof(Magic))){
+            return false;
+        }
+        if(!ReadExact(source, &Version, sizeof(Version))||(Version != SerializedVersion)){
+            return false;
+        }
+        if(!ReadExact(source, Counts, sizeof(Counts))||(Counts[0] >= InvalidVertex)||(Counts[1] >= std::numeric_limits<uint32_t>::max())){
+            return false;
+        }
+        //Shape offsets are either absent or one per edge plus one
+        if((Counts[2] && (Counts[2] != Counts[1] + 1))||(!Counts[2] && Counts[3])||(Counts[3] >= std::numeric_limits<uint32_t>::max())){
+            return false;
+        }
+        std::vector<CStreetMap::TNodeID> NodeIDs;
+        std::vector<double> Latitudes, Longitudes, Lengths;
+        std::vector<uint32_t> Offsets, Ways;
+        std::vector<TVertex> Targets;
+        if(!ReadColumn(source, NodeIDs, Counts[0])||!ReadColumn(source, Latitudes, Counts[0])||!ReadColumn(source, Longitudes, Counts[0])||!ReadColumn(source, Offsets, Counts[0] + 1)){
+            return false;
+        }
+        if(!ReadColumn(source, Targets, Counts[1])||!ReadColumn(source, Lengths, Counts[1])||!ReadColumn(source, Ways, Counts[1])){
+            return false;
+        }
+        std::vector<uint32_t> ShapeOffsets;
+        std::vector<CStreetMap::TNodeID> ShapeNodeIDs;
+        std::vector<double> ShapeLatitudes, ShapeLongitudes;
+        if(!ReadColumn(source, ShapeOffsets, Counts[2])||!ReadColumn(source, ShapeNodeIDs, Counts[3])||!ReadColumn(source, ShapeLatitudes, Counts[3])||!ReadColumn(source, ShapeLongitudes, Counts[3])){
+            return false;
+        }
+        if(Counts[2] && ((ShapeOffsets.front() != 0)||(ShapeOffsets.back() != Counts[3])||!std::is_sorted(ShapeOffsets.begin(), ShapeOffsets.end()))){
+            return false;
+        }
+        //Offsets must climb from 0 to the edge count and every target must be a vertex
+        if((Offsets.front() != 0)||(Offsets.back() != Counts[1])||!std::is_sorted(Offsets.begin(), Offsets.end())){
+            return false;
+        }
+        if(std::any_of(Targets.begin(), Targets.end(), [&](TVertex target){ return target >= Counts[0]; })){
+            return false;
+        }
+        DNodeIDs = std::move(NodeIDs);
+        DLatitudes = std::move(Latitudes);
+        DLongitudes = std::move(Longitudes);
+        DOffsets = std::move(Offsets);
+        DTargets = std::move(Targets);
+        DLengths = std::move(Lengths);
+        DWays = std::move(Ways);
+        DShapeOffsets = std::move(ShapeOffsets);
+        DShapeNodeIDs = std::move(ShapeNodeIDs);
+        DShapeLatitudes = std::move(ShapeLatitudes);
+        DShapeLongitudes = std::move(ShapeLongitudes);
+        DVertexIndex.Build(DNodeIDs);
+        return true;
+    }
+};
+
+CRoadGraph::CRoadGraph() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CRoadGraph::CRoadGraph(CRoadGraph &&graph) noexcept : DImplementation(std::move(graph.DImplementation)){
+    graph.DImplementation = std::make_unique<SImplementation>();
+}
+
+CRoadGraph &CRoadGraph::operator=(CRoadGraph &&graph) noexcept{
+    std::swap(DImplementation, graph.DImplementation);
+    return *this;
+}
+
+CRoadGraph::~CRoadGraph(){
+
+}
+
+void CRoadGraph::Build(const COpenStreetMap &map){
+    Build(map, SOptions());
+}
+
+//Replaces the graph with the street network of map
+void CRoadGraph::Build(const COpenStreetMap &map, const SOptions &options){
+    DImplementation->Build(map, options);
+}
+
+//Replaces the graph with graph's degree 2 chains collapsed, graph may be this graph
+void CRoadGraph::BuildContracted(const CRoadGraph &graph, std::size_t threadcount){
+    BuildContracted(graph, {}, threadcount);
+}
+
+void CRoadGraph::BuildContracted(const CRoadGraph &graph, std::span<const CStreetMap::TNodeID> keep, std::size_t threadcount){
+    auto Contracted = std::make_unique<SImplementation>();
+    Contracted->BuildContracted(*graph.DImplementation, keep, threadcount);
+    DImplementation = std::move(Contracted);
+}
+
+std::size_t CRoadGraph::VertexCount() const noexcept{
+    return DImplementation->DNodeIDs.size();
+}
+
+std::size_t CRoadGraph::EdgeCount() const noexcept{
+    return DImplementation->DTargets.size();
+}
+
+SMemoryUsage CRoadGraph::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    Usage.Add(DImplementation->DNodeIDs);
+    Usage.Add(DImplementation->DLatitudes);
+    Usage.Add(DImplementation->DLongitudes);
+    Usage.Add(DImplementation->DOffsets);
+    Usage.Add(DImplementation->DTargets);
+    Usage.Add(DImplementation->DLengths);
+    Usage.Add(DImplementation->DWays);
+    Usage.Add(DImplementation->DShapeOffsets);
+    Usage.Add(DImplementation->DShapeNodeIDs);
+    Usage.Add(DImplementation->DShapeLatitudes);
+    Usage.Add(DImplementation->DShapeLongitudes);
+    Usage += DImplementation->DVertexIndex.MemoryUsage();
+    return Usage;
+}
+
+//Vertex of the node with id, InvalidVertex if no chosen way references it
+CRoadGraph::TVertex CRoadGraph::VertexByNodeID(CStreetMap::TNodeID id) const noexcept{
+    auto Index = DImplementation->DVertexIndex.Find(id);
+    return Index == CIDIndex::InvalidIndex ? InvalidVertex : static_cast<TVertex>(Index);
+}
+
+CStreetMap::TNodeID CRoadGraph::NodeID(TVertex vertex) const noexcept{
+    return vertex < DImplementation->DNodeIDs.size() ? DImplementation->DNodeIDs[vertex] : CStreetMap::InvalidNodeID;
+}
+
+CStreetMap::SLocation CRoadGraph::Location(TVertex vertex) const noexcept{
+    if(vertex < DImplementation->DNodeIDs.size()){
+        return CStreetMap::SLocation{DImplementation->DLatitudes[vertex], DImplementation->DLongitudes[vertex]};
+    }
+    return CStreetMap::SLocation{0, 0};
+}
+
+//First edge leaving vertex, EdgeBegin(v) == EdgeEnd(v) for invalid vertices
+std::size_t CRoadGraph::EdgeBegin(TVertex vertex) const noexcept{
+    return vertex < DImplementation->DNodeIDs.size() ? DImplementation->DOffsets[vertex] : 0;
+}
+
+std::size_t CRoadGraph::EdgeEnd(TVertex vertex) const noexcept{
+    return vertex < DImplementation->DNodeIDs.size() ? DImplementation->DOffsets[vertex + 1] : 0;
+}
+
+CRoadGraph::TVertex CRoadGraph::EdgeTarget(std::size_t edge) const noexcept{
+    return edge < DImplementation->DTargets.size() ? DImplementation->DTargets[edge] : InvalidVertex;
+}
+
+//Length in meters, 0 for invalid edges
+double CRoadGraph::EdgeLength(std::size_t edge) const noexcept{
+    return edge < DImplementation->DLengths.size() ? DImplementation->DLengths[edge] : 0;
+}
+
+//Index in the map of the way the edge came from
+std::size_t CRoadGraph::EdgeWayIndex(std::size_t edge) const noexcept{
+    return edge < DImplementation->DWays.size() ? DImplementation->DWays[edge] : COpenStreetMap::InvalidIndex;
+}
+
+//Vertex the edge leaves from, found by binary search of the offsets
+CRoadGraph::TVertex CRoadGraph::EdgeSource(std::size_t edge) const noexcept{
+    const auto &Offsets = DImplementation->DOffsets;
+    if(edge >= DImplementation->DTargets.size()){
+        return InvalidVertex;
+    }
+    return static_cast<TVertex>(std::upper_bound(Offsets.begin(), Offsets.end(), edge) - Offsets.begin() - 1);
+}
+
+//Fills ids with every node the edge passes, from its source to its target
+std::size_t CRoadGraph::EdgeNodeIDs(std::size_t edge, std::vector<CStreetMap::TNodeID> &ids) const{
+    const auto &Implementation = *DImplementation;
+    ids.clear();
+    auto Source = EdgeSource(edge);
+    if(Source == InvalidVertex){
+        return 0;
+    }
+    ids.push_back(Implementation.DNodeIDs[Source]);
+    ids.insert(ids.end(), Implementation.DShapeNodeIDs.begin() + Implementation.ShapeBegin(edge), Implementation.DShapeNodeIDs.begin() + Implementation.ShapeEnd(edge));
+    ids.push_back(Implementation.DNodeIDs[Implementation.DTargets[edge]]);
+    return ids.size();
+}
+
+//Fills locations with the polyline of the edge, from its source to its target
+std::size_t CRoadGraph::EdgeLocations(std::size_t edge, std::vector<CStreetMap::SLocation> &locations) const{
+    const auto &Implementation = *DImplementation;
+    locations.clear();
+    auto Source = EdgeSource(edge);
+    if(Source == InvalidVertex){
+        return 0;
+    }
+    locations.push_back(Location(Source));
+    for(auto Shape = Implementation.ShapeBegin(edge); Shape < Implementation.ShapeEnd(edge); Shape++){
+        locations.push_back({Implementation.DShapeLatitudes[Shape], Implementation.DShapeLongitudes[Shape]});
+    }
+    locations.push_back(Location(Implementation.DTargets[edge]));
+    return locations.size();
+}
+
+//Number of nodes stored inside contracted edges, 0 for graphs built from a map
+std::size_t CRoadGraph::ShapeNodeCount() const noexcept{
+    return DImplementation->DShapeNodeIDs.size();
+}
+
+std::span<const uint32_t> CRoadGraph::Offsets() const noexcept{
+    return DImplementation->DOffsets;
+}
+
+std::span<const CRoadGraph::TVertex> CRoadGraph::Targets() const noexcept{
+    return DImplementation->DTargets;
+}
+
+std::span<const double> CRoadGraph::Lengths() const noexcept{
+    return DImplementation->DLengths;
+}
+
+std::span<const uint32_t> CRoadGraph::WayIndices() const noexcept{
+    return DImplementation->DWays;
+}
+
+std::span<const CStreetMap::TNodeID> CRoadGraph::NodeIDs() const noexcept{
+    return DImplementation->DNodeIDs;
+}
+
+std::span<const double> CRoadGraph::Latitudes() const noexcept{
+    return DImplementation->DLatitudes;
+}
+
+std::span<const double> CRoadGraph::Longitudes() const noexcept{
+    return DImplementation->DLongitudes;
+}
+
+bool CRoadGraph::Save(std::shared_ptr<CDataSink> sink) const{
+    return DImplementation->Save(sink);
+}
+
+//Replaces the graph with one written by Save, the graph is unchanged if the data is not valid
+bool CRoadGraph::Load(std::shared_ptr<CDataSource> source){
+    return DImplementation->Load(source);
+}
@@ -0,0 +1,263 @@
+#include "RoadRouter.h"
+#include "GeographicUtils.h"
+#include <algorithm>
+
+struct CRoadRouter::SWorkspace::SImplementation{
+    using TVertex = CRoadGraph::TVertex;
+    inline static constexpr uint32_t NotInHeap = std::numeric_limits<uint32_t>::max();
+    inline static constexpr uint32_t Settled = NotInHeap - 1;
+    //Children of heap entry i are 4i+1 to 4i+4, a shallower tree than a binary heap with the children on one cache line
+    inline static constexpr std::size_t HeapArity = 4;
+
+    //Valid only when DGeneration matches the workspace's, so nothing is cleared between queries
+    struct SVertexState{
+        double DDistance;
+        double DEstimate;
+        uint32_t DGeneration;
+        uint32_t DHeapIndex;
+        uint32_t DParentEdge;
+        TVertex DParent;
+    };
+
+    struct SHeapEntry{
+        double DKey;
+        TVertex DVertex;
+    };
+
+    std::vector<SVertexState> DStates;
+    std::vector<SHeapEntry> DHeap;
+    uint32_t DGeneration = 0;
+    std::size_t DSettledCount = 0;
+    //Scratch for unpacking paths
+    std::vector<uint32_t> DPathEdges;
+    std::vector<CStreetMap::TNodeID> DEdgeNodeIDs;
+
+    //Starts a query over vertexcount vertices
+    void Reset(std::size_t vertexcount){
+        if(DStates.size() < vertexcount){
+            DStates.resize(vertexcount, SVertexState{0, 0, 0, NotInHeap, 0, 0});
+        }
+        DGeneration++;
+        if(DGeneration == 0){
+            //Wrapped around, stale states could now look current
+            for(auto &State : DStates){
+                State.DGeneration = 0;
+            }
+            DGeneration = 1;
+        }
+        DHeap.clear();
+        DSettledCount = 0;
+    }
+
+    bool Reached(TVertex vertex) const noexcept{
+        return DStates[vertex].DGeneration == DGeneration;
+    }
+
+    void Place(std::size_t index, const SHeapEntry &entry) noexcept{
+        DHeap[index] = entry;
+        DStates[entry.DVertex].DHeapIndex = static_cast<uint32_t>(index);
+    }
+
+    void SiftUp(std::size_t index) noexcept{
+        auto Entry = DHeap[index];
+        while(index){
+            auto Parent = (index - 1) / HeapArity;
+            if(DHeap[Parent].DKey <= Entry.DKey){
+                break;
+            }
+            Place(index, DHeap[Parent]);
+            index = Parent;
+        }
+        Place(index, Entry);
+    }
+
+    void SiftDown(std::size_t index) noexcept{
+        auto Entry = DHeap[index];
+        while(true){
+            auto First = index * HeapArity + 1;
+            if(First >= DHeap.size()){
+                break;
+            }
+            auto Smallest = First;
+            for(auto Child = First + 1; Child < std::min(First + HeapArity, DHeap.size()); Child++){
+                if(DHeap[Child].DKey < DHeap[Smallest].DKey){
+                    Smallest = Child;
+                }
+            }
+            if(Entry.DKey <= DHeap[Smallest].DKey){
+                break;
+            }
+            Place(index, DHeap[Smallest]);
+            index = Smallest;
+        }
+        Place(index, Entry);
+    }
+
+    void Push(TVertex vertex, double key){
+        DHeap.push_back({key, vertex});
+        SiftUp(DHeap.size() - 1);
+    }
+
+    void DecreaseKey(TVertex vertex, double key) noexcept{
+        auto Index = DStates[vertex].DHeapIndex;
+        DHeap[Index].DKey = key;
+        SiftUp(Index);
+    }
+
+    TVertex Pop() noexcept{
+        auto Top = DHeap.front().DVertex;
+        DStates[Top].DHeapIndex = Settled;
+        auto Last = DHeap.back();
+        DHeap.pop_back();
+        if(!DHeap.empty()){
+            DHeap.front() = Last;
+            SiftDown(0);
+        }
+        DSettledCount++;
+        return Top;
+    }
+};
+
+CRoadRouter::SWorkspace::SWorkspace() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CRoadRouter::SWorkspace::SWorkspace(SWorkspace &&workspace) noexcept = default;
+
+CRoadRouter::SWorkspace &CRoadRouter::SWorkspace::operator=(SWorkspace &&workspace) noexcept = default;
+
+CRoadRouter::SWorkspace::~SWorkspace(){
+
+}
+
+std::size_t CRoadRouter::SWorkspace::SettledCount() const noexcept{
+    return DImplementation ? DImplementation->DSettledCount : 0;
+}
+
+struct CRoadRouter::SImplementation{
+    using TVertex = CRoadGraph::TVertex;
+    //Edge lengths are sums of haversine distances, so the straight line distance never overestimates
+    //The slight shrink keeps rounding in the heuristic from ever overestimating either
+    inline static constexpr double HeuristicScale = 1.0 - 1e-9;
+
+    struct SPath : public CBusSystem::SPath{
+        std::vector<CStreetMap::TNodeID> DNodeIDs;
+
+        CStreetMap::TNodeID StartNodeID() const noexcept override{
+            return DNodeIDs.front();
+        }
+
+        CStreetMap::TNodeID EndNodeID() const noexcept override{
+            return DNodeIDs.back();
+        }
+
+        std::size_t NodeCount() const noexcept override{
+            return DNodeIDs.size();
+        }
+
+        CStreetMap::TNodeID GetNodeID(std::size_t index) const noexcept override{
+            return index < DNodeIDs.size() ? DNodeIDs[index] : CStreetMap::InvalidNodeID;
+        }
+    };
+
+    std::shared_ptr<const CRoadGraph> DGraph;
+
+    SImplementation(std::shared_ptr<const CRoadGraph> graph) : DGraph(graph){
+
+    }
+
+    double FindShortestPath(SWorkspace::SImplementation &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path, EAlgorithm algorithm) const{
+        path.clear();
+        workspace.DSettledCount = 0;
+        auto Source = DGraph->VertexByNodeID(src);
+        auto Target = DGraph->VertexByNodeID(dest);
+        if((Source == CRoadGraph::InvalidVertex)||(Target == CRoadGraph::InvalidVertex)){
+            return NoPathExists;
+        }
+        auto Offsets = DGraph->Offsets();
+        auto Targets = DGraph->Targets();
+        auto Lengths = DGraph->Lengths();
+        auto Latitudes = DGraph->Latitudes();
+        auto Longitudes = DGraph->Longitudes();
+        auto TargetLocation = DGraph->Location(Target);
+        auto Informed = algorithm == EAlgorithm::AStar;
+        auto Estimate = [&](TVertex vertex){
+            return Informed ? SGeographicUtils::HaversineDistanceInMeters({Latitudes[vertex], Longitudes[vertex]}, TargetLocation) * HeuristicScale : 0.0;
+        };
+
+        workspace.Reset(DGraph->VertexCount());
+        auto &States = workspace.DStates;
+        States[Source] = {0, Estimate(Source), workspace.DGeneration, SWorkspace::SImplementation::NotInHeap, 0, CRoadGraph::InvalidVertex};
+        workspace.Push(Source, States[Source].DEstimate);
+        while(!workspace.DHeap.empty()){
+            auto Vertex = workspace.Pop();
+            if(Vertex == Target){
+                break;
+            }
+            auto Distance = States[Vertex].DDistance;
+            for(auto Edge = Offsets[Vertex]; Edge < Offsets[Vertex + 1]; Edge++){
+                auto Next = Targets[Edge];
+                auto Candidate = Distance + Lengths[Edge];
+                auto &State = States[Next];
+                if(!workspace.Reached(Next)){
+                    State = {Candidate, Estimate(Next), workspace.DGeneration, SWorkspace::SImplementation::NotInHeap, Edge, Vertex};
+                    workspace.Push(Next, Candidate + State.DEstimate);
+                }
+                else if((State.DHeapIndex != SWorkspace::SImplementation::Settled)&&(Candidate < State.DDistance)){
+                    State.DDistance = Candidate;
+                    State.DParentEdge = Edge;
+                    State.DParent = Vertex;
+                    workspace.DecreaseKey(Next, Candidate + State.DEstimate);
+                }
+            }
+        }
+        if(!workspace.Reached(Target)||(States[Target].DHeapIndex != SWorkspace::SImplementation::Settled)){
+            return NoPathExists;
+        }
+
+        //Walk the parents back, then unpack each edge's nodes front to back
+        workspace.DPathEdges.clear();
+        for(auto Vertex = Target; Vertex != Source; Vertex = States[Vertex].DParent){
+            workspace.DPathEdges.push_back(States[Vertex].DParentEdge);
+        }
+        path.push_back(src);
+        for(auto Edge = workspace.DPathEdges.rbegin(); Edge != workspace.DPathEdges.rend(); Edge++){
+            DGraph->EdgeNodeIDs(*Edge, workspace.DEdgeNodeIDs);
+            path.insert(path.end(), workspace.DEdgeNodeIDs.begin() + 1, workspace.DEdgeNodeIDs.end());
+        }
+        return States[Target].DDistance;
+    }
+};
+
+CRoadRouter::CRoadRouter(std::shared_ptr<const CRoadGraph> graph) : DImplementation(std::make_unique<SImplementation>(graph)){
+
+}
+
+CRoadRouter::~CRoadRouter(){
+
+}
+
+std::shared_ptr<const CRoadGraph> CRoadRouter::Graph() const noexcept{
+    return DImplementation->DGraph;
+}
+
+double CRoadRouter::FindShortestPath(CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path, EAlgorithm algorithm) const{
+    //One workspace per thread, shared by every router that thread uses
+    thread_local SWorkspace Workspace;
+    return FindShortestPath(Workspace, src, dest, path, algorithm);
+}
+
+double CRoadRouter::FindShortestPath(SWorkspace &workspace, CStreetMap::TNodeID src, CStreetMap::TNodeID dest, std::vector<CStreetMap::TNodeID> &path, EAlgorithm algorithm) const{
+    if(!workspace.DImplementation){
+        workspace.DImplementation = std::make_unique<SWorkspace::SImplementation>();
+    }
+    return DImplementation->FindShortestPath(*workspace.DImplementation, src, dest, path, algorithm);
+}
+
+std::shared_ptr<CBusSystem::SPath> CRoadRouter::ShortestPath(CStreetMap::TNodeID src, CStreetMap::TNodeID dest, EAlgorithm algorithm) const{
+    auto Path = std::make_shared<SImplementation::SPath>();
+    if(FindShortestPath(src, dest, Path->DNodeIDs, algorithm) == NoPathExists){
+        return nullptr;
+    }
+    return Path;
+}
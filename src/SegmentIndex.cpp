@@ -0,0 +1,298 @@
+#include "SegmentIndex.h"
+#include "GeographicUtils.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+struct CSegmentIndex::SImplementation{
+    inline static const double MetersPerDegree = SGeographicUtils::EarthRadiusMeters * std::numbers::pi / 180.0;
+    const std::string DNameKey = "name";
+
+    std::shared_ptr<const COpenStreetMap> DMap;
+    SOptions DOptions;
+
+    //One entry per segment
+    std::vector<uint32_t> DSegmentWays;
+    std::vector<uint32_t> DSegmentStarts;
+
+    //Grid cell size in degrees, and the smallest cell edge in meters anywhere in the data
+    double DCellLatitude = 1;
+    double DCellLongitude = 1;
+    double DMinCellMeters = 1;
+    int32_t DMinRow = 0, DMaxRow = -1, DMinColumn = 0, DMaxColumn = -1;
+
+    //Cells as sorted keys, the segments of cell i are bucket entries DCellOffsets[i] to DCellOffsets[i+1]
+    //Bucket entries copy the segment end points so a bucket is scanned as contiguous arrays
+    std::vector<uint64_t> DCellKeys;
+    std::vector<uint32_t> DCellOffsets;
+    std::vector<double> DBucketLatitudesA, DBucketLongitudesA, DBucketLatitudesB, DBucketLongitudesB;
+    std::vector<uint32_t> DBucketSegments;
+    std::size_t DLargestBucket = 0;
+
+    static uint64_t CellKey(int32_t row, int32_t column) noexcept{
+        return (uint64_t(uint32_t(row)) << 32) | uint32_t(column);
+    }
+
+    int32_t Row(double latitude) const noexcept{
+        return static_cast<int32_t>(std::floor(latitude / DCellLatitude));
+    }
+
+    int32_t Column(double longitude) const noexcept{
+        return static_cast<int32_t>(std::floor(longitude / DCellLongitude));
+    }
+
+    struct SSegment{
+        uint32_t DWay;
+        uint32_t DStart;
+        CStreetMap::SLocation DA;
+        CStreetMap::SLocation DB;
+    };
+
+    //Segments between consecutive nodes of the way that are in the map
+    void WaySegments(std::size_t way, std::vector<SSegment> &segments) const{
+        auto Indices = DMap->WayNodeIndices(way);
+        std::size_t Previous = Indices.size();
+        for(std::size_t Position = 0; Position < Indices.size(); Position++){
+            if(Indices[Position] == COpenStreetMap::InvalidNodeIndex){
+                continue;
+            }
+            if(Previous < Indices.size()){
+                segments.push_back({static_cast<uint32_t>(way), static_cast<uint32_t>(Previous), DMap->NodeByIndex(Indices[Previous])->Location(), DMap->NodeByIndex(Indices[Position])->Location()});
+            }
+            Previous = Position;
+        }
+    }
+
+    SImplementation(std::shared_ptr<const COpenStreetMap> map, const SOptions &options) : DMap(map), DOptions(options){
+        //Segments are gathered per chunk of ways, then joined in way order
+        auto Threads = ResolveThreadCount(options.DThreadCount);
+        std::vector<std::vector<SSegment>> ChunkSegments(Threads);
+        auto ChunkSize = (DMap->WayCount() + Threads - 1) / std::max<std::size_t>(Threads, 1);
+        ParallelFor(Threads, Threads, [&](std::size_t begin, std::size_t end){
+            for(auto Chunk = begin; Chunk < end; Chunk++){
+                for(auto Way = Chunk * ChunkSize; Way < std::min(DMap->WayCount(), (Chunk + 1) * ChunkSize); Way++){
+                    if(DOptions.DRequiredKey.empty() || DMap->WayByIndex(Way)->HasAttribute(DOptions.DRequiredKey)){
+                        WaySegments(Way, ChunkSegments[Chunk]);
+                    }
+                }
+            }
+        });
+        std::vector<SSegment> Segments;
+        for(auto &Chunk : ChunkSegments){
+            Segments.insert(Segments.end(), Chunk.begin(), Chunk.end());
+        }
+        if(Segments.empty()){
+            return;
+        }
+
+        //Longitude cells are widened by the mean latitude so cells are roughly square in meters
+        double MinLatitude = Segments[0].DA.DLatitude, MaxLatitude = MinLatitude;
+        for(const auto &Segment : Segments){
+            for(const auto &End : {Segment.DA, Segment.DB}){
+                MinLatitude = std::min(MinLatitude, End.DLatitude);
+                MaxLatitude = std::max(MaxLatitude, End.DLatitude);
+            }
+        }
+        auto Cosine = [](double latitude){
+            return std::max(0.01, std::cos(SGeographicUtils::DegreesToRadians(latitude)));
+        };
+        auto ReferenceCosine = Cosine((MinLatitude + MaxLatitude) / 2);
+        DCellLatitude = DOptions.DCellMeters / MetersPerDegree;
+        DCellLongitude = DCellLatitude / ReferenceCosine;
+        auto WorstCosine = std::min(Cosine(MinLatitude), Cosine(MaxLatitude));
+        DMinCellMeters = DOptions.DCellMeters * std::min(1.0, WorstCosine / ReferenceCosine);
+
+        //Every (cell, segment) pair where the segment's bounds overlap the cell
+        std::vector<std::vector<std::pair<uint64_t, uint32_t>>> ChunkPairs(Threads);
+        auto SegmentChunk = (Segments.size() + Threads - 1) / Threads;
+        ParallelFor(Threads, Threads, [&](std::size_t begin, std::size_t end){
+            for(auto Chunk = begin; Chunk < end; Chunk++){
+                for(auto Index = Chunk * SegmentChunk; Index < std::min(Segments.size(), (Chunk + 1) * SegmentChunk); Index++){
+                    const auto &Segment = Segments[Index];
+                    auto FirstRow = Row(std::min(Segment.DA.DLatitude, Segment.DB.DLatitude));
+                    auto LastRow = Row(std::max(Segment.DA.DLatitude, Segment.DB.DLatitude));
+                    auto FirstColumn = Column(std::min(Segment.DA.DLongitude, Segment.DB.DLongitude));
+                    auto LastColumn = Column(std::max(Segment.DA.DLongitude, Segment.DB.DLongitude));
+                    for(auto CellRow = FirstRow; CellRow <= LastRow; CellRow++){
+                        for(auto CellColumn = FirstColumn; CellColumn <= LastColumn; CellColumn++){
+                            ChunkPairs[Chunk].push_back({CellKey(CellRow, CellColumn), static_cast<uint32_t>(Index)});
+                        }
+                    }
+                }
+            }
+        });
+        std::vector<std::pair<uint64_t, uint32_t>> Pairs;
+        for(auto &Chunk : ChunkPairs){
+            Pairs.insert(Pairs.end(), Chunk.begin(), Chunk.end());
+            Chunk = std::vector<std::pair<uint64_t, uint32_t>>();
+        }
+        std::sort(Pairs.begin(), Pairs.end());
+
+        DMinRow = DMinColumn = std::numeric_limits<int32_t>::max();
+        DMaxRow = DMaxColumn = std::numeric_limits<int32_t>::min();
+        for(std::size_t Index = 0; Index < Pairs.size(); Index++){
+            if(DCellKeys.empty() || (DCellKeys.back() != Pairs[Index].first)){
+                DCellKeys.push_back(Pairs[Index].first);
+                DCellOffsets.push_back(Index);
+                auto CellRow = static_cast<int32_t>(Pairs[Index].first >> 32);
+                auto CellColumn = static_cast<int32_t>(uint32_t(Pairs[Index].first));
+                DMinRow = std::min(DMinRow, CellRow);
+                DMaxRow = std::max(DMaxRow, CellRow);
+                DMinColumn = std::min(DMinColumn, CellColumn);
+                DMaxColumn = std::max(DMaxColumn, CellColumn);
+            }
+            const auto &Segment = Segments[Pairs[Index].second];
+            DBucketLatitudesA.push_back(Segment.DA.DLatitude);
+            DBucketLongitudesA.push_back(Segment.DA.DLongitude);
+            DBucketLatitudesB.push_back(Segment.DB.DLatitude);
+            DBucketLongitudesB.push_back(Segment.DB.DLongitude);
+            DBucketSegments.push_back(Pairs[Index].second);
+        }
+        DCellOffsets.push_back(Pairs.size());
+        for(std::size_t Cell = 0; Cell + 1 < DCellOffsets.size(); Cell++){
+            DLargestBucket = std::max<std::size_t>(DLargestBucket, DCellOffsets[Cell + 1] - DCellOffsets[Cell]);
+        }
+        for(const auto &Segment : Segments){
+            DSegmentWays.push_back(Segment.DWay);
+            DSegmentStarts.push_back(Segment.DStart);
+        }
+    }
+
+    //Squared distance and clamped projection fraction from the origin to every segment of a bucket
+    //Coordinates are projected to meters around the query, the loop has no branches so it vectorizes
+    static void BucketDistances(const double *latitudesa, const double *longitudesa, const double *latitudesb, const double *longitudesb, std::size_t count, double latitude, double longitude, double scalex, double scaley, double *distances, double *fractions) noexcept{
+        for(std::size_t Index = 0; Index < count; Index++){
+            auto AX = (longitudesa[Index] - longitude) * scalex;
+            auto AY = (latitudesa[Index] - latitude) * scaley;
+            auto DX = (longitudesb[Index] - longitude) * scalex - AX;
+            auto DY = (latitudesb[Index] - latitude) * scaley - AY;
+            auto Length = DX * DX + DY * DY;
+            auto Fraction = std::clamp(-(AX * DX + AY * DY) / std::max(Length, 1e-18), 0.0, 1.0);
+            auto PX = AX + Fraction * DX;
+            auto PY = AY + Fraction * DY;
+            distances[Index] = PX * PX + PY * PY;
+            fractions[Index] = Fraction;
+        }
+    }
+
+    SMatch Nearest(const CStreetMap::SLocation &location) const{
+        SMatch Match{location, std::numeric_limits<double>::infinity(), CStreetMap::InvalidWayID, 0, 0, 0, std::string()};
+        if(DCellKeys.empty()){
+            return Match;
+        }
+        thread_local std::vector<double> Distances, Fractions;
+        Distances.resize(DLargestBucket);
+        Fractions.resize(DLargestBucket);
+
+        auto ScaleY = MetersPerDegree;
+        auto ScaleX = MetersPerDegree * std::cos(SGeographicUtils::DegreesToRadians(location.DLatitude));
+        auto Best = std::numeric_limits<double>::infinity();
+        auto BestEntry = DBucketSegments.size();
+        double BestFraction = 0;
+        auto ScanCell = [&](int32_t row, int32_t column){
+            auto Search = std::lower_bound(DCellKeys.begin(), DCellKeys.end(), CellKey(row, column));
+            if((Search == DCellKeys.end())||(*Search != CellKey(row, column))){
+                return;
+            }
+            auto Cell = Search - DCellKeys.begin();
+            auto Begin = DCellOffsets[Cell];
+            auto Count = DCellOffsets[Cell + 1] - Begin;
+            BucketDistances(DBucketLatitudesA.data() + Begin, DBucketLongitudesA.data() + Begin, DBucketLatitudesB.data() + Begin, DBucketLongitudesB.data() + Begin, Count, location.DLatitude, location.DLongitude, ScaleX, ScaleY, Distances.data(), Fractions.data());
+            for(std::size_t Index = 0; Index < Count; Index++){
+                //Ties go to the lower segment so results do not depend on which cell is scanned first
+                if((Distances[Index] < Best)||((Distances[Index] == Best)&&(DBucketSegments[Begin + Index] < DBucketSegments[BestEntry]))){
+                    Best = Distances[Index];
+                    BestEntry = Begin + Index;
+                    BestFraction = Fractions[Index];
+                }
+            }
+        };
+
+        //Rings of cells around the query until no unscanned cell can be closer than the best so far
+        auto QueryRow = Row(location.DLatitude);
+        auto QueryColumn = Column(location.DLongitude);
+        //Rings that do not reach the grid are empty
+        auto FirstRing = std::max({DMinRow - QueryRow, QueryRow - DMaxRow, DMinColumn - QueryColumn, QueryColumn - DMaxColumn, 0});
+        for(int32_t Ring = FirstRing; ; Ring++){
+            //No cell of this ring is closer than RingDistance
+            auto RingDistance = (Ring - 1) * DMinCellMeters;
+            if((Ring > 0)&&((RingDistance > DOptions.DMaxDistanceMeters)||(RingDistance * RingDistance >= Best))){
+                break;
+            }
+            //The previous rings already covered the whole grid
+            if((QueryRow - Ring < DMinRow)&&(QueryRow + Ring > DMaxRow)&&(QueryColumn - Ring < DMinColumn)&&(QueryColumn + Ring > DMaxColumn)){
+                break;
+            }
+            for(auto CellRow = std::max(QueryRow - Ring, DMinRow); CellRow <= std::min(QueryRow + Ring, DMaxRow); CellRow++){
+                if((CellRow == QueryRow - Ring)||(CellRow == QueryRow + Ring)){
+                    for(auto CellColumn = std::max(QueryColumn - Ring, DMinColumn); CellColumn <= std::min(QueryColumn + Ring, DMaxColumn); CellColumn++){
+                        ScanCell(CellRow, CellColumn);
+                    }
+                }
+                else{
+                    if(QueryColumn - Ring >= DMinColumn){
+                        ScanCell(CellRow, QueryColumn - Ring);
+                    }
+                    if(QueryColumn + Ring <= DMaxColumn){
+                        ScanCell(CellRow, QueryColumn + Ring);
+                    }
+                }
+            }
+        }
+        if(BestEntry >= DBucketSegments.size()){
+            return Match;
+        }
+
+        auto Segment = DBucketSegments[BestEntry];
+        CStreetMap::SLocation A(DBucketLatitudesA[BestEntry], DBucketLongitudesA[BestEntry]);
+        CStreetMap::SLocation B(DBucketLatitudesB[BestEntry], DBucketLongitudesB[BestEntry]);
+        CStreetMap::SLocation Projected(A.DLatitude + BestFraction * (B.DLatitude - A.DLatitude), A.DLongitude + BestFraction * (B.DLongitude - A.DLongitude));
+        auto Distance = SGeographicUtils::HaversineDistanceInMeters(location, Projected);
+        if(Distance > DOptions.DMaxDistanceMeters){
+            return Match;
+        }
+        auto Way = DMap->WayByIndex(DSegmentWays[Segment]);
+        Match.DLocation = Projected;
+        Match.DDistance = Distance;
+        Match.DWayID = Way->ID();
+        Match.DWayIndex = DSegmentWays[Segment];
+        Match.DSegment = DSegmentStarts[Segment];
+        Match.DOffset = SGeographicUtils::HaversineDistanceInMeters(A, Projected);
+        Match.DName = Way->GetAttribute(DNameKey);
+        return Match;
+    }
+};
+
+CSegmentIndex::CSegmentIndex(std::shared_ptr<const COpenStreetMap> map){
+    DImplementation = std::make_unique<SImplementation>(map, SOptions());
+}
+
+CSegmentIndex::CSegmentIndex(std::shared_ptr<const COpenStreetMap> map, const SOptions &options){
+    DImplementation = std::make_unique<SImplementation>(map, options);
+}
+
+CSegmentIndex::~CSegmentIndex(){
+
+}
+
+//Number of indexed segments
+std::size_t CSegmentIndex::SegmentCount() const noexcept{
+    return DImplementation->DSegmentWays.size();
+}
+
+//Closest point on any indexed segment, DWayID is InvalidWayID if none is within DMaxDistanceMeters
+CSegmentIndex::SMatch CSegmentIndex::Nearest(const CStreetMap::SLocation &location) const{
+    return DImplementation->Nearest(location);
+}
+
+//matches[i] is Nearest(locations[i]), queries are split across threadcount threads
+void CSegmentIndex::NearestBatch(const std::vector<CStreetMap::SLocation> &locations, std::vector<SMatch> &matches, std::size_t threadcount) const{
+    matches.resize(locations.size());
+    ParallelFor(locations.size(), threadcount, [&](std::size_t begin, std::size_t end){
+        for(auto Index = begin; Index < end; Index++){
+            matches[Index] = DImplementation->Nearest(locations[Index]);
+        }
+    });
+}
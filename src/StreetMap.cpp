@@ -0,0 +1,14 @@
+#include "StreetMap.h"
+#include "ParallelFor.h"
+
+void CStreetMap::ParallelForEachNode(const TNodeVisitor &visit, std::size_t threadcount) const{
+    ParallelFor(NodeCount(), threadcount, [&](std::size_t begin, std::size_t end){
+        ForEachNodeInRange(begin, end, visit);
+    });
+}
+
+void CStreetMap::ParallelForEachWay(const TWayVisitor &visit, std::size_t threadcount) const{
+    ParallelFor(WayCount(), threadcount, [&](std::size_t begin, std::size_t end){
+        ForEachWayInRange(begin, end, visit);
+    });
+}
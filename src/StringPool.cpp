@@ -0,0 +1,46 @@
+#include "StringPool.h"
+
+// Returns the ID of str, adding it to the pool the first time it is seen
+CStringPool::TStringID CStringPool::Intern(std::string_view str){
+    auto Search = DIDsByString.find(str);
+    if(Search != DIDsByString.end()){
+        return Search->second;
+    }
+    TStringID NewID = DStrings.size();
+    DStrings.emplace_back(str);
+    DIDsByString[DStrings.back()] = NewID;
+    return NewID;
+}
+
+// Returns the ID of str, or InvalidStringID if it was never interned
+CStringPool::TStringID CStringPool::Find(std::string_view str) const noexcept{
+    auto Search = DIDsByString.find(str);
+    if(Search != DIDsByString.end()){
+        return Search->second;
+    }
+    return InvalidStringID;
+}
+
+// Returns the string for id, or an empty string if id is not in the pool
+const std::string &CStringPool::String(TStringID id) const noexcept{
+    static const std::string EmptyString;
+    if(id < DStrings.size()){
+        return DStrings[id];
+    }
+    return EmptyString;
+}
+
+std::size_t CStringPool::Count() const noexcept{
+    return DStrings.size();
+}
+
+// The strings, the deque holding them and the lookup table
+SMemoryUsage CStringPool::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    Usage.Add(DStrings);
+    for(const auto &String : DStrings){
+        Usage.Add(String);
+    }
+    Usage.Add(DIDsByString);
+    return Usage;
+}
@@ -0,0 +1,285 @@
+#include "TagIndex.h"
+#include <algorithm>
+#include <unordered_map>
+
+struct CTagIndex::SImplementation{
+    //Posting list i is DPostings[DOffsets[i]] to DPostings[DOffsets[i+1]]
+    //Once mutable (see MakeMutable) list i ends at DEnds[i] instead and DOffsets has one entry per list
+    //Keys are looked up as "key" and (key, value) pairs as "key\0value", neither can hold a NUL in XML
+    std::unordered_map<std::string, uint32_t> DLists;
+    std::vector<uint64_t> DOffsets{0};
+    std::vector<uint32_t> DPostings;
+    std::size_t DKeyCount = 0;
+    bool DMutable = false;
+    std::vector<uint64_t> DEnds;
+    //Postings no list points at any more, left behind by lists that moved to the end to grow
+    std::size_t DUnused = 0;
+
+    static std::string PairKey(const std::string &key, const std::string &value){
+        std::string Combined = key;
+        Combined.push_back('\0');
+        Combined += value;
+        return Combined;
+    }
+
+    void Build(const CStreetMap &map, EObjectType type){
+        //Objects are visited in index order so every list comes out sorted
+        std::unordered_map<std::string, std::vector<uint32_t>> Lists;
+        std::size_t Count = type == EObjectType::Nodes ? map.NodeCount() : map.WayCount();
+        DKeyCount = 0;
+        auto AddObject = [&](uint32_t index, const auto &object){
+            for(std::size_t Attribute = 0; Attribute < object->AttributeCount(); Attribute++){
+                auto Key = object->GetAttributeKey(Attribute);
+                auto &KeyList = Lists[Key];
+                //A key repeated on one object is listed once
+                if(KeyList.empty() || (KeyList.back() != index)){
+                    KeyList.push_back(index);
+                }
+                auto &PairList = Lists[PairKey(Key, object->GetAttribute(Key))];
+                if(PairList.empty() || (PairList.back() != index)){
+                    PairList.push_back(index);
+                }
+            }
+        };
+        for(std::size_t Index = 0; Index < Count; Index++){
+            if(type == EObjectType::Nodes){
+                AddObject(Index, map.NodeByIndex(Index));
+            }
+            else{
+                AddObject(Index, map.WayByIndex(Index));
+            }
+        }
+
+        DLists.clear();
+        DOffsets.assign(1, 0);
+        DPostings.clear();
+        DMutable = false;
+        DEnds.clear();
+        DUnused = 0;
+        for(auto &[Key, List] : Lists){
+            if(Key.find('\0') == std::string::npos){
+                DKeyCount++;
+            }
+            DLists[Key] = DOffsets.size() - 1;
+            DPostings.insert(DPostings.end(), List.begin(), List.end());
+            DOffsets.push_back(DPostings.size());
+        }
+        DPostings.shrink_to_fit();
+        DOffsets.shrink_to_fit();
+    }
+
+    uint64_t End(uint32_t list) const noexcept{
+        return DMutable ? DEnds[list] : DOffsets[list + 1];
+    }
+
+    //The key and pair lists an object with tags belongs to, pairs use the first value of a repeated key as Build does
+    static std::vector<std::string> ListKeys(const TAttributes &tags){
+        std::vector<std::string> Keys;
+        for(const auto &Tag : tags){
+            auto First = std::find_if(tags.begin(), tags.end(), [&](const TAttribute &tag){ return tag.first == Tag.first; });
+            Keys.push_back(Tag.first);
+            Keys.push_back(PairKey(Tag.first, First->second));
+        }
+        return Keys;
+    }
+
+    //Gives every list an explicit end so lists can grow and shrink in place
+    void MakeMutable(){
+        if(DMutable){
+            return;
+        }
+        DMutable = true;
+        DEnds.assign(DOffsets.begin() + 1, DOffsets.end());
+        DOffsets.pop_back();
+    }
+
+    void Add(uint32_t index, const TAttributes &tags){
+        MakeMutable();
+        for(const auto &Key : ListKeys(tags)){
+            auto [Search, Inserted] = DLists.try_emplace(Key, DEnds.size());
+            auto List = Search->second;
+            if(Inserted){
+                DOffsets.push_back(DPostings.size());
+                DEnds.push_back(DPostings.size());
+            }
+            auto Begin = DPostings.begin() + DOffsets[List];
+            auto Position = std::lower_bound(Begin, DPostings.begin() + DEnds[List], index) - Begin;
+            if((DOffsets[List] + Position < DEnds[List])&&(Begin[Position] == index)){
+                continue;
+            }
+            if((DOffsets[List] == DEnds[List])&&(Key.find('\0') == std::string::npos)){
+                DKeyCount++;
+            }
+            //A list grows in place only at the end of the postings, any other list is first moved there
+            if(DEnds[List] != DPostings.size()){
+                auto Old = DOffsets[List];
+                auto Length = DEnds[List] - Old;
+                DOffsets[List] = DPostings.size();
+                DEnds[List] = DPostings.size() + Length;
+                DPostings.resize(DEnds[List]);
+                std::copy(DPostings.begin() + Old, DPostings.begin() + Old + Length, DPostings.begin() + DOffsets[List]);
+                DUnused += Length;
+            }
+            DPostings.insert(DPostings.begin() + DOffsets[List] + Position, index);
+            DEnds[List]++;
+        }
+        CompactIfSparse();
+    }
+
+    void Remove(uint32_t index, const TAttributes &tags){
+        MakeMutable();
+        for(const auto &Key : ListKeys(tags)){
+            auto Search = DLists.find(Key);
+            if(Search == DLists.end()){
+                continue;
+            }
+            auto List = Search->second;
+            auto Begin = DPostings.begin() + DOffsets[List];
+            auto End = DPostings.begin() + DEnds[List];
+            auto Position = std::lower_bound(Begin, End, index);
+            if((Position == End)||(*Position != index)){
+                continue;
+            }
+            std::copy(Position + 1, End, Position);
+            DEnds[List]--;
+            DUnused++;
+            if((DOffsets[List] == DEnds[List])&&(Key.find('\0') == std::string::npos)){
+                DKeyCount--;
+            }
+        }
+        CompactIfSparse();
+    }
+
+    //Copies the non empty lists back to back once more than half the postings are unused, dropping the empty ones
+    void CompactIfSparse(){
+        if(DUnused * 2 <= DPostings.size()){
+            return;
+        }
+        std::unordered_map<std::string, uint32_t> Lists;
+        std::vector<uint64_t> Offsets, Ends;
+        std::vector<uint32_t> Postings;
+        Postings.reserve(DPostings.size() - DUnused);
+        for(const auto &[Key, List] : DLists){
+            if(DOffsets[List] == DEnds[List]){
+                continue;
+            }
+            Lists[Key] = Offsets.size();
+            Offsets.push_back(Postings.size());
+            Postings.insert(Postings.end(), DPostings.begin() + DOffsets[List], DPostings.begin() + DEnds[List]);
+            Ends.push_back(Postings.size());
+        }
+        DLists = std::move(Lists);
+        DOffsets = std::move(Offsets);
+        DEnds = std::move(Ends);
+        DPostings = std::move(Postings);
+        DUnused = 0;
+    }
+
+    std::span<const uint32_t> Find(const std::string &key) const noexcept{
+        auto Search = DLists.find(key);
+        if(Search == DLists.end()){
+            return std::span<const uint32_t>();
+        }
+        return std::span<const uint32_t>(DPostings.data() + DOffsets[Search->second], End(Search->second) - DOffsets[Search->second]);
+    }
+};
+
+CTagIndex::CTagIndex() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CTagIndex::CTagIndex(CTagIndex &&index) noexcept : DImplementation(std::move(index.DImplementation)){
+    index.DImplementation = std::make_unique<SImplementation>();
+}
+
+CTagIndex &CTagIndex::operator=(CTagIndex &&index) noexcept{
+    std::swap(DImplementation, index.DImplementation);
+    return *this;
+}
+
+CTagIndex::~CTagIndex(){
+
+}
+
+//Replaces the contents with the tags of every node or way of map
+void CTagIndex::Build(const CStreetMap &map, EObjectType type){
+    DImplementation->Build(map, type);
+}
+
+//Adds object index with tags to the lists of its keys and key value pairs
+void CTagIndex::Add(uint32_t index, const TAttributes &tags){
+    DImplementation->Add(index, tags);
+}
+
+//Takes object index out of the lists of tags, which must be the tags it was added or built with
+void CTagIndex::Remove(uint32_t index, const TAttributes &tags){
+    DImplementation->Remove(index, tags);
+}
+
+//Number of distinct tag keys
+std::size_t CTagIndex::KeyCount() const noexcept{
+    return DImplementation->DKeyCount;
+}
+
+SMemoryUsage CTagIndex::MemoryUsage() const noexcept{
+    SMemoryUsage Usage;
+    Usage.Add(DImplementation->DLists);
+    for(const auto &List : DImplementation->DLists){
+        Usage.Add(List.first);
+    }
+    Usage.Add(DImplementation->DOffsets);
+    Usage.Add(DImplementation->DEnds);
+    Usage.Add(DImplementation->DPostings);
+    return Usage;
+}
+
+//Sorted indices of the objects with tag key, empty if none have it
+std::span<const uint32_t> CTagIndex::Find(const std::string &key) const noexcept{
+    if(key.find('\0') != std::string::npos){
+        return std::span<const uint32_t>();
+    }
+    return DImplementation->Find(key);
+}
+
+//Sorted indices of the objects whose tag key equals value
+std::span<const uint32_t> CTagIndex::Find(const std::string &key, const std::string &value) const noexcept{
+    if(key.find('\0') != std::string::npos){
+        return std::span<const uint32_t>();
+    }
+    return DImplementation->Find(SImplementation::PairKey(key, value));
+}
+
+//Sets result to the indices in both sorted lists, returns its size
+//Each element of the shorter list gallops through the longer one, so cost follows the shorter list
+std::size_t CTagIndex::Intersect(std::span<const uint32_t> left, std::span<const uint32_t> right, std::vector<uint32_t> &result){
+    result.clear();
+    if(left.size() > right.size()){
+        std::swap(left, right);
+    }
+    auto Position = right.begin();
+    for(auto Value : left){
+        //Double the step until past Value, then binary search the last step
+        std::size_t Step = 1;
+        auto Low = Position;
+        while((Low + Step < right.end())&&(*(Low + Step) < Value)){
+            Low += Step;
+            Step *= 2;
+        }
+        Position = std::lower_bound(Low, std::min(Low + Step + 1, right.end()), Value);
+        if(Position == right.end()){
+            break;
+        }
+        if(*Position == Value){
+            result.push_back(Value);
+        }
+    }
+    return result.size();
+}
+
+//Sets result to the indices in either sorted list, returns its size
+std::size_t CTagIndex::Union(std::span<const uint32_t> left, std::span<const uint32_t> right, std::vector<uint32_t> &result){
+    result.clear();
+    result.reserve(left.size() + right.size());
+    std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(result));
+    return result.size();
+}
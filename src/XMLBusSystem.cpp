@@ -1,4 +1,5 @@
 #include "XMLBusSystem.h"
+#include "IDIndex.h"
 #include <vector>
 #include <unordered_map>
 #include <iostream>
@@ -160,6 +161,10 @@ struct CXMLBusSystem::SImplementation{
     std::vector<std::shared_ptr<SStop> > DStopsByIndex;
     std::unordered_map<TStopID,std::shared_ptr<SStop> > DStopsByID;
 
+    // Batch lookups: flat open addressing index over stop IDs and each stop's node in index order
+    CIDIndex DStopIndex{CIDIndex::EType::OpenAddressing};
+    std::vector<CStreetMap::TNodeID> DStopNodeIDs;
+
     // Route storage: should be by index (fast iteration) and name (fast lookup)
     std::vector<std::shared_ptr<SRoute>> DRoutesByIndex;
     std::unordered_map<std::string, std::shared_ptr<SRoute>> DRoutesByName;
@@ -330,6 +335,22 @@ struct CXMLBusSystem::SImplementation{
     SImplementation(std::shared_ptr< CXMLReader > systemsource, std::shared_ptr< CXMLReader > pathsource){
         ParseBusSystem(systemsource);   // Parse stops and routes from bussystem.xml
         ParsePaths(pathsource);         // Parse paths from paths.xml
+        std::vector<TStopID> StopIDs;
+        for(const auto &Stop : DStopsByIndex){
+            StopIDs.push_back(Stop->ID());
+            DStopNodeIDs.push_back(Stop->NodeID());
+        }
+        DStopIndex.Build(StopIDs);
+    }
+
+    std::size_t StopNodeIDsByID(std::span<const TStopID> ids, std::vector<CStreetMap::TNodeID> &nodeids) const{
+        std::vector<std::size_t> Indices;
+        auto Found = DStopIndex.FindBatch(ids, Indices);
+        nodeids.resize(ids.size());
+        for(std::size_t Index = 0; Index < ids.size(); Index++){
+            nodeids[Index] = Indices[Index] != CIDIndex::InvalidIndex ? DStopNodeIDs[Indices[Index]] : CStreetMap::InvalidNodeID;
+        }
+        return Found;
     }
 
     // Returns total number of stops
@@ -387,7 +408,56 @@ struct CXMLBusSystem::SImplementation{
         }
         return nullptr;
     }
-    
+
+    // Stops, routes and paths are each one std::make_shared allocation
+    SMemoryReport MemoryUsage() const noexcept{
+        SMemoryReport Report;
+        SMemoryUsage All;
+        auto Charge = [&All](std::size_t &bytes, const SMemoryUsage &usage){
+            bytes += usage.DBytes;
+            All += usage;
+        };
+        SMemoryUsage Stops;
+        Stops.Add(DStopsByIndex);
+        for(const auto &Stop : DStopsByIndex){
+            Stops.AddShared(sizeof(SStop));
+            Stops.Add(Stop->DDescription);
+        }
+        Charge(Report.DStops, Stops);
+
+        SMemoryUsage StopIndexes;
+        StopIndexes.Add(DStopsByID);
+        StopIndexes.Add(DStopNodeIDs);
+        StopIndexes += DStopIndex.MemoryUsage();
+        Charge(Report.DStopIndexes, StopIndexes);
+
+        SMemoryUsage Routes;
+        Routes.Add(DRoutesByIndex);
+        Routes.Add(DRoutesByName);
+        for(const auto &Route : DRoutesByIndex){
+            Routes.AddShared(sizeof(SRoute));
+            Routes.Add(Route->DName);
+            Routes.Add(Route->DStopIDs);
+        }
+        for(const auto &Route : DRoutesByName){
+            Routes.Add(Route.first);
+        }
+        Charge(Report.DRoutes, Routes);
+
+        SMemoryUsage Paths;
+        Paths.Add(DPathsByStopIDs);
+        for(const auto &Destinations : DPathsByStopIDs){
+            Paths.Add(Destinations.second);
+            for(const auto &Path : Destinations.second){
+                Paths.AddShared(sizeof(SPath));
+                Paths.Add(Path.second->DNodeIDs);
+            }
+        }
+        Charge(Report.DPaths, Paths);
+
+        Report.DAllocatorOverhead = All.Overhead();
+        return Report;
+    }
 };
 
 CXMLBusSystem::CXMLBusSystem(std::shared_ptr< CXMLReader > systemsource, std::shared_ptr< CXMLReader > pathsource){
@@ -425,3 +495,17 @@ std::shared_ptr<CBusSystem::SRoute> CXMLBusSystem::RouteByName(const std::string
 std::shared_ptr<CBusSystem::SPath> CXMLBusSystem::PathByStopIDs(TStopID start, TStopID end) const noexcept{
     return DImplementation->PathByStopIDs(start, end);
 }
+
+std::size_t CXMLBusSystem::SMemoryReport::Total() const noexcept{
+    return DStops + DStopIndexes + DRoutes + DPaths + DAllocatorOverhead;
+}
+
+// Estimated heap use, see SMemoryUsage for how containers are charged
+CXMLBusSystem::SMemoryReport CXMLBusSystem::MemoryUsage() const noexcept{
+    return DImplementation->MemoryUsage();
+}
+
+// Batch lookup through a prefetching open addressing index over stop IDs
+std::size_t CXMLBusSystem::StopNodeIDsByID(std::span<const TStopID> ids, std::vector<CStreetMap::TNodeID> &nodeids) const{
+    return DImplementation->StopNodeIDsByID(ids, nodeids);
+}
@@ -0,0 +1,389 @@
+#include "XMLQuery.h"
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/*
+Implementation for CXMLQuery
+
+The expression is compiled into a list of steps. While streaming, each open
+element keeps a bit mask of which steps may still match below it, so memory
+only grows with the element depth and never with the document size.
+
+Supported grammar:
+    expression  := step+
+    step        := ('/' | '//') name predicate*
+    name        := element name or '*'
+    predicate   := '[' '@' attribute (operator literal)? ']'
+                 | '[' name ('[' '@' attribute (operator literal)? ']')* ']'
+    operator    := '=' | '!=' | '~='  (~= means "contains")
+    literal     := 'text' or "text"
+
+Child element predicates (e.g. [tag[@k='highway']]) are only allowed on the
+last step, since they can only be decided once the element closes. Matches
+still waiting on their children hold back the matches opened after them, so
+they are returned in document order.
+*/
+struct CXMLQuery::SImplementation{
+    // Most steps a query may have, one bit per step plus one for "all matched"
+    inline static constexpr std::size_t DMaxSteps = 63;
+
+    // Test on a single attribute of an element
+    struct SAttributeTest{
+        enum class EOperator{Exists, Equal, NotEqual, Contains};
+        std::string DName;
+        EOperator DOperator = EOperator::Exists;
+        std::string DValue;
+
+        bool Matches(const SXMLEntity &entity) const{
+            for(auto &Attribute : entity.DAttributes){
+                if(Attribute.first == DName){
+                    switch(DOperator){
+                        case EOperator::Exists:     return true;
+                        case EOperator::Equal:      return Attribute.second == DValue;
+                        case EOperator::NotEqual:   return Attribute.second != DValue;
+                        case EOperator::Contains:   return Attribute.second.find(DValue) != std::string::npos;
+                    }
+                }
+            }
+            // A missing attribute only satisfies !=
+            return DOperator == EOperator::NotEqual;
+        }
+    };
+
+    // Test that the element has a direct child with a name and attributes
+    struct SChildTest{
+        std::string DName;
+        std::vector<SAttributeTest> DAttributeTests;
+
+        bool Matches(const SXMLEntity &entity) const{
+            if((DName != "*")&&(entity.DNameData != DName)){
+                return false;
+            }
+            for(auto &Test : DAttributeTests){
+                if(!Test.Matches(entity)){
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    struct SStep{
+        bool DDescendant = false;
+        std::string DName;
+        std::vector<SAttributeTest> DAttributeTests;
+        std::vector<SChildTest> DChildTests;
+
+        bool Matches(const SXMLEntity &entity) const{
+            if((DName != "*")&&(entity.DNameData != DName)){
+                return false;
+            }
+            for(auto &Test : DAttributeTests){
+                if(!Test.Matches(entity)){
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // Element that matched every step, undecided until its children are seen
+    struct SMatch{
+        SXMLEntity DEntity;
+        bool DDecided;
+        bool DAccepted;
+    };
+
+    // Open element that matched every step but still waits on its children
+    struct SPendingMatch{
+        std::size_t DDepth;
+        std::size_t DMatchNumber;
+        uint64_t DSatisfied;
+    };
+
+    std::shared_ptr<CXMLReader> DSource;
+    std::vector<SStep> DSteps;
+    bool DValid;
+
+    // One state mask per open element, bottom entry is the document root
+    std::vector<uint64_t> DStateStack;
+    std::vector<SPendingMatch> DPending;
+    // Matches in document order, DFirstMatchNumber numbers the front one
+    std::deque<SMatch> DMatches;
+    std::size_t DFirstMatchNumber = 0;
+
+    SImplementation(std::shared_ptr<CXMLReader> src, const std::string &expression) : DSource(src){
+        DValid = ParseExpression(expression);
+        DStateStack.push_back(1);
+    }
+
+    // Expression parsing
+
+    static void SkipSpaces(const std::string &expr, std::size_t &pos){
+        while((pos < expr.size())&&std::isspace(static_cast<unsigned char>(expr[pos]))){
+            pos++;
+        }
+    }
+
+    static bool ParseName(const std::string &expr, std::size_t &pos, std::string &name){
+        SkipSpaces(expr,pos);
+        if((pos < expr.size())&&(expr[pos] == '*')){
+            name = "*";
+            pos++;
+            return true;
+        }
+        std::size_t Start = pos;
+        while(pos < expr.size()){
+            char Ch = expr[pos];
+            if(std::isalnum(static_cast<unsigned char>(Ch))||(Ch == '_')||(Ch == '-')||(Ch == ':')||(Ch == '.')){
+                pos++;
+            }
+            else{
+                break;
+            }
+        }
+        name = expr.substr(Start, pos - Start);
+        return !name.empty();
+    }
+
+    static bool ParseLiteral(const std::string &expr, std::size_t &pos, std::string &value){
+        SkipSpaces(expr,pos);
+        if((pos >= expr.size())||((expr[pos] != '\'')&&(expr[pos] != '"'))){
+            return false;
+        }
+        char Quote = expr[pos++];
+        auto End = expr.find(Quote, pos);
+        if(End == std::string::npos){
+            return false;
+        }
+        value = expr.substr(pos, End - pos);
+        pos = End + 1;
+        return true;
+    }
+
+    // Parses "@name", "@name='v'", "@name!='v'" or "@name~='v'" (without brackets)
+    static bool ParseAttributeTest(const std::string &expr, std::size_t &pos, SAttributeTest &test){
+        SkipSpaces(expr,pos);
+        if((pos >= expr.size())||(expr[pos] != '@')){
+            return false;
+        }
+        pos++;
+        if(!ParseName(expr,pos,test.DName)||(test.DName == "*")){
+            return false;
+        }
+        SkipSpaces(expr,pos);
+        if(expr.compare(pos,1,"=") == 0){
+            test.DOperator = SAttributeTest::EOperator::Equal;
+            pos += 1;
+        }
+        else if(expr.compare(pos,2,"!=") == 0){
+            test.DOperator = SAttributeTest::EOperator::NotEqual;
+            pos += 2;
+        }
+        else if(expr.compare(pos,2,"~=") == 0){
+            test.DOperator = SAttributeTest::EOperator::Contains;
+            pos += 2;
+        }
+        else{
+            test.DOperator = SAttributeTest::EOperator::Exists;
+            return true;
+        }
+        return ParseLiteral(expr,pos,test.DValue);
+    }
+
+    static bool ExpectChar(const std::string &expr, std::size_t &pos, char ch){
+        SkipSpaces(expr,pos);
+        if((pos < expr.size())&&(expr[pos] == ch)){
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    static bool ParsePredicate(const std::string &expr, std::size_t &pos, SStep &step){
+        if(!ExpectChar(expr,pos,'[')){
+            return false;
+        }
+        SkipSpaces(expr,pos);
+        if((pos < expr.size())&&(expr[pos] == '@')){
+            SAttributeTest Test;
+            if(!ParseAttributeTest(expr,pos,Test)){
+                return false;
+            }
+            step.DAttributeTests.push_back(Test);
+        }
+        else{
+            SChildTest Child;
+            if(!ParseName(expr,pos,Child.DName)){
+                return false;
+            }
+            SkipSpaces(expr,pos);
+            while((pos < expr.size())&&(expr[pos] == '[')){
+                pos++;
+                SAttributeTest Test;
+                if(!ParseAttributeTest(expr,pos,Test)||!ExpectChar(expr,pos,']')){
+                    return false;
+                }
+                Child.DAttributeTests.push_back(Test);
+                SkipSpaces(expr,pos);
+            }
+            step.DChildTests.push_back(Child);
+        }
+        return ExpectChar(expr,pos,']');
+    }
+
+    bool ParseExpression(const std::string &expr){
+        std::size_t Pos = 0;
+        SkipSpaces(expr,Pos);
+        while(Pos < expr.size()){
+            if(expr[Pos] != '/'){
+                return false;
+            }
+            SStep Step;
+            Step.DDescendant = expr.compare(Pos,2,"//") == 0;
+            Pos += Step.DDescendant ? 2 : 1;
+            if(!ParseName(expr,Pos,Step.DName)){
+                return false;
+            }
+            SkipSpaces(expr,Pos);
+            while((Pos < expr.size())&&(expr[Pos] == '[')){
+                if(!ParsePredicate(expr,Pos,Step)){
+                    return false;
+                }
+                SkipSpaces(expr,Pos);
+            }
+            DSteps.push_back(Step);
+        }
+        if(DSteps.empty()||(DSteps.size() > DMaxSteps)){
+            return false;
+        }
+        // Child predicates can only be resolved on the final step
+        for(std::size_t Index = 0; Index + 1 < DSteps.size(); Index++){
+            if(!DSteps[Index].DChildTests.empty()){
+                return false;
+            }
+        }
+        return DSteps.back().DChildTests.size() < 64;
+    }
+
+    // Streaming state machine
+
+    void ProcessStart(const SXMLEntity &entity){
+        std::size_t Depth = DStateStack.size();
+        // New element may be a direct child of the innermost pending match
+        if(!DPending.empty()&&(DPending.back().DDepth + 1 == Depth)){
+            auto &Pending = DPending.back();
+            auto &ChildTests = DSteps.back().DChildTests;
+            for(std::size_t Index = 0; Index < ChildTests.size(); Index++){
+                if(ChildTests[Index].Matches(entity)){
+                    Pending.DSatisfied |= uint64_t(1) << Index;
+                }
+            }
+        }
+
+        uint64_t Parent = DStateStack.back();
+        uint64_t State = 0;
+        if(Parent){
+            for(std::size_t Index = 0; Index < DSteps.size(); Index++){
+                if(Parent & (uint64_t(1) << Index)){
+                    if(DSteps[Index].DDescendant){
+                        State |= uint64_t(1) << Index;
+                    }
+                    if(DSteps[Index].Matches(entity)){
+                        State |= uint64_t(1) << (Index + 1);
+                    }
+                }
+            }
+        }
+        DStateStack.push_back(State);
+
+        if(State & (uint64_t(1) << DSteps.size())){
+            if(DSteps.back().DChildTests.empty()){
+                DMatches.push_back(SMatch{entity, true, true});
+            }
+            else{
+                DPending.push_back(SPendingMatch{Depth, DFirstMatchNumber + DMatches.size(), 0});
+                DMatches.push_back(SMatch{entity, false, false});
+            }
+        }
+    }
+
+    void ProcessEnd(){
+        std::size_t Depth = DStateStack.size() - 1;
+        if(!DPending.empty()&&(DPending.back().DDepth == Depth)){
+            auto ChildCount = DSteps.back().DChildTests.size();
+            uint64_t AllSatisfied = (uint64_t(1) << ChildCount) - 1;
+            auto &Match = DMatches[DPending.back().DMatchNumber - DFirstMatchNumber];
+            Match.DDecided = true;
+            Match.DAccepted = DPending.back().DSatisfied == AllSatisfied;
+            DPending.pop_back();
+            DropRejected();
+        }
+        if(DStateStack.size() > 1){
+            DStateStack.pop_back();
+        }
+    }
+
+    void DropRejected(){
+        while(!DMatches.empty()&&DMatches.front().DDecided&&!DMatches.front().DAccepted){
+            DMatches.pop_front();
+            DFirstMatchNumber++;
+        }
+    }
+
+    bool MatchReady() const{
+        return !DMatches.empty()&&DMatches.front().DDecided;
+    }
+
+    bool ReadMatch(SXMLEntity &entity){
+        if(!DValid){
+            return false;
+        }
+        SXMLEntity TempEntity;
+        while(!MatchReady()){
+            if(!DSource->ReadEntity(TempEntity,true)){
+                return false;
+            }
+            if(TempEntity.DType == SXMLEntity::EType::StartElement){
+                ProcessStart(TempEntity);
+            }
+            else if(TempEntity.DType == SXMLEntity::EType::EndElement){
+                ProcessEnd();
+            }
+            else if(TempEntity.DType == SXMLEntity::EType::CompleteElement){
+                ProcessStart(TempEntity);
+                ProcessEnd();
+            }
+        }
+        entity = std::move(DMatches.front().DEntity);
+        DMatches.pop_front();
+        DFirstMatchNumber++;
+        DropRejected();
+        return true;
+    }
+};
+
+CXMLQuery::CXMLQuery(std::shared_ptr< CXMLReader > src, const std::string &expression){
+    DImplementation = std::make_unique<SImplementation>(src, expression);
+}
+
+CXMLQuery::~CXMLQuery(){
+
+}
+
+// Returns false if the expression could not be compiled
+bool CXMLQuery::Valid() const noexcept{
+    return DImplementation->DValid;
+}
+
+// Returns true once the source is consumed and all matches have been read
+bool CXMLQuery::End() const{
+    return !DImplementation->MatchReady() && DImplementation->DSource->End();
+}
+
+// Reads the next matching element (its start tag and attributes)
+bool CXMLQuery::ReadMatch(SXMLEntity &entity){
+    return DImplementation->ReadMatch(entity);
+}
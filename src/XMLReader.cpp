@@ -171,61 +171,66 @@ skipcdata: If true, it will skip CharData entities and return on the opening and
 returns: true if an entity was successfully read, false if no more entities or error
 */
 bool CXMLReader::ReadEntity(SXMLEntity &entity, bool skipcdata){
-    // Parse more data if queue is both empty and not at the end of the document
-    while (DImplementation->DEntityQueue.empty() && !DImplementation->DEnd)
-    {
-        // Create buffer to read data from the source (to feed expat)
-        const int bufferSize = 512;
-        std::vector<char> buffer;
+    // Keep parsing until a usable entity is found, a chunk may hold nothing but skipped CharData
+    while(true){
+        // Parse more data if queue is both empty and not at the end of the document
+        while (DImplementation->DEntityQueue.empty() && !DImplementation->DEnd)
+        {
+            // Create buffer to read data from the source (to feed expat)
+            const int bufferSize = 512;
+            std::vector<char> buffer;
 
-      /* Inside of the XML_Parse function of the Expat Library, it calls conditionals to call StartElement, or EndElement, or
-     CharacterData callbacks depending on the *data passed into it. */
+          /* Inside of the XML_Parse function of the Expat Library, it calls conditionals to call StartElement, or EndElement, or
+         CharacterData callbacks depending on the *data passed into it. */
 
-        // Read from data source into the buffer
-        if(!DImplementation->DSource->Read(buffer, bufferSize)){
+            // Read from data source into the buffer
+            if(!DImplementation->DSource->Read(buffer, bufferSize)){
 
-            // If no more data is avaliable, flag the end of parsing to true
-            DImplementation->DEnd = true; 
+                // If no more data is avaliable, flag the end of parsing to true
+                DImplementation->DEnd = true; 
 
-            // Sets the isFinal flag to true to signal successful parsing and end of file.
-            XML_Parse(DImplementation->DParser, "", 0, XML_TRUE);
+                // Sets the isFinal flag to true to signal successful parsing and end of file.
+                XML_Parse(DImplementation->DParser, "", 0, XML_TRUE);
 
-            // Leave the loop and continue to the DEntityQueue popper
-            break; 
+                // Leave the loop and continue to the DEntityQueue popper
+                break; 
 
-        }
+            }
         
-        /*
-        The last function should've read everything into the buffer, now we feed it into Expat 
-        to parse AND CHECK IF THERE'S AN ERROR kills program cleanly if theres an error while
-        also parsing at the same time (feed buffer to Expat parser and check for errors)
-        */ 
-        if(XML_Parse(DImplementation->DParser, buffer.data(), buffer.size(), XML_FALSE) == XML_STATUS_ERROR) {
-            DImplementation->DEnd = true;
-            return false; 
+            /*
+            The last function should've read everything into the buffer, now we feed it into Expat 
+            to parse AND CHECK IF THERE'S AN ERROR kills program cleanly if theres an error while
+            also parsing at the same time (feed buffer to Expat parser and check for errors)
+            */ 
+            if(XML_Parse(DImplementation->DParser, buffer.data(), buffer.size(), XML_FALSE) == XML_STATUS_ERROR) {
+                DImplementation->DEnd = true;
+                return false; 
+            }
         }
-    }
-
-    /*
-    Have entity in queue(Not empty) -> pop them
-    If skip data is true, read until non-CharData entity
 
-    Pop entities from the queue
-    */
-    while (!DImplementation->DEntityQueue.empty())
-    {   // Get first entity from queue
-        entity = DImplementation->DEntityQueue.front();
-
-        // After getting it -> remove it from the queue
-        DImplementation->DEntityQueue.pop();
+        /*
+        Have entity in queue(Not empty) -> pop them
+        If skip data is true, read until non-CharData entity
+
+        Pop entities from the queue
+        */
+        while (!DImplementation->DEntityQueue.empty())
+        {   // Get first entity from queue
+            entity = DImplementation->DEntityQueue.front();
+
+            // After getting it -> remove it from the queue
+            DImplementation->DEntityQueue.pop();
+
+            // Skip character data entities if skipcdata is true
+            if(skipcdata && entity.DType == SXMLEntity::EType::CharData){
+                continue;
+            }
+            return true;
+        }
 
-        // Skip character data entities if skipcdata is true
-        if(skipcdata && entity.DType == SXMLEntity::EType::CharData){
-            continue;
+        // No more entities to read
+        if(DImplementation->DEnd){
+            return false;
         }
-        return true;
     }
-
-    // No more entities to read
-    return false;   
 }
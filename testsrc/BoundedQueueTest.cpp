@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "BoundedQueue.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(BoundedQueueTest, SingleThreadTest){
+    CBoundedQueue<int> Queue(5);
+    EXPECT_EQ(Queue.Capacity(), 8);
+    int Value = 0;
+    EXPECT_FALSE(Queue.TryPop(Value));
+    for(int Index = 0; Index < 8; Index++){
+        Value = Index;
+        EXPECT_TRUE(Queue.TryPush(Value));
+    }
+    Value = 8;
+    EXPECT_FALSE(Queue.TryPush(Value));
+    EXPECT_EQ(Value, 8);
+    for(int Index = 0; Index < 8; Index++){
+        EXPECT_TRUE(Queue.TryPop(Value));
+        EXPECT_EQ(Value, Index);
+    }
+    EXPECT_FALSE(Queue.TryPop(Value));
+    //Positions keep counting past the capacity
+    for(int Round = 0; Round < 20; Round++){
+        Queue.Push(Round);
+        Queue.Pop(Value);
+        EXPECT_EQ(Value, Round);
+    }
+}
+
+TEST(BoundedQueueTest, MoveOnlyTest){
+    CBoundedQueue<std::unique_ptr<int>> Queue(2);
+    auto Value = std::make_unique<int>(7);
+    EXPECT_TRUE(Queue.TryPush(Value));
+    EXPECT_EQ(Value, nullptr);
+    Queue.Push(nullptr);
+    auto Full = std::make_unique<int>(9);
+    EXPECT_FALSE(Queue.TryPush(Full));
+    ASSERT_NE(Full, nullptr);
+    std::unique_ptr<int> Result;
+    Queue.Pop(Result);
+    ASSERT_NE(Result, nullptr);
+    EXPECT_EQ(*Result, 7);
+    Queue.Pop(Result);
+    EXPECT_EQ(Result, nullptr);
+}
+
+TEST(BoundedQueueTest, CancelTest){
+    CBoundedQueue<int> Queue(2);
+    std::atomic<bool> Cancel{false};
+    int Value = 0;
+    EXPECT_TRUE(Queue.Push(1, Cancel));
+    EXPECT_TRUE(Queue.Push(2, Cancel));
+    //A blocked consumer and producer both return once cancel is set
+    CBoundedQueue<int> Empty(2);
+    bool Popped = true, Pushed = true;
+    std::thread Consumer([&]{ Popped = Empty.Pop(Value, Cancel); });
+    std::thread Producer([&]{ Pushed = Queue.Push(3, Cancel); });
+    Cancel = true;
+    Consumer.join();
+    Producer.join();
+    EXPECT_FALSE(Popped);
+    EXPECT_FALSE(Pushed);
+    //Values already queued can still be taken
+    EXPECT_TRUE(Queue.Pop(Value, Cancel));
+    EXPECT_EQ(Value, 1);
+}
+
+TEST(BoundedQueueTest, ManyThreadsTest){
+    //Every pushed value must be popped exactly once, and each producer's values in order
+    const int Producers = 4, Consumers = 4, PerProducer = 20000;
+    CBoundedQueue<int> Queue(16);
+    std::vector<std::vector<int>> Popped(Consumers);
+    std::vector<std::thread> Threads;
+    for(int Producer = 0; Producer < Producers; Producer++){
+        Threads.emplace_back([&, Producer]{
+            for(int Index = 0; Index < PerProducer; Index++){
+                Queue.Push(Producer * PerProducer + Index);
+            }
+        });
+    }
+    for(int Consumer = 0; Consumer < Consumers; Consumer++){
+        Threads.emplace_back([&, Consumer]{
+            int Value;
+            for(int Index = 0; Index < Producers * PerProducer / Consumers; Index++){
+                Queue.Pop(Value);
+                Popped[Consumer].push_back(Value);
+            }
+        });
+    }
+    for(auto &Thread : Threads){
+        Thread.join();
+    }
+    std::vector<int> Seen(Producers * PerProducer, 0);
+    for(const auto &Values : Popped){
+        std::vector<int> Last(Producers, -1);
+        for(auto Value : Values){
+            Seen[Value]++;
+            EXPECT_GT(Value, Last[Value / PerProducer]);
+            Last[Value / PerProducer] = Value;
+        }
+    }
+    for(auto Count : Seen){
+        ASSERT_EQ(Count, 1);
+    }
+}
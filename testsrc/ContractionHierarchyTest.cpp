@@ -0,0 +1,324 @@
+#include <gtest/gtest.h>
+#include "ContractionHierarchy.h"
+#include "RoadRouter.h"
+#include "RoadTestSupport.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include <algorithm>
+#include <cstring>
+
+static std::string Serialized(const CContractionHierarchy &hierarchy){
+    auto Sink = std::make_shared<CStringDataSink>();
+    EXPECT_TRUE(hierarchy.Save(Sink));
+    return Sink->String();
+}
+
+TEST(ContractionHierarchyTest, SimpleTest){
+    auto Graph = RoadTestGraph(SmallRoadTestOSM);
+    CContractionHierarchy Hierarchy;
+    EXPECT_EQ(Hierarchy.VertexCount(), 0);
+    EXPECT_EQ(Hierarchy.Distance(1, 2), CContractionHierarchy::NoPathExists);
+    Hierarchy.Build(*Graph);
+    EXPECT_EQ(Hierarchy.VertexCount(), Graph->VertexCount());
+    std::vector<bool> Ranked(Hierarchy.VertexCount(), false);
+    for(CContractionHierarchy::TVertex Vertex = 0; Vertex < Hierarchy.VertexCount(); Vertex++){
+        EXPECT_EQ(Hierarchy.NodeID(Vertex), Graph->NodeID(Vertex));
+        EXPECT_EQ(Hierarchy.VertexByNodeID(Graph->NodeID(Vertex)), Vertex);
+        ASSERT_LT(Hierarchy.Rank(Vertex), Hierarchy.VertexCount());
+        EXPECT_FALSE(Ranked[Hierarchy.Rank(Vertex)]);
+        Ranked[Hierarchy.Rank(Vertex)] = true;
+    }
+    EXPECT_EQ(Hierarchy.Rank(Hierarchy.VertexCount()), CContractionHierarchy::InvalidVertex);
+    EXPECT_EQ(Hierarchy.NodeID(Hierarchy.VertexCount()), CStreetMap::InvalidNodeID);
+    EXPECT_EQ(Hierarchy.VertexByNodeID(99), CContractionHierarchy::InvalidVertex);
+
+    CRoadRouter Router(Graph);
+    std::vector<CStreetMap::TNodeID> Path, RouterPath;
+    for(CStreetMap::TNodeID Source = 1; Source <= 6; Source++){
+        for(CStreetMap::TNodeID Target = 1; Target <= 6; Target++){
+            auto Expected = Router.FindShortestPath(Source, Target, RouterPath, CRoadRouter::EAlgorithm::Dijkstra);
+            EXPECT_DOUBLE_EQ(Hierarchy.Distance(Source, Target), Expected);
+            EXPECT_DOUBLE_EQ(Hierarchy.FindShortestPath(Source, Target, Path), Expected);
+            if(Expected == CRoadRouter::NoPathExists){
+                EXPECT_TRUE(Path.empty());
+            }
+            else{
+                EXPECT_EQ(Path.front(), Source);
+                EXPECT_EQ(Path.back(), Target);
+                EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6);
+            }
+        }
+    }
+    // 1-4-3 is oneway so the way back goes round by 2, and nothing leads to 6
+    Hierarchy.FindShortestPath(5, 1, Path);
+    EXPECT_EQ(Path, std::vector<CStreetMap::TNodeID>({5, 4, 3, 2, 1}));
+    EXPECT_EQ(Hierarchy.FindShortestPath(1, 6, Path), CContractionHierarchy::NoPathExists);
+    EXPECT_EQ(Hierarchy.FindShortestPath(4, 4, Path), 0.0);
+    EXPECT_EQ(Path, std::vector<CStreetMap::TNodeID>({4}));
+    EXPECT_EQ(Hierarchy.FindShortestPath(99, 4, Path), CContractionHierarchy::NoPathExists);
+    EXPECT_TRUE(Path.empty());
+}
+
+TEST(ContractionHierarchyTest, GridTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CContractionHierarchy Hierarchy;
+    Hierarchy.Build(*Graph);
+    EXPECT_GT(Hierarchy.ShortcutCount(), 0);
+    EXPECT_GE(Hierarchy.ArcCount(), Graph->EdgeCount());
+    EXPECT_GT(Hierarchy.MemoryUsage().DBytes, 0);
+
+    CRoadRouter Router(Graph);
+    CRoadRouter::SWorkspace RouterWorkspace;
+    CContractionHierarchy::SWorkspace Workspace;
+    std::vector<CStreetMap::TNodeID> Path, RouterPath;
+    std::size_t DijkstraSettled = 0, HierarchySettled = 0;
+    uint32_t Seed = 12345;
+    for(int Query = 0; Query < 300; Query++){
+        Seed = Seed * 1103515245 + 12345;
+        auto Source = Graph->NodeID((Seed >> 8) % Graph->VertexCount());
+        Seed = Seed * 1103515245 + 12345;
+        auto Target = Graph->NodeID((Seed >> 8) % Graph->VertexCount());
+        auto Expected = Router.FindShortestPath(RouterWorkspace, Source, Target, RouterPath, CRoadRouter::EAlgorithm::Dijkstra);
+        DijkstraSettled += RouterWorkspace.SettledCount();
+        ASSERT_NE(Expected, CRoadRouter::NoPathExists);
+        EXPECT_NEAR(Hierarchy.Distance(Workspace, Source, Target), Expected, 1e-6);
+        EXPECT_NEAR(Hierarchy.FindShortestPath(Workspace, Source, Target, Path), Expected, 1e-6);
+        HierarchySettled += Workspace.SettledCount();
+        EXPECT_EQ(Path.front(), Source);
+        EXPECT_EQ(Path.back(), Target);
+        EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6);
+    }
+    EXPECT_LT(HierarchySettled * 4, DijkstraSettled);
+}
+
+//Random streets over a few spots, with several nodes on each spot so many edges have zero length and many paths tie
+static std::string CoincidentTestOSM(uint32_t seed){
+    const int Spots = 6, Nodes = 16;
+    auto Next = [&seed](uint32_t bound){
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) % bound;
+    };
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    for(int Node = 0; Node < Nodes; Node++){
+        auto Spot = Next(Spots);
+        OSM += "   <node id=\"" + std::to_string(Node + 1) + "\" lat=\"" + std::to_string(38.5 + (Spot / 3) * 0.001) + "\" lon=\"" + std::to_string(-121.7 + (Spot % 3) * 0.001) + "\"/>\n";
+    }
+    for(int Way = 0; Way < 14; Way++){
+        OSM += "   <way id=\"" + std::to_string(Way + 100) + "\">\n";
+        for(uint32_t Step = 0, Length = 2 + Next(3); Step < Length; Step++){
+            OSM += "       <nd ref=\"" + std::to_string(Next(Nodes) + 1) + "\"/>\n";
+        }
+        OSM += "       <tag k=\"highway\" v=\"residential\"/>\n";
+        if(Next(3) == 0){
+            OSM += "       <tag k=\"oneway\" v=\"yes\"/>\n";
+        }
+        OSM += "   </way>\n";
+    }
+    OSM += "</osm>";
+    return OSM;
+}
+
+TEST(ContractionHierarchyTest, CoincidentNodeTest){
+    std::vector<CStreetMap::TNodeID> Path, RouterPath;
+    for(uint32_t Seed = 1; Seed <= 60; Seed++){
+        auto Graph = RoadTestGraph(CoincidentTestOSM(Seed));
+        CRoadRouter Router(Graph);
+        for(std::size_t Threads : {1, 4}){
+            CContractionHierarchy::SOptions Options;
+            Options.DThreadCount = Threads;
+            CContractionHierarchy Hierarchy;
+            Hierarchy.Build(*Graph, Options);
+            for(CRoadGraph::TVertex Source = 0; Source < Graph->VertexCount(); Source++){
+                for(CRoadGraph::TVertex Target = 0; Target < Graph->VertexCount(); Target++){
+                    auto Expected = Router.FindShortestPath(Graph->NodeID(Source), Graph->NodeID(Target), RouterPath, CRoadRouter::EAlgorithm::Dijkstra);
+                    auto Actual = Hierarchy.FindShortestPath(Graph->NodeID(Source), Graph->NodeID(Target), Path);
+                    if(Expected == CRoadRouter::NoPathExists){
+                        EXPECT_EQ(Actual, CContractionHierarchy::NoPathExists) << "seed " << Seed;
+                    }
+                    else{
+                        EXPECT_NEAR(Actual, Expected, 1e-6) << "seed " << Seed;
+                        EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6) << "seed " << Seed;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(ContractionHierarchyTest, ParallelBuildTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CContractionHierarchy::SOptions Options;
+    Options.DThreadCount = 1;
+    CContractionHierarchy Serial;
+    Serial.Build(*Graph, Options);
+    auto Expected = Serialized(Serial);
+    for(std::size_t Threads : {2, 3, 8}){
+        Options.DThreadCount = Threads;
+        CContractionHierarchy Parallel;
+        Parallel.Build(*Graph, Options);
+        EXPECT_EQ(Serialized(Parallel), Expected);
+    }
+
+    // A tiny witness search keeps more shortcuts but finds the same distances
+    Options.DWitnessSettleLimit = 1;
+    CContractionHierarchy Limited;
+    Limited.Build(*Graph, Options);
+    EXPECT_GE(Limited.ShortcutCount(), Serial.ShortcutCount());
+    for(CContractionHierarchy::TVertex Target = 0; Target < Graph->VertexCount(); Target += 13){
+        EXPECT_NEAR(Limited.Distance(Graph->NodeID(5), Graph->NodeID(Target)), Serial.Distance(Graph->NodeID(5), Graph->NodeID(Target)), 1e-6);
+    }
+}
+
+TEST(ContractionHierarchyTest, SearchSpaceTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CContractionHierarchy Hierarchy;
+    Hierarchy.Build(*Graph);
+    CContractionHierarchy::SWorkspace Workspace;
+    std::vector<CContractionHierarchy::SSearchEntry> Forward, Backward;
+    EXPECT_EQ(Hierarchy.SearchSpace(Workspace, 99999, CContractionHierarchy::EDirection::Forward, Forward), 0);
+    EXPECT_TRUE(Forward.empty());
+
+    // The best meeting vertex of a forward and a backward search space gives the distance
+    std::vector<double> BackwardDistance(Hierarchy.VertexCount(), CContractionHierarchy::NoPathExists);
+    for(CContractionHierarchy::TVertex Source = 0; Source < Graph->VertexCount(); Source += 37){
+        for(CContractionHierarchy::TVertex Target = 0; Target < Graph->VertexCount(); Target += 23){
+            auto Count = Hierarchy.SearchSpace(Workspace, Graph->NodeID(Source), CContractionHierarchy::EDirection::Forward, Forward);
+            EXPECT_EQ(Count, Forward.size());
+            Hierarchy.SearchSpace(Workspace, Graph->NodeID(Target), CContractionHierarchy::EDirection::Backward, Backward);
+            ASSERT_FALSE(Forward.empty());
+            EXPECT_EQ(Forward.front().DVertex, Source);
+            EXPECT_EQ(Forward.front().DDistance, 0.0);
+            for(auto &Entry : Backward){
+                BackwardDistance[Entry.DVertex] = Entry.DDistance;
+            }
+            double Best = CContractionHierarchy::NoPathExists;
+            for(auto &Entry : Forward){
+                EXPECT_GE(Hierarchy.Rank(Entry.DVertex), Hierarchy.Rank(Source));
+                if(BackwardDistance[Entry.DVertex] != CContractionHierarchy::NoPathExists){
+                    Best = std::min(Best, Entry.DDistance + BackwardDistance[Entry.DVertex]);
+                }
+            }
+            for(auto &Entry : Backward){
+                BackwardDistance[Entry.DVertex] = CContractionHierarchy::NoPathExists;
+            }
+            EXPECT_NEAR(Best, Hierarchy.Distance(Graph->NodeID(Source), Graph->NodeID(Target)), 1e-6);
+        }
+    }
+}
+
+TEST(ContractionHierarchyTest, ContractedGraphTest){
+    auto Graph = RoadTestGraph(GridTestOSM(3));
+    CRoadGraph Contracted;
+    Contracted.BuildContracted(*Graph);
+    CContractionHierarchy Hierarchy;
+    Hierarchy.Build(Contracted);
+    ASSERT_LT(Contracted.VertexCount(), Graph->VertexCount());
+    EXPECT_EQ(Hierarchy.VertexCount(), Contracted.VertexCount());
+
+    // Paths between kept vertices come back with the nodes of the contracted edges
+    CRoadRouter Router(Graph);
+    std::vector<CStreetMap::TNodeID> Path, RouterPath;
+    bool Unpacked = false;
+    for(CRoadGraph::TVertex Source = 0; Source < Contracted.VertexCount(); Source += 11){
+        for(CRoadGraph::TVertex Target = 0; Target < Contracted.VertexCount(); Target += 7){
+            auto Expected = Router.FindShortestPath(Contracted.NodeID(Source), Contracted.NodeID(Target), RouterPath);
+            EXPECT_NEAR(Hierarchy.FindShortestPath(Contracted.NodeID(Source), Contracted.NodeID(Target), Path), Expected, 1e-6);
+            EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6);
+            Unpacked |= std::any_of(Path.begin(), Path.end(), [&](CStreetMap::TNodeID id){ return Contracted.VertexByNodeID(id) == CRoadGraph::InvalidVertex; });
+        }
+    }
+    EXPECT_TRUE(Unpacked);
+
+    // Nodes inside contracted edges are not vertices, so routes cannot start or end there
+    CStreetMap::TNodeID Inside = CStreetMap::InvalidNodeID;
+    for(CRoadGraph::TVertex Vertex = 0; Vertex < Graph->VertexCount(); Vertex++){
+        if(Contracted.VertexByNodeID(Graph->NodeID(Vertex)) == CRoadGraph::InvalidVertex){
+            Inside = Graph->NodeID(Vertex);
+            break;
+        }
+    }
+    ASSERT_NE(Inside, CStreetMap::InvalidNodeID);
+    EXPECT_EQ(Hierarchy.VertexByNodeID(Inside), CContractionHierarchy::InvalidVertex);
+    EXPECT_EQ(Hierarchy.Distance(Inside, Contracted.NodeID(0)), CContractionHierarchy::NoPathExists);
+    auto ContractedGraph = std::make_shared<CRoadGraph>();
+    ContractedGraph->BuildContracted(*Graph);
+    EXPECT_EQ(CRoadRouter(ContractedGraph).FindShortestPath(Contracted.NodeID(0), Inside, Path), CRoadRouter::NoPathExists);
+    // Unless they are kept, when they route like on the full graph
+    std::vector<CStreetMap::TNodeID> Keep{Inside, CStreetMap::InvalidNodeID};
+    ContractedGraph->BuildContracted(*Graph, Keep);
+    EXPECT_EQ(ContractedGraph->VertexCount(), Contracted.VertexCount() + 1);
+    CContractionHierarchy KeptHierarchy;
+    KeptHierarchy.Build(*ContractedGraph);
+    for(CRoadGraph::TVertex Target = 0; Target < Contracted.VertexCount(); Target += 5){
+        auto Expected = Router.FindShortestPath(Inside, Contracted.NodeID(Target), RouterPath);
+        EXPECT_NEAR(KeptHierarchy.FindShortestPath(Inside, Contracted.NodeID(Target), Path), Expected, 1e-6);
+        EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6);
+        EXPECT_NEAR(CRoadRouter(ContractedGraph).FindShortestPath(Contracted.NodeID(Target), Inside, Path), Router.FindShortestPath(Contracted.NodeID(Target), Inside, RouterPath), 1e-6);
+    }
+
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Hierarchy.Save(Sink));
+    CContractionHierarchy Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String())));
+    std::vector<CStreetMap::TNodeID> LoadedPath;
+    auto Source = Contracted.NodeID(3), Target = Contracted.NodeID(Contracted.VertexCount() - 2);
+    EXPECT_EQ(Loaded.FindShortestPath(Source, Target, LoadedPath), Hierarchy.FindShortestPath(Source, Target, Path));
+    EXPECT_EQ(LoadedPath, Path);
+}
+
+TEST(ContractionHierarchyTest, SaveLoadTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CContractionHierarchy Hierarchy;
+    Hierarchy.Build(*Graph);
+    auto Data = Serialized(Hierarchy);
+
+    CContractionHierarchy Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Data)));
+    EXPECT_EQ(Serialized(Loaded), Data);
+    EXPECT_EQ(Loaded.ShortcutCount(), Hierarchy.ShortcutCount());
+    EXPECT_EQ(Loaded.VertexByNodeID(Graph->NodeID(17)), 17);
+    std::vector<CStreetMap::TNodeID> Path, LoadedPath;
+    for(CContractionHierarchy::TVertex Target = 0; Target < Graph->VertexCount(); Target += 9){
+        EXPECT_EQ(Loaded.FindShortestPath(Graph->NodeID(40), Graph->NodeID(Target), LoadedPath), Hierarchy.FindShortestPath(Graph->NodeID(40), Graph->NodeID(Target), Path));
+        EXPECT_EQ(LoadedPath, Path);
+    }
+
+    // Moving keeps the contents and leaves an empty hierarchy behind
+    CContractionHierarchy Moved(std::move(Loaded));
+    EXPECT_EQ(Loaded.VertexCount(), 0);
+    EXPECT_EQ(Serialized(Moved), Data);
+}
+
+TEST(ContractionHierarchyTest, ErrorTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CContractionHierarchy Hierarchy;
+    Hierarchy.Build(*Graph);
+    auto Data = Serialized(Hierarchy);
+
+    CContractionHierarchy Loaded;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>("")));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Data.substr(0, Data.size() - 1))));
+    auto BadMagic = Data;
+    BadMagic[0] = 'X';
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadMagic)));
+    auto BadVersion = Data;
+    BadVersion[8] = 9;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadVersion)));
+    // Two vertices with the same rank, the ranks follow the header and node IDs
+    auto BadRank = Data;
+    auto RanksAt = 8 + 4 + 56 + Graph->VertexCount() * 8;
+    std::copy_n(BadRank.begin() + RanksAt, 4, BadRank.begin() + RanksAt + 4);
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadRank)));
+    // The last shortcut standing for an arc that does not exist yet, it ends the data when there are no shapes
+    auto BadShortcut = Data;
+    std::fill(BadShortcut.end() - 4, BadShortcut.end(), char(0x7F));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadShortcut)));
+    // A vertex count far larger than the data fails instead of allocating every column
+    auto HugeCount = Data;
+    uint64_t VertexCount = 0xFFFFFF00;
+    std::memcpy(HugeCount.data() + 12, &VertexCount, sizeof(VertexCount));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(HugeCount)));
+    // Failed loads leave the hierarchy alone
+    EXPECT_EQ(Loaded.VertexCount(), 0);
+    EXPECT_EQ(Loaded.Distance(1, 2), CContractionHierarchy::NoPathExists);
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include "DistanceMatrix.h"
+#include "XMLBusSystem.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include <cstring>
+
+//Grid of streets with every third row oneway, plus node 500 on a oneway street that leads out of the grid and never back
+static std::string MatrixTestOSM(){
+    const int Size = 8;
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    for(int Node = 0; Node < Size * Size; Node++){
+        OSM += "   <node id=\"" + std::to_string(Node + 1) + "\" lat=\"" + std::to_string(38.5 + (Node / Size) * 0.001) + "\" lon=\"" + std::to_string(-121.7 + (Node % Size) * 0.001 + (Node % 3) * 0.0001) + "\"/>\n";
+    }
+    OSM += "   <node id=\"500\" lat=\"38.490\" lon=\"-121.700\"/>\n";
+    int WayID = 1000;
+    auto AddWay = [&](const std::vector<int> &nodes, bool oneway){
+        OSM += "   <way id=\"" + std::to_string(WayID++) + "\">\n";
+        for(auto Node : nodes){
+            OSM += "       <nd ref=\"" + std::to_string(Node) + "\"/>\n";
+        }
+        OSM += "       <tag k=\"highway\" v=\"residential\"/>\n";
+        if(oneway){
+            OSM += "       <tag k=\"oneway\" v=\"yes\"/>\n";
+        }
+        OSM += "   </way>\n";
+    };
+    for(int Line = 0; Line < Size; Line++){
+        std::vector<int> Row, Column;
+        for(int Step = 0; Step < Size; Step++){
+            Row.push_back(Line * Size + Step + 1);
+            Column.push_back(Step * Size + Line + 1);
+        }
+        AddWay(Row, Line % 3 == 1);
+        AddWay(Column, false);
+    }
+    AddWay({1, 500}, true);
+    OSM += "</osm>";
+    return OSM;
+}
+
+static CContractionHierarchy MatrixTestHierarchy(){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MatrixTestOSM())));
+    CRoadGraph Graph;
+    Graph.Build(Map);
+    CContractionHierarchy Hierarchy;
+    Hierarchy.Build(Graph);
+    return Hierarchy;
+}
+
+static std::string Serialized(const CDistanceMatrix &matrix){
+    auto Sink = std::make_shared<CStringDataSink>();
+    EXPECT_TRUE(matrix.Save(Sink));
+    return Sink->String();
+}
+
+//Sink that fails every write after the first count
+class CFailingDataSink : public CDataSink{
+    public:
+        std::size_t DWritesLeft;
+
+        CFailingDataSink(std::size_t count) : DWritesLeft(count){}
+
+        bool Put(const char &) noexcept override{
+            return DWritesLeft ? DWritesLeft--, true : false;
+        }
+
+        bool Write(const std::vector<char> &) noexcept override{
+            return DWritesLeft ? DWritesLeft--, true : false;
+        }
+};
+
+static const std::vector<CStreetMap::TNodeID> MatrixSources = {1, 8, 12, 30, 64, 500, 777, 20};
+static const std::vector<CStreetMap::TNodeID> MatrixTargets = {64, 1, 500, 33, 12, 777, 5, 1};
+
+TEST(DistanceMatrixTest, BuildTest){
+    auto Hierarchy = MatrixTestHierarchy();
+    CDistanceMatrix Matrix;
+    EXPECT_EQ(Matrix.RowCount(), 0);
+    EXPECT_TRUE(Matrix.Values().empty());
+    Matrix.Build(Hierarchy, MatrixSources, MatrixTargets);
+    ASSERT_EQ(Matrix.RowCount(), MatrixSources.size());
+    ASSERT_EQ(Matrix.ColumnCount(), MatrixTargets.size());
+    EXPECT_EQ(Matrix.Values().size(), MatrixSources.size() * MatrixTargets.size());
+    EXPECT_TRUE(std::equal(Matrix.SourceNodeIDs().begin(), Matrix.SourceNodeIDs().end(), MatrixSources.begin(), MatrixSources.end()));
+    EXPECT_TRUE(std::equal(Matrix.TargetNodeIDs().begin(), Matrix.TargetNodeIDs().end(), MatrixTargets.begin(), MatrixTargets.end()));
+    for(std::size_t Row = 0; Row < Matrix.RowCount(); Row++){
+        ASSERT_EQ(Matrix.Row(Row).size(), Matrix.ColumnCount());
+        EXPECT_EQ(Matrix.Row(Row).data(), Matrix.Values().data() + Row * Matrix.ColumnCount());
+        for(std::size_t Column = 0; Column < Matrix.ColumnCount(); Column++){
+            auto Expected = Hierarchy.Distance(MatrixSources[Row], MatrixTargets[Column]);
+            if(Expected == CDistanceMatrix::NoPathExists){
+                EXPECT_EQ(Matrix.Distance(Row, Column), CDistanceMatrix::NoPathExists);
+            }
+            else{
+                EXPECT_NEAR(Matrix.Distance(Row, Column), Expected, 1e-6);
+            }
+        }
+    }
+    // 500 can be reached but not left, and 777 is not on the map
+    EXPECT_NE(Matrix.Distance(0, 2), CDistanceMatrix::NoPathExists);
+    EXPECT_EQ(Matrix.Distance(5, 0), CDistanceMatrix::NoPathExists);
+    EXPECT_EQ(Matrix.Distance(5, 2), 0.0);
+    EXPECT_EQ(Matrix.Distance(6, 5), CDistanceMatrix::NoPathExists);
+    EXPECT_EQ(Matrix.Distance(0, 1), 0.0);
+    EXPECT_EQ(Matrix.Distance(0, 7), 0.0);
+    EXPECT_EQ(Matrix.Distance(Matrix.RowCount(), 0), CDistanceMatrix::NoPathExists);
+    EXPECT_EQ(Matrix.Distance(0, Matrix.ColumnCount()), CDistanceMatrix::NoPathExists);
+    EXPECT_TRUE(Matrix.Row(Matrix.RowCount()).empty());
+}
+
+TEST(DistanceMatrixTest, ThreadTest){
+    auto Hierarchy = MatrixTestHierarchy();
+    std::vector<CStreetMap::TNodeID> NodeIDs;
+    for(CStreetMap::TNodeID NodeID = 1; NodeID <= 64; NodeID++){
+        NodeIDs.push_back(NodeID);
+    }
+    CDistanceMatrix::SOptions Options;
+    Options.DThreadCount = 1;
+    CDistanceMatrix Serial;
+    Serial.Build(Hierarchy, NodeIDs, NodeIDs, Options);
+    for(std::size_t Index = 0; Index < NodeIDs.size(); Index++){
+        EXPECT_EQ(Serial.Distance(Index, Index), 0.0);
+    }
+    auto Expected = Serialized(Serial);
+    for(std::size_t Threads : {2, 3, 8}){
+        Options.DThreadCount = Threads;
+        CDistanceMatrix Parallel;
+        Parallel.Build(Hierarchy, NodeIDs, NodeIDs, Options);
+        EXPECT_EQ(Serialized(Parallel), Expected);
+    }
+}
+
+TEST(DistanceMatrixTest, WriteTest){
+    auto Hierarchy = MatrixTestHierarchy();
+    CDistanceMatrix Matrix;
+    Matrix.Build(Hierarchy, MatrixSources, MatrixTargets);
+    auto Expected = Serialized(Matrix);
+
+    // Streaming in blocks gives the same bytes as Save, whatever the block size
+    CDistanceMatrix::SOptions Options;
+    for(std::size_t BlockRows : {0, 1, 3, 8, 100}){
+        Options.DBlockRows = BlockRows;
+        auto Sink = std::make_shared<CStringDataSink>();
+        EXPECT_TRUE(CDistanceMatrix::Write(Hierarchy, MatrixSources, MatrixTargets, Sink, Options));
+        EXPECT_EQ(Sink->String(), Expected);
+    }
+    Options.DBlockRows = 3;
+    EXPECT_FALSE(CDistanceMatrix::Write(Hierarchy, MatrixSources, MatrixTargets, std::make_shared<CFailingDataSink>(0), Options));
+    EXPECT_FALSE(CDistanceMatrix::Write(Hierarchy, MatrixSources, MatrixTargets, std::make_shared<CFailingDataSink>(2), Options));
+
+    CDistanceMatrix Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Expected)));
+    EXPECT_EQ(Serialized(Loaded), Expected);
+    EXPECT_EQ(Loaded.Distance(3, 4), Matrix.Distance(3, 4));
+
+    // Moving keeps the contents and leaves an empty matrix behind
+    CDistanceMatrix Moved(std::move(Loaded));
+    EXPECT_EQ(Loaded.RowCount(), 0);
+    EXPECT_EQ(Serialized(Moved), Expected);
+}
+
+TEST(DistanceMatrixTest, ErrorTest){
+    auto Hierarchy = MatrixTestHierarchy();
+    CDistanceMatrix Matrix;
+    Matrix.Build(Hierarchy, MatrixSources, MatrixTargets);
+    auto Data = Serialized(Matrix);
+
+    CDistanceMatrix Loaded;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>("")));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Data.substr(0, Data.size() - 1))));
+    auto BadMagic = Data;
+    BadMagic[0] = 'X';
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadMagic)));
+    auto BadVersion = Data;
+    BadVersion[8] = 9;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadVersion)));
+    // A row count so large the values would not fit in memory
+    auto BadCount = Data;
+    std::fill(BadCount.begin() + 12, BadCount.begin() + 20, char(0xFF));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadCount)));
+    // Counts whose values would fit the address space but not the data fail instead of allocating them
+    auto HugeCount = Data;
+    uint64_t RowCount = uint64_t(1) << 40;
+    std::memcpy(HugeCount.data() + 12, &RowCount, sizeof(RowCount));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(HugeCount)));
+    // Failed loads leave the matrix alone
+    EXPECT_EQ(Loaded.RowCount(), 0);
+    EXPECT_EQ(Loaded.Distance(0, 0), CDistanceMatrix::NoPathExists);
+}
+
+TEST(DistanceMatrixTest, BusSystemTest){
+    auto BusRouteSource = std::make_shared<CStringDataSource>(  "<bussystem>\n"
+                                                                "<stops>\n"
+                                                                "   <stop id=\"1\" node=\"10\" description=\"First\"/>\n"
+                                                                "   <stop id=\"2\" node=\"55\" description=\"Second\"/>\n"
+                                                                "   <stop id=\"3\" node=\"500\" description=\"Third\"/>\n"
+                                                                "</stops>\n"
+                                                                "</bussystem>");
+    auto BusPathSource = std::make_shared<CStringDataSource>("<paths>\n</paths>");
+    CXMLBusSystem BusSystem(std::make_shared<CXMLReader>(BusRouteSource), std::make_shared<CXMLReader>(BusPathSource));
+    auto Stops = CDistanceMatrix::StopNodeIDs(BusSystem);
+    ASSERT_EQ(Stops.size(), 3);
+    for(std::size_t Index = 0; Index < Stops.size(); Index++){
+        EXPECT_EQ(Stops[Index], BusSystem.StopByIndex(Index)->NodeID());
+    }
+
+    auto Hierarchy = MatrixTestHierarchy();
+    CDistanceMatrix Matrix;
+    Matrix.Build(Hierarchy, Stops, Stops);
+    for(std::size_t Row = 0; Row < Stops.size(); Row++){
+        EXPECT_EQ(Matrix.Distance(Row, Row), 0.0);
+        for(std::size_t Column = 0; Column < Stops.size(); Column++){
+            EXPECT_DOUBLE_EQ(Matrix.Distance(Row, Column), Hierarchy.Distance(Stops[Row], Stops[Column]));
+        }
+    }
+}
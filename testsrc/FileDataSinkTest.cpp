@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include "FileDataSink.h"
+#include <fstream>
+#include <sstream>
+
+static std::string ReadFile(const std::string &filename){
+    std::ifstream Input(filename, std::ios::binary);
+    std::stringstream Buffer;
+    Buffer << Input.rdbuf();
+    return Buffer.str();
+}
+
+TEST(FileDataSinkTest, WriteTest){
+    std::string Filename = "testtmp/filedatasink.bin";
+    {
+        CFileDataSink Sink(Filename);
+        ASSERT_TRUE(Sink.Valid());
+        EXPECT_TRUE(Sink.Put('A'));
+        EXPECT_TRUE(Sink.Write({'b','c','\0','d'}));
+        EXPECT_TRUE(Sink.Write({}));
+    }
+    EXPECT_EQ(ReadFile(Filename), std::string("Abc\0d", 5));
+
+    // Reopening truncates the old contents
+    {
+        CFileDataSink Sink(Filename);
+        EXPECT_TRUE(Sink.Put('Z'));
+    }
+    EXPECT_EQ(ReadFile(Filename), "Z");
+}
+
+TEST(FileDataSinkTest, ErrorTest){
+    CFileDataSink Sink("testtmp/missing_directory/file.bin");
+    EXPECT_FALSE(Sink.Valid());
+    EXPECT_FALSE(Sink.Put('A'));
+    EXPECT_FALSE(Sink.Write({'b'}));
+}
@@ -0,0 +1,22 @@
+#include <gtest/gtest.h>
+#include "GeographicUtils.h"
+
+TEST(GeographicUtilsTest, HaversineTest){
+    CStreetMap::SLocation Davis(38.5449, -121.7405);
+    CStreetMap::SLocation Sacramento(38.5816, -121.4944);
+    EXPECT_EQ(SGeographicUtils::HaversineDistanceInMeters(Davis, Davis), 0.0);
+    EXPECT_NEAR(SGeographicUtils::HaversineDistanceInMeters(Davis, Sacramento), 21783.0, 1.0);
+    EXPECT_DOUBLE_EQ(SGeographicUtils::HaversineDistanceInMeters(Davis, Sacramento), SGeographicUtils::HaversineDistanceInMeters(Sacramento, Davis));
+    // One degree of latitude along a meridian and half way around the globe
+    EXPECT_NEAR(SGeographicUtils::HaversineDistanceInMeters({0, 0}, {1, 0}), 111195.0, 1.0);
+    EXPECT_NEAR(SGeographicUtils::HaversineDistanceInMeters({0, 0}, {0, 180}), SGeographicUtils::EarthRadiusMeters * 3.14159265358979, 1.0);
+    // Across the antimeridian
+    EXPECT_NEAR(SGeographicUtils::HaversineDistanceInMeters({0, 179.5}, {0, -179.5}), 111195.0, 1.0);
+}
+
+TEST(GeographicUtilsTest, ChordTest){
+    EXPECT_EQ(SGeographicUtils::MetersToChord(0), 0.0);
+    EXPECT_NEAR(SGeographicUtils::ChordToMeters(SGeographicUtils::MetersToChord(1234.5)), 1234.5, 1e-6);
+    EXPECT_NEAR(SGeographicUtils::MetersToChord(1e12), 2.0, 1e-12);
+    EXPECT_NEAR(SGeographicUtils::ChordToMeters(3.0), SGeographicUtils::EarthRadiusMeters * 3.14159265358979, 1.0);
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include "IDIndex.h"
+#include <map>
+#include <stdexcept>
+
+static const CIDIndex::EType AllIndexTypes[] = {CIDIndex::EType::Hash, CIDIndex::EType::Sorted, CIDIndex::EType::OpenAddressing};
+
+TEST(IDIndexTest, SortedIDsTest){
+    std::vector<CIDIndex::TID> IDs;
+    for(CIDIndex::TID ID = 62208369; IDs.size() < 5000; ID += 1 + (ID % 7)){
+        IDs.push_back(ID);
+    }
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        Index.Build(IDs);
+        EXPECT_EQ(Index.Type(), Type);
+        EXPECT_EQ(Index.Count(), IDs.size());
+        for(std::size_t Position = 0; Position < IDs.size(); Position++){
+            EXPECT_EQ(Index.Find(IDs[Position]), Position);
+        }
+        EXPECT_EQ(Index.Find(IDs.front() - 1), CIDIndex::InvalidIndex);
+        EXPECT_EQ(Index.Find(IDs.back() + 1), CIDIndex::InvalidIndex);
+        EXPECT_EQ(Index.Find(IDs[10] + 1), CIDIndex::InvalidIndex);
+    }
+}
+
+TEST(IDIndexTest, UnsortedIDsTest){
+    // Skewed and out of order, like a hand edited file
+    std::vector<CIDIndex::TID> IDs = {5603430199, 1, 2, 12000000000, 5229979989, 3, 62232638, 0};
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        Index.Build(IDs);
+        EXPECT_EQ(Index.Count(), IDs.size());
+        for(std::size_t Position = 0; Position < IDs.size(); Position++){
+            EXPECT_EQ(Index.Find(IDs[Position]), Position);
+        }
+        EXPECT_EQ(Index.Find(4), CIDIndex::InvalidIndex);
+        EXPECT_EQ(Index.Find(5603430198), CIDIndex::InvalidIndex);
+        EXPECT_EQ(Index.Find(CIDIndex::EmptyID), CIDIndex::InvalidIndex);
+    }
+}
+
+TEST(IDIndexTest, DuplicateIDsTest){
+    std::vector<CIDIndex::TID> IDs = {10, 20, 10, 30};
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        Index.Build(IDs);
+        EXPECT_EQ(Index.Count(), 3);
+        EXPECT_EQ(Index.Find(10), 2);
+        EXPECT_EQ(Index.Find(20), 1);
+        EXPECT_EQ(Index.Find(30), 3);
+    }
+}
+
+TEST(IDIndexTest, ParallelBuildTest){
+    // Sorted, shuffled with repeats spread across the chunks, and more threads than IDs
+    std::vector<CIDIndex::TID> Sorted, Shuffled;
+    for(CIDIndex::TID ID = 1000; Sorted.size() < 20000; ID += 1 + (ID % 5)){
+        Sorted.push_back(ID);
+    }
+    uint32_t Seed = 3;
+    for(std::size_t Position = 0; Position < 30000; Position++){
+        Seed = Seed * 1103515245 + 12345;
+        Shuffled.push_back(Sorted[(Seed >> 8) % Sorted.size()]);
+    }
+    std::vector<CIDIndex::TID> Few = {7, 3, 7};
+    for(auto Type : AllIndexTypes){
+        for(const auto *IDs : {&Sorted, &Shuffled, &Few}){
+            CIDIndex Serial(Type);
+            Serial.Build(*IDs);
+            for(std::size_t Threads : {2, 3, 8}){
+                CIDIndex Parallel(Type);
+                Parallel.Build(*IDs, Threads);
+                EXPECT_EQ(Parallel.Count(), Serial.Count());
+                for(auto ID : *IDs){
+                    EXPECT_EQ(Parallel.Find(ID), Serial.Find(ID));
+                }
+                EXPECT_EQ(Parallel.Find(1), CIDIndex::InvalidIndex);
+            }
+        }
+    }
+}
+
+TEST(IDIndexTest, EmptyTest){
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        EXPECT_EQ(Index.Count(), 0);
+        EXPECT_EQ(Index.Find(1), CIDIndex::InvalidIndex);
+        Index.Build({});
+        EXPECT_EQ(Index.Find(1), CIDIndex::InvalidIndex);
+    }
+    CIDIndex Default;
+    EXPECT_EQ(Default.Type(), CIDIndex::EType::Hash);
+}
+
+TEST(IDIndexTest, MemoryUsageTest){
+    std::vector<CIDIndex::TID> IDs;
+    for(CIDIndex::TID ID = 1; ID <= 1000; ID++){
+        IDs.push_back(ID * 3);
+    }
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        EXPECT_EQ(Index.MemoryUsage().DBytes, 0);
+        Index.Build(IDs);
+        auto Usage = Index.MemoryUsage();
+        EXPECT_GE(Usage.DBytes, IDs.size() * sizeof(CIDIndex::TID));
+        EXPECT_GT(Usage.DAllocations, 0);
+        EXPECT_EQ(Usage.Overhead(), Usage.DAllocations * SMemoryUsage::AllocationOverhead);
+    }
+    // The open addressing table stays between a quarter and three quarters full
+    CIDIndex Slots(CIDIndex::EType::OpenAddressing);
+    Slots.Build(IDs);
+    EXPECT_LE(Slots.MemoryUsage().DBytes, IDs.size() * 32);
+}
+
+TEST(IDIndexTest, FindBatchTest){
+    std::vector<CIDIndex::TID> IDs;
+    for(CIDIndex::TID ID = 62208369; IDs.size() < 3000; ID += 1 + (ID % 7)){
+        IDs.push_back(ID);
+    }
+    //Shuffled so the sorted backend keeps positions, with misses spread through the batch
+    std::vector<CIDIndex::TID> Shuffled(IDs.rbegin(), IDs.rend());
+    std::vector<CIDIndex::TID> Queries;
+    for(std::size_t Position = 0; Position < IDs.size(); Position += 3){
+        Queries.push_back(IDs[Position]);
+        Queries.push_back(IDs[Position] + 1000000000);
+    }
+    Queries.push_back(CIDIndex::EmptyID);
+    for(auto Type : AllIndexTypes){
+        for(const auto *Built : {&IDs, &Shuffled}){
+            CIDIndex Index(Type);
+            Index.Build(*Built);
+            std::vector<std::size_t> Indices{7};
+            EXPECT_EQ(Index.FindBatch(Queries, Indices), Queries.size() / 2);
+            ASSERT_EQ(Indices.size(), Queries.size());
+            for(std::size_t Query = 0; Query < Queries.size(); Query++){
+                EXPECT_EQ(Indices[Query], Index.Find(Queries[Query]));
+            }
+            EXPECT_EQ(Index.FindBatch({}, Indices), 0);
+            EXPECT_TRUE(Indices.empty());
+        }
+        CIDIndex Empty(Type);
+        std::vector<std::size_t> Indices;
+        EXPECT_EQ(Empty.FindBatch(Queries, Indices), 0);
+        EXPECT_EQ(Indices, std::vector<std::size_t>(Queries.size(), CIDIndex::InvalidIndex));
+    }
+}
+
+TEST(IDIndexTest, SetEraseTest){
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        Index.Build({10, 20, 30});
+        Index.Set(40, 3);
+        Index.Set(20, 7);
+        Index.Set(5, 8);
+        EXPECT_EQ(Index.Count(), 5);
+        EXPECT_EQ(Index.Find(40), 3);
+        EXPECT_EQ(Index.Find(20), 7);
+        EXPECT_EQ(Index.Find(5), 8);
+        EXPECT_EQ(Index.Find(10), 0);
+        EXPECT_TRUE(Index.Erase(10));
+        EXPECT_FALSE(Index.Erase(10));
+        EXPECT_FALSE(Index.Erase(11));
+        EXPECT_EQ(Index.Count(), 4);
+        EXPECT_EQ(Index.Find(10), CIDIndex::InvalidIndex);
+        EXPECT_EQ(Index.Find(30), 2);
+        CIDIndex Empty(Type);
+        EXPECT_FALSE(Empty.Erase(1));
+        Empty.Set(1, 4);
+        EXPECT_EQ(Empty.Find(1), 4);
+        // Positions are stored in 32 bits
+        EXPECT_THROW(Empty.Set(2, std::size_t(1) << 32), std::length_error);
+        EXPECT_EQ(Empty.Find(2), CIDIndex::InvalidIndex);
+    }
+}
+
+TEST(IDIndexTest, RandomSetEraseTest){
+    //Clustered IDs make long probe runs, which erasing has to keep intact
+    for(auto Type : AllIndexTypes){
+        CIDIndex Index(Type);
+        std::map<CIDIndex::TID, std::size_t> Expected;
+        uint64_t State = 12345;
+        for(std::size_t Step = 0; Step < 4000; Step++){
+            State = State * 6364136223846793005ULL + 1442695040888963407ULL;
+            CIDIndex::TID ID = (State >> 33) % 300;
+            if((State >> 20) % 3 == 0){
+                EXPECT_EQ(Index.Erase(ID), Expected.erase(ID) == 1);
+            }
+            else{
+                Index.Set(ID, Step);
+                Expected[ID] = Step;
+            }
+        }
+        EXPECT_EQ(Index.Count(), Expected.size());
+        for(CIDIndex::TID ID = 0; ID < 300; ID++){
+            auto Search = Expected.find(ID);
+            EXPECT_EQ(Index.Find(ID), Search == Expected.end() ? CIDIndex::InvalidIndex : Search->second);
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include "KDTree.h"
+#include "GeographicUtils.h"
+#include <algorithm>
+#include <random>
+
+static std::vector<CStreetMap::SLocation> RandomLocations(std::size_t count, unsigned seed){
+    std::mt19937 Generator(seed);
+    std::uniform_real_distribution<double> Latitude(38.5, 38.6);
+    std::uniform_real_distribution<double> Longitude(-121.8, -121.7);
+    std::vector<CStreetMap::SLocation> Locations;
+    for(std::size_t Index = 0; Index < count; Index++){
+        Locations.push_back({Latitude(Generator), Longitude(Generator)});
+    }
+    return Locations;
+}
+
+//Every point sorted by haversine distance to location
+static std::vector<CKDTree::SNeighbor> LinearNeighbors(const std::vector<CStreetMap::SLocation> &points, const CStreetMap::SLocation &location){
+    std::vector<CKDTree::SNeighbor> Neighbors;
+    for(std::size_t Index = 0; Index < points.size(); Index++){
+        Neighbors.push_back({static_cast<uint32_t>(Index), SGeographicUtils::HaversineDistanceInMeters(points[Index], location)});
+    }
+    std::sort(Neighbors.begin(), Neighbors.end(), [](const CKDTree::SNeighbor &left, const CKDTree::SNeighbor &right){
+        return left.DDistance < right.DDistance;
+    });
+    return Neighbors;
+}
+
+TEST(KDTreeTest, EmptyTest){
+    CKDTree Tree;
+    std::vector<CKDTree::SNeighbor> Neighbors{{1, 1.0}};
+    EXPECT_EQ(Tree.Count(), 0);
+    EXPECT_EQ(Tree.Nearest({38.5, -121.7}).DItem, CKDTree::InvalidItem);
+    EXPECT_EQ(Tree.KNearest({38.5, -121.7}, 3, Neighbors), 0);
+    EXPECT_TRUE(Neighbors.empty());
+    EXPECT_EQ(Tree.Radius({38.5, -121.7}, 1000, Neighbors), 0);
+
+    Tree.Build({{38.5, -121.7}});
+    EXPECT_EQ(Tree.KNearest({38.5, -121.7}, 0, Neighbors), 0);
+    EXPECT_EQ(Tree.Radius({38.5, -121.7}, -1, Neighbors), 0);
+    EXPECT_EQ(Tree.Nearest({0, 0}).DItem, 0);
+}
+
+TEST(KDTreeTest, NearestTest){
+    auto Points = RandomLocations(3000, 3);
+    for(std::size_t Threads : {1, 4}){
+        CKDTree Tree;
+        Tree.Build(Points, Threads);
+        EXPECT_EQ(Tree.Count(), Points.size());
+        for(const auto &Query : RandomLocations(100, 5)){
+            auto Expected = LinearNeighbors(Points, Query);
+            auto Nearest = Tree.Nearest(Query);
+            EXPECT_EQ(Nearest.DItem, Expected[0].DItem);
+            EXPECT_NEAR(Nearest.DDistance, Expected[0].DDistance, 1e-3);
+
+            std::vector<CKDTree::SNeighbor> Neighbors;
+            ASSERT_EQ(Tree.KNearest(Query, 10, Neighbors), 10);
+            for(std::size_t Index = 0; Index < 10; Index++){
+                EXPECT_EQ(Neighbors[Index].DItem, Expected[Index].DItem);
+                EXPECT_NEAR(Neighbors[Index].DDistance, Expected[Index].DDistance, 1e-3);
+            }
+        }
+        // Exact hits are zero distance
+        EXPECT_EQ(Tree.Nearest(Points[123]).DItem, 123);
+        EXPECT_NEAR(Tree.Nearest(Points[123]).DDistance, 0.0, 1e-6);
+
+        std::vector<CKDTree::SNeighbor> Neighbors;
+        EXPECT_EQ(Tree.KNearest(Points[0], Points.size() + 5, Neighbors), Points.size());
+    }
+}
+
+TEST(KDTreeTest, UpdateTest){
+    auto Points = RandomLocations(2000, 3);
+    auto Moves = RandomLocations(600, 4);
+    std::vector<bool> Present(Points.size(), true);
+    CKDTree Tree;
+    Tree.Build(Points, 1);
+    std::mt19937 Generator(9);
+    // Moves, removals and new points, enough to pass the rebuild threshold more than once
+    for(std::size_t Step = 0; Step < Moves.size(); Step++){
+        auto Item = Generator() % (Points.size() + 20);
+        if(Item >= Points.size()){
+            Points.resize(Item + 1);
+            Present.resize(Item + 1, false);
+        }
+        if(Step % 4 == 0){
+            Tree.Remove(Item);
+            Present[Item] = false;
+        }
+        else{
+            Tree.Update(Item, Moves[Step]);
+            Points[Item] = Moves[Step];
+            Present[Item] = true;
+        }
+        if(Step % 97 == 0){
+            EXPECT_EQ(Tree.Count(), std::count(Present.begin(), Present.end(), true));
+            for(const auto &Query : RandomLocations(20, Step)){
+                auto Expected = LinearNeighbors(Points, Query);
+                Expected.erase(std::remove_if(Expected.begin(), Expected.end(), [&](const CKDTree::SNeighbor &neighbor){ return !Present[neighbor.DItem]; }), Expected.end());
+                EXPECT_EQ(Tree.Nearest(Query).DItem, Expected[0].DItem);
+                std::vector<CKDTree::SNeighbor> Neighbors;
+                ASSERT_EQ(Tree.KNearest(Query, 5, Neighbors), 5);
+                for(std::size_t Index = 0; Index < 5; Index++){
+                    EXPECT_EQ(Neighbors[Index].DItem, Expected[Index].DItem);
+                }
+                auto Within = std::count_if(Expected.begin(), Expected.end(), [](const CKDTree::SNeighbor &neighbor){ return neighbor.DDistance <= 300; });
+                EXPECT_EQ(Tree.Radius(Query, 300, Neighbors), Within);
+            }
+        }
+    }
+
+    // An empty tree takes changes too
+    CKDTree Empty;
+    Empty.Update(4, {38.5, -121.7});
+    EXPECT_EQ(Empty.Count(), 1);
+    EXPECT_EQ(Empty.Nearest({0, 0}).DItem, 4);
+    Empty.Remove(4);
+    Empty.Remove(5);
+    EXPECT_EQ(Empty.Count(), 0);
+    EXPECT_EQ(Empty.Nearest({0, 0}).DItem, CKDTree::InvalidItem);
+}
+
+TEST(KDTreeTest, RadiusTest){
+    auto Points = RandomLocations(2000, 7);
+    CKDTree Tree;
+    Tree.Build(Points);
+    std::vector<CKDTree::SNeighbor> Neighbors;
+    for(const auto &Query : RandomLocations(50, 9)){
+        auto Expected = LinearNeighbors(Points, Query);
+        for(double Meters : {0.0, 50.0, 400.0}){
+            Tree.Radius(Query, Meters, Neighbors);
+            std::size_t Count = 0;
+            while((Count < Expected.size())&&(Expected[Count].DDistance <= Meters)){
+                Count++;
+            }
+            ASSERT_EQ(Neighbors.size(), Count);
+            for(std::size_t Index = 0; Index < Count; Index++){
+                EXPECT_EQ(Neighbors[Index].DItem, Expected[Index].DItem);
+            }
+        }
+    }
+}
+
+TEST(KDTreeTest, BatchTest){
+    auto Points = RandomLocations(1000, 11);
+    auto Queries = RandomLocations(500, 13);
+    CKDTree Tree;
+    Tree.Build(Points);
+
+    std::vector<CKDTree::SNeighbor> Nearest;
+    Tree.NearestBatch(Queries, Nearest, 4);
+    ASSERT_EQ(Nearest.size(), Queries.size());
+    std::vector<std::vector<CKDTree::SNeighbor>> KNearest;
+    Tree.KNearestBatch(Queries, 3, KNearest, 4);
+    ASSERT_EQ(KNearest.size(), Queries.size());
+    std::vector<CKDTree::SNeighbor> Neighbors;
+    for(std::size_t Index = 0; Index < Queries.size(); Index++){
+        EXPECT_EQ(Nearest[Index], Tree.Nearest(Queries[Index]));
+        Tree.KNearest(Queries[Index], 3, Neighbors);
+        EXPECT_EQ(KNearest[Index], Neighbors);
+    }
+
+    // Poles and the antimeridian are not special
+    CKDTree Globe;
+    Globe.Build({{0, 179.9}, {0, -100}, {89.99, 0}, {-89.99, 45}});
+    EXPECT_EQ(Globe.Nearest({0, -179.9}).DItem, 0);
+    EXPECT_EQ(Globe.Nearest({89.99, 170}).DItem, 2);
+    EXPECT_NEAR(Globe.Nearest({0, -179.9}).DDistance, SGeographicUtils::HaversineDistanceInMeters({0, 179.9}, {0, -179.9}), 1e-3);
+}
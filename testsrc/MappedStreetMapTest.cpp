@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+#include "MappedStreetMap.h"
+#include "OpenStreetMap.h"
+#include "FileDataSink.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+static const std::string MappedTestOSM =    "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                            "   <node id=\"62232638\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                                            "   <node id=\"5603430199\" lat=\"38.5612363\" lon=\"-121.643647\">\n"
+                                            "       <tag k=\"highway\" v=\"turning_circle\"/>\n"
+                                            "   </node>\n"
+                                            "   <node id=\"2\" lat=\"38.5\" lon=\"-121.8\">\n"
+                                            "       <tag k=\"name\" v=\"Main &amp; 1st\"/>\n"
+                                            "       <tag k=\"highway\" v=\"stop\"/>\n"
+                                            "   </node>\n"
+                                            "   <way id=\"8700118\">\n"
+                                            "       <nd ref=\"62232638\"/>\n"
+                                            "       <nd ref=\"5603430199\"/>\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <tag k=\"oneway\" v=\"yes\"/>\n"
+                                            "       <tag k=\"highway\" v=\"motorway_link\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"1000\"/>\n"
+                                            "</osm>";
+
+static void ExpectSameMap(const CStreetMap &expected, const CStreetMap &actual){
+    ASSERT_EQ(actual.NodeCount(), expected.NodeCount());
+    ASSERT_EQ(actual.WayCount(), expected.WayCount());
+    for(std::size_t Index = 0; Index < expected.NodeCount(); Index++){
+        auto Expected = expected.NodeByIndex(Index);
+        auto Actual = actual.NodeByID(Expected->ID());
+        ASSERT_NE(Actual, nullptr);
+        EXPECT_EQ(Actual->ID(), actual.NodeByIndex(Index)->ID());
+        EXPECT_EQ(Actual->Location(), Expected->Location());
+        ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+            auto Key = Expected->GetAttributeKey(Attribute);
+            EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+            EXPECT_TRUE(Actual->HasAttribute(Key));
+            EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+        }
+    }
+    for(std::size_t Index = 0; Index < expected.WayCount(); Index++){
+        auto Expected = expected.WayByIndex(Index);
+        auto Actual = actual.WayByID(Expected->ID());
+        ASSERT_NE(Actual, nullptr);
+        ASSERT_EQ(Actual->NodeCount(), Expected->NodeCount());
+        for(std::size_t Node = 0; Node < Expected->NodeCount(); Node++){
+            EXPECT_EQ(Actual->GetNodeID(Node), Expected->GetNodeID(Node));
+        }
+        ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+            auto Key = Expected->GetAttributeKey(Attribute);
+            EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+            EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+        }
+    }
+}
+
+TEST(MappedStreetMapTest, RoundTripTest){
+    COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)));
+    std::string Filename = "testtmp/mapped.osmsnap";
+    {
+        auto Sink = std::make_shared<CFileDataSink>(Filename);
+        ASSERT_TRUE(Sink->Valid());
+        ASSERT_TRUE(OpenStreetMap.WriteSnapshot(Sink));
+    }
+    std::shared_ptr<CStreetMap::SNode> Node;
+    {
+        CMappedStreetMap MappedMap(Filename);
+        ASSERT_TRUE(MappedMap.Valid());
+        ExpectSameMap(OpenStreetMap, MappedMap);
+
+        EXPECT_EQ(MappedMap.NodeByID(7), nullptr);
+        EXPECT_EQ(MappedMap.WayByID(7), nullptr);
+        EXPECT_EQ(MappedMap.NodeByIndex(3), nullptr);
+        EXPECT_EQ(MappedMap.WayByIndex(2), nullptr);
+        EXPECT_EQ(MappedMap.WayByID(1000)->NodeCount(), 0);
+        EXPECT_EQ(MappedMap.WayByID(1000)->GetNodeID(0), CStreetMap::InvalidNodeID);
+        EXPECT_EQ(MappedMap.WayByID(8700118)->GetAttributeKey(2), "");
+        EXPECT_FALSE(MappedMap.NodeByID(2)->HasAttribute("oneway"));
+        EXPECT_EQ(MappedMap.NodeByID(2)->GetAttribute("oneway"), "");
+        Node = MappedMap.NodeByID(2);
+    }
+    // Handles keep the mapping alive
+    EXPECT_EQ(Node->GetAttribute("name"), "Main & 1st");
+}
+
+TEST(MappedStreetMapTest, FixedPointTest){
+    COpenStreetMap::SOptions Options;
+    Options.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)), Options);
+    std::string Filename = "testtmp/mapped_fixed.osmsnap";
+    ASSERT_TRUE(OpenStreetMap.WriteSnapshot(std::make_shared<CFileDataSink>(Filename)));
+
+    CMappedStreetMap MappedMap(Filename);
+    ASSERT_TRUE(MappedMap.Valid());
+    ExpectSameMap(OpenStreetMap, MappedMap);
+    EXPECT_EQ(MappedMap.NodeByID(5603430199)->Location(), CStreetMap::SLocation(38.5612363, -121.643647));
+}
+
+TEST(MappedStreetMapTest, CompactOptionsTest){
+    COpenStreetMap::SOptions Options;
+    Options.DTagDecoding = COpenStreetMap::ETagDecoding::Lazy;
+    Options.DWayNodeStorage = COpenStreetMap::EWayNodeStorage::Compressed;
+    COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)), Options);
+    std::string Filename = "testtmp/mapped_compact.osmsnap";
+    ASSERT_TRUE(OpenStreetMap.WriteSnapshot(std::make_shared<CFileDataSink>(Filename)));
+
+    CMappedStreetMap MappedMap(Filename);
+    ASSERT_TRUE(MappedMap.Valid());
+    ExpectSameMap(OpenStreetMap, MappedMap);
+    EXPECT_EQ(MappedMap.WayByID(8700118)->GetAttribute("highway"), "motorway_link");
+}
+
+TEST(MappedStreetMapTest, ErrorTest){
+    CMappedStreetMap Missing("testtmp/does_not_exist.osmsnap");
+    EXPECT_FALSE(Missing.Valid());
+    EXPECT_EQ(Missing.NodeCount(), 0);
+    EXPECT_EQ(Missing.WayCount(), 0);
+    EXPECT_EQ(Missing.NodeByID(1), nullptr);
+    EXPECT_EQ(Missing.WayByID(1), nullptr);
+    EXPECT_EQ(Missing.NodeByIndex(0), nullptr);
+    EXPECT_EQ(Missing.WayByIndex(0), nullptr);
+
+    {
+        std::ofstream Garbage("testtmp/garbage.osmsnap", std::ios::binary);
+        Garbage << std::string(512, 'x');
+    }
+    EXPECT_FALSE(CMappedStreetMap("testtmp/garbage.osmsnap").Valid());
+
+    // A snapshot cut short must be rejected rather than read past the end
+    COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)));
+    auto StringSink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(OpenStreetMap.WriteSnapshot(StringSink));
+    {
+        std::ofstream Truncated("testtmp/truncated.osmsnap", std::ios::binary);
+        Truncated << StringSink->String().substr(0, StringSink->String().size() - 16);
+    }
+    EXPECT_FALSE(CMappedStreetMap("testtmp/truncated.osmsnap").Valid());
+
+    // Offsets that go backwards or leave their section, and counts whose size overflows, are rejected too
+    auto Corrupted = [&](auto corrupt){
+        auto Data = StringSink->String();
+        CMappedStreetMap::SSnapshotHeader Header;
+        std::memcpy(&Header, Data.data(), sizeof(Header));
+        corrupt(Header, Data);
+        std::memcpy(Data.data(), &Header, sizeof(Header));
+        {
+            std::ofstream Corrupt("testtmp/corrupt.osmsnap", std::ios::binary);
+            Corrupt << Data;
+        }
+        return CMappedStreetMap("testtmp/corrupt.osmsnap").Valid();
+    };
+    EXPECT_TRUE(Corrupted([](CMappedStreetMap::SSnapshotHeader &, std::string &){}));
+    auto SetOffset = [](std::string &data, const CMappedStreetMap::SSnapshotHeader &header, CMappedStreetMap::ESection section, std::size_t index, uint64_t value){
+        std::memcpy(data.data() + header.DSectionOffsets[static_cast<std::size_t>(section)] + index * sizeof(value), &value, sizeof(value));
+    };
+    EXPECT_FALSE(Corrupted([&](CMappedStreetMap::SSnapshotHeader &header, std::string &data){
+        SetOffset(data, header, CMappedStreetMap::ESection::WayNodeOffsets, 1, 1000000);
+    }));
+    EXPECT_FALSE(Corrupted([&](CMappedStreetMap::SSnapshotHeader &header, std::string &data){
+        SetOffset(data, header, CMappedStreetMap::ESection::StringOffsets, 1, 1000000);
+    }));
+    EXPECT_FALSE(Corrupted([](CMappedStreetMap::SSnapshotHeader &header, std::string &data){
+        uint32_t Value = 1000;
+        std::memcpy(data.data() + header.DSectionOffsets[static_cast<std::size_t>(CMappedStreetMap::ESection::NodeTagOffsets)] + sizeof(Value), &Value, sizeof(Value));
+    }));
+    EXPECT_FALSE(Corrupted([](CMappedStreetMap::SSnapshotHeader &header, std::string &){
+        header.DWayNodeCount = (uint64_t(1) << 61) + 1;
+    }));
+    EXPECT_FALSE(Corrupted([](CMappedStreetMap::SSnapshotHeader &header, std::string &){
+        header.DStringCount = std::numeric_limits<uint64_t>::max();
+    }));
+
+    auto EmptyMap = COpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>("<osm/>")));
+    ASSERT_TRUE(EmptyMap.WriteSnapshot(std::make_shared<CFileDataSink>("testtmp/empty.osmsnap")));
+    CMappedStreetMap EmptyMapped("testtmp/empty.osmsnap");
+    EXPECT_TRUE(EmptyMapped.Valid());
+    EXPECT_EQ(EmptyMapped.NodeCount(), 0);
+    EXPECT_EQ(EmptyMapped.NodeByID(1), nullptr);
+}
+
+TEST(MappedStreetMapTest, ForEachTest){
+    COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)));
+    std::string Filename = "testtmp/mapped_foreach.osmsnap";
+    ASSERT_TRUE(OpenStreetMap.WriteSnapshot(std::make_shared<CFileDataSink>(Filename)));
+
+    CMappedStreetMap MappedMap(Filename);
+    ASSERT_TRUE(MappedMap.Valid());
+    std::size_t Count = 0;
+    MappedMap.ForEachNode([&](std::size_t index, const CStreetMap::SNode &node){
+        EXPECT_EQ(node.ID(), OpenStreetMap.NodeByIndex(index)->ID());
+        EXPECT_EQ(node.Location(), OpenStreetMap.NodeByIndex(index)->Location());
+        Count++;
+    });
+    EXPECT_EQ(Count, OpenStreetMap.NodeCount());
+    MappedMap.ParallelForEachWay([&](std::size_t index, const CStreetMap::SWay &way){
+        EXPECT_EQ(way.NodeCount(), OpenStreetMap.WayByIndex(index)->NodeCount());
+        EXPECT_EQ(way.GetAttribute("highway"), OpenStreetMap.WayByIndex(index)->GetAttribute("highway"));
+    }, 2);
+
+    CMappedStreetMap Missing("testtmp/does_not_exist.osmsnap");
+    Missing.ForEachNode([&](std::size_t index, const CStreetMap::SNode &node){
+        ADD_FAILURE();
+    });
+    Missing.ForEachWay([&](std::size_t index, const CStreetMap::SWay &way){
+        ADD_FAILURE();
+    });
+}
+
+TEST(MappedStreetMapTest, BatchLookupTest){
+    COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)));
+    std::string Filename = "testtmp/mapped_batch.osmsnap";
+    ASSERT_TRUE(OpenStreetMap.WriteSnapshot(std::make_shared<CFileDataSink>(Filename)));
+
+    CMappedStreetMap MappedMap(Filename);
+    ASSERT_TRUE(MappedMap.Valid());
+    std::vector<CStreetMap::TNodeID> NodeIDs{7};
+    for(std::size_t Index = OpenStreetMap.NodeCount(); Index > 0; Index--){
+        NodeIDs.push_back(OpenStreetMap.NodeByIndex(Index - 1)->ID());
+    }
+    std::vector<CStreetMap::SLocation> Locations, Expected;
+    EXPECT_EQ(MappedMap.NodeLocationsByID(NodeIDs, Locations), OpenStreetMap.NodeCount());
+    EXPECT_EQ(OpenStreetMap.NodeLocationsByID(NodeIDs, Expected), OpenStreetMap.NodeCount());
+    ASSERT_EQ(Locations.size(), NodeIDs.size());
+    EXPECT_TRUE(std::isnan(Locations[0].DLatitude));
+    for(std::size_t Index = 1; Index < NodeIDs.size(); Index++){
+        EXPECT_EQ(Locations[Index], Expected[Index]);
+    }
+
+    CMappedStreetMap Missing("testtmp/does_not_exist.osmsnap");
+    EXPECT_EQ(Missing.NodeLocationsByID(NodeIDs, Locations), 0);
+    ASSERT_EQ(Locations.size(), NodeIDs.size());
+    EXPECT_TRUE(std::isnan(Locations[1].DLongitude));
+}
+
+TEST(MappedStreetMapTest, ChangedMapTest){
+    //Changes scatter tags and refs through the columns, snapshots must still be written in row order
+    std::string Change =    "<osmChange version=\"0.6\">\n"
+                            "   <modify>\n"
+                            "       <node id=\"2\" lat=\"38.6\" lon=\"-121.9\">\n"
+                            "           <tag k=\"highway\" v=\"traffic_signals\"/>\n"
+                            "       </node>\n"
+                            "       <way id=\"8700118\">\n"
+                            "           <nd ref=\"2\"/>\n"
+                            "           <nd ref=\"7\"/>\n"
+                            "           <tag k=\"highway\" v=\"primary\"/>\n"
+                            "       </way>\n"
+                            "   </modify>\n"
+                            "   <create>\n"
+                            "       <node id=\"7\" lat=\"38.7\" lon=\"-122.0\"/>\n"
+                            "   </create>\n"
+                            "   <delete>\n"
+                            "       <node id=\"62232638\"/>\n"
+                            "   </delete>\n"
+                            "</osmChange>";
+    for(auto Decoding : {COpenStreetMap::ETagDecoding::Eager, COpenStreetMap::ETagDecoding::Lazy}){
+        for(auto Storage : {COpenStreetMap::EWayNodeStorage::Plain, COpenStreetMap::EWayNodeStorage::Compressed}){
+            COpenStreetMap::SOptions Options;
+            Options.DTagDecoding = Decoding;
+            Options.DWayNodeStorage = Storage;
+            COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(MappedTestOSM)), Options);
+            ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(Change))));
+            std::string Filename = "testtmp/mapped_changed.osmsnap";
+            ASSERT_TRUE(OpenStreetMap.WriteSnapshot(std::make_shared<CFileDataSink>(Filename)));
+
+            CMappedStreetMap MappedMap(Filename);
+            ASSERT_TRUE(MappedMap.Valid());
+            ExpectSameMap(OpenStreetMap, MappedMap);
+            EXPECT_EQ(MappedMap.NodeCount(), 3);
+            EXPECT_EQ(MappedMap.NodeByID(62232638), nullptr);
+            EXPECT_EQ(MappedMap.WayByID(8700118)->GetNodeID(1), 7);
+            EXPECT_EQ(MappedMap.WayByID(8700118)->GetAttribute("highway"), "primary");
+            EXPECT_EQ(MappedMap.WayByID(8700118)->AttributeCount(), 1);
+        }
+    }
+}
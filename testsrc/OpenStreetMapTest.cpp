@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "OpenStreetMap.h"
+#include "GeographicUtils.h"
 #include "StringDataSource.h"
+#include <cmath>
+#include <random>
 
 TEST(OpenStreetMapTest, SimpleTest){
     auto OSMSource = std::make_shared<CStringDataSource>(  "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
@@ -190,4 +193,1197 @@ TEST(OpenStreetMapTest, DestructionTest){
         auto StackWay = StackOpenStreetMap.WayByIndex(0);
         auto StackWay2 = StackOpenStreetMap.WayByID(1234);
     }
-}
\ No newline at end of file
+}
+TEST(OpenStreetMapTest, NodeHandleTest){
+    auto OSMSource = std::make_shared<CStringDataSource>(  "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                                            "  <node id=\"1\" lat=\"38.5\" lon=\"-121.7\">\n"
+                                                            "    <tag k=\"name\" v=\"First\"/>\n"
+                                                            "    <tag k=\"highway\" v=\"stop\"/>\n"
+                                                            "  </node>\n"
+                                                            "  <node id=\"2\" lat=\"38.6\" lon=\"-121.8\"/>\n"
+                                                            "  <node id=\"3\" lat=\"38.7\" lon=\"-121.9\">\n"
+                                                            "    <tag k=\"name\" v=\"Third\"/>\n"
+                                                            "  </node>\n"
+                                                            "</osm>"
+                                                        );
+    auto OSMReader = std::make_shared< CXMLReader >(OSMSource);
+    std::shared_ptr<CStreetMap::SNode> Node1, Node2, Node3;
+    {
+        COpenStreetMap OpenStreetMap(OSMReader);
+        Node1 = OpenStreetMap.NodeByIndex(0);
+        Node2 = OpenStreetMap.NodeByID(2);
+        Node3 = OpenStreetMap.NodeByID(3);
+    }
+    // Handles stay usable after the map itself is gone
+    ASSERT_NE(Node1, nullptr);
+    EXPECT_EQ(Node1->ID(), 1);
+    EXPECT_EQ(Node1->AttributeCount(), 2);
+    EXPECT_EQ(Node1->GetAttributeKey(1), "highway");
+    EXPECT_EQ(Node1->GetAttributeKey(2), "");
+    EXPECT_EQ(Node1->GetAttribute("name"), "First");
+    ASSERT_NE(Node2, nullptr);
+    EXPECT_EQ(Node2->Location(), CStreetMap::SLocation(38.6,-121.8));
+    EXPECT_EQ(Node2->AttributeCount(), 0);
+    EXPECT_FALSE(Node2->HasAttribute("name"));
+    ASSERT_NE(Node3, nullptr);
+    EXPECT_EQ(Node3->AttributeCount(), 1);
+    EXPECT_EQ(Node3->GetAttribute("name"), "Third");
+    EXPECT_EQ(Node3->GetAttribute("highway"), "");
+}
+
+TEST(OpenStreetMapTest, AttributeIDTest){
+    auto OSMSource = std::make_shared<CStringDataSource>(  "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                                            "  <node id=\"1\" lat=\"38.5\" lon=\"-121.7\">\n"
+                                                            "    <tag k=\"highway\" v=\"stop\"/>\n"
+                                                            "  </node>\n"
+                                                            "  <node id=\"2\" lat=\"38.6\" lon=\"-121.8\"/>\n"
+                                                            "  <way id=\"1000\">\n"
+                                                            "    <nd ref=\"1\"/>\n"
+                                                            "    <nd ref=\"2\"/>\n"
+                                                            "    <tag k=\"highway\" v=\"residential\"/>\n"
+                                                            "    <tag k=\"name\" v=\"Main Street\"/>\n"
+                                                            "  </way>\n"
+                                                            "  <way id=\"1001\">\n"
+                                                            "    <tag k=\"highway\" v=\"residential\"/>\n"
+                                                            "  </way>\n"
+                                                            "</osm>"
+                                                        );
+    auto OSMReader = std::make_shared< CXMLReader >(OSMSource);
+    COpenStreetMap OpenStreetMap(OSMReader);
+
+    auto Highway = OpenStreetMap.StringID("highway");
+    auto Residential = OpenStreetMap.StringID("residential");
+    ASSERT_NE(Highway, COpenStreetMap::InvalidStringID);
+    ASSERT_NE(Residential, COpenStreetMap::InvalidStringID);
+    EXPECT_EQ(OpenStreetMap.StringByID(Highway), "highway");
+    EXPECT_EQ(OpenStreetMap.StringID("missing"), COpenStreetMap::InvalidStringID);
+    EXPECT_EQ(OpenStreetMap.StringByID(COpenStreetMap::InvalidStringID), "");
+
+    // Both ways share the same interned value
+    EXPECT_EQ(OpenStreetMap.WayAttributeID(0, Highway), Residential);
+    EXPECT_EQ(OpenStreetMap.WayAttributeID(1, Highway), Residential);
+    EXPECT_EQ(OpenStreetMap.StringByID(OpenStreetMap.WayAttributeID(0, OpenStreetMap.StringID("name"))), "Main Street");
+    EXPECT_EQ(OpenStreetMap.WayAttributeID(1, OpenStreetMap.StringID("name")), COpenStreetMap::InvalidStringID);
+    EXPECT_EQ(OpenStreetMap.WayAttributeID(2, Highway), COpenStreetMap::InvalidStringID);
+
+    EXPECT_EQ(OpenStreetMap.StringByID(OpenStreetMap.NodeAttributeID(0, Highway)), "stop");
+    EXPECT_EQ(OpenStreetMap.NodeAttributeID(1, Highway), COpenStreetMap::InvalidStringID);
+    EXPECT_EQ(OpenStreetMap.NodeAttributeID(5, Highway), COpenStreetMap::InvalidStringID);
+
+    // String based lookups still work on top of the pool
+    auto Way = OpenStreetMap.WayByID(1000);
+    ASSERT_NE(Way, nullptr);
+    EXPECT_EQ(Way->AttributeCount(), 2);
+    EXPECT_EQ(Way->GetAttributeKey(1), "name");
+    EXPECT_TRUE(Way->HasAttribute("highway"));
+    EXPECT_FALSE(Way->HasAttribute("stop"));
+    EXPECT_EQ(Way->GetAttribute("name"), "Main Street");
+}
+
+TEST(OpenStreetMapTest, IndexTypeTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"5603430199\" lat=\"38.5612363\" lon=\"-121.643647\"/>\n"
+                        "   <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"62232638\" lat=\"38.5\" lon=\"-121.8\"/>\n"
+                        "   <way id=\"8701218\">\n"
+                        "       <nd ref=\"1\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"8700118\">\n"
+                        "       <nd ref=\"62232638\"/>\n"
+                        "   </way>\n"
+                        "</osm>";
+    for(auto Type : {CIDIndex::EType::Hash, CIDIndex::EType::Sorted, CIDIndex::EType::OpenAddressing}){
+        COpenStreetMap::SOptions Options;
+        Options.DIndexType = Type;
+        COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+
+        for(std::size_t Index = 0; Index < OpenStreetMap.NodeCount(); Index++){
+            auto Node = OpenStreetMap.NodeByID(OpenStreetMap.NodeByIndex(Index)->ID());
+            ASSERT_NE(Node, nullptr);
+            EXPECT_EQ(Node->Location(), OpenStreetMap.NodeByIndex(Index)->Location());
+        }
+        ASSERT_NE(OpenStreetMap.WayByID(8700118), nullptr);
+        EXPECT_EQ(OpenStreetMap.WayByID(8700118)->GetNodeID(0), 62232638);
+        ASSERT_NE(OpenStreetMap.WayByID(8701218), nullptr);
+        EXPECT_EQ(OpenStreetMap.WayByID(8701218)->GetNodeID(0), 1);
+        EXPECT_EQ(OpenStreetMap.NodeByID(2), nullptr);
+        EXPECT_EQ(OpenStreetMap.WayByID(1), nullptr);
+    }
+}
+
+TEST(OpenStreetMapTest, FixedPointTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"5229979989\" lat=\"38.5902119\" lon=\"-121.7650771\"/>\n"
+                        "   <node id=\"5603430199\" lat=\"-89.9999999\" lon=\"179.9999999\"/>\n"
+                        "</osm>";
+    COpenStreetMap DoubleMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)));
+    EXPECT_EQ(DoubleMap.CoordinateStorage(), COpenStreetMap::ECoordinateStorage::Double);
+    EXPECT_EQ(DoubleMap.NodeLatitudes().size(), 3);
+    EXPECT_EQ(DoubleMap.NodeLongitudes()[1], -121.7650771);
+    EXPECT_TRUE(DoubleMap.NodeFixedPointLatitudes().empty());
+
+    COpenStreetMap::SOptions Options;
+    Options.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    COpenStreetMap FixedMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    EXPECT_EQ(FixedMap.CoordinateStorage(), COpenStreetMap::ECoordinateStorage::FixedPoint);
+    EXPECT_TRUE(FixedMap.NodeLatitudes().empty());
+    ASSERT_EQ(FixedMap.NodeFixedPointLatitudes().size(), 3);
+    ASSERT_EQ(FixedMap.NodeFixedPointLongitudes().size(), 3);
+    EXPECT_EQ(FixedMap.NodeFixedPointLatitudes()[0], 385000000);
+    EXPECT_EQ(FixedMap.NodeFixedPointLongitudes()[1], -1217650771);
+    EXPECT_EQ(FixedMap.NodeFixedPointLatitudes()[2], -899999999);
+    EXPECT_EQ(FixedMap.NodeFixedPointLongitudes()[2], 1799999999);
+
+    // Seven decimal places round trip exactly
+    for(std::size_t Index = 0; Index < DoubleMap.NodeCount(); Index++){
+        EXPECT_EQ(FixedMap.NodeByIndex(Index)->Location(), DoubleMap.NodeByIndex(Index)->Location());
+    }
+    EXPECT_EQ(FixedMap.NodeByID(5229979989)->Location(), CStreetMap::SLocation(38.5902119, -121.7650771));
+
+    EXPECT_EQ(COpenStreetMap::ToFixedPoint(-121.64364701), -1216436470);
+    EXPECT_EQ(COpenStreetMap::FromFixedPoint(385612363), 38.5612363);
+}
+
+TEST(OpenStreetMapTest, TagDecodingTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"2\" lat=\"38.5\" lon=\"-121.8\">\n"
+                        "       <tag k=\"name\" v=\"Main &amp; 1st\"/>\n"
+                        "       <tag k=\"highway\" v=\"\"/>\n"
+                        "   </node>\n"
+                        "   <way id=\"1000\">\n"
+                        "       <nd ref=\"1\"/>\n"
+                        "       <tag k=\"highway\" v=\"residential\"/>\n"
+                        "       <tag k=\"name\" v=\"Main Street\"/>\n"
+                        "       <nd ref=\"2\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1001\"/>\n"
+                        "</osm>";
+    COpenStreetMap EagerMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)));
+    EXPECT_EQ(EagerMap.TagDecoding(), COpenStreetMap::ETagDecoding::Eager);
+    for(auto Decoding : {COpenStreetMap::ETagDecoding::Lazy, COpenStreetMap::ETagDecoding::LazyMemoized}){
+        COpenStreetMap::SOptions Options;
+        Options.DTagDecoding = Decoding;
+        COpenStreetMap LazyMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+        EXPECT_EQ(LazyMap.TagDecoding(), Decoding);
+        ASSERT_EQ(LazyMap.NodeCount(), 2);
+        ASSERT_EQ(LazyMap.WayCount(), 2);
+
+        // Repeat so memoized objects are read both before and after decoding
+        for(int Pass = 0; Pass < 2; Pass++){
+            for(std::size_t Index = 0; Index < EagerMap.NodeCount(); Index++){
+                auto Expected = EagerMap.NodeByIndex(Index);
+                auto Actual = LazyMap.NodeByIndex(Index);
+                ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+                for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+                    auto Key = Expected->GetAttributeKey(Attribute);
+                    EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+                    EXPECT_TRUE(Actual->HasAttribute(Key));
+                    EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+                }
+            }
+            auto Way = LazyMap.WayByID(1000);
+            ASSERT_NE(Way, nullptr);
+            EXPECT_EQ(Way->NodeCount(), 2);
+            EXPECT_EQ(Way->AttributeCount(), 2);
+            EXPECT_EQ(Way->GetAttributeKey(1), "name");
+            EXPECT_EQ(Way->GetAttributeKey(2), "");
+            EXPECT_EQ(Way->GetAttribute("name"), "Main Street");
+            EXPECT_FALSE(Way->HasAttribute("oneway"));
+            EXPECT_FALSE(Way->HasAttribute("highwa"));
+            EXPECT_EQ(Way->GetAttribute("oneway"), "");
+            EXPECT_EQ(LazyMap.WayByID(1001)->AttributeCount(), 0);
+        }
+        EXPECT_TRUE(LazyMap.NodeByID(2)->HasAttribute("highway"));
+        EXPECT_EQ(LazyMap.NodeByID(2)->GetAttribute("name"), "Main & 1st");
+
+        // Lazy tags are never interned
+        EXPECT_EQ(LazyMap.StringID("highway"), COpenStreetMap::InvalidStringID);
+        EXPECT_EQ(LazyMap.WayAttributeID(0, EagerMap.StringID("highway")), COpenStreetMap::InvalidStringID);
+
+        // Handles keep decoded tags alive after the map is gone
+        std::shared_ptr<CStreetMap::SWay> Kept;
+        {
+            COpenStreetMap ShortMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+            Kept = ShortMap.WayByIndex(0);
+        }
+        EXPECT_EQ(Kept->GetAttribute("highway"), "residential");
+    }
+}
+
+TEST(OpenStreetMapTest, WayNodeStorageTest){
+    // Ways spanning several blocks with forward, backward and huge jumps between refs
+    std::vector<std::vector<CStreetMap::TNodeID>> WayRefs = {
+        {},
+        {5603430199},
+        {1, 2, 3, 2, 1},
+        {},
+        {}
+    };
+    for(CStreetMap::TNodeID Ref = 1000; Ref < 1040; Ref++){
+        WayRefs[3].push_back((Ref % 3) ? Ref : 9000000000 - Ref);
+    }
+    for(std::size_t Index = 0; Index < COpenStreetMap::WayNodeBlockSize * 2; Index++){
+        WayRefs[4].push_back(Index % 2 ? 0xFFFFFFFFFFFFFFFEULL : 0);
+    }
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    for(std::size_t Way = 0; Way < WayRefs.size(); Way++){
+        OSM += "   <way id=\"" + std::to_string(Way + 10) + "\">\n";
+        for(auto Ref : WayRefs[Way]){
+            OSM += "       <nd ref=\"" + std::to_string(Ref) + "\"/>\n";
+        }
+        OSM += "       <tag k=\"highway\" v=\"residential\"/>\n";
+        OSM += "   </way>\n";
+    }
+    OSM += "</osm>";
+
+    for(auto Storage : {COpenStreetMap::EWayNodeStorage::Plain, COpenStreetMap::EWayNodeStorage::Compressed}){
+        COpenStreetMap::SOptions Options;
+        Options.DWayNodeStorage = Storage;
+        COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+        EXPECT_EQ(OpenStreetMap.WayNodeStorage(), Storage);
+        ASSERT_EQ(OpenStreetMap.WayCount(), WayRefs.size());
+        std::vector<CStreetMap::TNodeID> Decoded;
+        for(std::size_t Way = 0; Way < WayRefs.size(); Way++){
+            auto Handle = OpenStreetMap.WayByIndex(Way);
+            ASSERT_EQ(Handle->NodeCount(), WayRefs[Way].size());
+            // Random access, walked backwards so every block is entered cold
+            for(std::size_t Index = WayRefs[Way].size(); Index-- > 0;){
+                EXPECT_EQ(Handle->GetNodeID(Index), WayRefs[Way][Index]);
+            }
+            EXPECT_EQ(Handle->GetNodeID(WayRefs[Way].size()), CStreetMap::InvalidNodeID);
+            EXPECT_EQ(Handle->GetAttribute("highway"), "residential");
+
+            std::vector<CStreetMap::TNodeID> Iterated;
+            for(auto ID : OpenStreetMap.WayNodeIDs(Way)){
+                Iterated.push_back(ID);
+            }
+            EXPECT_EQ(Iterated, WayRefs[Way]);
+            EXPECT_EQ(OpenStreetMap.WayNodeIDs(Way, Decoded), WayRefs[Way].size());
+            EXPECT_EQ(Decoded, WayRefs[Way]);
+        }
+        EXPECT_TRUE(OpenStreetMap.WayNodeIDs(WayRefs.size()).begin() == std::default_sentinel);
+        EXPECT_EQ(OpenStreetMap.WayNodeIDs(WayRefs.size(), Decoded), 0);
+        EXPECT_TRUE(Decoded.empty());
+    }
+}
+
+TEST(OpenStreetMapTest, MemoryUsageTest){
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    for(int Node = 1; Node <= 64; Node++){
+        OSM += "   <node id=\"" + std::to_string(1000 + Node) + "\" lat=\"38.5" + std::to_string(Node) + "\" lon=\"-121.7\">\n";
+        OSM += "       <tag k=\"name\" v=\"Node number " + std::to_string(Node) + "\"/>\n";
+        OSM += "   </node>\n";
+    }
+    OSM += "   <way id=\"10\">\n";
+    for(int Node = 1; Node <= 64; Node++){
+        OSM += "       <nd ref=\"" + std::to_string(1000 + Node) + "\"/>\n";
+    }
+    OSM += "       <tag k=\"highway\" v=\"residential\"/>\n";
+    OSM += "   </way>\n";
+    OSM += "</osm>";
+
+    COpenStreetMap::SOptions Options;
+    COpenStreetMap Plain(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    auto Report = Plain.MemoryUsage();
+    EXPECT_GE(Report.DNodes, 64 * (sizeof(CStreetMap::TNodeID) + 2 * sizeof(double)));
+    EXPECT_GT(Report.DNodeTags, 0);
+    EXPECT_GT(Report.DNodeIndex, 0);
+    EXPECT_GE(Report.DWays, sizeof(CStreetMap::TWayID));
+    EXPECT_GE(Report.DWayReferences, 64 * sizeof(CStreetMap::TNodeID));
+    EXPECT_GT(Report.DWayTags, 0);
+    EXPECT_GT(Report.DWayIndex, 0);
+    EXPECT_GT(Report.DStrings, 0);
+    EXPECT_GT(Report.DAllocatorOverhead, 0);
+    EXPECT_EQ(Report.Total(), Report.DNodes + Report.DNodeTags + Report.DNodeIndex + Report.DWays + Report.DWayReferences
+                                + Report.DWayTags + Report.DWayIndex + Report.DStrings + Report.DSearchIndexes + Report.DAllocatorOverhead);
+
+    Options.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    Options.DWayNodeStorage = COpenStreetMap::EWayNodeStorage::Compressed;
+    Options.DTagDecoding = COpenStreetMap::ETagDecoding::LazyMemoized;
+    COpenStreetMap Compact(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    auto CompactReport = Compact.MemoryUsage();
+    EXPECT_LT(CompactReport.DNodes, Report.DNodes);
+    EXPECT_LT(CompactReport.DWayReferences, Report.DWayReferences);
+    // Memoized tags are charged once they have been decoded
+    EXPECT_EQ(Compact.NodeByIndex(0)->GetAttribute("name"), "Node number 1");
+    EXPECT_GT(Compact.MemoryUsage().DNodeTags, CompactReport.DNodeTags);
+
+    Options.DBuildWayRTree = true;
+    Options.DBuildNodeKDTree = true;
+    Options.DBuildTagIndex = true;
+    COpenStreetMap Indexed(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    EXPECT_GT(Indexed.MemoryUsage().DSearchIndexes, CompactReport.DSearchIndexes);
+}
+
+TEST(OpenStreetMapTest, WayGeometryTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"30\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"10\" lat=\"38.6\" lon=\"-121.8\"/>\n"
+                        "   <node id=\"20\" lat=\"38.7\" lon=\"-121.9\"/>\n"
+                        "   <way id=\"1000\">\n"
+                        "       <nd ref=\"10\"/>\n"
+                        "       <nd ref=\"99\"/>\n"
+                        "       <nd ref=\"20\"/>\n"
+                        "       <nd ref=\"30\"/>\n"
+                        "       <nd ref=\"10\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1001\"/>\n"
+                        "</osm>";
+    for(auto Storage : {COpenStreetMap::EWayNodeStorage::Plain, COpenStreetMap::EWayNodeStorage::Compressed}){
+        COpenStreetMap::SOptions Options;
+        Options.DWayNodeStorage = Storage;
+        Options.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+        COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+
+        auto Indices = OpenStreetMap.WayNodeIndices(0);
+        ASSERT_EQ(Indices.size(), 5);
+        EXPECT_EQ(Indices[0], 1);
+        EXPECT_EQ(Indices[1], COpenStreetMap::InvalidNodeIndex);
+        EXPECT_EQ(Indices[2], 2);
+        EXPECT_EQ(Indices[3], 0);
+        EXPECT_EQ(Indices[4], 1);
+        EXPECT_TRUE(OpenStreetMap.WayNodeIndices(1).empty());
+        EXPECT_TRUE(OpenStreetMap.WayNodeIndices(2).empty());
+
+        std::vector<CStreetMap::SLocation> Locations;
+        ASSERT_EQ(OpenStreetMap.WayLocations(0, Locations), 4);
+        ASSERT_EQ(Locations.size(), 4);
+        EXPECT_EQ(Locations[0], CStreetMap::SLocation(38.6, -121.8));
+        EXPECT_EQ(Locations[1], CStreetMap::SLocation(38.7, -121.9));
+        EXPECT_EQ(Locations[2], CStreetMap::SLocation(38.5, -121.7));
+        EXPECT_EQ(Locations[3], CStreetMap::SLocation(38.6, -121.8));
+        EXPECT_EQ(OpenStreetMap.WayLocations(1, Locations), 0);
+        EXPECT_EQ(OpenStreetMap.WayLocations(2, Locations), 0);
+        EXPECT_TRUE(Locations.empty());
+    }
+}
+
+TEST(OpenStreetMapTest, WayRTreeTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"1\" lat=\"38.50\" lon=\"-121.70\"/>\n"
+                        "   <node id=\"2\" lat=\"38.52\" lon=\"-121.72\"/>\n"
+                        "   <node id=\"3\" lat=\"38.60\" lon=\"-121.80\"/>\n"
+                        "   <node id=\"4\" lat=\"38.61\" lon=\"-121.81\"/>\n"
+                        "   <way id=\"1000\">\n"
+                        "       <nd ref=\"1\"/>\n"
+                        "       <nd ref=\"2\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1001\">\n"
+                        "       <nd ref=\"3\"/>\n"
+                        "       <nd ref=\"4\"/>\n"
+                        "       <nd ref=\"99\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1002\">\n"
+                        "       <nd ref=\"2\"/>\n"
+                        "       <nd ref=\"3\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1003\">\n"
+                        "       <nd ref=\"99\"/>\n"
+                        "   </way>\n"
+                        "</osm>";
+    COpenStreetMap::SOptions Options;
+    COpenStreetMap PlainMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    EXPECT_EQ(PlainMap.WayRTree().Count(), 0);
+    Options.DBuildWayRTree = true;
+    Options.DThreadCount = 2;
+    COpenStreetMap TreeMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    EXPECT_EQ(TreeMap.WayRTree().Count(), 3);
+
+    auto Bounds = TreeMap.WayBounds(1);
+    EXPECT_EQ(Bounds.DMinLatitude, 38.60);
+    EXPECT_EQ(Bounds.DMaxLatitude, 38.61);
+    EXPECT_EQ(Bounds.DMinLongitude, -121.81);
+    EXPECT_EQ(Bounds.DMaxLongitude, -121.80);
+    EXPECT_TRUE(TreeMap.WayBounds(3).Empty());
+    EXPECT_TRUE(TreeMap.WayBounds(4).Empty());
+
+    for(const COpenStreetMap *Map : {&PlainMap, &TreeMap}){
+        std::vector<uint32_t> Ways;
+        EXPECT_EQ(Map->WaysInBox({38.49, -121.71, 38.51, -121.69}, Ways), 1);
+        EXPECT_EQ(Ways, std::vector<uint32_t>({0}));
+        Map->WaysInBox({38.52, -121.72, 38.52, -121.72}, Ways);
+        EXPECT_EQ(Ways, std::vector<uint32_t>({0, 2}));
+        Map->WaysInBox({-90, -180, 90, 180}, Ways);
+        EXPECT_EQ(Ways, std::vector<uint32_t>({0, 1, 2}));
+        EXPECT_EQ(Map->WaysInBox({0, 0, 1, 1}, Ways), 0);
+    }
+}
+
+TEST(OpenStreetMapTest, NodeKDTreeTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"1\" lat=\"38.50\" lon=\"-121.70\"/>\n"
+                        "   <node id=\"2\" lat=\"38.52\" lon=\"-121.72\"/>\n"
+                        "   <node id=\"3\" lat=\"38.60\" lon=\"-121.80\"/>\n"
+                        "</osm>";
+    COpenStreetMap PlainMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)));
+    EXPECT_EQ(PlainMap.NodeKDTree().Count(), 0);
+
+    COpenStreetMap::SOptions Options;
+    Options.DBuildNodeKDTree = true;
+    Options.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+    ASSERT_EQ(OpenStreetMap.NodeKDTree().Count(), 3);
+    auto Nearest = OpenStreetMap.NodeKDTree().Nearest({38.59, -121.79});
+    EXPECT_EQ(OpenStreetMap.NodeByIndex(Nearest.DItem)->ID(), 3);
+
+    std::vector<CKDTree::SNeighbor> Neighbors;
+    EXPECT_EQ(OpenStreetMap.NodeKDTree().Radius({38.505, -121.705}, 2500, Neighbors), 2);
+    EXPECT_EQ(OpenStreetMap.NodeByIndex(Neighbors[0].DItem)->ID(), 1);
+}
+
+TEST(OpenStreetMapTest, WayFilterTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"2\" lat=\"38.6\" lon=\"-121.8\">\n"
+                        "       <tag k=\"highway\" v=\"stop\"/>\n"
+                        "   </node>\n"
+                        "   <node id=\"3\" lat=\"38.7\" lon=\"-121.9\"/>\n"
+                        "   <node id=\"4\" lat=\"38.8\" lon=\"-122.0\">\n"
+                        "       <tag k=\"amenity\" v=\"bench\"/>\n"
+                        "   </node>\n"
+                        "   <way id=\"1000\">\n"
+                        "       <nd ref=\"1\"/>\n"
+                        "       <nd ref=\"2\"/>\n"
+                        "       <tag k=\"highway\" v=\"residential\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1001\">\n"
+                        "       <nd ref=\"3\"/>\n"
+                        "       <nd ref=\"2\"/>\n"
+                        "       <tag k=\"building\" v=\"yes\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1002\">\n"
+                        "       <nd ref=\"2\"/>\n"
+                        "       <nd ref=\"5\"/>\n"
+                        "       <tag k=\"name\" v=\"Lane\"/>\n"
+                        "       <tag k=\"highway\" v=\"service\"/>\n"
+                        "   </way>\n"
+                        "</osm>";
+    auto Reader = [&]{
+        return std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM));
+    };
+    COpenStreetMap::SOptions Options;
+    Options.DWayFilter = [](const TAttributes &tags){
+        for(const auto &Tag : tags){
+            if(Tag.first == "highway"){
+                return true;
+            }
+        }
+        return false;
+    };
+    for(auto Decoding : {COpenStreetMap::ETagDecoding::Eager, COpenStreetMap::ETagDecoding::Lazy}){
+        Options.DTagDecoding = Decoding;
+        // Two passes drop unreferenced nodes too
+        COpenStreetMap TwoPass(Reader(), Reader(), Options);
+        ASSERT_EQ(TwoPass.WayCount(), 2);
+        EXPECT_EQ(TwoPass.WayByIndex(0)->ID(), 1000);
+        EXPECT_EQ(TwoPass.WayByIndex(1)->ID(), 1002);
+        EXPECT_EQ(TwoPass.WayByID(1001), nullptr);
+        EXPECT_EQ(TwoPass.WayByID(1002)->GetAttribute("name"), "Lane");
+        ASSERT_EQ(TwoPass.NodeCount(), 2);
+        EXPECT_EQ(TwoPass.NodeByIndex(0)->ID(), 1);
+        EXPECT_EQ(TwoPass.NodeByIndex(1)->ID(), 2);
+        EXPECT_EQ(TwoPass.NodeByID(2)->GetAttribute("highway"), "stop");
+        EXPECT_EQ(TwoPass.NodeByID(3), nullptr);
+        EXPECT_EQ(TwoPass.NodeByID(4), nullptr);
+        EXPECT_EQ(TwoPass.WayNodeIndices(1)[1], COpenStreetMap::InvalidNodeIndex);
+
+        // One pass can only drop ways
+        COpenStreetMap OnePass(Reader(), Options);
+        ASSERT_EQ(OnePass.WayCount(), 2);
+        EXPECT_EQ(OnePass.WayByIndex(1)->ID(), 1002);
+        EXPECT_EQ(OnePass.WayByIndex(1)->GetAttributeKey(0), "name");
+        EXPECT_EQ(OnePass.WayByIndex(1)->GetNodeID(1), 5);
+        EXPECT_EQ(OnePass.WayByIndex(0)->AttributeCount(), 1);
+        EXPECT_EQ(OnePass.NodeCount(), 4);
+    }
+
+    // Without a filter the first reader is ignored
+    COpenStreetMap Unfiltered(nullptr, Reader(), COpenStreetMap::SOptions());
+    EXPECT_EQ(Unfiltered.WayCount(), 3);
+    EXPECT_EQ(Unfiltered.NodeCount(), 4);
+}
+
+//Every node and way of actual must match expected, including order, locations, tags and refs
+static void ExpectSameMap(const COpenStreetMap &expected, const COpenStreetMap &actual){
+    ASSERT_EQ(actual.NodeCount(), expected.NodeCount());
+    ASSERT_EQ(actual.WayCount(), expected.WayCount());
+    for(std::size_t Index = 0; Index < expected.NodeCount(); Index++){
+        auto Expected = expected.NodeByIndex(Index);
+        auto Actual = actual.NodeByIndex(Index);
+        ASSERT_EQ(Actual->ID(), Expected->ID());
+        EXPECT_EQ(Actual->Location(), Expected->Location());
+        ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+            auto Key = Expected->GetAttributeKey(Attribute);
+            EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+            EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+        }
+    }
+    for(std::size_t Index = 0; Index < expected.WayCount(); Index++){
+        auto Expected = expected.WayByIndex(Index);
+        auto Actual = actual.WayByIndex(Index);
+        ASSERT_EQ(Actual->ID(), Expected->ID());
+        ASSERT_EQ(Actual->NodeCount(), Expected->NodeCount());
+        for(std::size_t Node = 0; Node < Expected->NodeCount(); Node++){
+            EXPECT_EQ(Actual->GetNodeID(Node), Expected->GetNodeID(Node));
+        }
+        auto ExpectedIndices = expected.WayNodeIndices(Index);
+        auto ActualIndices = actual.WayNodeIndices(Index);
+        EXPECT_TRUE(std::equal(ActualIndices.begin(), ActualIndices.end(), ExpectedIndices.begin(), ExpectedIndices.end()));
+        ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+            auto Key = Expected->GetAttributeKey(Attribute);
+            EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+            EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, PipelinedLoadTest){
+    //Enough elements for several batches, so batches finish out of order
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    for(int Node = 1; Node <= 1200; Node++){
+        OSM += "<node id=\"" + std::to_string(Node * 3) + "\" lat=\"38." + std::to_string(100000 + Node) + "\" lon=\"-121." + std::to_string(200000 + Node * 7) + "\"";
+        if(Node % 10 == 0){
+            OSM += "><tag k=\"highway\" v=\"stop\"/><tag k=\"ref\" v=\"" + std::to_string(Node) + "\"/></node>\n";
+        }
+        else{
+            OSM += "/>\n";
+        }
+    }
+    for(int Way = 1; Way <= 400; Way++){
+        OSM += "<way id=\"" + std::to_string(Way * 5) + "\">";
+        for(int Node = 0; Node < Way % 23 + 2; Node++){
+            OSM += "<nd ref=\"" + std::to_string(((Way * 11 + Node) % 1200 + 1) * 3) + "\"/>";
+        }
+        if(Way % 7 == 0){
+            OSM += "<nd ref=\"" + std::to_string(90000 + Way) + "\"/>";
+        }
+        OSM += std::string("<tag k=\"highway\" v=\"") + (Way % 3 ? "residential" : "primary") + "\"/>";
+        if(Way % 4 == 0){
+            OSM += "<tag k=\"name\" v=\"Street " + std::to_string(Way) + "\"/>";
+        }
+        OSM += "</way>\n";
+    }
+    OSM += "</osm>";
+    auto Reader = [&]{
+        return std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM));
+    };
+    auto Primary = [](const TAttributes &tags){
+        for(const auto &Tag : tags){
+            if((Tag.first == "highway")&&(Tag.second == "primary")){
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<COpenStreetMap::SOptions> Configurations(6);
+    Configurations[1].DTagDecoding = COpenStreetMap::ETagDecoding::Lazy;
+    Configurations[1].DWayNodeStorage = COpenStreetMap::EWayNodeStorage::Compressed;
+    Configurations[1].DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    Configurations[2].DWayFilter = Primary;
+    Configurations[3].DWayFilter = Primary;
+    //The ID indexes and ref resolution after loading are split between the threads too
+    Configurations[4].DIndexType = CIDIndex::EType::Sorted;
+    Configurations[4].DWayNodeStorage = COpenStreetMap::EWayNodeStorage::Compressed;
+    Configurations[5].DIndexType = CIDIndex::EType::OpenAddressing;
+    for(std::size_t Configuration = 0; Configuration < Configurations.size(); Configuration++){
+        auto Options = Configurations[Configuration];
+        Options.DThreadCount = 1;
+        //The fourth configuration uses the two pass filter
+        bool TwoPass = Configuration == 3;
+        auto Serial = TwoPass ? COpenStreetMap(Reader(), Reader(), Options) : COpenStreetMap(Reader(), Options);
+        EXPECT_GT(Serial.WayCount(), 0);
+        Options.DPipelinedLoad = true;
+        for(std::size_t Threads : {1, 3, 8}){
+            Options.DThreadCount = Threads;
+            auto Pipelined = TwoPass ? COpenStreetMap(Reader(), Reader(), Options) : COpenStreetMap(Reader(), Options);
+            ExpectSameMap(Serial, Pipelined);
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, PipelinedErrorTest){
+    //Many batches, so the reader and converters are still busy when one element fails
+    auto MakeOSM = [](const std::string &badnode, const std::string &badref){
+        std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+        for(int Node = 1; Node <= 5000; Node++){
+            auto ID = Node == 700 ? badnode : std::to_string(Node);
+            OSM += "<node id=\"" + ID + "\" lat=\"38.5\" lon=\"-121.7\"/>\n";
+        }
+        for(int Way = 1; Way <= 2000; Way++){
+            OSM += "<way id=\"" + std::to_string(Way) + "\"><nd ref=\"" + (Way == 30 ? badref : std::to_string(Way)) + "\"/><tag k=\"highway\" v=\"residential\"/></way>\n";
+        }
+        return OSM + "</osm>";
+    };
+    auto Load = [](const std::string &osm, COpenStreetMap::SOptions options){
+        COpenStreetMap OpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(osm)), options);
+        return OpenStreetMap.NodeCount();
+    };
+    COpenStreetMap::SOptions Options;
+    EXPECT_EQ(Load(MakeOSM("700", "30"), Options), 5000);
+    EXPECT_THROW(Load(MakeOSM("x700", "30"), Options), std::invalid_argument);
+    EXPECT_THROW(Load(MakeOSM("700", "ref"), Options), std::invalid_argument);
+    Options.DPipelinedLoad = true;
+    for(std::size_t Threads : {1, 3, 8}){
+        Options.DThreadCount = Threads;
+        //Malformed numbers throw as a serial load does instead of becoming 0
+        EXPECT_THROW(Load(MakeOSM("x700", "30"), Options), std::invalid_argument);
+        EXPECT_THROW(Load(MakeOSM("700", "ref"), Options), std::invalid_argument);
+        //An exception on the appending thread reaches the caller after every thread has stopped
+        auto Throwing = Options;
+        Throwing.DWayFilter = [](const TAttributes &){
+            throw std::runtime_error("filter failed");
+            return true;
+        };
+        EXPECT_THROW(Load(MakeOSM("700", "30"), Throwing), std::runtime_error);
+        EXPECT_EQ(Load(MakeOSM("700", "30"), Options), 5000);
+    }
+}
+
+TEST(OpenStreetMapTest, ForEachTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"10\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"20\" lat=\"38.6\" lon=\"-121.8\">\n"
+                        "       <tag k=\"highway\" v=\"stop\"/>\n"
+                        "   </node>\n"
+                        "   <node id=\"30\" lat=\"38.7\" lon=\"-121.9\"/>\n"
+                        "   <way id=\"1000\">\n"
+                        "       <nd ref=\"10\"/>\n"
+                        "       <nd ref=\"20\"/>\n"
+                        "       <tag k=\"highway\" v=\"residential\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"1001\">\n"
+                        "       <nd ref=\"30\"/>\n"
+                        "   </way>\n"
+                        "</osm>";
+    COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)));
+    const CStreetMap &StreetMap = OpenStreetMap;
+    std::vector<std::size_t> Indices;
+    std::vector<CStreetMap::TNodeID> NodeIDs;
+    StreetMap.ForEachNode([&](std::size_t index, const CStreetMap::SNode &node){
+        Indices.push_back(index);
+        NodeIDs.push_back(node.ID());
+    });
+    EXPECT_EQ(Indices, std::vector<std::size_t>({0, 1, 2}));
+    EXPECT_EQ(NodeIDs, std::vector<CStreetMap::TNodeID>({10, 20, 30}));
+
+    std::vector<std::string> Highways;
+    StreetMap.ForEachWay([&](std::size_t index, const CStreetMap::SWay &way){
+        EXPECT_EQ(way.ID(), OpenStreetMap.WayByIndex(index)->ID());
+        Highways.push_back(way.GetAttribute("highway"));
+    });
+    EXPECT_EQ(Highways, std::vector<std::string>({"residential", ""}));
+
+    //Ranges are clipped to the map
+    NodeIDs.clear();
+    StreetMap.ForEachNodeInRange(1, 10, [&](std::size_t index, const CStreetMap::SNode &node){
+        NodeIDs.push_back(node.ID());
+    });
+    EXPECT_EQ(NodeIDs, std::vector<CStreetMap::TNodeID>({20, 30}));
+
+    //The base class version goes through NodeByIndex and must agree
+    NodeIDs.clear();
+    StreetMap.CStreetMap::ForEachNodeInRange(0, 10, [&](std::size_t index, const CStreetMap::SNode &node){
+        NodeIDs.push_back(node.ID());
+    });
+    EXPECT_EQ(NodeIDs, std::vector<CStreetMap::TNodeID>({10, 20, 30}));
+    std::size_t WayNodes = 0;
+    StreetMap.CStreetMap::ForEachWayInRange(0, 10, [&](std::size_t index, const CStreetMap::SWay &way){
+        WayNodes += way.NodeCount();
+    });
+    EXPECT_EQ(WayNodes, 3);
+
+    for(std::size_t Threads : {1, 2, 3, 8}){
+        std::vector<std::atomic<int>> Visits(OpenStreetMap.NodeCount());
+        std::atomic<uint64_t> IDSum = 0;
+        StreetMap.ParallelForEachNode([&](std::size_t index, const CStreetMap::SNode &node){
+            Visits[index]++;
+            IDSum += node.ID();
+        }, Threads);
+        for(const auto &Count : Visits){
+            EXPECT_EQ(Count, 1);
+        }
+        EXPECT_EQ(IDSum, 60);
+        std::atomic<std::size_t> Tagged = 0;
+        StreetMap.ParallelForEachWay([&](std::size_t index, const CStreetMap::SWay &way){
+            Tagged += way.AttributeCount();
+        }, Threads);
+        EXPECT_EQ(Tagged, 1);
+    }
+}
+
+TEST(OpenStreetMapTest, BatchLookupTest){
+    std::string OSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                        "   <node id=\"10\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                        "   <node id=\"30\" lat=\"38.6\" lon=\"-121.8\"/>\n"
+                        "   <node id=\"20\" lat=\"38.7\" lon=\"-121.9\"/>\n"
+                        "   <way id=\"1000\">\n"
+                        "       <nd ref=\"10\"/>\n"
+                        "   </way>\n"
+                        "   <way id=\"999\">\n"
+                        "       <nd ref=\"30\"/>\n"
+                        "   </way>\n"
+                        "</osm>";
+    for(auto Type : {CIDIndex::EType::Hash, CIDIndex::EType::Sorted, CIDIndex::EType::OpenAddressing}){
+        for(auto Storage : {COpenStreetMap::ECoordinateStorage::Double, COpenStreetMap::ECoordinateStorage::FixedPoint}){
+            COpenStreetMap::SOptions Options;
+            Options.DIndexType = Type;
+            Options.DCoordinateStorage = Storage;
+            COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(OSM)), Options);
+            std::vector<CStreetMap::TNodeID> NodeIDs{20, 11, 10, 30, 20};
+            std::vector<std::size_t> Indices;
+            EXPECT_EQ(OpenStreetMap.NodeIndicesByID(NodeIDs, Indices), 4);
+            EXPECT_EQ(Indices, std::vector<std::size_t>({2, COpenStreetMap::InvalidIndex, 0, 1, 2}));
+            std::vector<CStreetMap::TWayID> WayIDs{999, 1000, 1001};
+            EXPECT_EQ(OpenStreetMap.WayIndicesByID(WayIDs, Indices), 2);
+            EXPECT_EQ(Indices, std::vector<std::size_t>({1, 0, COpenStreetMap::InvalidIndex}));
+
+            std::vector<CStreetMap::SLocation> Locations;
+            const CStreetMap &StreetMap = OpenStreetMap;
+            EXPECT_EQ(StreetMap.NodeLocationsByID(NodeIDs, Locations), 4);
+            ASSERT_EQ(Locations.size(), NodeIDs.size());
+            EXPECT_EQ(Locations[0], CStreetMap::SLocation(38.7, -121.9));
+            EXPECT_TRUE(std::isnan(Locations[1].DLatitude));
+            EXPECT_TRUE(std::isnan(Locations[1].DLongitude));
+            EXPECT_EQ(Locations[3], CStreetMap::SLocation(38.6, -121.8));
+            //The base class version must agree
+            std::vector<CStreetMap::SLocation> Expected;
+            EXPECT_EQ(StreetMap.CStreetMap::NodeLocationsByID(NodeIDs, Expected), 4);
+            EXPECT_EQ(Expected[4], Locations[4]);
+            EXPECT_TRUE(std::isnan(Expected[1].DLatitude));
+        }
+    }
+}
+
+static const std::string ChangeBaseOSM =    "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                            "   <node id=\"1\" lat=\"38.50\" lon=\"-121.70\"/>\n"
+                                            "   <node id=\"2\" lat=\"38.51\" lon=\"-121.71\">\n"
+                                            "       <tag k=\"highway\" v=\"stop\"/>\n"
+                                            "   </node>\n"
+                                            "   <node id=\"3\" lat=\"38.52\" lon=\"-121.72\"/>\n"
+                                            "   <node id=\"4\" lat=\"38.53\" lon=\"-121.73\"/>\n"
+                                            "   <node id=\"5\" lat=\"38.54\" lon=\"-121.74\"/>\n"
+                                            "   <way id=\"100\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"101\">\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <tag k=\"highway\" v=\"service\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"102\">\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <nd ref=\"5\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "</osm>";
+
+static const std::string ChangeOSC =    "<osmChange version=\"0.6\" generator=\"osmium/1.14\">\n"
+                                        "   <create>\n"
+                                        "       <node id=\"6\" lat=\"38.60\" lon=\"-121.80\">\n"
+                                        "           <tag k=\"amenity\" v=\"bench\"/>\n"
+                                        "       </node>\n"
+                                        "       <way id=\"103\">\n"
+                                        "           <nd ref=\"5\"/>\n"
+                                        "           <nd ref=\"6\"/>\n"
+                                        "           <nd ref=\"7\"/>\n"
+                                        "           <tag k=\"highway\" v=\"residential\"/>\n"
+                                        "       </way>\n"
+                                        "       <node id=\"7\" lat=\"38.61\" lon=\"-121.81\"/>\n"
+                                        "   </create>\n"
+                                        "   <modify>\n"
+                                        "       <node id=\"2\" lat=\"38.55\" lon=\"-121.75\">\n"
+                                        "           <tag k=\"highway\" v=\"traffic_signals\"/>\n"
+                                        "           <tag k=\"name\" v=\"Main\"/>\n"
+                                        "       </node>\n"
+                                        "       <way id=\"100\">\n"
+                                        "           <nd ref=\"2\"/>\n"
+                                        "           <nd ref=\"3\"/>\n"
+                                        "           <nd ref=\"6\"/>\n"
+                                        "           <nd ref=\"5\"/>\n"
+                                        "           <tag k=\"highway\" v=\"tertiary\"/>\n"
+                                        "       </way>\n"
+                                        "   </modify>\n"
+                                        "   <delete>\n"
+                                        "       <way id=\"101\"/>\n"
+                                        "       <node id=\"1\"/>\n"
+                                        "       <node id=\"4\" lat=\"38.53\" lon=\"-121.73\"/>\n"
+                                        "       <node id=\"99\"/>\n"
+                                        "   </delete>\n"
+                                        "   <delete>\n"
+                                        "       <way id=\"102\"/>\n"
+                                        "   </delete>\n"
+                                        "</osmChange>";
+
+//ChangeBaseOSM with ChangeOSC applied
+static const std::string ChangedOSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                        "   <node id=\"2\" lat=\"38.55\" lon=\"-121.75\">\n"
+                                        "       <tag k=\"highway\" v=\"traffic_signals\"/>\n"
+                                        "       <tag k=\"name\" v=\"Main\"/>\n"
+                                        "   </node>\n"
+                                        "   <node id=\"3\" lat=\"38.52\" lon=\"-121.72\"/>\n"
+                                        "   <node id=\"5\" lat=\"38.54\" lon=\"-121.74\"/>\n"
+                                        "   <node id=\"6\" lat=\"38.60\" lon=\"-121.80\">\n"
+                                        "       <tag k=\"amenity\" v=\"bench\"/>\n"
+                                        "   </node>\n"
+                                        "   <node id=\"7\" lat=\"38.61\" lon=\"-121.81\"/>\n"
+                                        "   <way id=\"100\">\n"
+                                        "       <nd ref=\"2\"/>\n"
+                                        "       <nd ref=\"3\"/>\n"
+                                        "       <nd ref=\"6\"/>\n"
+                                        "       <nd ref=\"5\"/>\n"
+                                        "       <tag k=\"highway\" v=\"tertiary\"/>\n"
+                                        "   </way>\n"
+                                        "   <way id=\"103\">\n"
+                                        "       <nd ref=\"5\"/>\n"
+                                        "       <nd ref=\"6\"/>\n"
+                                        "       <nd ref=\"7\"/>\n"
+                                        "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                        "   </way>\n"
+                                        "</osm>";
+
+//Changes may reorder rows, so objects are matched by ID and resolved refs must agree with the ID index
+static void ExpectSameByID(const COpenStreetMap &expected, const COpenStreetMap &actual){
+    ASSERT_EQ(actual.NodeCount(), expected.NodeCount());
+    ASSERT_EQ(actual.WayCount(), expected.WayCount());
+    for(std::size_t Index = 0; Index < expected.NodeCount(); Index++){
+        auto Expected = expected.NodeByIndex(Index);
+        auto Actual = actual.NodeByID(Expected->ID());
+        ASSERT_NE(Actual, nullptr);
+        EXPECT_EQ(Actual->Location(), Expected->Location());
+        ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+            auto Key = Expected->GetAttributeKey(Attribute);
+            EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+            EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+        }
+    }
+    std::vector<std::size_t> WayIndices;
+    std::vector<CStreetMap::TWayID> WayIDs;
+    for(std::size_t Index = 0; Index < expected.WayCount(); Index++){
+        WayIDs.push_back(expected.WayByIndex(Index)->ID());
+    }
+    ASSERT_EQ(actual.WayIndicesByID(WayIDs, WayIndices), WayIDs.size());
+    for(std::size_t Index = 0; Index < expected.WayCount(); Index++){
+        auto Expected = expected.WayByIndex(Index);
+        auto Actual = actual.WayByIndex(WayIndices[Index]);
+        ASSERT_EQ(Actual->ID(), Expected->ID());
+        ASSERT_EQ(Actual->NodeCount(), Expected->NodeCount());
+        auto NodeIndices = actual.WayNodeIndices(WayIndices[Index]);
+        ASSERT_EQ(NodeIndices.size(), Expected->NodeCount());
+        for(std::size_t Node = 0; Node < Expected->NodeCount(); Node++){
+            EXPECT_EQ(Actual->GetNodeID(Node), Expected->GetNodeID(Node));
+            auto NodeIndex = actual.NodeByID(Expected->GetNodeID(Node));
+            if(NodeIndex){
+                EXPECT_EQ(actual.NodeByIndex(NodeIndices[Node])->ID(), Expected->GetNodeID(Node));
+            }
+            else{
+                EXPECT_EQ(NodeIndices[Node], COpenStreetMap::InvalidNodeIndex);
+            }
+        }
+        ASSERT_EQ(Actual->AttributeCount(), Expected->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Expected->AttributeCount(); Attribute++){
+            auto Key = Expected->GetAttributeKey(Attribute);
+            EXPECT_EQ(Actual->GetAttributeKey(Attribute), Key);
+            EXPECT_EQ(Actual->GetAttribute(Key), Expected->GetAttribute(Key));
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, ApplyChangesTest){
+    for(auto Type : {CIDIndex::EType::Hash, CIDIndex::EType::Sorted, CIDIndex::EType::OpenAddressing}){
+        for(auto Decoding : {COpenStreetMap::ETagDecoding::Eager, COpenStreetMap::ETagDecoding::Lazy, COpenStreetMap::ETagDecoding::LazyMemoized}){
+            for(auto Storage : {COpenStreetMap::EWayNodeStorage::Plain, COpenStreetMap::EWayNodeStorage::Compressed}){
+                COpenStreetMap::SOptions Options;
+                Options.DIndexType = Type;
+                Options.DTagDecoding = Decoding;
+                Options.DWayNodeStorage = Storage;
+                Options.DCoordinateStorage = Storage == COpenStreetMap::EWayNodeStorage::Plain ? COpenStreetMap::ECoordinateStorage::Double : COpenStreetMap::ECoordinateStorage::FixedPoint;
+                COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)), Options);
+                //Memoized tags of changed objects must not be served from the cache
+                EXPECT_EQ(OpenStreetMap.NodeByID(2)->GetAttribute("highway"), "stop");
+                EXPECT_EQ(OpenStreetMap.WayByID(102)->GetAttribute("highway"), "residential");
+                EXPECT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeOSC))));
+                COpenStreetMap Expected(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangedOSM)), Options);
+                ExpectSameByID(Expected, OpenStreetMap);
+                EXPECT_EQ(OpenStreetMap.NodeByID(1), nullptr);
+                EXPECT_EQ(OpenStreetMap.NodeByID(4), nullptr);
+                EXPECT_EQ(OpenStreetMap.WayByID(101), nullptr);
+                EXPECT_EQ(OpenStreetMap.WayByID(102), nullptr);
+                //Applying the same change again leaves the map as it is
+                EXPECT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeOSC))));
+                ExpectSameByID(Expected, OpenStreetMap);
+            }
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, ApplyChangesIndexTest){
+    COpenStreetMap::SOptions Options;
+    Options.DBuildWayRTree = true;
+    Options.DBuildNodeKDTree = true;
+    Options.DBuildTagIndex = true;
+    COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)), Options);
+    ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeOSC))));
+    EXPECT_EQ(OpenStreetMap.WayRTree().Count(), 2);
+    EXPECT_EQ(OpenStreetMap.NodeKDTree().Count(), 5);
+    auto Nearest = OpenStreetMap.NodeKDTree().Nearest({38.601, -121.801});
+    EXPECT_EQ(OpenStreetMap.NodeByIndex(Nearest.DItem)->ID(), 6);
+    std::vector<uint32_t> Ways;
+    EXPECT_EQ(OpenStreetMap.WaysInBox({38.605, -121.815, 38.615, -121.805}, Ways), 1);
+    EXPECT_EQ(OpenStreetMap.WayByIndex(Ways[0])->ID(), 103);
+    auto Residential = OpenStreetMap.WayTagIndex().Find("highway", "residential");
+    ASSERT_EQ(Residential.size(), 1);
+    EXPECT_EQ(OpenStreetMap.WayByIndex(Residential[0])->ID(), 103);
+    EXPECT_TRUE(OpenStreetMap.WayTagIndex().Find("highway", "service").empty());
+    auto Benches = OpenStreetMap.NodeTagIndex().Find("amenity", "bench");
+    ASSERT_EQ(Benches.size(), 1);
+    EXPECT_EQ(OpenStreetMap.NodeByIndex(Benches[0])->ID(), 6);
+
+    //Indexes updated over many changes answer as a scan of the changed map does
+    std::mt19937 Generator(11);
+    for(int Round = 0; Round < 30; Round++){
+        std::string Change = "<osmChange version=\"0.6\"><modify>";
+        for(int Node = 0; Node < 6; Node++){
+            auto ID = std::to_string(1 + Generator() % 12);
+            Change += "<node id=\"" + ID + "\" lat=\"" + std::to_string(38.5 + (Generator() % 100) * 0.001) + "\" lon=\"" + std::to_string(-121.8 + (Generator() % 100) * 0.001) + "\">";
+            Change += Generator() % 2 ? "<tag k=\"amenity\" v=\"bench\"/></node>" : "</node>";
+        }
+        for(int Way = 0; Way < 2; Way++){
+            Change += "<way id=\"" + std::to_string(100 + Generator() % 6) + "\">";
+            for(auto Refs = 1 + Generator() % 4; Refs; Refs--){
+                Change += "<nd ref=\"" + std::to_string(1 + Generator() % 12) + "\"/>";
+            }
+            Change += Generator() % 2 ? "<tag k=\"highway\" v=\"residential\"/></way>" : "<tag k=\"highway\" v=\"service\"/></way>";
+        }
+        Change += "</modify><delete><node id=\"" + std::to_string(1 + Generator() % 12) + "\"/><way id=\"" + std::to_string(100 + Generator() % 6) + "\"/></delete></osmChange>";
+        ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Change))));
+
+        ASSERT_EQ(OpenStreetMap.NodeKDTree().Count(), OpenStreetMap.NodeCount());
+        //Ways with none of their nodes in the map have no bounds and are not in the R-tree
+        std::size_t Bounded = 0;
+        for(std::size_t Index = 0; Index < OpenStreetMap.WayCount(); Index++){
+            Bounded += !OpenStreetMap.WayBounds(Index).Empty();
+        }
+        ASSERT_EQ(OpenStreetMap.WayRTree().Count(), Bounded);
+        for(CRTree::SBox Box : {CRTree::SBox{38.5, -121.8, 38.55, -121.75}, CRTree::SBox{38.55, -121.75, 38.6, -121.7}}){
+            std::vector<uint32_t> Expected;
+            for(std::size_t Index = 0; Index < OpenStreetMap.WayCount(); Index++){
+                auto Bounds = OpenStreetMap.WayBounds(Index);
+                if(!Bounds.Empty() && Bounds.Intersects(Box)){
+                    Expected.push_back(Index);
+                }
+            }
+            OpenStreetMap.WaysInBox(Box, Ways);
+            EXPECT_EQ(Ways, Expected);
+        }
+        CStreetMap::SLocation Query{38.55, -121.75};
+        std::size_t Closest = 0;
+        for(std::size_t Index = 1; Index < OpenStreetMap.NodeCount(); Index++){
+            if(SGeographicUtils::HaversineDistanceInMeters(OpenStreetMap.NodeByIndex(Index)->Location(), Query) < SGeographicUtils::HaversineDistanceInMeters(OpenStreetMap.NodeByIndex(Closest)->Location(), Query)){
+                Closest = Index;
+            }
+        }
+        EXPECT_EQ(OpenStreetMap.NodeKDTree().Nearest(Query).DItem, Closest);
+        std::vector<uint32_t> ExpectedBenches, ExpectedResidential;
+        for(std::size_t Index = 0; Index < OpenStreetMap.NodeCount(); Index++){
+            if(OpenStreetMap.NodeByIndex(Index)->GetAttribute("amenity") == "bench"){
+                ExpectedBenches.push_back(Index);
+            }
+        }
+        for(std::size_t Index = 0; Index < OpenStreetMap.WayCount(); Index++){
+            if(OpenStreetMap.WayByIndex(Index)->GetAttribute("highway") == "residential"){
+                ExpectedResidential.push_back(Index);
+            }
+        }
+        Benches = OpenStreetMap.NodeTagIndex().Find("amenity", "bench");
+        EXPECT_EQ(std::vector<uint32_t>(Benches.begin(), Benches.end()), ExpectedBenches);
+        Residential = OpenStreetMap.WayTagIndex().Find("highway", "residential");
+        EXPECT_EQ(std::vector<uint32_t>(Residential.begin(), Residential.end()), ExpectedResidential);
+    }
+}
+
+TEST(OpenStreetMapTest, ApplyChangesRepeatedTest){
+    //Many rewrites of the same objects leave mostly unused storage, which is compacted along the way
+    for(auto Decoding : {COpenStreetMap::ETagDecoding::Eager, COpenStreetMap::ETagDecoding::LazyMemoized}){
+        for(auto Storage : {COpenStreetMap::EWayNodeStorage::Plain, COpenStreetMap::EWayNodeStorage::Compressed}){
+            COpenStreetMap::SOptions Options;
+            Options.DTagDecoding = Decoding;
+            Options.DWayNodeStorage = Storage;
+            COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)), Options);
+            for(int Round = 0; Round < 40; Round++){
+                auto Name = std::to_string(Round);
+                std::string Change =    "<osmChange version=\"0.6\"><modify>"
+                                        "<node id=\"3\" lat=\"38.52\" lon=\"-121.72\"><tag k=\"name\" v=\"" + Name + "\"/></node>"
+                                        "<way id=\"101\"><nd ref=\"3\"/><nd ref=\"4\"/><nd ref=\"" + Name + "\"/><tag k=\"name\" v=\"" + Name + "\"/></way>"
+                                        "</modify><create>"
+                                        "<node id=\"" + std::to_string(1000 + Round) + "\" lat=\"38.7\" lon=\"-121.9\"/>"
+                                        "</create></osmChange>";
+                ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Change))));
+                EXPECT_EQ(OpenStreetMap.NodeByID(3)->GetAttribute("name"), Name);
+                auto Way = OpenStreetMap.WayByID(101);
+                ASSERT_EQ(Way->NodeCount(), 3);
+                EXPECT_EQ(Way->GetNodeID(2), Round);
+                EXPECT_EQ(Way->GetAttribute("name"), Name);
+            }
+            EXPECT_EQ(OpenStreetMap.NodeCount(), 45);
+            EXPECT_EQ(OpenStreetMap.WayByID(100)->GetAttribute("highway"), "residential");
+            EXPECT_EQ(OpenStreetMap.WayByID(102)->GetNodeID(1), 5);
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, ApplyChangesCompressedTest){
+    //Compressed refs take their IDs from node rows, so removals that move rows must keep every way naming the same nodes as plain refs do
+    COpenStreetMap::SOptions Options;
+    COpenStreetMap Plain(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)), Options);
+    Options.DWayNodeStorage = COpenStreetMap::EWayNodeStorage::Compressed;
+    COpenStreetMap Compressed(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)), Options);
+    std::mt19937 Generator(23);
+    std::vector<CStreetMap::TNodeID> Iterated;
+    for(int Round = 0; Round < 60; Round++){
+        std::string Change = "<osmChange version=\"0.6\"><create>";
+        for(int Node = 0; Node < 3; Node++){
+            Change += "<node id=\"" + std::to_string(1 + Generator() % 12) + "\" lat=\"38.5\" lon=\"-121.7\"/>";
+        }
+        auto WayID = std::to_string(100 + Generator() % 6);
+        Change += "<way id=\"" + WayID + "\">";
+        for(auto Refs = 1 + Generator() % 5; Refs; Refs--){
+            Change += "<nd ref=\"" + std::to_string(1 + Generator() % 12) + "\"/>";
+        }
+        Change += "</way></create><delete>";
+        for(int Node = 0; Node < 3; Node++){
+            Change += "<node id=\"" + std::to_string(1 + Generator() % 12) + "\"/>";
+        }
+        Change += Round % 4 ? "" : "<way id=\"" + std::to_string(100 + Generator() % 6) + "\"/>";
+        Change += "</delete></osmChange>";
+        ASSERT_TRUE(Plain.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Change))));
+        ASSERT_TRUE(Compressed.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Change))));
+        ExpectSameByID(Plain, Compressed);
+        for(std::size_t Index = 0; Index < Compressed.WayCount(); Index++){
+            auto Way = Compressed.WayByIndex(Index);
+            Iterated.clear();
+            for(auto ID : Compressed.WayNodeIDs(Index)){
+                Iterated.push_back(ID);
+            }
+            ASSERT_EQ(Iterated.size(), Way->NodeCount());
+            for(std::size_t Node = 0; Node < Way->NodeCount(); Node++){
+                EXPECT_EQ(Iterated[Node], Plain.WayByID(Way->ID())->GetNodeID(Node));
+            }
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, ApplyChangesCreatedNodeTest){
+    //Way 10 names node 2 before it exists, creating it must resolve the unchanged way as a fresh load would
+    std::string Base =  "<osm version=\"0.6\">"
+                        "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/></way>"
+                        "<way id=\"11\"><nd ref=\"3\"/><nd ref=\"1\"/></way>"
+                        "</osm>";
+    std::string Change =    "<osmChange version=\"0.6\"><create>"
+                            "<node id=\"2\" lat=\"38.6\" lon=\"-121.8\"/>"
+                            "</create></osmChange>";
+    std::string Fresh = "<osm version=\"0.6\">"
+                        "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                        "<node id=\"2\" lat=\"38.6\" lon=\"-121.8\"/>"
+                        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/></way>"
+                        "<way id=\"11\"><nd ref=\"3\"/><nd ref=\"1\"/></way>"
+                        "</osm>";
+    for(auto Type : {CIDIndex::EType::Hash, CIDIndex::EType::Sorted, CIDIndex::EType::OpenAddressing}){
+        for(auto Storage : {COpenStreetMap::EWayNodeStorage::Plain, COpenStreetMap::EWayNodeStorage::Compressed}){
+            COpenStreetMap::SOptions Options;
+            Options.DIndexType = Type;
+            Options.DWayNodeStorage = Storage;
+            COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Base)), Options);
+            EXPECT_EQ(OpenStreetMap.WayNodeIndices(0)[1], COpenStreetMap::InvalidNodeIndex);
+            ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Change))));
+            COpenStreetMap Expected(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(Fresh)), Options);
+            ExpectSameByID(Expected, OpenStreetMap);
+            std::vector<CStreetMap::SLocation> Locations;
+            EXPECT_EQ(OpenStreetMap.WayLocations(0, Locations), 2);
+            //Node 3 is still missing
+            EXPECT_EQ(OpenStreetMap.WayNodeIndices(1)[0], COpenStreetMap::InvalidNodeIndex);
+        }
+    }
+}
+
+TEST(OpenStreetMapTest, ApplyChangesHandleTest){
+    COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)));
+    auto LastNode = OpenStreetMap.NodeByIndex(OpenStreetMap.NodeCount() - 1);
+    auto LastWay = OpenStreetMap.WayByIndex(OpenStreetMap.WayCount() - 1);
+    auto LastWayID = LastWay->ID();
+    //Modifying keeps every row, so handles stay current and see the change
+    ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(
+        "<osmChange version=\"0.6\"><modify><node id=\"3\" lat=\"38.52\" lon=\"-121.72\"><tag k=\"name\" v=\"Third\"/></node></modify></osmChange>"))));
+    EXPECT_EQ(OpenStreetMap.NodeByID(3)->GetAttribute("name"), "Third");
+    EXPECT_NE(LastNode->ID(), CStreetMap::InvalidNodeID);
+    EXPECT_EQ(LastWay->ID(), LastWayID);
+    //Removing nodes shrinks the node columns, older node handles must not read past them
+    ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(
+        "<osmChange version=\"0.6\"><delete><node id=\"1\"/><node id=\"2\"/><node id=\"3\"/></delete></osmChange>"))));
+    EXPECT_EQ(LastNode->ID(), CStreetMap::InvalidNodeID);
+    EXPECT_TRUE(std::isnan(LastNode->Location().DLatitude));
+    EXPECT_EQ(LastNode->AttributeCount(), 0);
+    EXPECT_FALSE(LastNode->HasAttribute("highway"));
+    EXPECT_EQ(LastNode->GetAttribute("highway"), "");
+    EXPECT_EQ(LastWay->ID(), LastWayID);
+    //Removing a way does the same for older way handles
+    ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(
+        "<osmChange version=\"0.6\"><delete><way id=\"100\"/></delete></osmChange>"))));
+    EXPECT_EQ(LastWay->ID(), CStreetMap::InvalidWayID);
+    EXPECT_EQ(LastWay->NodeCount(), 0);
+    EXPECT_EQ(LastWay->GetNodeID(0), CStreetMap::InvalidNodeID);
+    EXPECT_EQ(LastWay->GetAttributeKey(0), "");
+    //Handles taken afterwards are current again
+    EXPECT_EQ(OpenStreetMap.WayByID(LastWayID)->ID(), LastWayID);
+}
+
+TEST(OpenStreetMapTest, ApplyChangesErrorTest){
+    COpenStreetMap OpenStreetMap(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)));
+    EXPECT_FALSE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangedOSM))));
+    EXPECT_FALSE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(""))));
+    EXPECT_EQ(OpenStreetMap.NodeCount(), 5);
+    EXPECT_EQ(OpenStreetMap.WayCount(), 3);
+    //Elements with an ID or ref that is not a number are skipped rather than read as 0, and so are nodes with a bad or missing coordinate
+    std::size_t Skipped = 0;
+    ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(
+        "<osmChange version=\"0.6\"><create><node id=\"x9\" lat=\"1\" lon=\"2\"/><way id=\"900\"><nd ref=\"1\"/><nd ref=\"two\"/></way>"
+        "<node id=\"7\" lat=\"38.5x\" lon=\"-121.7\"/><node id=\"8\" lat=\"38.5\"/><node id=\"9\" lat=\"nan\" lon=\"-121.7\"/></create>"
+        "<modify><node id=\"1\" lat=\"\" lon=\"-121.7\"/></modify>"
+        "<delete><node id=\"\"/><node id=\"5\" lat=\"bad\"/></delete></osmChange>")), Skipped));
+    EXPECT_EQ(Skipped, 7);
+    EXPECT_EQ(OpenStreetMap.NodeCount(), 4);
+    EXPECT_EQ(OpenStreetMap.NodeByID(5), nullptr);
+    EXPECT_EQ(OpenStreetMap.NodeByID(1)->Location().DLatitude, 38.50);
+    ASSERT_TRUE(OpenStreetMap.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(
+        "<osmChange version=\"0.6\"><create><node id=\"5\" lat=\"38.5\" lon=\"-121.7\"/></create></osmChange>")), Skipped));
+    EXPECT_EQ(Skipped, 0);
+    EXPECT_EQ(OpenStreetMap.NodeCount(), 5);
+    EXPECT_EQ(OpenStreetMap.WayCount(), 3);
+    EXPECT_EQ(OpenStreetMap.NodeByID(0), nullptr);
+    EXPECT_EQ(OpenStreetMap.WayByID(900), nullptr);
+    //A way filter drops changed ways it would not have loaded
+    COpenStreetMap::SOptions Options;
+    Options.DWayFilter = [](const TAttributes &tags){
+        for(const auto &Tag : tags){
+            if((Tag.first == "highway")&&(Tag.second == "residential")){
+                return true;
+            }
+        }
+        return false;
+    };
+    COpenStreetMap Filtered(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeBaseOSM)), Options);
+    EXPECT_EQ(Filtered.WayCount(), 2);
+    ASSERT_TRUE(Filtered.ApplyChanges(std::make_shared< CXMLReader >(std::make_shared<CStringDataSource>(ChangeOSC))));
+    EXPECT_EQ(Filtered.WayCount(), 1);
+    EXPECT_EQ(Filtered.WayByID(100), nullptr);
+    EXPECT_NE(Filtered.WayByID(103), nullptr);
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include "RTree.h"
+#include "StringDataSink.h"
+#include "StringDataSource.h"
+#include <random>
+
+static std::vector<CRTree::SBox> RandomBoxes(std::size_t count){
+    std::mt19937 Generator(17);
+    std::uniform_real_distribution<double> Latitude(38.0, 39.0);
+    std::uniform_real_distribution<double> Longitude(-122.0, -121.0);
+    std::uniform_real_distribution<double> Size(0.0, 0.02);
+    std::vector<CRTree::SBox> Boxes;
+    for(std::size_t Index = 0; Index < count; Index++){
+        auto MinLatitude = Latitude(Generator);
+        auto MinLongitude = Longitude(Generator);
+        Boxes.push_back({MinLatitude, MinLongitude, MinLatitude + Size(Generator), MinLongitude + Size(Generator)});
+    }
+    return Boxes;
+}
+
+static std::vector<uint32_t> LinearQuery(const std::vector<CRTree::SBox> &boxes, const CRTree::SBox &box){
+    std::vector<uint32_t> Items;
+    for(std::size_t Index = 0; Index < boxes.size(); Index++){
+        if(!boxes[Index].Empty() && boxes[Index].Intersects(box)){
+            Items.push_back(Index);
+        }
+    }
+    return Items;
+}
+
+TEST(RTreeTest, EmptyTest){
+    CRTree Tree;
+    std::vector<uint32_t> Items{7};
+    EXPECT_EQ(Tree.Count(), 0);
+    EXPECT_TRUE(Tree.Bounds().Empty());
+    EXPECT_EQ(Tree.Query({-90, -180, 90, 180}, Items), 0);
+    EXPECT_TRUE(Items.empty());
+
+    Tree.Build({CRTree::SBox::EmptyBox()});
+    EXPECT_EQ(Tree.Count(), 0);
+}
+
+TEST(RTreeTest, QueryTest){
+    auto Boxes = RandomBoxes(5000);
+    // Ways with no nodes have empty boxes and are never reported
+    Boxes[42] = CRTree::SBox::EmptyBox();
+    for(std::size_t Threads : {1, 4}){
+        CRTree Tree;
+        Tree.Build(Boxes, Threads);
+        EXPECT_EQ(Tree.Count(), Boxes.size() - 1);
+        auto Bounds = Tree.Bounds();
+        EXPECT_GE(Bounds.DMinLatitude, 38.0);
+        EXPECT_LE(Bounds.DMaxLongitude, -120.98);
+
+        std::vector<uint32_t> Items;
+        for(const auto &Query : RandomBoxes(50)){
+            Tree.Query(Query, Items);
+            EXPECT_EQ(Items, LinearQuery(Boxes, Query));
+        }
+        // Point queries and a query covering everything
+        CRTree::SBox Point{Boxes[7].DMinLatitude, Boxes[7].DMinLongitude, Boxes[7].DMinLatitude, Boxes[7].DMinLongitude};
+        Tree.Query(Point, Items);
+        EXPECT_EQ(Items, LinearQuery(Boxes, Point));
+        EXPECT_NE(std::find(Items.begin(), Items.end(), 7), Items.end());
+        EXPECT_EQ(Tree.Query({-90, -180, 90, 180}, Items), Boxes.size() - 1);
+        EXPECT_EQ(Tree.Query({0, 0, 1, 1}, Items), 0);
+    }
+}
+
+TEST(RTreeTest, UpdateTest){
+    auto Boxes = RandomBoxes(2000);
+    auto Moves = RandomBoxes(600);
+    CRTree Tree;
+    Tree.Build(Boxes, 1);
+    std::vector<uint32_t> Items;
+    std::mt19937 Generator(5);
+    // Moves, removals and new items, enough to pass the rebuild threshold more than once
+    for(std::size_t Step = 0; Step < Moves.size(); Step++){
+        auto Item = Generator() % (Boxes.size() + 50);
+        if(Item >= Boxes.size()){
+            Boxes.resize(Item + 1, CRTree::SBox::EmptyBox());
+        }
+        Boxes[Item] = Step % 5 == 0 ? CRTree::SBox::EmptyBox() : Moves[Step];
+        Tree.Update(Item, Boxes[Item]);
+        if(Step % 97 == 0){
+            for(const auto &Query : RandomBoxes(10)){
+                Tree.Query(Query, Items);
+                EXPECT_EQ(Items, LinearQuery(Boxes, Query));
+            }
+            EXPECT_EQ(Tree.Query({-90, -180, 90, 180}, Items), LinearQuery(Boxes, {-90, -180, 90, 180}).size());
+            EXPECT_EQ(Tree.Count(), Items.size());
+        }
+    }
+    // Removing an item that is not there changes nothing
+    auto Count = Tree.Count();
+    Tree.Update(Boxes.size() + 10, CRTree::SBox::EmptyBox());
+    EXPECT_EQ(Tree.Count(), Count);
+
+    // Updated trees save as a fresh build of their items
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Tree.Save(Sink));
+    CRTree Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String())));
+    EXPECT_EQ(Loaded.Count(), Count);
+    for(const auto &Query : RandomBoxes(10)){
+        Loaded.Query(Query, Items);
+        EXPECT_EQ(Items, LinearQuery(Boxes, Query));
+    }
+
+    // An empty tree takes updates too
+    CRTree Empty;
+    Empty.Update(3, Boxes[7]);
+    EXPECT_EQ(Empty.Count(), 1);
+    EXPECT_EQ(Empty.Query(Boxes[7], Items), 1);
+    EXPECT_EQ(Items[0], 3);
+    Empty.Update(3, CRTree::SBox::EmptyBox());
+    EXPECT_EQ(Empty.Count(), 0);
+}
+
+TEST(RTreeTest, SaveLoadTest){
+    auto Boxes = RandomBoxes(1000);
+    CRTree Tree;
+    Tree.Build(Boxes);
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Tree.Save(Sink));
+
+    CRTree Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String())));
+    EXPECT_EQ(Loaded.Count(), Tree.Count());
+    std::vector<uint32_t> Expected, Actual;
+    for(const auto &Query : RandomBoxes(20)){
+        Tree.Query(Query, Expected);
+        Loaded.Query(Query, Actual);
+        EXPECT_EQ(Actual, Expected);
+    }
+
+    // Moving keeps the contents
+    CRTree Moved(std::move(Loaded));
+    EXPECT_EQ(Moved.Count(), Tree.Count());
+
+    // Empty trees round trip too
+    auto EmptySink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(CRTree().Save(EmptySink));
+    ASSERT_TRUE(Moved.Load(std::make_shared<CStringDataSource>(EmptySink->String())));
+    EXPECT_EQ(Moved.Count(), 0);
+}
+
+TEST(RTreeTest, ErrorTest){
+    CRTree Tree;
+    Tree.Build(RandomBoxes(100));
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Tree.Save(Sink));
+    auto Data = Sink->String();
+
+    CRTree Loaded;
+    Loaded.Build(RandomBoxes(3));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>("")));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Data.substr(0, Data.size() - 1))));
+    auto BadMagic = Data;
+    BadMagic[0] = 'X';
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadMagic)));
+    auto BadVersion = Data;
+    BadVersion[8] = 9;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadVersion)));
+    // A valid header for far more boxes than the data holds fails instead of allocating them
+    std::vector<uint64_t> LevelOffsets = {0};
+    for(uint64_t Size = uint64_t(1) << 40; Size; Size = (Size == 1) ? 0 : (Size + CRTree::NodeCapacity - 1) / CRTree::NodeCapacity){
+        LevelOffsets.push_back(LevelOffsets.back() + Size);
+    }
+    uint64_t Levels = LevelOffsets.size() - 1;
+    auto Huge = Data.substr(0, 16);
+    Huge.append(reinterpret_cast<const char *>(&Levels), sizeof(Levels));
+    Huge.append(reinterpret_cast<const char *>(LevelOffsets.data()), LevelOffsets.size() * sizeof(uint64_t));
+    Huge.append(Data.substr(Data.size() - 64));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Huge)));
+    // Failed loads leave the tree alone
+    EXPECT_EQ(Loaded.Count(), 3);
+}
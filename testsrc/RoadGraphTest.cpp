@@ -0,0 +1,399 @@
+#include <gtest/gtest.h>
+#include "RoadGraph.h"
+#include "RoadTestSupport.h"
+#include "GeographicUtils.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include <algorithm>
+#include <cstring>
+
+static const std::string RoadGraphTestOSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                            "   <node id=\"1\" lat=\"38.500\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"2\" lat=\"38.500\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"3\" lat=\"38.510\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"4\" lat=\"38.520\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"5\" lat=\"38.520\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"6\" lat=\"38.530\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"7\" lat=\"38.540\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"8\" lat=\"38.550\" lon=\"-121.700\"/>\n"
+                                            "   <way id=\"100\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <nd ref=\"99\"/>\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"200\">\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <tag k=\"highway\" v=\"primary\"/>\n"
+                                            "       <tag k=\"oneway\" v=\"yes\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"300\">\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <nd ref=\"5\"/>\n"
+                                            "       <tag k=\"highway\" v=\"secondary\"/>\n"
+                                            "       <tag k=\"oneway\" v=\"-1\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"400\">\n"
+                                            "       <nd ref=\"5\"/>\n"
+                                            "       <nd ref=\"6\"/>\n"
+                                            "       <tag k=\"highway\" v=\"motorway\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"500\">\n"
+                                            "       <nd ref=\"6\"/>\n"
+                                            "       <nd ref=\"6\"/>\n"
+                                            "       <nd ref=\"7\"/>\n"
+                                            "       <tag k=\"highway\" v=\"motorway\"/>\n"
+                                            "       <tag k=\"oneway\" v=\"no\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"600\">\n"
+                                            "       <nd ref=\"7\"/>\n"
+                                            "       <nd ref=\"8\"/>\n"
+                                            "       <tag k=\"waterway\" v=\"canal\"/>\n"
+                                            "   </way>\n"
+                                            "</osm>";
+
+static COpenStreetMap RoadGraphTestMap(const COpenStreetMap::SOptions &options = COpenStreetMap::SOptions()){
+    return COpenStreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(RoadGraphTestOSM)), options);
+}
+
+//Target node IDs of the edges leaving the node with id
+static std::vector<CStreetMap::TNodeID> Neighbors(const CRoadGraph &graph, CStreetMap::TNodeID id){
+    std::vector<CStreetMap::TNodeID> Result;
+    auto Vertex = graph.VertexByNodeID(id);
+    for(auto Edge = graph.EdgeBegin(Vertex); Edge < graph.EdgeEnd(Vertex); Edge++){
+        Result.push_back(graph.NodeID(graph.EdgeTarget(Edge)));
+    }
+    std::sort(Result.begin(), Result.end());
+    return Result;
+}
+
+static void ExpectSameGraph(const CRoadGraph &graph1, const CRoadGraph &graph2){
+    EXPECT_TRUE(std::ranges::equal(graph1.NodeIDs(), graph2.NodeIDs()));
+    EXPECT_TRUE(std::ranges::equal(graph1.Latitudes(), graph2.Latitudes()));
+    EXPECT_TRUE(std::ranges::equal(graph1.Longitudes(), graph2.Longitudes()));
+    EXPECT_TRUE(std::ranges::equal(graph1.Offsets(), graph2.Offsets()));
+    EXPECT_TRUE(std::ranges::equal(graph1.Targets(), graph2.Targets()));
+    EXPECT_TRUE(std::ranges::equal(graph1.Lengths(), graph2.Lengths()));
+    EXPECT_TRUE(std::ranges::equal(graph1.WayIndices(), graph2.WayIndices()));
+    ASSERT_EQ(graph1.ShapeNodeCount(), graph2.ShapeNodeCount());
+    std::vector<CStreetMap::TNodeID> IDs1, IDs2;
+    for(std::size_t Edge = 0; Edge < graph1.EdgeCount(); Edge++){
+        graph1.EdgeNodeIDs(Edge, IDs1);
+        graph2.EdgeNodeIDs(Edge, IDs2);
+        EXPECT_EQ(IDs1, IDs2);
+    }
+}
+
+TEST(RoadGraphTest, BuildTest){
+    auto Map = RoadGraphTestMap();
+    CRoadGraph Graph;
+    EXPECT_EQ(Graph.VertexCount(), 0);
+    EXPECT_EQ(Graph.EdgeCount(), 0);
+    Graph.Build(Map);
+    // Node 8 is only on the canal
+    EXPECT_EQ(Graph.VertexCount(), 7);
+    EXPECT_EQ(Graph.VertexByNodeID(8), CRoadGraph::InvalidVertex);
+    EXPECT_EQ(Graph.VertexByNodeID(99), CRoadGraph::InvalidVertex);
+    // 1-2 and 2-3 across the missing node both ways, 3->4, 5->4 (reverse oneway), 5->6 (motorway), 6-7 both ways
+    EXPECT_EQ(Graph.EdgeCount(), 9);
+    EXPECT_EQ(Neighbors(Graph, 1), std::vector<CStreetMap::TNodeID>({2}));
+    EXPECT_EQ(Neighbors(Graph, 2), std::vector<CStreetMap::TNodeID>({1, 3}));
+    EXPECT_EQ(Neighbors(Graph, 3), std::vector<CStreetMap::TNodeID>({2, 4}));
+    EXPECT_EQ(Neighbors(Graph, 4), std::vector<CStreetMap::TNodeID>());
+    EXPECT_EQ(Neighbors(Graph, 5), std::vector<CStreetMap::TNodeID>({4, 6}));
+    EXPECT_EQ(Neighbors(Graph, 6), std::vector<CStreetMap::TNodeID>({7}));
+    EXPECT_EQ(Neighbors(Graph, 7), std::vector<CStreetMap::TNodeID>({6}));
+
+    // Vertices follow map node order and carry their locations
+    for(CRoadGraph::TVertex Vertex = 0; Vertex < Graph.VertexCount(); Vertex++){
+        EXPECT_EQ(Graph.NodeID(Vertex), Vertex + 1);
+        EXPECT_EQ(Graph.VertexByNodeID(Vertex + 1), Vertex);
+        auto Location = Map.NodeByID(Vertex + 1)->Location();
+        EXPECT_EQ(Graph.Location(Vertex).DLatitude, Location.DLatitude);
+        EXPECT_EQ(Graph.Location(Vertex).DLongitude, Location.DLongitude);
+    }
+    for(CRoadGraph::TVertex Vertex = 0; Vertex < Graph.VertexCount(); Vertex++){
+        for(auto Edge = Graph.EdgeBegin(Vertex); Edge < Graph.EdgeEnd(Vertex); Edge++){
+            auto Target = Graph.EdgeTarget(Edge);
+            EXPECT_NEAR(Graph.EdgeLength(Edge), SGeographicUtils::HaversineDistanceInMeters(Graph.Location(Vertex), Graph.Location(Target)), 1e-6);
+            // Each edge joins two nodes of the way it names
+            auto Way = Map.WayByIndex(Graph.EdgeWayIndex(Edge));
+            bool HasSource = false, HasTarget = false;
+            for(std::size_t Index = 0; Index < Way->NodeCount(); Index++){
+                HasSource |= Way->GetNodeID(Index) == Graph.NodeID(Vertex);
+                HasTarget |= Way->GetNodeID(Index) == Graph.NodeID(Target);
+            }
+            EXPECT_TRUE(HasSource && HasTarget);
+        }
+    }
+
+    // Out of range lookups
+    EXPECT_EQ(Graph.NodeID(7), CStreetMap::InvalidNodeID);
+    EXPECT_EQ(Graph.EdgeBegin(CRoadGraph::InvalidVertex), Graph.EdgeEnd(CRoadGraph::InvalidVertex));
+    EXPECT_EQ(Graph.EdgeTarget(9), CRoadGraph::InvalidVertex);
+    EXPECT_EQ(Graph.EdgeLength(9), 0);
+    EXPECT_EQ(Graph.EdgeWayIndex(9), COpenStreetMap::InvalidIndex);
+    EXPECT_GT(Graph.MemoryUsage().DBytes, 0);
+}
+
+TEST(RoadGraphTest, OptionsTest){
+    auto Map = RoadGraphTestMap();
+    CRoadGraph::SOptions Options;
+    Options.DRespectOneway = false;
+    CRoadGraph Graph;
+    Graph.Build(Map, Options);
+    EXPECT_EQ(Graph.EdgeCount(), 12);
+    EXPECT_EQ(Neighbors(Graph, 4), std::vector<CStreetMap::TNodeID>({3, 5}));
+
+    // An empty required key takes every way
+    Options.DRequiredKey = "";
+    Graph.Build(Map, Options);
+    EXPECT_EQ(Graph.VertexCount(), 8);
+    EXPECT_EQ(Graph.EdgeCount(), 14);
+
+    Options.DRequiredKey = "oneway";
+    Options.DRespectOneway = true;
+    Graph.Build(Map, Options);
+    EXPECT_EQ(Graph.EdgeCount(), 4);
+}
+
+TEST(RoadGraphTest, ParallelBuildTest){
+    auto OSM = GridTestOSM(3);
+    COpenStreetMap::SOptions MapOptions;
+    MapOptions.DCoordinateStorage = COpenStreetMap::ECoordinateStorage::FixedPoint;
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(OSM)), MapOptions);
+
+    CRoadGraph::SOptions Options;
+    Options.DThreadCount = 1;
+    CRoadGraph Serial;
+    Serial.Build(Map, Options);
+    // Rows with one oneway in four, seven columns with two oneway, and four two way diagonals
+    EXPECT_EQ(Serial.EdgeCount(), (15 * 2 + 5) * 19 + (5 * 2 + 2) * 19 + 2 * (19 + 14 + 9 + 4));
+    for(std::size_t Threads : {2, 3, 8}){
+        Options.DThreadCount = Threads;
+        CRoadGraph Parallel;
+        Parallel.Build(Map, Options);
+        ExpectSameGraph(Parallel, Serial);
+    }
+}
+
+TEST(RoadGraphTest, SaveLoadTest){
+    auto Map = RoadGraphTestMap();
+    CRoadGraph Graph;
+    Graph.Build(Map);
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Graph.Save(Sink));
+
+    CRoadGraph Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String())));
+    ExpectSameGraph(Loaded, Graph);
+    EXPECT_EQ(Loaded.VertexByNodeID(5), Graph.VertexByNodeID(5));
+
+    // Moving keeps the contents
+    CRoadGraph Moved(std::move(Loaded));
+    EXPECT_EQ(Moved.EdgeCount(), Graph.EdgeCount());
+
+    // Empty graphs round trip too
+    auto EmptySink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(CRoadGraph().Save(EmptySink));
+    ASSERT_TRUE(Moved.Load(std::make_shared<CStringDataSource>(EmptySink->String())));
+    EXPECT_EQ(Moved.VertexCount(), 0);
+    EXPECT_EQ(Moved.EdgeCount(), 0);
+}
+
+TEST(RoadGraphTest, ErrorTest){
+    auto Map = RoadGraphTestMap();
+    CRoadGraph Graph;
+    Graph.Build(Map);
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Graph.Save(Sink));
+    auto Data = Sink->String();
+
+    CRoadGraph Loaded;
+    Loaded.Build(Map);
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>("")));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Data.substr(0, Data.size() - 1))));
+    auto BadMagic = Data;
+    BadMagic[0] = 'X';
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadMagic)));
+    auto BadVersion = Data;
+    BadVersion[8] = 9;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadVersion)));
+    // A target past the last vertex, the targets follow the header, vertex columns and offsets
+    auto BadTarget = Data;
+    auto TargetsAt = 8 + 4 + 32 + Graph.VertexCount() * 24 + (Graph.VertexCount() + 1) * 4;
+    BadTarget[TargetsAt] = 100;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(BadTarget)));
+    // A vertex count far larger than the data fails instead of allocating every column
+    auto HugeCount = Data;
+    uint64_t VertexCount = 0xFFFFFF00;
+    std::memcpy(HugeCount.data() + 12, &VertexCount, sizeof(VertexCount));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(HugeCount)));
+    // Failed loads leave the graph alone
+    ExpectSameGraph(Loaded, Graph);
+}
+
+TEST(RoadGraphTest, ContractTest){
+    auto Map = RoadGraphTestMap();
+    CRoadGraph Graph;
+    Graph.Build(Map);
+    EXPECT_EQ(Graph.ShapeNodeCount(), 0);
+    CRoadGraph Contracted;
+    Contracted.BuildContracted(Graph);
+    // Only node 2 is inside a chain, 1 is a dead end and the rest join two ways
+    EXPECT_EQ(Contracted.VertexCount(), 6);
+    EXPECT_EQ(Contracted.VertexByNodeID(2), CRoadGraph::InvalidVertex);
+    EXPECT_EQ(Contracted.EdgeCount(), 7);
+    EXPECT_EQ(Contracted.ShapeNodeCount(), 2);
+    EXPECT_EQ(Neighbors(Contracted, 1), std::vector<CStreetMap::TNodeID>({3}));
+    EXPECT_EQ(Neighbors(Contracted, 3), std::vector<CStreetMap::TNodeID>({1, 4}));
+    EXPECT_EQ(Neighbors(Contracted, 5), std::vector<CStreetMap::TNodeID>({4, 6}));
+
+    auto Edge = Contracted.EdgeBegin(Contracted.VertexByNodeID(1));
+    EXPECT_EQ(Contracted.EdgeSource(Edge), Contracted.VertexByNodeID(1));
+    std::vector<CStreetMap::TNodeID> IDs;
+    EXPECT_EQ(Contracted.EdgeNodeIDs(Edge, IDs), 3);
+    EXPECT_EQ(IDs, std::vector<CStreetMap::TNodeID>({1, 2, 3}));
+    std::vector<CStreetMap::SLocation> Locations;
+    EXPECT_EQ(Contracted.EdgeLocations(Edge, Locations), 3);
+    EXPECT_EQ(Locations[1].DLongitude, Map.NodeByID(2)->Location().DLongitude);
+    auto Expected = SGeographicUtils::HaversineDistanceInMeters(Locations[0], Locations[1]) + SGeographicUtils::HaversineDistanceInMeters(Locations[1], Locations[2]);
+    EXPECT_NEAR(Contracted.EdgeLength(Edge), Expected, 1e-6);
+    EXPECT_EQ(Map.WayByIndex(Contracted.EdgeWayIndex(Edge))->ID(), 100);
+
+    // Uncontracted edges are their two ends
+    EXPECT_EQ(Graph.EdgeNodeIDs(Graph.EdgeBegin(Graph.VertexByNodeID(3)), IDs), 2);
+    EXPECT_EQ(Contracted.EdgeSource(Contracted.EdgeCount()), CRoadGraph::InvalidVertex);
+    EXPECT_EQ(Contracted.EdgeNodeIDs(Contracted.EdgeCount(), IDs), 0);
+    EXPECT_TRUE(IDs.empty());
+    EXPECT_EQ(Contracted.EdgeLocations(Contracted.EdgeCount(), Locations), 0);
+}
+
+TEST(RoadGraphTest, ContractChainTest){
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    for(int Node = 10; Node < 24; Node++){
+        OSM += "   <node id=\"" + std::to_string(Node) + "\" lat=\"" + std::to_string(38.5 + Node * 0.001) + "\" lon=\"" + std::to_string(-121.7 + (Node % 3) * 0.001) + "\"/>\n";
+    }
+    // A two way chain, a oneway chain off its end and a ring touching nothing
+    std::vector<std::pair<std::vector<int>, bool>> Ways = {
+        {{10, 11, 12, 13, 14}, false},
+        {{14, 15, 16, 17}, true},
+        {{20, 21, 22, 23, 20}, false}
+    };
+    for(std::size_t Way = 0; Way < Ways.size(); Way++){
+        OSM += "   <way id=\"" + std::to_string(Way + 1) + "\">\n";
+        for(auto Node : Ways[Way].first){
+            OSM += "       <nd ref=\"" + std::to_string(Node) + "\"/>\n";
+        }
+        OSM += "       <tag k=\"highway\" v=\"residential\"/>\n";
+        if(Ways[Way].second){
+            OSM += "       <tag k=\"oneway\" v=\"yes\"/>\n";
+        }
+        OSM += "   </way>\n";
+    }
+    OSM += "</osm>";
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(OSM)));
+    CRoadGraph Graph;
+    Graph.Build(Map);
+    EXPECT_EQ(Graph.VertexCount(), 12);
+    EXPECT_EQ(Graph.EdgeCount(), 19);
+
+    CRoadGraph Contracted;
+    Contracted.BuildContracted(Graph);
+    EXPECT_EQ(Contracted.VertexCount(), 4);
+    EXPECT_EQ(Contracted.EdgeCount(), 5);
+    EXPECT_EQ(Contracted.ShapeNodeCount(), 14);
+    std::vector<CStreetMap::TNodeID> IDs;
+    auto Vertex = Contracted.VertexByNodeID(14);
+    std::vector<std::vector<CStreetMap::TNodeID>> Paths;
+    for(auto Edge = Contracted.EdgeBegin(Vertex); Edge < Contracted.EdgeEnd(Vertex); Edge++){
+        Contracted.EdgeNodeIDs(Edge, IDs);
+        Paths.push_back(IDs);
+    }
+    std::sort(Paths.begin(), Paths.end());
+    EXPECT_EQ(Paths, std::vector<std::vector<CStreetMap::TNodeID>>({{14, 13, 12, 11, 10}, {14, 15, 16, 17}}));
+    EXPECT_EQ(Neighbors(Contracted, 17), std::vector<CStreetMap::TNodeID>());
+    // The ring keeps one vertex with a loop edge each way round
+    EXPECT_EQ(Neighbors(Contracted, 20), std::vector<CStreetMap::TNodeID>({20, 20}));
+    Vertex = Contracted.VertexByNodeID(20);
+    Contracted.EdgeNodeIDs(Contracted.EdgeBegin(Vertex), IDs);
+    EXPECT_EQ(IDs.size(), 5);
+    EXPECT_EQ(IDs.front(), 20);
+    EXPECT_EQ(IDs.back(), 20);
+
+    // Contracting again changes nothing, in place too
+    CRoadGraph Again;
+    Again.BuildContracted(Contracted);
+    ExpectSameGraph(Again, Contracted);
+    Again.BuildContracted(Again);
+    ExpectSameGraph(Again, Contracted);
+
+    auto Sink = std::make_shared<CStringDataSink>();
+    ASSERT_TRUE(Contracted.Save(Sink));
+    CRoadGraph Loaded;
+    ASSERT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String())));
+    ExpectSameGraph(Loaded, Contracted);
+}
+
+TEST(RoadGraphTest, ContractGridTest){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(GridTestOSM(3))));
+    CRoadGraph Graph;
+    Graph.Build(Map);
+    CRoadGraph Contracted;
+    Contracted.BuildContracted(Graph, 1);
+    EXPECT_LT(Contracted.VertexCount(), Graph.VertexCount());
+
+    // Every contracted edge is a walk along graph edges of one way and its length is their sum
+    double GraphLength = 0, ContractedLength = 0;
+    std::vector<bool> Covered(Graph.VertexCount(), false);
+    for(auto Length : Graph.Lengths()){
+        GraphLength += Length;
+    }
+    std::vector<CStreetMap::TNodeID> IDs;
+    for(std::size_t Edge = 0; Edge < Contracted.EdgeCount(); Edge++){
+        ContractedLength += Contracted.EdgeLength(Edge);
+        Contracted.EdgeNodeIDs(Edge, IDs);
+        double Length = 0;
+        for(std::size_t Index = 1; Index < IDs.size(); Index++){
+            auto Source = Graph.VertexByNodeID(IDs[Index - 1]);
+            Covered[Source] = true;
+            auto Step = Graph.EdgeEnd(Source);
+            for(auto GraphEdge = Graph.EdgeBegin(Source); GraphEdge < Graph.EdgeEnd(Source); GraphEdge++){
+                if((Graph.NodeID(Graph.EdgeTarget(GraphEdge)) == IDs[Index])&&(Graph.EdgeWayIndex(GraphEdge) == Contracted.EdgeWayIndex(Edge))){
+                    Step = GraphEdge;
+                }
+            }
+            ASSERT_LT(Step, Graph.EdgeEnd(Source));
+            Length += Graph.EdgeLength(Step);
+        }
+        EXPECT_NEAR(Contracted.EdgeLength(Edge), Length, 1e-6);
+    }
+    EXPECT_NEAR(ContractedLength, GraphLength, 1e-3);
+    // Removed vertices all lie inside some contracted edge
+    for(CRoadGraph::TVertex Vertex = 0; Vertex < Graph.VertexCount(); Vertex++){
+        if(Contracted.VertexByNodeID(Graph.NodeID(Vertex)) == CRoadGraph::InvalidVertex){
+            EXPECT_TRUE(Covered[Vertex]);
+        }
+    }
+
+    for(std::size_t Threads : {2, 5}){
+        CRoadGraph Parallel;
+        Parallel.BuildContracted(Graph, Threads);
+        ExpectSameGraph(Parallel, Contracted);
+    }
+
+    // Kept nodes stay vertices and split the edge they were inside
+    std::vector<CStreetMap::TNodeID> Keep{2, 3};
+    ASSERT_EQ(Contracted.VertexByNodeID(2), CRoadGraph::InvalidVertex);
+    CRoadGraph Kept;
+    Kept.BuildContracted(Graph, Keep, 1);
+    EXPECT_NE(Kept.VertexByNodeID(2), CRoadGraph::InvalidVertex);
+    EXPECT_NE(Kept.VertexByNodeID(3), CRoadGraph::InvalidVertex);
+    EXPECT_EQ(Kept.VertexCount(), Contracted.VertexCount() + 2);
+    EXPECT_EQ(Kept.ShapeNodeCount(), Contracted.ShapeNodeCount() - 2 * 2);
+    CRoadGraph KeptParallel;
+    KeptParallel.BuildContracted(Graph, Keep, 4);
+    ExpectSameGraph(KeptParallel, Kept);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "RoadRouter.h"
+#include "RoadTestSupport.h"
+#include "StringDataSource.h"
+#include <queue>
+#include <thread>
+
+//Plain Dijkstra with a binary heap and lazy deletion to check the router against
+static double ReferenceDistance(const CRoadGraph &graph, CRoadGraph::TVertex source, CRoadGraph::TVertex target){
+    std::vector<double> Distances(graph.VertexCount(), CRoadRouter::NoPathExists);
+    using TEntry = std::pair<double, CRoadGraph::TVertex>;
+    std::priority_queue<TEntry, std::vector<TEntry>, std::greater<TEntry>> Queue;
+    Distances[source] = 0;
+    Queue.push({0, source});
+    while(!Queue.empty()){
+        auto [Distance, Vertex] = Queue.top();
+        Queue.pop();
+        if(Distance > Distances[Vertex]){
+            continue;
+        }
+        for(auto Edge = graph.EdgeBegin(Vertex); Edge < graph.EdgeEnd(Vertex); Edge++){
+            auto Next = graph.EdgeTarget(Edge);
+            if(Distance + graph.EdgeLength(Edge) < Distances[Next]){
+                Distances[Next] = Distance + graph.EdgeLength(Edge);
+                Queue.push({Distances[Next], Next});
+            }
+        }
+    }
+    return Distances[target];
+}
+
+TEST(RoadRouterTest, SimpleTest){
+    auto Graph = RoadTestGraph(SmallRoadTestOSM);
+    CRoadRouter Router(Graph);
+    EXPECT_EQ(Router.Graph(), Graph);
+    std::vector<CStreetMap::TNodeID> Path;
+    for(auto Algorithm : {CRoadRouter::EAlgorithm::Dijkstra, CRoadRouter::EAlgorithm::AStar}){
+        // 1-4-3 is oneway, so the way back goes round by 2
+        auto Distance = Router.FindShortestPath(1, 5, Path, Algorithm);
+        EXPECT_EQ(Path, std::vector<CStreetMap::TNodeID>({1, 4, 5}));
+        EXPECT_NEAR(Distance, PathLength(*Graph, Path), 1e-6);
+        Distance = Router.FindShortestPath(5, 1, Path, Algorithm);
+        EXPECT_EQ(Path, std::vector<CStreetMap::TNodeID>({5, 4, 3, 2, 1}));
+        EXPECT_NEAR(Distance, PathLength(*Graph, Path), 1e-6);
+        EXPECT_EQ(Router.FindShortestPath(3, 3, Path, Algorithm), 0.0);
+        EXPECT_EQ(Path, std::vector<CStreetMap::TNodeID>({3}));
+
+        // Unreachable, and not in the graph
+        EXPECT_EQ(Router.FindShortestPath(1, 6, Path, Algorithm), CRoadRouter::NoPathExists);
+        EXPECT_TRUE(Path.empty());
+        EXPECT_GT(Router.FindShortestPath(6, 1, Path, Algorithm), 0.0);
+        EXPECT_EQ(Router.FindShortestPath(1, 99, Path, Algorithm), CRoadRouter::NoPathExists);
+        EXPECT_EQ(Router.FindShortestPath(99, 1, Path, Algorithm), CRoadRouter::NoPathExists);
+        EXPECT_TRUE(Path.empty());
+    }
+}
+
+TEST(RoadRouterTest, BusPathTest){
+    CRoadRouter Router(RoadTestGraph(SmallRoadTestOSM));
+    std::shared_ptr<CBusSystem::SPath> Path = Router.ShortestPath(5, 1);
+    ASSERT_NE(Path, nullptr);
+    EXPECT_EQ(Path->StartNodeID(), 5);
+    EXPECT_EQ(Path->EndNodeID(), 1);
+    ASSERT_EQ(Path->NodeCount(), 5);
+    EXPECT_EQ(Path->GetNodeID(2), 3);
+    EXPECT_EQ(Path->GetNodeID(5), CStreetMap::InvalidNodeID);
+    EXPECT_EQ(Router.ShortestPath(1, 6), nullptr);
+}
+
+TEST(RoadRouterTest, GridTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CRoadRouter Router(Graph);
+    CRoadRouter::SWorkspace Workspace;
+    EXPECT_EQ(Workspace.SettledCount(), 0);
+    std::vector<CStreetMap::TNodeID> Path;
+    std::size_t DijkstraSettled = 0, AStarSettled = 0;
+    uint32_t Seed = 12345;
+    for(int Query = 0; Query < 200; Query++){
+        Seed = Seed * 1103515245 + 12345;
+        auto Source = static_cast<CRoadGraph::TVertex>((Seed >> 8) % Graph->VertexCount());
+        Seed = Seed * 1103515245 + 12345;
+        auto Target = static_cast<CRoadGraph::TVertex>((Seed >> 8) % Graph->VertexCount());
+        auto Expected = ReferenceDistance(*Graph, Source, Target);
+        ASSERT_NE(Expected, CRoadRouter::NoPathExists);
+
+        auto Distance = Router.FindShortestPath(Workspace, Graph->NodeID(Source), Graph->NodeID(Target), Path, CRoadRouter::EAlgorithm::Dijkstra);
+        EXPECT_NEAR(Distance, Expected, 1e-6);
+        EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6);
+        DijkstraSettled += Workspace.SettledCount();
+
+        Distance = Router.FindShortestPath(Workspace, Graph->NodeID(Source), Graph->NodeID(Target), Path, CRoadRouter::EAlgorithm::AStar);
+        EXPECT_NEAR(Distance, Expected, 1e-6);
+        EXPECT_NEAR(PathLength(*Graph, Path), Expected, 1e-6);
+        EXPECT_EQ(Path.front(), Graph->NodeID(Source));
+        EXPECT_EQ(Path.back(), Graph->NodeID(Target));
+        AStarSettled += Workspace.SettledCount();
+    }
+    EXPECT_LT(AStarSettled, DijkstraSettled);
+}
+
+TEST(RoadRouterTest, ContractedTest){
+    auto Graph = RoadTestGraph(GridTestOSM(3));
+    auto Contracted = std::make_shared<CRoadGraph>();
+    Contracted->BuildContracted(*Graph);
+    ASSERT_LT(Contracted->VertexCount(), Graph->VertexCount());
+    CRoadRouter Router(Graph), ContractedRouter(Contracted);
+    std::vector<CStreetMap::TNodeID> Path, ContractedPath;
+    for(CRoadGraph::TVertex Source = 0; Source < Contracted->VertexCount(); Source += 7){
+        for(CRoadGraph::TVertex Target = 0; Target < Contracted->VertexCount(); Target += 5){
+            auto Distance = Router.FindShortestPath(Contracted->NodeID(Source), Contracted->NodeID(Target), Path);
+            auto ContractedDistance = ContractedRouter.FindShortestPath(Contracted->NodeID(Source), Contracted->NodeID(Target), ContractedPath);
+            EXPECT_NEAR(ContractedDistance, Distance, 1e-6);
+            // The unpacked path runs along the full graph's edges
+            EXPECT_NEAR(PathLength(*Graph, ContractedPath), Distance, 1e-6);
+        }
+    }
+    // Nodes inside contracted edges are not vertices
+    EXPECT_EQ(Contracted->VertexByNodeID(2), CRoadGraph::InvalidVertex);
+    EXPECT_EQ(ContractedRouter.FindShortestPath(2, 1, Path), CRoadRouter::NoPathExists);
+}
+
+TEST(RoadRouterTest, ThreadTest){
+    auto Graph = RoadTestGraph(GridTestOSM());
+    CRoadRouter Router(Graph);
+    const std::size_t Threads = 4;
+    std::vector<std::vector<double>> Distances(Threads);
+    std::vector<std::thread> Workers;
+    for(std::size_t Thread = 0; Thread < Threads; Thread++){
+        Workers.emplace_back([&, Thread](){
+            std::vector<CStreetMap::TNodeID> Path;
+            for(CRoadGraph::TVertex Target = 0; Target < Graph->VertexCount(); Target += 3){
+                // Alternate the thread's own workspace with the built in one
+                if(Target % 2){
+                    Distances[Thread].push_back(Router.FindShortestPath(Graph->NodeID(0), Graph->NodeID(Target), Path));
+                }
+                else{
+                    CRoadRouter::SWorkspace Workspace;
+                    Distances[Thread].push_back(Router.FindShortestPath(Workspace, Graph->NodeID(0), Graph->NodeID(Target), Path));
+                }
+            }
+        });
+    }
+    for(auto &Worker : Workers){
+        Worker.join();
+    }
+    for(std::size_t Thread = 1; Thread < Threads; Thread++){
+        EXPECT_EQ(Distances[Thread], Distances[0]);
+    }
+    std::size_t Index = 0;
+    for(CRoadGraph::TVertex Target = 0; Target < Graph->VertexCount(); Target += 3){
+        EXPECT_NEAR(Distances[0][Index++], ReferenceDistance(*Graph, 0, Target), 1e-6);
+    }
+
+    // A moved from workspace can still be searched with
+    CRoadRouter::SWorkspace Workspace;
+    CRoadRouter::SWorkspace Moved(std::move(Workspace));
+    std::vector<CStreetMap::TNodeID> Path;
+    EXPECT_EQ(Router.FindShortestPath(Workspace, 1, 1, Path), 0.0);
+    EXPECT_EQ(Router.FindShortestPath(Moved, 1, 1, Path), 0.0);
+}
@@ -0,0 +1,120 @@
+#ifndef ROADTESTSUPPORT_H
+#define ROADTESTSUPPORT_H
+
+#include "RoadGraph.h"
+#include "StringDataSource.h"
+#include "XMLReader.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+//Map and path helpers shared by the road graph, router and hierarchy tests
+
+//Six nodes: 1-2-3 two way, 1-4-3 oneway, 4-5-4 two way, and 6 leads to 5 but nothing leads to 6
+inline const std::string SmallRoadTestOSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                            "   <node id=\"1\" lat=\"38.500\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"2\" lat=\"38.500\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"3\" lat=\"38.510\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"4\" lat=\"38.510\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"5\" lat=\"38.520\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"6\" lat=\"38.600\" lon=\"-121.700\"/>\n"
+                                            "   <way id=\"100\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"200\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "       <tag k=\"oneway\" v=\"yes\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"300\">\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <nd ref=\"5\"/>\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"400\">\n"
+                                            "       <nd ref=\"6\"/>\n"
+                                            "       <nd ref=\"5\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "       <tag k=\"oneway\" v=\"yes\"/>\n"
+                                            "   </way>\n"
+                                            "</osm>";
+
+//Jittered 20 by 20 grid of streets with a few diagonals, so there are many paths of similar length
+//Every fourth row is oneway, and every fourth column is oneway in alternating directions
+//Only every columnstep-th column is a street, leaving chains along the rows between them
+inline std::string GridTestOSM(int columnstep = 1){
+    const int Size = 20;
+    std::string OSM = "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n";
+    uint32_t Seed = 7;
+    for(int Node = 0; Node < Size * Size; Node++){
+        Seed = Seed * 1103515245 + 12345;
+        auto Jitter = ((Seed >> 16) % 100) * 0.000002;
+        OSM += "   <node id=\"" + std::to_string(Node + 1) + "\" lat=\"" + std::to_string(38.5 + (Node / Size) * 0.001 + Jitter) + "\" lon=\"" + std::to_string(-121.7 + (Node % Size) * 0.001 - Jitter) + "\"/>\n";
+    }
+    int WayID = 1000;
+    auto AddWay = [&](const std::vector<int> &nodes, const std::string &oneway){
+        OSM += "   <way id=\"" + std::to_string(WayID++) + "\">\n";
+        for(auto Node : nodes){
+            OSM += "       <nd ref=\"" + std::to_string(Node + 1) + "\"/>\n";
+        }
+        OSM += "       <tag k=\"highway\" v=\"residential\"/>\n";
+        if(!oneway.empty()){
+            OSM += "       <tag k=\"oneway\" v=\"" + oneway + "\"/>\n";
+        }
+        OSM += "   </way>\n";
+    };
+    for(int Line = 0; Line < Size; Line++){
+        std::vector<int> Row, Column;
+        for(int Step = 0; Step < Size; Step++){
+            Row.push_back(Line * Size + Step);
+            Column.push_back(Step * Size + Line);
+        }
+        AddWay(Row, Line % 4 == 1 ? "yes" : "");
+        if(Line % columnstep == 0){
+            AddWay(Column, Line % 4 != 3 ? "" : Line % 8 == 3 ? "yes" : "-1");
+        }
+    }
+    for(int Start = 0; Start < Size - 1; Start += 5){
+        std::vector<int> Diagonal;
+        for(int Step = 0; Start + Step < Size; Step++){
+            Diagonal.push_back(Step * Size + Start + Step);
+        }
+        AddWay(Diagonal, "");
+    }
+    OSM += "</osm>";
+    return OSM;
+}
+
+inline std::shared_ptr<CRoadGraph> RoadTestGraph(const std::string &osm){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(osm)));
+    auto Graph = std::make_shared<CRoadGraph>();
+    Graph->Build(Map);
+    return Graph;
+}
+
+//Length of the path if each step follows an edge of graph, otherwise -1
+inline double PathLength(const CRoadGraph &graph, const std::vector<CStreetMap::TNodeID> &path){
+    double Length = 0;
+    for(std::size_t Index = 1; Index < path.size(); Index++){
+        auto Vertex = graph.VertexByNodeID(path[Index - 1]);
+        double Step = -1;
+        for(auto Edge = graph.EdgeBegin(Vertex); Edge < graph.EdgeEnd(Vertex); Edge++){
+            if((graph.NodeID(graph.EdgeTarget(Edge)) == path[Index])&&((Step < 0)||(graph.EdgeLength(Edge) < Step))){
+                Step = graph.EdgeLength(Edge);
+            }
+        }
+        if(Step < 0){
+            return -1;
+        }
+        Length += Step;
+    }
+    return Length;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "SegmentIndex.h"
+#include "GeographicUtils.h"
+#include "StringDataSource.h"
+#include <cmath>
+#include <random>
+
+static const std::string SegmentTestOSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                            "   <node id=\"1\" lat=\"38.500\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"2\" lat=\"38.500\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"3\" lat=\"38.510\" lon=\"-121.690\"/>\n"
+                                            "   <node id=\"4\" lat=\"38.520\" lon=\"-121.700\"/>\n"
+                                            "   <node id=\"5\" lat=\"38.520\" lon=\"-121.680\"/>\n"
+                                            "   <way id=\"100\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <nd ref=\"99\"/>\n"
+                                            "       <nd ref=\"3\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "       <tag k=\"name\" v=\"Main Street\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"200\">\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <nd ref=\"5\"/>\n"
+                                            "       <tag k=\"highway\" v=\"primary\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"300\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"4\"/>\n"
+                                            "       <tag k=\"waterway\" v=\"canal\"/>\n"
+                                            "   </way>\n"
+                                            "</osm>";
+
+static std::shared_ptr<COpenStreetMap> SegmentTestMap(){
+    return std::make_shared<COpenStreetMap>(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(SegmentTestOSM)));
+}
+
+TEST(SegmentIndexTest, NearestTest){
+    auto Map = SegmentTestMap();
+    CSegmentIndex Index(Map);
+    // 1-2 and 2-3 (across the missing node) from way 100, 4-5 from way 200, the canal is left out
+    EXPECT_EQ(Index.SegmentCount(), 3);
+
+    auto Match = Index.Nearest({38.501, -121.695});
+    EXPECT_EQ(Match.DWayID, 100);
+    EXPECT_EQ(Match.DWayIndex, 0);
+    EXPECT_EQ(Match.DSegment, 0);
+    EXPECT_EQ(Match.DName, "Main Street");
+    EXPECT_NEAR(Match.DLocation.DLatitude, 38.500, 1e-9);
+    EXPECT_NEAR(Match.DLocation.DLongitude, -121.695, 1e-9);
+    EXPECT_NEAR(Match.DDistance, SGeographicUtils::HaversineDistanceInMeters({38.501, -121.695}, {38.5, -121.695}), 0.01);
+    EXPECT_NEAR(Match.DOffset, SGeographicUtils::HaversineDistanceInMeters({38.5, -121.7}, {38.5, -121.695}), 0.01);
+
+    // Segment starts count missing nodes so they line up with GetNodeID
+    Match = Index.Nearest({38.505, -121.689});
+    EXPECT_EQ(Match.DWayID, 100);
+    EXPECT_EQ(Match.DSegment, 1);
+    EXPECT_NEAR(Match.DLocation.DLongitude, -121.690, 1e-9);
+
+    // Past the end of a segment snaps to its end node
+    Match = Index.Nearest({38.525, -121.670});
+    EXPECT_EQ(Match.DWayID, 200);
+    EXPECT_EQ(Match.DName, "");
+    EXPECT_EQ(Match.DLocation, CStreetMap::SLocation(38.520, -121.680));
+
+    // Closer to the canal, but only highways are indexed
+    Match = Index.Nearest({38.510, -121.7005});
+    EXPECT_NE(Match.DWayID, 300);
+
+    // Too far from everything
+    Match = Index.Nearest({39.0, -121.0});
+    EXPECT_EQ(Match.DWayID, CStreetMap::InvalidWayID);
+}
+
+TEST(SegmentIndexTest, OptionsTest){
+    auto Map = SegmentTestMap();
+    CSegmentIndex::SOptions Options;
+    Options.DRequiredKey = "";
+    Options.DCellMeters = 50;
+    Options.DMaxDistanceMeters = 1e9;
+    CSegmentIndex Index(Map, Options);
+    EXPECT_EQ(Index.SegmentCount(), 4);
+    EXPECT_EQ(Index.Nearest({38.510, -121.7005}).DWayID, 300);
+    // No distance limit and far outside the grid
+    EXPECT_EQ(Index.Nearest({10.0, 10.0}).DWayID, 200);
+
+    auto Empty = std::make_shared<COpenStreetMap>(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>("<osm></osm>")));
+    CSegmentIndex EmptyIndex(Empty);
+    EXPECT_EQ(EmptyIndex.SegmentCount(), 0);
+    EXPECT_EQ(EmptyIndex.Nearest({38.5, -121.7}).DWayID, CStreetMap::InvalidWayID);
+}
+
+TEST(SegmentIndexTest, RandomTest){
+    // A random road network checked against a scan of every segment
+    std::mt19937 Generator(23);
+    std::uniform_real_distribution<double> Latitude(38.50, 38.56);
+    std::uniform_real_distribution<double> Longitude(-121.78, -121.70);
+    std::string OSM = "<osm>\n";
+    for(int Node = 0; Node < 400; Node++){
+        OSM += "<node id=\"" + std::to_string(Node + 1) + "\" lat=\"" + std::to_string(Latitude(Generator)) + "\" lon=\"" + std::to_string(Longitude(Generator)) + "\"/>\n";
+    }
+    for(int Way = 0; Way < 100; Way++){
+        OSM += "<way id=\"" + std::to_string(Way + 1000) + "\">\n";
+        for(int Node = 0; Node < 4; Node++){
+            OSM += "<nd ref=\"" + std::to_string(Way * 4 + Node + 1) + "\"/>\n";
+        }
+        OSM += "<tag k=\"highway\" v=\"service\"/>\n</way>\n";
+    }
+    OSM += "</osm>";
+    auto Map = std::make_shared<COpenStreetMap>(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(OSM)));
+    CSegmentIndex Index(Map);
+    ASSERT_EQ(Index.SegmentCount(), 300);
+
+    std::vector<CStreetMap::SLocation> Queries;
+    for(int Query = 0; Query < 200; Query++){
+        Queries.push_back({Latitude(Generator), Longitude(Generator)});
+    }
+    std::vector<CSegmentIndex::SMatch> Matches;
+    Index.NearestBatch(Queries, Matches, 4);
+    ASSERT_EQ(Matches.size(), Queries.size());
+    for(std::size_t Query = 0; Query < Queries.size(); Query++){
+        const auto &Location = Queries[Query];
+        auto ScaleY = SGeographicUtils::EarthRadiusMeters * M_PI / 180;
+        auto ScaleX = ScaleY * std::cos(SGeographicUtils::DegreesToRadians(Location.DLatitude));
+        double Best = 1e300;
+        CStreetMap::TWayID BestWay = CStreetMap::InvalidWayID;
+        for(std::size_t Way = 0; Way < Map->WayCount(); Way++){
+            std::vector<CStreetMap::SLocation> Locations;
+            Map->WayLocations(Way, Locations);
+            for(std::size_t Node = 0; Node + 1 < Locations.size(); Node++){
+                double AX = (Locations[Node].DLongitude - Location.DLongitude) * ScaleX, AY = (Locations[Node].DLatitude - Location.DLatitude) * ScaleY;
+                double DX = (Locations[Node + 1].DLongitude - Location.DLongitude) * ScaleX - AX, DY = (Locations[Node + 1].DLatitude - Location.DLatitude) * ScaleY - AY;
+                double T = std::clamp(-(AX * DX + AY * DY) / (DX * DX + DY * DY), 0.0, 1.0);
+                double Distance = std::hypot(AX + T * DX, AY + T * DY);
+                if(Distance < Best){
+                    Best = Distance;
+                    BestWay = Map->WayByIndex(Way)->ID();
+                }
+            }
+        }
+        EXPECT_EQ(Matches[Query].DWayID, BestWay);
+        EXPECT_NEAR(Matches[Query].DDistance, Best, 0.5);
+        EXPECT_EQ(Matches[Query].DWayID, Index.Nearest(Location).DWayID);
+    }
+}
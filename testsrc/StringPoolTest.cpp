@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "StringPool.h"
+
+TEST(StringPoolTest, InternTest){
+    CStringPool Pool;
+    EXPECT_EQ(Pool.Count(), 0);
+
+    auto Highway = Pool.Intern("highway");
+    auto Name = Pool.Intern("name");
+    EXPECT_NE(Highway, Name);
+    EXPECT_EQ(Pool.Intern("highway"), Highway);
+    EXPECT_EQ(Pool.Intern(std::string("na") + "me"), Name);
+    EXPECT_EQ(Pool.Count(), 2);
+
+    EXPECT_EQ(Pool.String(Highway), "highway");
+    EXPECT_EQ(Pool.String(Name), "name");
+    EXPECT_EQ(Pool.Find("name"), Name);
+}
+
+TEST(StringPoolTest, ManyStringsTest){
+    CStringPool Pool;
+    // Enough strings to force the containers to grow several times
+    for(int Index = 0; Index < 10000; Index++){
+        EXPECT_EQ(Pool.Intern(std::to_string(Index)), CStringPool::TStringID(Index));
+    }
+    for(int Index = 0; Index < 10000; Index++){
+        EXPECT_EQ(Pool.Find(std::to_string(Index)), CStringPool::TStringID(Index));
+        EXPECT_EQ(Pool.String(Index), std::to_string(Index));
+    }
+}
+
+TEST(StringPoolTest, ErrorTest){
+    CStringPool Pool;
+    EXPECT_EQ(Pool.Find("missing"), CStringPool::InvalidStringID);
+    EXPECT_EQ(Pool.String(0), "");
+    EXPECT_EQ(Pool.String(CStringPool::InvalidStringID), "");
+
+    auto Empty = Pool.Intern("");
+    EXPECT_EQ(Pool.Find(""), Empty);
+    EXPECT_EQ(Pool.String(Empty), "");
+}
+
+TEST(StringPoolTest, MemoryUsageTest){
+    CStringPool Pool;
+    Pool.Intern("short");
+    auto Before = Pool.MemoryUsage();
+    // Long strings need their own allocation, short ones fit inside the std::string
+    std::string Long(100, 'x');
+    Pool.Intern(Long);
+    auto After = Pool.MemoryUsage();
+    EXPECT_GE(After.DBytes, Before.DBytes + Long.size());
+    EXPECT_GT(After.DAllocations, Before.DAllocations);
+}
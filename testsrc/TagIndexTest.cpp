@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include "TagIndex.h"
+#include "OpenStreetMap.h"
+#include "StringDataSource.h"
+#include <algorithm>
+#include <random>
+
+static const std::string TagTestOSM =   "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                        "   <node id=\"1\" lat=\"38.500\" lon=\"-121.700\">\n"
+                                        "       <tag k=\"highway\" v=\"traffic_signals\"/>\n"
+                                        "   </node>\n"
+                                        "   <node id=\"2\" lat=\"38.500\" lon=\"-121.690\"/>\n"
+                                        "   <node id=\"3\" lat=\"38.510\" lon=\"-121.690\">\n"
+                                        "       <tag k=\"amenity\" v=\"cafe\"/>\n"
+                                        "       <tag k=\"name\" v=\"Corner Cafe\"/>\n"
+                                        "   </node>\n"
+                                        "   <way id=\"100\">\n"
+                                        "       <nd ref=\"1\"/>\n"
+                                        "       <nd ref=\"2\"/>\n"
+                                        "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                        "       <tag k=\"name\" v=\"Main Street\"/>\n"
+                                        "   </way>\n"
+                                        "   <way id=\"200\">\n"
+                                        "       <nd ref=\"2\"/>\n"
+                                        "       <nd ref=\"3\"/>\n"
+                                        "       <tag k=\"highway\" v=\"primary\"/>\n"
+                                        "       <tag k=\"oneway\" v=\"yes\"/>\n"
+                                        "   </way>\n"
+                                        "   <way id=\"300\">\n"
+                                        "       <nd ref=\"1\"/>\n"
+                                        "       <nd ref=\"3\"/>\n"
+                                        "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                        "   </way>\n"
+                                        "   <way id=\"400\">\n"
+                                        "       <nd ref=\"1\"/>\n"
+                                        "       <nd ref=\"3\"/>\n"
+                                        "       <tag k=\"waterway\" v=\"canal\"/>\n"
+                                        "       <tag k=\"name\" v=\"Main Street\"/>\n"
+                                        "   </way>\n"
+                                        "</osm>";
+
+static std::vector<uint32_t> ToVector(std::span<const uint32_t> list){
+    return std::vector<uint32_t>(list.begin(), list.end());
+}
+
+TEST(TagIndexTest, EmptyTest){
+    CTagIndex Index;
+    EXPECT_EQ(Index.KeyCount(), 0);
+    EXPECT_TRUE(Index.Find("highway").empty());
+    EXPECT_TRUE(Index.Find("highway", "primary").empty());
+}
+
+TEST(TagIndexTest, BuildTest){
+    for(auto Decoding : {COpenStreetMap::ETagDecoding::Eager, COpenStreetMap::ETagDecoding::Lazy, COpenStreetMap::ETagDecoding::LazyMemoized}){
+        COpenStreetMap::SOptions Options;
+        Options.DTagDecoding = Decoding;
+        COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(TagTestOSM)), Options);
+        CTagIndex Ways;
+        Ways.Build(Map, CTagIndex::EObjectType::Ways);
+        EXPECT_EQ(Ways.KeyCount(), 4);
+        EXPECT_EQ(ToVector(Ways.Find("highway")), std::vector<uint32_t>({0, 1, 2}));
+        EXPECT_EQ(ToVector(Ways.Find("highway", "residential")), std::vector<uint32_t>({0, 2}));
+        EXPECT_EQ(ToVector(Ways.Find("name", "Main Street")), std::vector<uint32_t>({0, 3}));
+        EXPECT_EQ(ToVector(Ways.Find("oneway")), std::vector<uint32_t>({1}));
+        EXPECT_TRUE(Ways.Find("highway", "motorway").empty());
+        EXPECT_TRUE(Ways.Find("building").empty());
+        //A pair key must not be reachable through the single key lookup
+        EXPECT_TRUE(Ways.Find(std::string("highway\0primary", 15)).empty());
+
+        CTagIndex Nodes;
+        Nodes.Build(Map, CTagIndex::EObjectType::Nodes);
+        EXPECT_EQ(Nodes.KeyCount(), 3);
+        EXPECT_EQ(ToVector(Nodes.Find("amenity", "cafe")), std::vector<uint32_t>({2}));
+        EXPECT_EQ(ToVector(Nodes.Find("highway")), std::vector<uint32_t>({0}));
+    }
+}
+
+TEST(TagIndexTest, UpdateTest){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(TagTestOSM)));
+    CTagIndex Ways;
+    Ways.Build(Map, CTagIndex::EObjectType::Ways);
+    // Way 1 loses its oneway tag and becomes residential, way 4 is added with a new key
+    Ways.Remove(1, {{"highway", "primary"}, {"oneway", "yes"}});
+    Ways.Add(1, {{"highway", "residential"}});
+    Ways.Add(4, {{"building", "yes"}, {"highway", "service"}, {"building", "no"}});
+    EXPECT_EQ(Ways.KeyCount(), 4);
+    EXPECT_EQ(ToVector(Ways.Find("highway", "residential")), std::vector<uint32_t>({0, 1, 2}));
+    EXPECT_EQ(ToVector(Ways.Find("highway")), std::vector<uint32_t>({0, 1, 2, 4}));
+    EXPECT_TRUE(Ways.Find("highway", "primary").empty());
+    EXPECT_TRUE(Ways.Find("oneway").empty());
+    // A repeated key is listed once, under its first value as Build does
+    EXPECT_EQ(ToVector(Ways.Find("building", "yes")), std::vector<uint32_t>({4}));
+    EXPECT_TRUE(Ways.Find("building", "no").empty());
+    // Adding twice lists once, removing tags the object does not have changes nothing
+    Ways.Add(4, {{"highway", "service"}});
+    Ways.Remove(3, {{"highway", "service"}, {"amenity", "cafe"}});
+    EXPECT_EQ(ToVector(Ways.Find("highway", "service")), std::vector<uint32_t>({4}));
+    EXPECT_EQ(ToVector(Ways.Find("name")), std::vector<uint32_t>({0, 3}));
+
+    // Many changes end up where a fresh build of the same tags would
+    std::mt19937 Generator(3);
+    std::vector<TAttributes> Tags(50);
+    CTagIndex Changed;
+    for(int Step = 0; Step < 2000; Step++){
+        auto Object = Generator() % Tags.size();
+        Changed.Remove(Object, Tags[Object]);
+        Tags[Object].clear();
+        for(auto Count = Generator() % 3; Count; Count--){
+            Tags[Object].push_back({"k" + std::to_string(Generator() % 4), "v" + std::to_string(Generator() % 3)});
+        }
+        Changed.Add(Object, Tags[Object]);
+    }
+    CTagIndex Fresh;
+    for(std::size_t Object = 0; Object < Tags.size(); Object++){
+        Fresh.Add(Object, Tags[Object]);
+    }
+    EXPECT_EQ(Changed.KeyCount(), Fresh.KeyCount());
+    for(int Key = 0; Key < 4; Key++){
+        EXPECT_EQ(ToVector(Changed.Find("k" + std::to_string(Key))), ToVector(Fresh.Find("k" + std::to_string(Key))));
+        for(int Value = 0; Value < 3; Value++){
+            EXPECT_EQ(ToVector(Changed.Find("k" + std::to_string(Key), "v" + std::to_string(Value))), ToVector(Fresh.Find("k" + std::to_string(Key), "v" + std::to_string(Value))));
+        }
+    }
+    EXPECT_LT(Changed.MemoryUsage().DBytes, Fresh.MemoryUsage().DBytes * 4);
+}
+
+TEST(TagIndexTest, MapOptionTest){
+    COpenStreetMap::SOptions Options;
+    COpenStreetMap Plain(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(TagTestOSM)), Options);
+    EXPECT_EQ(Plain.WayTagIndex().KeyCount(), 0);
+    EXPECT_EQ(Plain.NodeTagIndex().KeyCount(), 0);
+
+    Options.DBuildTagIndex = true;
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(TagTestOSM)), Options);
+    EXPECT_EQ(ToVector(Map.WayTagIndex().Find("highway", "primary")), std::vector<uint32_t>({1}));
+    EXPECT_EQ(Map.WayByIndex(1)->ID(), 200);
+    EXPECT_EQ(ToVector(Map.NodeTagIndex().Find("name")), std::vector<uint32_t>({2}));
+}
+
+TEST(TagIndexTest, SetOperationTest){
+    std::vector<uint32_t> Result{7};
+    std::vector<uint32_t> Left{1, 3, 5, 7, 9};
+    std::vector<uint32_t> Right{2, 3, 4, 9, 10};
+    EXPECT_EQ(CTagIndex::Intersect(Left, Right, Result), 2);
+    EXPECT_EQ(Result, std::vector<uint32_t>({3, 9}));
+    EXPECT_EQ(CTagIndex::Union(Left, Right, Result), 8);
+    EXPECT_EQ(Result, std::vector<uint32_t>({1, 2, 3, 4, 5, 7, 9, 10}));
+    EXPECT_EQ(CTagIndex::Intersect(Left, {}, Result), 0);
+    EXPECT_TRUE(Result.empty());
+    EXPECT_EQ(CTagIndex::Union({}, Right, Result), 5);
+    EXPECT_EQ(Result, Right);
+}
+
+TEST(TagIndexTest, GallopTest){
+    //Short lists against a long one take the galloping path, compare with std::set_intersection
+    std::mt19937 Generator(7);
+    std::vector<uint32_t> Long;
+    for(uint32_t Value = 0; Value < 100000; Value++){
+        if(Generator() % 3 == 0){
+            Long.push_back(Value);
+        }
+    }
+    for(std::size_t Size : {1, 2, 10, 100, 1000}){
+        std::vector<uint32_t> Short;
+        for(std::size_t Index = 0; Index < Size; Index++){
+            Short.push_back(Generator() % 100005);
+        }
+        std::sort(Short.begin(), Short.end());
+        Short.erase(std::unique(Short.begin(), Short.end()), Short.end());
+        std::vector<uint32_t> Expected, Result;
+        std::set_intersection(Short.begin(), Short.end(), Long.begin(), Long.end(), std::back_inserter(Expected));
+        EXPECT_EQ(CTagIndex::Intersect(Short, Long, Result), Expected.size());
+        EXPECT_EQ(Result, Expected);
+        EXPECT_EQ(CTagIndex::Intersect(Long, Short, Result), Expected.size());
+        EXPECT_EQ(Result, Expected);
+    }
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "VersionHolder.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//Counts live instances so tests can see when a version is freed
+struct SCounted{
+    inline static std::atomic<int> DLive{0};
+    int DValue;
+    int DCopy;
+
+    SCounted(int value) : DValue(value), DCopy(value){
+        DLive++;
+    }
+    ~SCounted(){
+        DCopy = -1;
+        DLive--;
+    }
+};
+
+TEST(VersionHolderTest, EmptyTest){
+    CVersionHolder<SCounted> Holder(4);
+    EXPECT_EQ(Holder.SlotCount(), 4);
+    EXPECT_EQ(Holder.Version(), 0);
+    auto Guard = Holder.Acquire();
+    EXPECT_FALSE(Guard);
+    EXPECT_EQ(Guard.Get(), nullptr);
+    EXPECT_EQ(Guard.Version(), 0);
+    EXPECT_EQ(Holder.Reclaim(), 0);
+}
+
+TEST(VersionHolderTest, PublishTest){
+    {
+        CVersionHolder<SCounted> Holder(4);
+        EXPECT_EQ(Holder.Publish(std::make_shared<SCounted>(1)), 1);
+        auto First = Holder.Acquire();
+        ASSERT_TRUE(First);
+        EXPECT_EQ(First->DValue, 1);
+        EXPECT_EQ(First.Version(), 1);
+
+        //The reader keeps its version after a newer one is published
+        EXPECT_EQ(Holder.Publish(std::make_shared<SCounted>(2)), 2);
+        EXPECT_EQ(Holder.Version(), 2);
+        EXPECT_EQ((*First).DValue, 1);
+        EXPECT_EQ(SCounted::DLive, 2);
+        EXPECT_EQ(Holder.Reclaim(), 1);
+
+        auto Second = Holder.Acquire();
+        EXPECT_EQ(Second->DValue, 2);
+        //Moving a guard moves the pin with it
+        auto Moved = std::move(First);
+        EXPECT_FALSE(First);
+        EXPECT_EQ(Moved->DValue, 1);
+        EXPECT_EQ(Holder.Reclaim(), 1);
+        Moved = CVersionHolder<SCounted>::CReadGuard();
+        EXPECT_EQ(Holder.Reclaim(), 0);
+        EXPECT_EQ(SCounted::DLive, 1);
+
+        //Versions no reader took are freed by the publish that replaces them
+        Holder.Publish(std::make_shared<SCounted>(3));
+        EXPECT_EQ(SCounted::DLive, 2);
+        Second = CVersionHolder<SCounted>::CReadGuard();
+        Holder.Publish(std::make_shared<SCounted>(4));
+        EXPECT_EQ(SCounted::DLive, 1);
+    }
+    EXPECT_EQ(SCounted::DLive, 0);
+}
+
+TEST(VersionHolderTest, SlotsTest){
+    //More guards than slots are fine as long as some are released
+    CVersionHolder<SCounted> Holder(2);
+    Holder.Publish(std::make_shared<SCounted>(5));
+    std::vector<CVersionHolder<SCounted>::CReadGuard> Guards;
+    Guards.push_back(Holder.Acquire());
+    Guards.push_back(Holder.Acquire());
+    std::thread Releaser([&]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Guards.front() = CVersionHolder<SCounted>::CReadGuard();
+    });
+    auto Third = Holder.Acquire();
+    Releaser.join();
+    EXPECT_EQ(Third->DValue, 5);
+}
+
+TEST(VersionHolderTest, ConcurrentTest){
+    CVersionHolder<SCounted> Holder(8);
+    Holder.Publish(std::make_shared<SCounted>(0));
+    std::atomic<bool> Done{false};
+    std::atomic<int> Errors{0};
+    std::vector<std::thread> Readers;
+    for(int Reader = 0; Reader < 4; Reader++){
+        Readers.emplace_back([&]{
+            uint64_t LastVersion = 0;
+            while(!Done.load()){
+                auto Guard = Holder.Acquire();
+                //A freed version would show DCopy as -1, and versions never go backwards for one reader
+                if((Guard->DCopy != Guard->DValue)||(Guard.Version() < LastVersion)){
+                    Errors++;
+                }
+                LastVersion = Guard.Version();
+            }
+        });
+    }
+    for(int Version = 1; Version <= 300; Version++){
+        Holder.Publish(std::make_shared<SCounted>(Version));
+    }
+    Done = true;
+    for(auto &Reader : Readers){
+        Reader.join();
+    }
+    EXPECT_EQ(Errors, 0);
+    EXPECT_EQ(Holder.Reclaim(), 0);
+    EXPECT_EQ(SCounted::DLive, 1);
+    EXPECT_EQ(Holder.Acquire()->DValue, 300);
+}
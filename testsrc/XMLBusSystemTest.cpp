@@ -278,4 +278,56 @@ TEST(XMLBusSystemTest, InvalidIDIndexTest){
     EXPECT_EQ(BusSystem.RouteByName("XYZ"), nullptr);
     EXPECT_EQ(BusSystem.StopByID(789), nullptr);
     EXPECT_EQ(BusSystem.PathByStopIDs(789,456), nullptr);
-}
\ No newline at end of file
+}
+
+TEST(XMLBusSystemTest, StopNodeIDsByIDTest){
+    auto BusRouteSource = std::make_shared<CStringDataSource>(  "<bussystem>\n"
+                                                                "<stops>\n"
+                                                                "   <stop id=\"1\" node=\"321\" description=\"First\"/>\n"
+                                                                "   <stop id=\"22\" node=\"311\" description=\"second\"/>\n"
+                                                                "   <stop id=\"5\" node=\"300\" description=\"Third\"/>\n"
+                                                                "</stops>\n"
+                                                                "</bussystem>");
+    auto BusPathSource = std::make_shared<CStringDataSource>("<paths>\n</paths>");
+    CXMLBusSystem BusSystem(std::make_shared< CXMLReader >(BusRouteSource), std::make_shared< CXMLReader >(BusPathSource));
+    std::vector<CBusSystem::TStopID> StopIDs{5, 2, 1, 22, 5};
+    std::vector<CStreetMap::TNodeID> NodeIDs;
+    EXPECT_EQ(BusSystem.StopNodeIDsByID(StopIDs, NodeIDs), 4);
+    EXPECT_EQ(NodeIDs, std::vector<CStreetMap::TNodeID>({300, CStreetMap::InvalidNodeID, 321, 311, 300}));
+    //The base class version must agree
+    std::vector<CStreetMap::TNodeID> Expected;
+    EXPECT_EQ(BusSystem.CBusSystem::StopNodeIDsByID(StopIDs, Expected), 4);
+    EXPECT_EQ(Expected, NodeIDs);
+    EXPECT_EQ(BusSystem.StopNodeIDsByID({}, NodeIDs), 0);
+    EXPECT_TRUE(NodeIDs.empty());
+}
+
+TEST(XMLBusSystemTest, MemoryUsageTest){
+    auto BusRouteSource = std::make_shared<CStringDataSource>(  "<bussystem>\n"
+                                                                "<stops>\n"
+                                                                "   <stop id=\"1\" node=\"321\" description=\"A description long enough to leave the string\"/>\n"
+                                                                "   <stop id=\"2\" node=\"311\" description=\"Second\"/>\n"
+                                                                "</stops>\n"
+                                                                "<routes>\n"
+                                                                "   <route name=\"A\">\n"
+                                                                "       <routestop stop=\"1\"/>\n"
+                                                                "       <routestop stop=\"2\"/>\n"
+                                                                "   </route>\n"
+                                                                "</routes>\n"
+                                                                "</bussystem>");
+    auto BusPathSource = std::make_shared<CStringDataSource>(   "<paths>\n"
+                                                                "   <path source=\"1\" destination=\"2\">\n"
+                                                                "       <node id=\"321\"/>\n"
+                                                                "       <node id=\"315\"/>\n"
+                                                                "       <node id=\"311\"/>\n"
+                                                                "   </path>\n"
+                                                                "</paths>");
+    CXMLBusSystem BusSystem(std::make_shared< CXMLReader >(BusRouteSource), std::make_shared< CXMLReader >(BusPathSource));
+    auto Report = BusSystem.MemoryUsage();
+    EXPECT_GT(Report.DStops, 2 * sizeof(CBusSystem::SStop));
+    EXPECT_GT(Report.DStopIndexes, 0);
+    EXPECT_GT(Report.DRoutes, sizeof(CBusSystem::SRoute) + 2 * sizeof(CBusSystem::TStopID));
+    EXPECT_GT(Report.DPaths, sizeof(CBusSystem::SPath) + 3 * sizeof(CStreetMap::TNodeID));
+    EXPECT_GT(Report.DAllocatorOverhead, 0);
+    EXPECT_EQ(Report.Total(), Report.DStops + Report.DStopIndexes + Report.DRoutes + Report.DPaths + Report.DAllocatorOverhead);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "XMLQuery.h"
+#include "StringDataSource.h"
+
+static const std::string QueryTestOSM =     "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">\n"
+                                            "   <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+                                            "   <node id=\"2\" lat=\"38.5\" lon=\"-121.8\">\n"
+                                            "       <tag k=\"highway\" v=\"turning_circle\"/>\n"
+                                            "   </node>\n"
+                                            "   <way id=\"8700118\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <tag k=\"highway\" v=\"motorway_link\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"8701218\">\n"
+                                            "       <nd ref=\"2\"/>\n"
+                                            "       <tag k=\"bridge\" v=\"yes\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "   <way id=\"8706922\">\n"
+                                            "       <nd ref=\"1\"/>\n"
+                                            "       <tag k=\"highway\" v=\"residential\"/>\n"
+                                            "   </way>\n"
+                                            "</osm>";
+
+static std::vector<std::string> QueryIDs(const std::string &xml, const std::string &expression){
+    auto Source = std::make_shared<CStringDataSource>(xml);
+    auto Reader = std::make_shared<CXMLReader>(Source);
+    CXMLQuery Query(Reader, expression);
+    std::vector<std::string> IDs;
+    SXMLEntity Entity;
+    while(Query.ReadMatch(Entity)){
+        IDs.push_back(Entity.AttributeValue("id"));
+    }
+    return IDs;
+}
+
+TEST(XMLQueryTest, PathTest){
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "/osm/node"), std::vector<std::string>({"1","2"}));
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "//way"), std::vector<std::string>({"8700118","8701218","8706922"}));
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "/osm/*[@id='2']"), std::vector<std::string>({"2"}));
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "/way").size(), 0);
+}
+
+TEST(XMLQueryTest, ChildPredicateTest){
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "//way[tag[@k='highway'][@v='residential']]"), std::vector<std::string>({"8701218","8706922"}));
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "//way[tag[@k='bridge']][tag[@v='residential']]"), std::vector<std::string>({"8701218"}));
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "//*[tag[@k='highway'][@v~='turn']]"), std::vector<std::string>({"2"}));
+    EXPECT_EQ(QueryIDs(QueryTestOSM, "//way[@id!='8700118'][nd[@ref='1']]"), std::vector<std::string>({"8706922"}));
+}
+
+TEST(XMLQueryTest, NestedOrderTest){
+    std::string XML =   "<root>\n"
+                        "   <group id=\"1\">\n"
+                        "       <group id=\"2\">\n"
+                        "           <group id=\"3\">\n"
+                        "               <tag k=\"keep\"/>\n"
+                        "           </group>\n"
+                        "       </group>\n"
+                        "       <group id=\"4\">\n"
+                        "           <tag k=\"keep\"/>\n"
+                        "       </group>\n"
+                        "       <tag k=\"keep\"/>\n"
+                        "   </group>\n"
+                        "   <group id=\"5\">\n"
+                        "       <tag k=\"keep\"/>\n"
+                        "   </group>\n"
+                        "</root>";
+    // Inner groups close first but come back after the groups enclosing them, 2 has no tag of its own
+    EXPECT_EQ(QueryIDs(XML, "//group[tag[@k='keep']]"), std::vector<std::string>({"1","3","4","5"}));
+    EXPECT_EQ(QueryIDs(XML, "//group"), std::vector<std::string>({"1","2","3","4","5"}));
+}
+
+TEST(XMLQueryTest, AttributeTest){
+    std::string XML =   "<bussystem>\n"
+                        "   <stops>\n"
+                        "       <stop id=\"1\" node=\"10\" description=\"Silo Terminal\"/>\n"
+                        "       <stop id=\"2\" node=\"20\"/>\n"
+                        "       <stop id=\"3\" node=\"30\" description=\"MU Terminal\"/>\n"
+                        "   </stops>\n"
+                        "</bussystem>";
+    EXPECT_EQ(QueryIDs(XML, "//stop[@description~='Terminal']"), std::vector<std::string>({"1","3"}));
+    EXPECT_EQ(QueryIDs(XML, "/bussystem/stops/stop[@description]"), std::vector<std::string>({"1","3"}));
+    EXPECT_EQ(QueryIDs(XML, "//stop[@node=\"20\"]"), std::vector<std::string>({"2"}));
+}
+
+TEST(XMLQueryTest, ErrorTest){
+    auto Source = std::make_shared<CStringDataSource>(QueryTestOSM);
+    auto Reader = std::make_shared<CXMLReader>(Source);
+    SXMLEntity Entity;
+
+    CXMLQuery Missing(Reader, "way");
+    EXPECT_FALSE(Missing.Valid());
+    EXPECT_FALSE(Missing.ReadMatch(Entity));
+
+    EXPECT_FALSE(CXMLQuery(Reader, "").Valid());
+    EXPECT_FALSE(CXMLQuery(Reader, "//way[@k='highway'").Valid());
+    EXPECT_FALSE(CXMLQuery(Reader, "//way[@k=highway]").Valid());
+    EXPECT_FALSE(CXMLQuery(Reader, "//way[tag]/nd").Valid());
+
+    CXMLQuery Query(Reader, "//node");
+    EXPECT_TRUE(Query.Valid());
+    EXPECT_TRUE(Query.ReadMatch(Entity));
+    EXPECT_TRUE(Query.ReadMatch(Entity));
+    EXPECT_FALSE(Query.ReadMatch(Entity));
+    EXPECT_TRUE(Query.End());
+}
@@ -245,3 +245,31 @@ TEST(XMLReaderTest, LongCharDataCrosses512Boundary){
 
     EXPECT_TRUE(reader.End());
 }
+
+// Checking that skipping CharData keeps reading when a whole 512 chunk is only text
+TEST(XMLReaderTest, SkipCharDataAcross512Boundary){
+    std::string longText(1024, ' '); // Two full buffers of nothing but whitespace
+
+    std::string XML = "<person>" + longText + "<name/></person>";
+
+    std::shared_ptr<CStringDataSource> source = std::make_shared<CStringDataSource>(XML);
+    CXMLReader reader(source);
+
+    SXMLEntity entity;
+
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DNameData, "person");
+
+    // Should skip past all the whitespace instead of stopping early
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::StartElement);
+    EXPECT_EQ(entity.DNameData, "name");
+
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::EndElement);
+    EXPECT_EQ(entity.DNameData, "person");
+
+    EXPECT_FALSE(reader.ReadEntity(entity, true));
+    EXPECT_TRUE(reader.End());
+}